@@ -30,7 +30,29 @@ SOURCES += \
     src/tablewidget.cpp \
     src/predictionmodel.cpp \
     src/qcustomplot.cpp \
-    src/chartwidget.cpp
+    src/chartwidget.cpp \
+    src/csvtokenizer.cpp \
+    src/stringdictionary.cpp \
+    src/flowstore.cpp \
+    src/flowsnapshot.cpp \
+    src/datetimeparser.cpp \
+    src/csvschema.cpp \
+    src/flowpartitions.cpp \
+    src/routegraph.cpp \
+    src/flowaggregates.cpp \
+    src/flowdatabase.cpp \
+    src/flowblockfile.cpp \
+    src/flowblockpool.cpp \
+    src/compressedreader.cpp \
+    src/perfecthash.cpp \
+    src/flowvalidation.cpp \
+    src/flowdeduplicator.cpp \
+    src/flowcoldsource.cpp \
+    src/flowcolumnfile.cpp \
+    src/flowindex.cpp \
+    src/flowbitmap.cpp \
+    src/flowcube.cpp \
+    src/analysiscache.cpp
 
 # 头文件
 HEADERS += \
@@ -43,11 +65,46 @@ HEADERS += \
     include/tablewidget.h \
     include/predictionmodel.h \
     include/qcustomplot.h \
-    include/chartwidget.h
+    include/chartwidget.h \
+    include/csvtokenizer.h \
+    include/stringdictionary.h \
+    include/flowstore.h \
+    include/flowsnapshot.h \
+    include/datetimeparser.h \
+    include/loadrecords.h \
+    include/csvschema.h \
+    include/flowpartitions.h \
+    include/routegraph.h \
+    include/flowaggregates.h \
+    include/flowdatabase.h \
+    include/flowblockfile.h \
+    include/flowblockpool.h \
+    include/compressedreader.h \
+    include/perfecthash.h \
+    include/entityarena.h \
+    include/flowvalidation.h \
+    include/flowdeduplicator.h \
+    include/flowcoldsource.h \
+    include/flowcolumnfile.h \
+    include/flowindex.h \
+    include/flowbitmap.h \
+    include/flowcube.h \
+    include/analysiscache.h
 
 # 包含路径
 INCLUDEPATH += include
 
+# 可选的压缩输入支持（.csv.gz / .csv.zst），需要pkg-config能找到对应的库
+CONFIG += link_pkgconfig
+packagesExist(zlib) {
+    PKGCONFIG += zlib
+    DEFINES += HAVE_ZLIB
+}
+packagesExist(libzstd) {
+    PKGCONFIG += libzstd
+    DEFINES += HAVE_ZSTD
+}
+
 # 数据文件
 DISTFILES += \
     客运站点（站点名称、站点编号、备注）.csv \
@@ -0,0 +1,141 @@
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QPair>
+#include <QDate>
+#include <QSharedPointer>
+#include <QDebug>
+
+// 分析结果缓存：键是查询签名（方法名加各参数），值是计算结果的副本。
+// 缓存属于一个数据代号（DataManager::dataGeneration），代号变化时整体失效；
+// 总字节数（按结果内容估算）超出预算时淘汰最久未用的结果。只在所在线程使用。
+class AnalysisCache
+{
+public:
+    static const qint64 DefaultBudget = qint64(64) * 1024 * 1024;
+
+    explicit AnalysisCache(qint64 budget = DefaultBudget) : m_budget(budget) {}
+
+    // 方法名和各参数依次拼成签名，参数之间用不会出现在名称中的分隔符隔开
+    template<typename... Args>
+    static QString signature(const char *method, const Args &...args)
+    {
+        QStringList parts;
+        parts.append(QString::fromLatin1(method));
+        (parts.append(part(args)), ...);
+        return parts.join(QChar(0x1f));
+    }
+
+    // 命中时返回缓存的结果，否则调用compute计算并放入缓存。
+    // compute中可以再调用其他经过缓存的方法
+    template<typename T, typename Compute>
+    T get(const QString &signature, quint64 generation, Compute compute);
+
+    // 在compute中调用：本次结果不完整（如核外块读取失败）。正在计算的各层结果都不放入缓存，
+    // get返回空结果，下次调用重新计算
+    void markIncomplete() { ++m_incomplete; }
+
+    void clear();
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return m_budget; }
+    qint64 bytes() const { return m_bytes; }
+    int size() const { return m_entries.size(); }
+    qint64 hits() const { return m_hits; }
+    qint64 misses() const { return m_misses; }
+    qint64 evictions() const { return m_evictions; }
+
+private:
+    struct Holder {
+        virtual ~Holder() {}
+    };
+    template<typename T>
+    struct Value : Holder {
+        explicit Value(const T &result) : value(result) {}
+        T value;
+    };
+    struct Entry {
+        QSharedPointer<Holder> value;
+        qint64 bytes = 0;
+        quint64 lastUsed = 0;
+    };
+
+    static QString part(const QString &value) { return value; }
+    static QString part(const QDate &value) { return value.toString(Qt::ISODate); }
+    static QString part(int value) { return QString::number(value); }
+    static QString part(double value) { return QString::number(value, 'g', 17); }
+
+    // 结果占用的字节数估算：容器按元素累加，其他类型按sizeof
+    template<typename T>
+    static qint64 cost(const T &) { return sizeof(T); }
+    static qint64 cost(const QString &value) { return sizeof(QString) + qint64(value.size()) * sizeof(QChar); }
+    template<typename A, typename B>
+    static qint64 cost(const QPair<A, B> &value) { return cost(value.first) + cost(value.second); }
+    template<typename T>
+    static qint64 cost(const QVector<T> &value)
+    {
+        qint64 bytes = sizeof(QVector<T>);
+        for (const T &item : value) {
+            bytes += cost(item);
+        }
+        return bytes;
+    }
+    template<typename K, typename V>
+    static qint64 cost(const QMap<K, V> &value)
+    {
+        // 每个节点另有约三个指针的开销
+        qint64 bytes = sizeof(QMap<K, V>);
+        for (auto it = value.constBegin(); it != value.constEnd(); ++it) {
+            bytes += cost(it.key()) + cost(it.value()) + 3 * sizeof(void*);
+        }
+        return bytes;
+    }
+
+    void insert(const QString &signature, const QSharedPointer<Holder> &value, qint64 bytes);
+    void evict();
+
+    qint64 m_budget;
+    quint64 m_generation = 0;
+    QHash<QString, Entry> m_entries;
+    qint64 m_bytes = 0;
+    quint64 m_clock = 0;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+    qint64 m_evictions = 0;
+    quint64 m_incomplete = 0;
+};
+
+template<typename T, typename Compute>
+T AnalysisCache::get(const QString &signature, quint64 generation, Compute compute)
+{
+    if (generation != m_generation) {
+        if (!m_entries.isEmpty()) {
+            qDebug() << "数据已变化，分析结果缓存失效：" << m_entries.size() << "项";
+        }
+        clear();
+        m_generation = generation;
+    }
+
+    auto it = m_entries.find(signature);
+    if (it != m_entries.end()) {
+        ++m_hits;
+        it->lastUsed = ++m_clock;
+        return static_cast<const Value<T>*>(it->value.data())->value;
+    }
+
+    ++m_misses;
+    const quint64 incomplete = m_incomplete;
+    T result = compute();
+    if (m_incomplete != incomplete) {
+        qDebug() << "分析结果不完整，不放入缓存：" << signature.section(QChar(0x1f), 0, 0);
+        return T();
+    }
+    insert(signature, QSharedPointer<Holder>(new Value<T>(result)), cost(result) + cost(signature));
+    return result;
+}
+
+#endif // ANALYSISCACHE_H
@@ -6,6 +6,7 @@
 #include <QMap>
 #include <QPair>
 #include "datamanager.h"
+#include "analysiscache.h"
 
 class AnalysisEngine : public QObject
 {
@@ -93,15 +94,55 @@ public:
 
 public:
     // Helper methods
-    QVector<PassengerFlow*> getFilteredData() const;
+    FlowView getFilteredData() const;
+
+    // 数据代号，缓存的分析结果按它失效
+    quint64 dataGeneration() const { return m_dataManager->dataGeneration(); }
+    // 本对象和PredictionModel共用的结果缓存
+    AnalysisCache &resultCache() const { return m_cache; }
 
 private:
     DataManager *m_dataManager;
+    mutable AnalysisCache m_cache;
     
     // Helper methods
     double calculateCorrelation(const QVector<int> &x, const QVector<int> &y) const;
-    QMap<int, int> aggregateByHour(const QVector<PassengerFlow*> &data) const;
-    QMap<int, int> aggregateByDay(const QVector<PassengerFlow*> &data) const;
+    QMap<int, int> aggregateByHour(const FlowView &data) const;
+    QMap<int, int> aggregateByDay(const FlowView &data) const;
+
+    // 数据库模式下按日期范围的统计下推成SQL聚合；查询没有结果时调用方照常走内存路径（得到模拟数据）
+    QVector<int> targetStationIds() const;
+    // 内存路径按站点名称筛选的目标站点，与逐行比较名称等价，用于位图和倒排索引查询
+    QVector<int> namedTargetStationIds() const;
+    // 按儒略日累加的汇总转成按日期排序的时间序列，数据库和扫描路径共用
+    QVector<TimeSeriesData> toTimeSeries(const QMap<int, FlowDatabase::Totals> &daily) const;
+    // 经DataManager扫描客流；核外块读取失败时标记结果不完整，由结果缓存丢弃整个结果
+    bool scanFlows(const DataManager::FlowVisitor &visit) const;
+    bool scanFlows(const QDate &startDate, const QDate &endDate, const DataManager::FlowVisitor &visit) const;
+
+    // 各公开分析方法的实际计算；公开方法先查结果缓存，未命中时调用这里
+    QVector<StationStatistics> computeStationStatistics() const;
+    QVector<TrainStatistics> computeTrainStatistics() const;
+    QVector<TimeSeriesData> computeTimeSeriesData(const QDate &startDate, const QDate &endDate) const;
+    QVector<QPair<QString, QString>> computeStationCorrelations() const;
+    QVector<QPair<QString, QString>> computeTrainCorrelations() const;
+    QMap<QString, double> computeStationRevenueAnalysis() const;
+    QMap<QString, double> computeTrainRevenueAnalysis() const;
+    double computeAverageTicketPrice() const;
+    QMap<QString, double> computeStationFlowByDateRange(const QDate &startDate, const QDate &endDate) const;
+    QMap<QString, double> computeTrainFlowByDateRange(const QDate &startDate, const QDate &endDate) const;
+    QVector<TimeSeriesData> computeTotalPassengerFlowTimeSeries(const QDate &startDate, const QDate &endDate) const;
+    QVector<TimeSeriesData> computePassengerFlowTimeSeriesByStation(const QString &stationName, const QDate &startDate, const QDate &endDate) const;
+    QVector<TimeSeriesData> computePassengerFlowTimeSeriesByTrain(const QString &trainNumber, const QDate &startDate, const QDate &endDate) const;
+    QVector<QPointF> computeFlowAndTrainCountCorrelation(const QDate &startDate, const QDate &endDate) const;
+    QVector<QPair<QString, double>> computeStationEfficiency() const;
+    QVector<QPair<QString, double>> computeTrainEfficiency() const;
+    QMap<QString, QMap<int, int>> computeStationHourlyPatterns() const;
+    QMap<QString, QMap<int, int>> computeStationDailyPatterns() const;
+    QString computeAnalysisSummary() const;
+    QVector<TicketTypeAnalysis> computeTicketTypeAnalysis(const QDate &startDate, const QDate &endDate) const;
+    QMap<double, int> computeTicketPriceDistribution() const;
+    QMap<QString, QMap<double, int>> computeTicketTypeAndPriceAnalysis() const;
 };
 
 #endif // ANALYSISENGINE_H
\ No newline at end of file
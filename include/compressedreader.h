@@ -0,0 +1,69 @@
+#ifndef COMPRESSEDREADER_H
+#define COMPRESSEDREADER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+
+// 客流文件的顺序读取：普通CSV直接读文件；.csv.gz和.csv.zst在后台线程中流式解压，
+// 解出的数据经有界队列交给解析方，解压和解析同时进行，不在磁盘上生成解压后的文件。
+// 编译时没有对应的库（HAVE_ZLIB / HAVE_ZSTD）时，打开压缩文件会返回错误。
+// 只能在一个线程中读取。
+class CompressedReader
+{
+public:
+    enum Codec { Plain, Gzip, Zstd };
+
+    // 按文件开头的魔数判断格式，读不到魔数时按扩展名
+    static Codec codecFor(const QString &path);
+    static bool isSupported(Codec codec);
+    static QString codecName(Codec codec);
+
+    // 解压后的大小，只用于进度显示：普通文件即文件大小；gzip取尾部记录的长度（按4GB取模），
+    // zstd取帧头记录的内容长度，没有记录时按压缩比估计
+    static qint64 expectedSize(const QString &path);
+
+    explicit CompressedReader(const QString &path);
+    ~CompressedReader();
+
+    bool open(QString *error);
+    Codec codec() const { return m_codec; }
+
+    // 读出至多maxBytes字节解压后的数据，解压线程还没跟上时等待
+    QByteArray read(qint64 maxBytes);
+    bool atEnd() const;
+    // 读或解压出错时非空；出错后atEnd()为true
+    QString errorString() const;
+
+private:
+    // 队列中最多积压的解压块数和每块的大小，限制解压线程领先解析方的内存
+    static const int QueueDepth = 4;
+    static const qint64 OutputChunkBytes = 4 * 1024 * 1024;
+    static const qint64 InputChunkBytes = 1024 * 1024;
+
+    void decompress();
+    bool decompressGzip(QString *error);
+    bool decompressZstd(QString *error);
+    // 解压线程交出一块数据；读取方已放弃时返回false
+    bool push(QByteArray chunk);
+
+    QString m_path;
+    Codec m_codec;
+    QFile m_file;
+    QThread *m_thread;
+    QByteArray m_front;     // 上次读剩的部分
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<QByteArray> m_queue;
+    bool m_finished;        // 解压线程已交出全部数据或出错
+    bool m_stopRequested;   // 读取方已析构
+    QString m_error;
+};
+
+#endif // COMPRESSEDREADER_H
@@ -0,0 +1,59 @@
+#ifndef CSVSCHEMA_H
+#define CSVSCHEMA_H
+
+#include <QByteArrayView>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class CsvProjection;
+
+// CSV列描述：每个逻辑列给出可能的表头名称（不区分大小写）和表头中找不到时使用的默认列号。
+// 每个文件按表头解析一次得到CsvProjection，逐行解析时只按列号取字段，不再查找名称。
+class CsvSchema
+{
+public:
+    explicit CsvSchema(const QString &name) : m_name(name) {}
+
+    // key为调用方定义的枚举值，须从0开始连续编号
+    CsvSchema &column(int key, const QStringList &headerNames, int defaultIndex);
+
+    CsvProjection resolve(QByteArrayView headerLine) const;
+    const QString &name() const { return m_name; }
+
+private:
+    struct Column {
+        QStringList headerNames;
+        int defaultIndex = -1;
+    };
+
+    QString m_name;
+    QVector<Column> m_columns;
+};
+
+// 解析后的列映射
+class CsvProjection
+{
+public:
+    int index(int key) const { return m_indices[key]; }
+
+    // 每行至少需要的字段数（用到的最大列号+1），也是切分行时的上限
+    int fieldCount() const { return m_fieldCount; }
+
+    // 有列没有在表头中找到、退回默认列号时为true
+    bool usedDefaults() const { return !m_missing.isEmpty(); }
+    const QStringList &missingColumns() const { return m_missing; }
+
+    // 用于日志，如 "zdid→0, zdmc→7"
+    QString describe() const;
+
+private:
+    friend class CsvSchema;
+
+    QVector<int> m_indices;
+    QStringList m_names;
+    QStringList m_missing;
+    int m_fieldCount = 0;
+};
+
+#endif // CSVSCHEMA_H
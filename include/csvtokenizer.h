@@ -0,0 +1,42 @@
+#ifndef CSVTOKENIZER_H
+#define CSVTOKENIZER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QVarLengthArray>
+
+// 在UTF-8字节上原地切分CSV，字段以QByteArrayView返回，不为每行分配内存。
+// 与原来的 QString::split(",") 语义一致：不处理引号，行尾的\r会被去掉。
+class CsvTokenizer
+{
+public:
+    typedef QVarLengthArray<QByteArrayView, 64> Fields;
+
+    CsvTokenizer(const char *begin, const char *end);
+
+    bool atEnd() const { return m_pos >= m_end; }
+    qint64 position() const { return m_pos - m_begin; }
+
+    // 跳过一行（用于表头）
+    void skipLine();
+
+    // 读取下一行的前maxFields个字段，返回实际取到的字段数。
+    // 字段数超过maxFields时只切分到第maxFields个，其余部分直接跳到行尾。
+    int nextRow(Fields &fields, int maxFields);
+
+    // 当前行原文（不含换行符），用于日志
+    QByteArrayView lastLine() const { return m_lastLine; }
+
+    // 字段转换：不分配内存
+    static QByteArrayView trimmed(QByteArrayView field);
+    static int toInt(QByteArrayView field);
+    static double toDouble(QByteArrayView field);
+
+private:
+    const char *m_begin;
+    const char *m_end;
+    const char *m_pos;
+    QByteArrayView m_lastLine;
+};
+
+#endif // CSVTOKENIZER_H
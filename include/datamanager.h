@@ -4,10 +4,42 @@
 #include <QObject>
 #include <QVector>
 #include <QMap>
+#include <QHash>
 #include <QString>
+#include <QByteArrayView>
+#include <QPair>
+#include <QDate>
+#include <QTime>
+#include <QStringList>
+#include <QThread>
+#include <QPointer>
+#include <QTimer>
+#include <QAtomicInteger>
+#include <QSharedPointer>
+#include <QBitArray>
+#include <functional>
 #include "station.h"
 #include "train.h"
 #include "passengerflow.h"
+#include "flowstore.h"
+#include "datetimeparser.h"
+#include "loadrecords.h"
+#include "csvschema.h"
+#include "flowpartitions.h"
+#include "routegraph.h"
+#include "flowaggregates.h"
+#include "flowdatabase.h"
+#include "flowblockpool.h"
+#include "perfecthash.h"
+#include "entityarena.h"
+#include "flowvalidation.h"
+#include "flowdeduplicator.h"
+#include "flowindex.h"
+#include "flowbitmap.h"
+#include "flowcube.h"
+
+class QFileSystemWatcher;
+class QThreadPool;
 
 class DataManager : public QObject
 {
@@ -15,6 +47,7 @@ class DataManager : public QObject
 
 public:
     explicit DataManager(QObject *parent = nullptr);
+    ~DataManager();
     
     // Data loading
     bool loadStations(const QString &filename);
@@ -24,13 +57,116 @@ public:
     bool isDataLoaded() const;
     bool loadDataFromDirectory(const QString &path);
 
+    // 后台加载：三个文件同时读取，先发出stationsAndTrainsLoaded，客流就绪后再发出dataLoaded；
+    // 过程中定期发出progress，可随时cancelLoading
+    void loadDataFromDirectoryAsync(const QString &path);
+    void cancelLoading();
+    bool isLoading() const { return m_loading; }
+
+    // 大文件按换行切块在所有核上并行解析，结果与单线程完全相同（默认开启）
+    void setParallelLoadingEnabled(bool enabled);
+    bool isParallelLoadingEnabled() const { return m_parallelLoading; }
+
+    // 加载成功后写二进制快照，下次从同一目录加载时若源文件未变则直接读快照（默认开启）
+    void setSnapshotCacheEnabled(bool enabled);
+    bool isSnapshotCacheEnabled() const { return m_snapshotCache; }
+
+    // 单个未压缩客流文件只解析常用的热列，线路、到达时间、票价和起终点站记下行偏移，
+    // 第一次被访问时再并行解码（默认开启）。分区、压缩文件和核外模式仍整行解析
+    void setLazyColumnsEnabled(bool enabled);
+    bool isLazyColumnsEnabled() const { return m_lazyColumns; }
+
+    // 分区数据集：目录中没有单个客流文件时，递归查找 高铁客运量*.csv（如每月一个文件），
+    // 只加载与日期窗口相交的分区，各分区并行解析。已加载的分区留在内存中，
+    // 总占用超出预算时淘汰窗口外最久未用的分区。分区模式不使用快照。
+    bool isPartitioned() const { return m_partitioned; }
+    const QVector<FlowPartition> &getPartitions() const { return m_partitions; }
+    void setPartitionMemoryBudget(qint64 bytes);
+    qint64 partitionMemoryBudget() const { return m_partitionBudget; }
+
+    // 设置查询日期窗口（无效日期表示不限）。分区模式下窗口需要尚未加载的分区时在后台加载并返回true，
+    // 完成后发出partitionsLoaded；否则立即切换getFlows()的内容并返回false
+    bool setDateWindow(const QDate &startDate, const QDate &endDate);
+
+    // 追加模式：监视客流文件，文件增长时只解析新增的完整行并追加到存储，汇总统计按增量更新，
+    // 完成后发出flowsAppended。文件变短（被截断或替换）时重新加载。只用于单文件数据集。
+    // 追加的行日期早于已有数据时存储会按日期重排，flowsAppended的firstRow只表示追加前的行数
+    void setTailModeEnabled(bool enabled);
+    bool isTailModeEnabled() const { return m_tailMode; }
+
+    // 核外模式：客流不进内存，加载时转换成缓存目录下的块文件（源文件未变时直接沿用），
+    // 分析时经缓冲池逐块读入，常驻的客流不超过缓冲池预算。单文件和分区数据集都适用，
+    // 但不使用快照、日期窗口和追加模式。设置对下一次加载生效
+    void setOutOfCoreEnabled(bool enabled);
+    bool isOutOfCoreEnabled() const { return m_outOfCore; }
+    bool isOutOfCore() const { return m_blockPool.isOpen(); }
+    void setBlockCacheBudget(qint64 bytes);
+    qint64 blockCacheBudget() const { return m_blockPool.budget(); }
+
+    // 逐块扫描客流，汇总分析用它代替一次取出全部行。常驻内存时整个存储作为一块交给visit
+    // （按日期范围扫描且没有客流数据时是模拟数据），核外模式下按块从磁盘读入，
+    // 日期范围不相交的块整块跳过。块只在visit期间有效，不要在visit之外保留FlowRow。
+    // 某块读取失败时停止扫描并返回false，已经visit的部分不完整，调用方不能当作结果使用
+    typedef std::function<void(const FlowView&)> FlowVisitor;
+    bool scanFlows(const FlowVisitor &visit, QString *error = nullptr) const;
+    bool scanFlows(const QDate &startDate, const QDate &endDate, const FlowVisitor &visit,
+                   QString *error = nullptr) const;
+
+    // 客流、站点或列车数据每变化一次（加载、切换日期窗口、追加）加一，AnalysisEngine的结果缓存据此失效
+    quint64 dataGeneration() const { return m_generation; }
+    // 加载和追加时按（车次、站点、日期、发车时间、票种）丢弃的重复客流行数
+    qint64 duplicateRowCount() const { return m_duplicateRows; }
+
+    // SQLite存储：saveToDatabase把当前数据写入数据库文件（分区模式下逐个解析全部分区后写入）；
+    // loadDataFromDatabase只把站点和列车读进内存，客流留在数据库中，
+    // 按日期范围的分析通过flowDatabase()下推成SQL聚合
+    bool saveToDatabase(const QString &path);
+    bool loadDataFromDatabase(const QString &path);
+    bool isDatabaseBacked() const { return m_databaseBacked; }
+    // 只在数据库模式下非空
+    const FlowDatabase *flowDatabase() const { return m_databaseBacked ? &m_database : nullptr; }
+
+    // 把客流导出为列式文件（见FlowColumnFile），交给其他工具使用；放进数据目录代替客流CSV也能直接加载。
+    // 分区模式下导出全部分区，核外模式下逐块导出，数据库模式不支持
+    bool exportFlows(const QString &path);
+
     // Data access
     QVector<Station*> getStations() const { return m_stations; }
     QVector<Train*> getTrains() const { return m_trains; }
-    QVector<PassengerFlow*> getPassengerFlows() const { return m_passengerFlows; }
+    const FlowStore &getFlowStore() const { return m_flowStore; }
+    FlowView getFlows() const { return m_flowStore.all(); }
+    // 冷列（线路、到达时间、票价、起止站）能否使用；首次调用时解码。内存客流的冷列解码失败时为false，
+    // 错误已通过dataLoadError报告，依赖冷列的分析应返回空结果。分区和核外模式加载时已解码
+    bool coldColumnsAvailable() const { return !m_flowStore.hasColdColumnsError(); }
+    // m_flowStore各属性值的位图索引，第一次使用时建立，数据变化后在下次使用时重建。
+    // 多条件筛选把各条件的位图组合后用FlowBitmap::forEach只访问命中的行
+    const FlowBitmapIndex &flowBitmaps() const;
+    // 日期×站点×小时的预聚合立方体，与汇总统计一起在加载和追加时维护，核外模式下也覆盖全部客流。
+    // 超出内存预算时isValid()为false，调用方改为扫描客流
+    const FlowCube &flowCube() const { return m_flowCube; }
+    FlowView getPassengerFlows(const FlowBitmap &rows) const { return FlowView(&m_flowStore, rows.toRows()); }
+    // 兼容旧接口：首次调用时按列存储生成PassengerFlow对象，新代码请使用getFlows()
+    QVector<PassengerFlow*> getPassengerFlows() const;
+    // 运营线路拓扑（运营线路客运站.csv），文件不存在时为空
+    const RouteGraph &getRouteGraph() const { return m_routeGraph; }
     
-    Station* getStationById(int id) const;
+    // 站点和列车的稠密编号就是在getStations()/getTrains()中的下标（0..N-1），加载时建立查找表：
+    // 原始站点ID经平铺数组一次下标换成稠密编号，名称、电报码和车次查完美哈希表
+    int getStationIndex(int id) const
+    {
+        const qint64 slot = qint64(id) - m_stationIdBase;
+        if (slot >= 0 && slot < m_stationSlots.size()) {
+            return m_stationSlots[slot];
+        }
+        return m_sparseStationIds.isEmpty() ? -1 : m_sparseStationIds.value(id, -1);
+    }
+    Station* getStationById(int id) const
+    {
+        const int index = getStationIndex(id);
+        return index >= 0 ? m_stations[index] : nullptr;
+    }
     Station* getStationByName(const QString &name) const;
+    Station* getStationByTelecode(const QString &telecode) const;
     Train* getTrainByCode(const QString &code) const;
     Train* getTrainByTrainCode(const QString &trainCode) const;
     int getStationIdByName(const QString &name) const;
@@ -43,33 +179,221 @@ public:
     QMap<QString, int> getStationPassengerStats() const;
     QMap<QString, int> getTrainPassengerStats() const;
     QMap<int, int> getHourlyPassengerStats() const;
+    QMap<int, int> getHourlyPassengerStats(const QDate &startDate, const QDate &endDate) const;
     QMap<int, int> getDailyPassengerStats() const;
+    QMap<QDate, int> getDatePassengerStats() const;
     
     // Filtering
-    QVector<PassengerFlow*> getPassengerFlowsByDate(const QDate &date) const;
-    QVector<PassengerFlow*> getPassengerFlowsByStation(int stationId) const;
-    QVector<PassengerFlow*> getPassengerFlowsByTrain(const QString &trainCode) const;
-    QVector<PassengerFlow*> getPassengerFlowsByDateRange(const QDate &startDate, const QDate &endDate) const;
+    FlowView getPassengerFlowsByDate(const QDate &date) const;
+    FlowView getPassengerFlowsByStation(int stationId) const;
+    FlowView getPassengerFlowsByTrain(const QString &trainCode) const;
+    // 以下三个只查倒排索引中该站点或车次的行，日期范围为闭区间
+    FlowView getPassengerFlowsByStation(int stationId, const QDate &startDate, const QDate &endDate) const;
+    FlowView getPassengerFlowsByTrain(const QString &trainCode, const QDate &startDate, const QDate &endDate) const;
+    FlowView getPassengerFlowsByStationAndTrain(int stationId, const QString &trainCode,
+                                                const QDate &startDate, const QDate &endDate) const;
+    FlowView getPassengerFlowsByDateRange(const QDate &startDate, const QDate &endDate) const;
     
-    // Data validation
-    bool validateData() const;
+    // 数据质量检查：重新扫描客流源文件，按规则统计违规行，违规行的位置写入隔离文件。
+    // 全部规则都通过时返回true；report为空时只记录日志，outputBase为空时写到缓存目录
+    bool validateData(FlowValidation::Report *report = nullptr, const QString &outputBase = QString()) const;
+    // 在工作线程中做数据质量检查，进度、取消和isLoading与后台加载共用，完成后发出validationFinished。
+    // 正在加载时不启动，返回false
+    bool validateDataAsync(const QString &outputBase = QString());
     QString getDataSummary() const;
 
 signals:
     void dataLoaded();
     void dataLoadError(const QString &error);
+    void stationsAndTrainsLoaded();
+    void progress(qint64 bytesRead, qint64 totalBytes);
+    void loadingCancelled();
+    void partitionsLoaded();
+    void flowsAppended(int firstRow, int count);
+    void validationFinished(const FlowValidation::Report &report);
 
 private:
+    // 站点、列车和兼容用的逐行客流对象都在区块分配器中，clearData()整块释放
+    EntityArena<Station> m_stationArena;
+    EntityArena<Train> m_trainArena;
+    mutable EntityArena<PassengerFlow> m_flowArena;
     QVector<Station*> m_stations;
     QVector<Train*> m_trains;
-    QVector<PassengerFlow*> m_passengerFlows;
+    FlowStore m_flowStore;
+    RouteGraph m_routeGraph;
+    mutable QVector<PassengerFlow*> m_passengerFlows;
+    // 没有客流数据时供查询使用的模拟数据
+    mutable FlowStore m_mockFlows;
     
-    QMap<int, Station*> m_stationMap;
-    QMap<QString, Train*> m_trainMap;
+    // 站点ID大致连续时平铺为m_stationIdBase起的数组，过于稀疏时退回哈希表
+    int m_stationIdBase;
+    QVector<int> m_stationSlots;
+    QHash<int, int> m_sparseStationIds;
+    PerfectHash m_stationNameIndex;
+    PerfectHash m_stationTelecodeIndex;
+    PerfectHash m_trainCodeIndex;
+    PerfectHash m_trainNumberIndex;
+    bool m_parallelLoading;
+    bool m_snapshotCache;
+    bool m_lazyColumns;
+
+    // 后台加载状态；字节计数和取消标志由解析线程访问
+    bool m_loading;
+    QPointer<QThread> m_loadThread;
+    QTimer *m_progressTimer;
+    mutable QAtomicInteger<qint64> m_bytesRead;
+    QAtomicInteger<qint64> m_bytesTotal;
+    QAtomicInt m_cancelRequested;
+
+    // 分区数据集状态，只在本对象所在线程访问；加载期间不变，解析线程可以读取m_partitioned
+    struct ResidentPartition {
+        FlowStore store;
+        qint64 duplicateRows = 0;
+        quint64 lastUsed = 0;
+    };
+    bool m_partitioned;
+    QString m_dataDirectory;
+    QStringList m_flowSources;        // 本次加载的客流源文件，数据质量检查据此重新扫描
+    QVector<FlowPartition> m_partitions;
+    QHash<QString, ResidentPartition> m_residentPartitions;
+    QStringList m_windowPartitions;   // 当前m_flowStore由哪些分区合并而成
+    int m_windowRows;                 // 这些分区去重前的总行数
+    quint64 m_partitionClock;
+    qint64 m_partitionBudget;
+    int m_windowStartDay;
+    int m_windowEndDay;
+
+    // 汇总统计与m_flowStore同步维护
+    FlowAggregates m_aggregates;
+    FlowCube m_flowCube;
+    quint64 m_generation;
+    // 站点和车次的倒排索引，加载完成时建立；追加或重排后在下次查询时按代号重建
+    mutable FlowIndex m_flowIndex;
+    mutable quint64 m_flowIndexGeneration;
+    mutable FlowBitmapIndex m_flowBitmaps;
+    mutable quint64 m_flowBitmapsGeneration;
+    qint64 m_duplicateRows;
+
+    // 追加模式：m_tailOffset之前的字节已经解析过；列映射和日期格式在第一次追加时从文件头探测
+    bool m_tailMode;
+    QFileSystemWatcher *m_tailWatcher;
+    QString m_flowFile;
+    qint64 m_tailOffset;
+    bool m_tailLayoutValid;
+    CsvProjection m_tailColumns;
+    DateTimeParser::DateFormat m_tailDateFormat;
+    FlowDeduplicator m_tailDeduplicator;  // 第一次追加时由已有数据建立，之后随追加的行增长
+
+    // 数据库模式：客流不在m_flowStore中，只在m_database里
+    FlowDatabase m_database;
+    bool m_databaseBacked;
+
+    // 核外模式：m_blockMode在检查源文件时按设置确定，加载期间不变，解析线程可以读取
+    bool m_outOfCore;
+    bool m_blockMode;
+    mutable FlowBlockPool m_blockPool;
+
+    // 客流解析的线程局部缓冲：每块解析成一个小的列式存储，合并时再统一字典编号
+    struct FlowChunk {
+        FlowStore store;
+        int totalRecords = 0;
+        qint64 fileOffset = -1;     // 不小于0时只解析热列，冷列记为解析起点在文件中的偏移加行内位置
+        QString error;              // 字典超出编号范围时停止解析并记下原因
+    };
+
+    // 一个待解析的分区：输入分区描述，解析线程填入数据、精确日期范围或错误
+    struct PartitionLoad {
+        FlowPartition partition;
+        FlowStore store;
+        qint64 duplicateRows = 0;
+        QString error;
+    };
+
+    // 一次加载的全部结果，只含普通数据，由工作线程生成、在本对象所在线程接管
+    struct LoadResult {
+        QVector<StationRecord> stations;
+        QVector<TrainRecord> trains;
+        FlowStore flows;
+        RouteGraph routeGraph;
+        QString stationsError;
+        QString trainsError;
+        QString flowsError;
+        QString routesError;
+        qint64 flowBytes = 0;   // 客流文件中已解析的字节数，追加模式从这里继续
+        qint64 duplicateRows = 0;
+        bool stagePublished = false;
+        bool cancelled = false;
+        // 分区模式下要解析的分区；partitionsOnly表示只为新的日期窗口补充分区，不重读站点和列车
+        QVector<PartitionLoad> partitions;
+        bool partitionsOnly = false;
+        // 核外模式下生成或沿用的块文件
+        QString blockFile;
+        QVector<FlowSnapshot::SourceFile> blockSources;
+    };
+    typedef std::function<void(const QVector<StationRecord>&, const QVector<TrainRecord>&)> StageCallback;
+    typedef std::function<bool(FlowStore&, QString*)> FlowSink;
+    // 按批读入的一段客流数据：ranges按行对齐，可以并行处理
+    struct FlowBatch {
+        CsvProjection columns;
+        DateTimeParser::DateFormat dateFormat = DateTimeParser::UnknownDate;
+        QVector<QPair<const char*, const char*>> ranges;
+        const char *base = nullptr;     // 本批缓冲区开头
+        qint64 baseOffset = 0;          // base在（解压后）文件中的字节偏移
+
+        qint64 offsetOf(const char *position) const { return baseOffset + (position - base); }
+    };
+    typedef std::function<bool(QThreadPool&, const FlowBatch&, QString*)> FlowBatchVisitor;
+
+    bool checkSourceFiles(const QString &path, QStringList &sourceFiles);
+    void loadSources(const QStringList &sourceFiles, LoadResult &result, const StageCallback &onStage) const;
+    bool finishLoad(LoadResult &result);
+    void startLoadThread(const QStringList &sourceFiles, QSharedPointer<LoadResult> result);
+    void resetProgress(const QStringList &sourceFiles, const QVector<PartitionLoad> &partitions);
+
+    // 解析函数不创建QObject，可在任意线程调用
+    bool readStations(const QString &filename, QVector<StationRecord> &records, QString *error) const;
+    bool readTrains(const QString &filename, QVector<TrainRecord> &records, QString *error) const;
+    bool readRouteGraph(const QString &filename, RouteGraph &graph, QString *error) const;
+    bool readPassengerFlow(const QString &filename, FlowStore &store, QString *error,
+                           bool splitChunks = true, qint64 *parsedBytes = nullptr,
+                           qint64 *duplicateRows = nullptr) const;
+    void adoptStations(const QVector<StationRecord> &records);
+    void adoptTrains(const QVector<TrainRecord> &records);
+    void rebuildStationIndex();
+    void rebuildTrainIndex();
+
+    QVector<QPair<const char*, const char*>> splitFlowRanges(const char *begin, const char *end) const;
+    void parseFlowChunk(const char *begin, const char *end, const CsvProjection &columns,
+                        DateTimeParser::DateFormat dateFormat, FlowChunk &chunk) const;
+    bool mergeFlowChunks(const QVector<FlowChunk> &chunks, FlowStore &store, QString *error) const;
+    void validateFlowChunk(const char *begin, const char *end, const FlowBatch &batch,
+                           const QBitArray &knownStations, const StringDictionary &knownTrains,
+                           FlowValidation::Chunk &chunk) const;
+    // 按固定大小分批读入，每批切成按行对齐的若干段交给visit（可用pool并行处理），处理完即释放，
+    // 内存占用与文件大小无关。压缩文件在后台线程解压，与处理同时进行
+    bool readFlowBatches(const QString &filename, bool splitChunks, const FlowBatchVisitor &visit,
+                         QString *error) const;
+    // 逐批解析，每批按文件顺序交给sink
+    bool streamPassengerFlow(const QString &filename, const FlowSink &sink, QString *error,
+                             bool splitChunks = true) const;
+    bool writeFlowBlocks(const QStringList &files, LoadResult &result) const;
+
+    void buildPartitionCatalog(const QStringList &files);
+    QVector<PartitionLoad> pendingPartitions() const;
+    void loadPartitions(QVector<PartitionLoad> &partitions, QString *error) const;
+    void adoptPartitions(QVector<PartitionLoad> &partitions);
+    void rebuildFlowWindow();
+    void evictPartitions();
+
+    const FlowIndex &flowIndex() const;
+    // 核外模式下逐块累加，块读取失败时汇总和立方体清空并返回false
+    bool refreshAggregates(QString *error = nullptr);
+    // 冷列解码失败时发出dataLoadError
+    void watchColdColumns();
+    void armTailWatcher();
+    void appendNewFlows();
     
     void clearData();
-    QTime parseTime(const QString &timeStr) const;
-    QDate parseDate(const QString &dateStr) const;
 };
 
 #endif // DATAMANAGER_H
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef DATETIMEPARSER_H
+#define DATETIMEPARSER_H
+
+#include <QByteArrayView>
+#include <QString>
+#include <climits>
+
+// 客流CSV的日期和时间字段解析：直接在字节上计算儒略日和一天中的分钟数，不构造QString/QDate。
+// 日期格式每个文件探测一次，逐行按固定格式解析；个别行与探测结果不符时再按通用规则解析。
+class DateTimeParser
+{
+public:
+    enum DateFormat {
+        UnknownDate,
+        CompactDate,     // YYYYMMDD
+        DashedDate,      // YYYY-MM-DD
+        SlashedDate,     // YYYY/MM/DD
+        UsSlashedDate    // MM/DD/YYYY
+    };
+
+    static const int InvalidDay = INT_MIN;
+    static const int InvalidMinute = -1;
+
+    // 根据一个样本字段判断日期格式
+    static DateFormat detectDateFormat(QByteArrayView field);
+    static QString formatName(DateFormat format);
+
+    // 返回儒略日（与QDate::toJulianDay一致）；年月日不合法时返回InvalidDay，
+    // 完全无法识别的格式沿用原来的约定，返回2015-01-01
+    static int parseDay(QByteArrayView field, DateFormat format);
+    // 同parseDay，但无法识别的格式也返回InvalidDay，供数据质量检查区分
+    static int parseDayStrict(QByteArrayView field, DateFormat format);
+
+    // HHMM → 一天中的分钟数，不合法时返回InvalidMinute
+    static int parseMinute(QByteArrayView field);
+
+    // 公历年月日 → 儒略日，不合法时返回InvalidDay
+    static int julianDay(int year, int month, int day);
+    static int defaultDay();
+
+private:
+    static int parseDay(QByteArrayView field, DateFormat format, int unrecognizedDay);
+};
+
+#endif // DATETIMEPARSER_H
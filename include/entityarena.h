@@ -0,0 +1,60 @@
+#ifndef ENTITYARENA_H
+#define ENTITYARENA_H
+
+#include <QVector>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 实体的区块分配器：对象成批构造在连续的大块内存中，不单独new/delete。
+// clear()按块顺序析构后整块释放（平凡析构的类型连析构也省掉），重新加载时代价只与块数有关。
+// 新对象只追加到新块，已有对象不会搬动，指针在clear()之前一直有效。
+template<typename T, int ChunkSize = 4096>
+class EntityArena
+{
+public:
+    EntityArena() = default;
+    EntityArena(const EntityArena &) = delete;
+    EntityArena &operator=(const EntityArena &) = delete;
+    ~EntityArena() { clear(); }
+
+    template<typename... Args>
+    T *create(Args &&...args)
+    {
+        if (m_chunks.isEmpty() || m_used == ChunkSize) {
+            m_chunks.append(std::allocator<T>().allocate(ChunkSize));
+            m_used = 0;
+        }
+        T *object = new (m_chunks.last() + m_used) T(std::forward<Args>(args)...);
+        ++m_used;
+        ++m_size;
+        return object;
+    }
+
+    void clear()
+    {
+        for (int chunk = 0; chunk < m_chunks.size(); ++chunk) {
+            if constexpr (!std::is_trivially_destructible<T>::value) {
+                const int count = chunk == m_chunks.size() - 1 ? m_used : ChunkSize;
+                for (int i = 0; i < count; ++i) {
+                    m_chunks[chunk][i].~T();
+                }
+            }
+            std::allocator<T>().deallocate(m_chunks[chunk], ChunkSize);
+        }
+        m_chunks.clear();
+        m_used = 0;
+        m_size = 0;
+    }
+
+    qsizetype size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+private:
+    QVector<T*> m_chunks;
+    int m_used = 0;         // 最后一块中已构造的对象数
+    qsizetype m_size = 0;
+};
+
+#endif // ENTITYARENA_H
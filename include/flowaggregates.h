@@ -0,0 +1,45 @@
+#ifndef FLOWAGGREGATES_H
+#define FLOWAGGREGATES_H
+
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include "flowstore.h"
+
+// 客流汇总：按站点、车次、小时、星期和日期累计客流量（上客+下客）。
+// 加载后对整个存储计算一次；追加新行时只累加新行，不重新扫描历史数据。
+// 车次按存储的字典编号累计，字典只增不减，编号在追加后保持不变。
+class FlowAggregates
+{
+public:
+    void clear();
+
+    // 累加store中 [firstRow, size) 的行
+    void add(const FlowStore &store, int firstRow = 0);
+
+    int rowCount() const { return m_rowCount; }
+    qint64 totalPassengers() const { return m_totalPassengers; }
+    double totalRevenue() const { return m_totalRevenue; }
+
+    const QHash<int, qint64> &stationTotals() const { return m_stationTotals; }
+    const QVector<qint64> &trainTotals() const { return m_trainTotals; }
+    const QVector<bool> &trainSeen() const { return m_trainSeen; }
+    // 出发时间无效的行计入-1小时，与FlowRow::getHour一致
+    const QMap<int, int> &hourlyTotals() const { return m_hourlyTotals; }
+    const QMap<int, int> &dayOfWeekTotals() const { return m_dayOfWeekTotals; }
+    // 键为儒略日
+    const QMap<int, qint64> &dateTotals() const { return m_dateTotals; }
+
+private:
+    int m_rowCount = 0;
+    qint64 m_totalPassengers = 0;
+    double m_totalRevenue = 0.0;
+    QHash<int, qint64> m_stationTotals;
+    QVector<qint64> m_trainTotals;
+    QVector<bool> m_trainSeen;
+    QMap<int, int> m_hourlyTotals;
+    QMap<int, int> m_dayOfWeekTotals;
+    QMap<int, qint64> m_dateTotals;
+};
+
+#endif // FLOWAGGREGATES_H
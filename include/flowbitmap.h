@@ -0,0 +1,122 @@
+#ifndef FLOWBITMAP_H
+#define FLOWBITMAP_H
+
+#include <QVector>
+#include <QHash>
+#include <QtAlgorithms>
+#include "flowstore.h"
+
+// 压缩行号位图（roaring结构）：行号按高16位分成块，每块一个容器，只存有行的块。
+// 一块中不超过ArrayLimit行时容器是递增的低16位数组，更多时是65536位的位图（1024个u64）。
+// 与、或、差、补按容器逐块进行：位图对位图按64位字运算，数组与位图互相查位，数组之间归并。
+// 遍历只访问置位的行，位图容器按字取最低置位。
+class FlowBitmap
+{
+public:
+    static const int ArrayLimit = 4096;
+
+    // 行区间[begin, end)
+    static FlowBitmap range(int begin, int end);
+    // rows须递增
+    static FlowBitmap fromRows(const QVector<int> &rows);
+
+    // 按递增顺序追加行（建立索引时使用）
+    void add(int row);
+    bool contains(int row) const;
+    int cardinality() const;
+    bool isEmpty() const { return m_containers.isEmpty(); }
+    void clear() { m_containers.clear(); }
+
+    FlowBitmap operator&(const FlowBitmap &other) const;
+    FlowBitmap operator|(const FlowBitmap &other) const;
+    // 在本位图中而不在other中的行
+    FlowBitmap andNot(const FlowBitmap &other) const;
+    // [0, rowCount)中不在本位图中的行
+    FlowBitmap complement(int rowCount) const;
+    FlowBitmap &operator&=(const FlowBitmap &other) { return *this = *this & other; }
+    FlowBitmap &operator|=(const FlowBitmap &other) { return *this = *this | other; }
+
+    // 按递增顺序对每个置位的行调用visit(row)
+    template<typename Visitor>
+    void forEach(Visitor visit) const;
+    QVector<int> toRows() const;
+
+    qint64 memoryUsage() const;
+
+private:
+    struct Container {
+        quint16 key = 0;
+        int cardinality = 0;
+        QVector<quint16> values;   // 数组容器
+        QVector<quint64> words;    // 位图容器，非空时values不用
+
+        bool isBitmap() const { return !words.isEmpty(); }
+        bool contains(quint16 low) const;
+        void toBitmap();
+        // 位图容器在行数降到ArrayLimit以内时转回数组
+        void shrink();
+    };
+
+    static Container intersect(const Container &a, const Container &b);
+    static Container unite(const Container &a, const Container &b);
+    static Container subtract(const Container &a, const Container &b);
+
+    QVector<Container> m_containers;   // 按key递增
+};
+
+template<typename Visitor>
+void FlowBitmap::forEach(Visitor visit) const
+{
+    for (const Container &container : m_containers) {
+        const int base = int(container.key) << 16;
+        if (!container.isBitmap()) {
+            for (quint16 low : container.values) {
+                visit(base + low);
+            }
+            continue;
+        }
+        for (int w = 0; w < container.words.size(); ++w) {
+            quint64 word = container.words[w];
+            while (word) {
+                visit(base + w * 64 + int(qCountTrailingZeroBits(word)));
+                word &= word - 1;
+            }
+        }
+    }
+}
+
+// 低基数属性的位图索引：每个站点、车次、票种、星期几各一个位图，另有高峰时段位图。
+// 多条件筛选先把各条件的位图做与、或、非，再只遍历结果中置位的行。
+// 行号随存储变化，存储重排、追加或删除行后需要重新build。
+class FlowBitmapIndex
+{
+public:
+    void build(const FlowStore &store);
+    void clear();
+    int rowCount() const { return m_rowCount; }
+
+    // 值不存在时返回空位图
+    const FlowBitmap &station(int stationId) const;
+    const FlowBitmap &train(int trainId) const;         // store字典中的车次编号
+    const FlowBitmap &ticketType(int ticketTypeId) const;
+    const FlowBitmap &weekday(int dayOfWeek) const;     // 1（星期一）到7
+    const FlowBitmap &peakHour() const { return m_peakHour; }
+    FlowBitmap weekend() const { return weekday(6) | weekday(7); }
+    FlowBitmap all() const { return FlowBitmap::range(0, m_rowCount); }
+    // 日期在[startDay, endDay]（儒略日）内的行：按日期聚集时是一个区间，否则逐行检查
+    FlowBitmap days(const FlowStore &store, int startDay, int endDay) const;
+    FlowBitmap stations(const QVector<int> &stationIds) const;
+
+    qint64 memoryUsage() const;
+
+private:
+    int m_rowCount = 0;
+    QHash<int, FlowBitmap> m_stations;
+    QVector<FlowBitmap> m_trains;
+    QVector<FlowBitmap> m_ticketTypes;
+    FlowBitmap m_weekdays[7];
+    FlowBitmap m_peakHour;
+    FlowBitmap m_empty;
+};
+
+#endif // FLOWBITMAP_H
@@ -0,0 +1,85 @@
+#ifndef FLOWBLOCKFILE_H
+#define FLOWBLOCKFILE_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QSaveFile>
+#include "flowstore.h"
+#include "flowsnapshot.h"
+
+// 核外模式的客流块文件：客流按固定行数切成块，每块的各列连续存放，可以单独读入。
+// 字典（线路、车次、票种、起终点站）全文件共用一份，块内只存编号，所以各块的编号一致。
+// 块目录记录每块的位置、行数和日期范围，按日期查询时不相交的块整块跳过。
+// 和快照一样记录源文件指纹，源文件变化后块文件失效。
+//
+// 文件布局（本机字节序）：
+//   [magic u32][version u32][directoryOffset u64][directorySize u64][directoryChecksum u64]
+//   [块0各列][块1各列]...   每列按64字节对齐
+//   [目录：QDataStream序列化的源文件指纹、字典和块描述]
+class FlowBlockFile
+{
+public:
+    static const quint32 Magic = 0x4b4c4246;   // "FBLK"
+    static const quint32 Version = 2;          // 2: 客流去重
+    static const int BlockRows = 65536;
+
+    struct Block {
+        qint64 offset = 0;
+        qint64 bytes = 0;
+        int rows = 0;
+        int firstDay = 0;       // 儒略日，闭区间
+        int lastDay = 0;
+
+        bool overlaps(int startDay, int endDay) const { return firstDay <= endDay && lastDay >= startDay; }
+    };
+
+    // 逐批写入：append可多次调用，攒满BlockRows行就写出一块；finish写出最后不满的一块和目录。
+    // 同一时刻只在内存中保留不到一块加上当前这一批
+    class Writer
+    {
+    public:
+        bool open(const QString &path, const QVector<FlowSnapshot::SourceFile> &sources, QString *error);
+        bool append(const FlowStore &flows, QString *error);
+        bool finish(QString *error);
+        qint64 rowCount() const { return m_rowCount; }
+
+    private:
+        bool writeBlock(int firstRow, int rows);
+
+        QSaveFile m_file;
+        QVector<FlowSnapshot::SourceFile> m_sources;
+        FlowStore m_pending;       // 尚未写出的行，字典是全文件的字典
+        QVector<Block> m_blocks;
+        qint64 m_position = 0;
+        qint64 m_rowCount = 0;
+    };
+
+    // 数据目录对应的块文件路径（位于系统缓存目录下）
+    static QString defaultPath(const QString &dataDirectory);
+
+    // 打开并校验块文件，只读入目录和字典
+    bool open(const QString &path, const QVector<FlowSnapshot::SourceFile> &sources, QString *error);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    int blockCount() const { return m_blocks.size(); }
+    const Block &block(int index) const { return m_blocks[index]; }
+    qint64 rowCount() const { return m_rowCount; }
+    // 只含字典、没有行的存储，编号到字符串的映射对所有块通用
+    const FlowStore &dictionaries() const { return m_dictionaries; }
+
+    // 读入一块；返回的存储带着全文件的字典（隐式共享，不复制字符串）
+    bool readBlock(int index, FlowStore &block, QString *error) const;
+
+private:
+    template<typename Store, typename Visitor>
+    static bool forEachColumn(Store &store, Visitor visit);
+
+    mutable QFile m_file;
+    QVector<Block> m_blocks;
+    qint64 m_rowCount = 0;
+    FlowStore m_dictionaries;
+};
+
+#endif // FLOWBLOCKFILE_H
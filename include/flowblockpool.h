@@ -0,0 +1,47 @@
+#ifndef FLOWBLOCKPOOL_H
+#define FLOWBLOCKPOOL_H
+
+#include <QHash>
+#include <QSharedPointer>
+#include "flowblockfile.h"
+
+// 块缓冲池：按需从块文件读入客流块，常驻的块总字节数超出预算时淘汰最久未用的块。
+// 交出的块是共享指针，调用方用完之前即使被淘汰也不会释放，
+// 所以峰值内存约为预算加上正在使用的一块，与数据集大小无关。
+class FlowBlockPool
+{
+public:
+    bool open(const QString &path, const QVector<FlowSnapshot::SourceFile> &sources, QString *error);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    const FlowBlockFile &file() const { return m_file; }
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return m_budget; }
+    qint64 residentBytes() const { return m_residentBytes; }
+
+    // 取一块，不在池中时从文件读入；读取失败返回空指针
+    QSharedPointer<const FlowStore> block(int index, QString *error = nullptr);
+
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+
+private:
+    struct Entry {
+        QSharedPointer<const FlowStore> store;
+        qint64 bytes = 0;
+        quint64 lastUsed = 0;
+    };
+
+    void evict(qint64 incomingBytes);
+
+    FlowBlockFile m_file;
+    QHash<int, Entry> m_entries;
+    quint64 m_clock = 0;
+    qint64 m_budget = qint64(256) * 1024 * 1024;
+    qint64 m_residentBytes = 0;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
+
+#endif // FLOWBLOCKPOOL_H
@@ -0,0 +1,66 @@
+#ifndef FLOWCOLDSOURCE_H
+#define FLOWCOLDSOURCE_H
+
+#include <QString>
+#include <QVector>
+#include "flowstore.h"
+#include "datetimeparser.h"
+#include <functional>
+
+// 客流冷列的来源文件。加载时只解析常用的热列，线路、到达时间、票价和起终点站这几列
+// 只记下每行在CSV中的字节偏移，第一次被访问时再回到文件中按偏移并行解码。
+// 创建时记下文件的大小和修改时间：解码时文件变短，或大小不变而修改时间变了（原地改写），直接失败；
+// 文件只是被追加时偏移仍然有效。此外每个偏移处的行都要重新解析站点ID和运行日期，
+// 与存储中该行的热列核对，任何一行对不上都说明偏移已指向别的行，解码失败。
+class FlowColdSource
+{
+public:
+    struct Columns {
+        QVector<FlowStore::DictId> lineIds;
+        QVector<qint16> arrivalMinutes;
+        QVector<double> ticketPrices;
+        QVector<FlowStore::DictId> startStationIds;
+        QVector<FlowStore::DictId> endStationIds;
+        StringDictionary lineCodes;
+        StringDictionary stationNames;
+    };
+
+    // 各列号、fieldCount和日期格式与加载时相同：字段不足的行加载时已被跳过
+    FlowColdSource(const QString &path, int stationColumn, int dateColumn, DateTimeParser::DateFormat dateFormat,
+                   int lineColumn, int arrivalColumn, int ticketPriceColumn,
+                   int startStationColumn, int endStationColumn, int fieldCount);
+
+    const QString &path() const { return m_path; }
+
+    // 冷列解码失败时的通知，可能在任意线程调用；解码由第一次访问冷列的线程触发
+    typedef std::function<void(const QString&)> FailureHandler;
+    void setFailureHandler(const FailureHandler &handler) { m_failureHandler = handler; }
+    void reportFailure(const QString &error) const
+    {
+        if (m_failureHandler) {
+            m_failureHandler(error);
+        }
+    }
+
+    // 按offsets的顺序解码各行，stationIds和dayNumbers是这些行已加载的热列，用于核对；
+    // 各线程先写自己的字典，最后按行的顺序统一编号，编号与整行解析时首次出现的顺序一致
+    bool decode(const QVector<qint64> &offsets, const QVector<qint32> &stationIds,
+                const QVector<qint32> &dayNumbers, Columns &columns, QString *error) const;
+
+private:
+    QString m_path;
+    qint64 m_fileSize;
+    qint64 m_modified;
+    int m_stationColumn;
+    int m_dateColumn;
+    DateTimeParser::DateFormat m_dateFormat;
+    int m_lineColumn;
+    int m_arrivalColumn;
+    int m_ticketPriceColumn;
+    int m_startStationColumn;
+    int m_endStationColumn;
+    int m_fieldCount;
+    FailureHandler m_failureHandler;
+};
+
+#endif // FLOWCOLDSOURCE_H
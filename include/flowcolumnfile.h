@@ -0,0 +1,109 @@
+#ifndef FLOWCOLUMNFILE_H
+#define FLOWCOLUMNFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QFile>
+#include <QSaveFile>
+#include <climits>
+#include "flowstore.h"
+
+// 列式客流交换文件（.fcol）：把客流按列编码后交给其他团队的工具，也可以放进数据目录代替客流CSV直接加载。
+// 行按至多RowGroupRows行分成行组，行组内每列单独编码，并记录最小值和最大值：
+//   Plain      原始值，用于票价和收入（float64）
+//   BitPacked  减去最小值后按最小位宽紧密排列，用于站点ID、时间和上下客量
+//   Delta      首值为基准，相邻差值zigzag后按最小位宽排列，用于日期（按日期排序的数据差值几乎全为0）
+//   Dictionary 字典编号按最小位宽排列，字符串在文件尾的字典中，全文件共用一份
+// 整数列每个行组在BitPacked和Delta中取位宽较小的一种。读取时按日期统计跳过不相交的行组。
+//
+// 文件布局（小端字节序）：
+//   [magic u32][version u32][footerOffset u64][footerSize u64][footerChecksum u64]
+//   [行组0各列][行组1各列]...   每列按64字节对齐，位流以u64为单位、低位在前
+//   [尾部：QDataStream序列化的列定义、字典和行组元数据]
+class FlowColumnFile
+{
+public:
+    static const quint32 Magic = 0x4c4f4346;   // "FCOL"
+    static const quint32 Version = 1;
+    static const int RowGroupRows = 1 << 20;
+
+    enum Encoding : quint8 { Plain, BitPacked, Delta, Dictionary };
+    enum ColumnType : quint8 { Int16Column, Int32Column, Float64Column, DictionaryColumn };
+
+    struct ColumnChunk {
+        qint64 offset = 0;
+        qint64 bytes = 0;
+        Encoding encoding = Plain;
+        int bitWidth = 0;
+        qint64 base = 0;        // BitPacked为最小值，Delta为首值
+        double minValue = 0.0;  // 字典列为编号范围
+        double maxValue = 0.0;
+    };
+
+    struct RowGroup {
+        int rows = 0;
+        QVector<ColumnChunk> columns;
+
+        // 儒略日，闭区间，取自日期列的统计
+        int firstDay() const;
+        int lastDay() const;
+        bool overlaps(int startDay, int endDay) const { return firstDay() <= endDay && lastDay() >= startDay; }
+    };
+
+    // 逐批写入：每次append的行直接从存储编码写出（超过RowGroupRows行时分成多个行组），
+    // 各批的字典合并成全文件的字典；finish写出尾部。未调用finish时文件不会提交
+    class Writer
+    {
+    public:
+        bool open(const QString &path, QString *error);
+        bool append(const FlowStore &flows, QString *error);
+        bool finish(QString *error);
+        qint64 rowCount() const { return m_rowCount; }
+
+    private:
+        bool writeRowGroup(const FlowStore &flows, int firstRow, int rows);
+
+        QSaveFile m_file;
+        StringDictionary m_dictionaries[4];
+        QVector<FlowStore::DictId> m_remaps[4];   // 本批字典编号到全文件编号
+        QVector<RowGroup> m_rowGroups;
+        qint64 m_position = 0;
+        qint64 m_rowCount = 0;
+    };
+
+    // 按扩展名判断
+    static bool isColumnFile(const QString &path);
+    // 各列的名称（与客流CSV的表头一致）
+    static QStringList columnNames();
+
+    // 打开、映射并校验文件，只解析尾部
+    bool open(const QString &path, QString *error);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    qint64 rowCount() const { return m_rowCount; }
+    int rowGroupCount() const { return m_rowGroups.size(); }
+    const RowGroup &rowGroup(int index) const { return m_rowGroups[index]; }
+
+    // 把与日期范围相交的行组追加到store。各列直接从映射的内存解码到存储中，行组之间并行解码；
+    // 不相交的行组不会被读入。整数列和字典列解出的值超出尾部记录的范围时（列数据损坏）读取失败
+    bool read(FlowStore &store, QString *error, int startDay = INT_MIN, int endDay = INT_MAX) const;
+    // 只读一个行组，返回的存储带着全文件的字典
+    bool readRowGroup(int index, FlowStore &store, QString *error) const;
+
+private:
+    // 按文件中的列顺序访问FlowStore的各列，visit(列号, 列)
+    template<typename Store, typename Visitor>
+    static bool forEachColumn(Store &store, Visitor visit);
+    bool decode(const QVector<int> &groups, FlowStore &store) const;
+
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_dataSize = 0;
+    QVector<RowGroup> m_rowGroups;
+    qint64 m_rowCount = 0;
+    FlowStore m_dictionaries;
+};
+
+#endif // FLOWCOLUMNFILE_H
@@ -0,0 +1,72 @@
+#ifndef FLOWCUBE_H
+#define FLOWCUBE_H
+
+#include <QVector>
+#include <QHash>
+#include "flowstore.h"
+
+// 日期×站点×小时的预聚合立方体：每个（站点、日期、发车小时）累计行数、上客量、下客量和收入，
+// 沿日期轴存前缀和，任意日期范围的合计是两个单元相减，与行数无关。
+// 只为出现过的站点分配存储，每个站点只覆盖它有客流的日期范围；另有一份全部站点的合计。
+// 小时维度是-1（发车时间无效，与FlowRow::getHour一致）到23，另加一格全天合计。
+// 追加的行日期不早于已有数据时只更新末尾的几格；总存储超过预算时立方体失效，调用方回到逐行扫描。
+class FlowCube
+{
+public:
+    static const int AllHours = 24;
+    static const qint64 DefaultBudget = qint64(256) * 1024 * 1024;
+
+    struct Totals {
+        qint64 rows = 0;
+        qint64 boarding = 0;
+        qint64 alighting = 0;
+        double revenue = 0.0;
+
+        qint64 passengers() const { return boarding + alighting; }
+        Totals &operator+=(const Totals &other);
+        Totals operator-(const Totals &other) const;
+    };
+
+    explicit FlowCube(qint64 budget = DefaultBudget) : m_budget(budget) {}
+
+    void clear();
+    // 累加store中 [firstRow, size) 的行
+    void add(const FlowStore &store, int firstRow = 0);
+
+    bool isValid() const { return m_valid; }
+    qint64 rowCount() const { return m_rowCount; }
+    // 有数据的日期范围（儒略日），没有数据时firstDay() > lastDay()
+    int firstDay() const { return m_all.firstDay; }
+    int lastDay() const { return m_all.firstDay + m_all.days - 1; }
+    QVector<int> stationIds() const { return m_stations.keys(); }
+
+    // 日期在[startDay, endDay]（儒略日）内全部站点、某个站点或若干站点的合计，hour为-1到23或AllHours
+    Totals total(int startDay, int endDay, int hour = AllHours) const;
+    Totals station(int stationId, int startDay, int endDay, int hour = AllHours) const;
+    Totals stations(const QVector<int> &stationIds, int startDay, int endDay, int hour = AllHours) const;
+
+    qint64 memoryUsage() const { return m_cells * qint64(sizeof(Totals)); }
+
+private:
+    static const int Slots = AllHours + 2;   // 小时-1..23占0..24，全天合计占25
+
+    struct Block {
+        int firstDay = 0;
+        int days = 0;
+        // 第k行（Slots格）是[firstDay, firstDay + k)的合计，共days + 1行
+        QVector<Totals> cells;
+    };
+
+    // 把块扩展到覆盖[lowDay, highDay]，新增日期之前的前缀和照旧
+    void extend(Block &block, int lowDay, int highDay);
+    Totals range(const Block &block, int startDay, int endDay, int hour) const;
+
+    qint64 m_budget;
+    bool m_valid = true;
+    qint64 m_rowCount = 0;
+    qint64 m_cells = 0;
+    QHash<int, Block> m_stations;
+    Block m_all;
+};
+
+#endif // FLOWCUBE_H
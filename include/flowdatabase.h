@@ -0,0 +1,64 @@
+#ifndef FLOWDATABASE_H
+#define FLOWDATABASE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QSqlDatabase>
+#include "loadrecords.h"
+#include "flowstore.h"
+
+// SQLite持久化存储：站点、列车和客流写入一个数据库文件，之后可以不把客流读进内存，
+// 按日期范围的统计直接由SQL聚合完成，适合比内存还大的数据集。
+// 日期存为儒略日；(day)、(station_id, day)、(train_code, day)三个索引都带上聚合要用的列，
+// 查询只读索引不回表。
+// 每个对象使用一个独立的连接名，只能在创建它的线程中使用。
+class FlowDatabase
+{
+public:
+    static const int SchemaVersion = 1;
+
+    // 聚合结果；trains只在按日汇总时计算（当天出现的不同车次数）
+    struct Totals {
+        qint64 rows = 0;
+        qint64 passengers = 0;
+        double revenue = 0.0;
+        double priceSum = 0.0;
+        int trains = 0;
+    };
+
+    explicit FlowDatabase(const QString &connectionName);
+    ~FlowDatabase();
+
+    bool open(const QString &path, QString *error);
+    void close();
+    bool isOpen() const;
+    const QString &path() const { return m_path; }
+
+    // 导入：beginImport清空旧数据并写入站点和列车，appendFlows可多次调用（如逐个分区），
+    // finishImport最后建索引。客流按批在大事务中用预编译语句插入
+    bool beginImport(const QVector<StationRecord> &stations, const QVector<TrainRecord> &trains, QString *error);
+    bool appendFlows(const FlowStore &flows, QString *error);
+    bool finishImport(QString *error);
+
+    bool readStations(QVector<StationRecord> &records, QString *error) const;
+    bool readTrains(QVector<TrainRecord> &records, QString *error) const;
+    qint64 flowCount() const;
+
+    // 聚合查询：日期为儒略日闭区间；stationIds为空表示不限站点
+    QHash<int, Totals> stationTotals(int startDay, int endDay) const;
+    QHash<QString, Totals> trainTotals(int startDay, int endDay, const QVector<int> &stationIds) const;
+    QMap<int, Totals> dailyTotals(int startDay, int endDay, const QVector<int> &stationIds,
+                                  const QString &trainCode = QString()) const;
+    QHash<QString, Totals> ticketTypeTotals(int startDay, int endDay, const QVector<int> &stationIds) const;
+
+private:
+    QSqlDatabase database() const { return QSqlDatabase::database(m_connectionName, false); }
+    bool exec(const QString &sql, QString *error) const;
+
+    QString m_connectionName;
+    QString m_path;
+};
+
+#endif // FLOWDATABASE_H
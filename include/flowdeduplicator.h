@@ -0,0 +1,38 @@
+#ifndef FLOWDEDUPLICATOR_H
+#define FLOWDEDUPLICATOR_H
+
+#include <QVector>
+#include "flowstore.h"
+
+// 客流去重：按（车次、站点、日期、发车时间、票种）计算64位指纹，放进开放寻址的哈希集合，
+// 键已出现过的行直接丢弃，保留第一次出现的那行。集合只存指纹，每行十几字节，
+// 用完即可释放；指纹碰撞的概率在千万行量级约为十万分之一，可以忽略。
+// 各存储的字典编号互不相同，指纹按字典中的字符串计算，因此可以跨块、跨文件使用同一个集合。
+class FlowDeduplicator
+{
+public:
+    // 从store中删除与之前见过的行（包括store内更早的行）键相同的行，返回删除的行数
+    int filter(FlowStore &store);
+    // 只记录store中各行的指纹，不删除任何行；用于在已有数据上继续去重
+    void insert(const FlowStore &store);
+
+    qint64 size() const { return m_count; }
+    qint64 duplicates() const { return m_duplicates; }
+    void reserve(qint64 rows);
+    void clear();
+
+    static quint64 fingerprint(quint64 trainHash, int stationId, int dayNumber, int departureMinute,
+                               quint64 ticketTypeHash);
+
+private:
+    // 指纹不存在时插入并返回true
+    bool insert(quint64 fingerprint);
+    template<typename Visit>
+    void visitFingerprints(const FlowStore &store, Visit visit);
+
+    QVector<quint64> m_slots;   // 0表示空槽，长度为2的幂
+    qint64 m_count = 0;
+    qint64 m_duplicates = 0;
+};
+
+#endif // FLOWDEDUPLICATOR_H
@@ -0,0 +1,61 @@
+#ifndef FLOWINDEX_H
+#define FLOWINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <climits>
+#include "flowstore.h"
+
+// 客流的倒排索引：每个站点ID和每个车次编号对应一个递增的行号列表。
+// 列表按CSR存放：同类的列表首尾相接放在一个数组里，另存每个列表的起始位置，查询结果直接引用数组的一段
+// （隐式共享，不复制行号）。客流按日期聚集时行号递增就是日期递增，日期范围对应的行号区间
+// 在列表中倍增查找即可；站点与车次的组合查询用倍增查找求两个列表的交集。
+// 行号随存储变化，存储重排、追加或删除行后需要重新build。
+class FlowIndex
+{
+public:
+    void build(const FlowStore &store);
+    void clear();
+    int rowCount() const { return m_rowCount; }
+
+    // 站点（原始站点ID）或车次（store字典中的编号）在日期范围（儒略日，闭区间）内的行
+    FlowView stationFlows(const FlowStore &store, int stationId,
+                          int startDay = INT_MIN, int endDay = INT_MAX) const;
+    FlowView trainFlows(const FlowStore &store, int trainId,
+                        int startDay = INT_MIN, int endDay = INT_MAX) const;
+    // 同时属于该站点和该车次的行
+    FlowView stationTrainFlows(const FlowStore &store, int stationId, int trainId,
+                               int startDay = INT_MIN, int endDay = INT_MAX) const;
+
+    // 递增数组rows的[from, to)中第一个不小于value的位置，没有时返回to：
+    // 先按1、2、4……倍增跨步找到目标所在的一段，再在这一段中二分，离from越近越快
+    static int gallop(const int *rows, int from, int to, int value);
+    // 两个递增行号列表的交集：较短列表的每个元素在较长列表中从上次的位置继续倍增查找
+    static QVector<int> intersect(const int *a, int aSize, const int *b, int bSize);
+
+private:
+    struct Slice {
+        int begin = 0;
+        int end = 0;
+    };
+
+    int stationSlot(int stationId) const;
+    Slice stationSlice(int stationId) const;
+    Slice trainSlice(int trainId) const;
+    // 把列表的一段收窄到日期范围内；存储未按日期聚集时返回false
+    bool restrictToDays(const FlowStore &store, const QVector<int> &rows, Slice &slice,
+                        int startDay, int endDay) const;
+    FlowView view(const FlowStore &store, const QVector<int> &rows, Slice slice, int startDay, int endDay) const;
+
+    int m_rowCount = 0;
+    // 站点ID大致连续时按m_stationIdBase起的下标直接定位列表，过于稀疏时查哈希表
+    int m_stationIdBase = 0;
+    bool m_flatStations = true;
+    QHash<int, int> m_stationSlots;
+    QVector<int> m_stationOffsets;    // 列表k是m_stationRows的[offsets[k], offsets[k+1])
+    QVector<int> m_stationRows;
+    QVector<int> m_trainOffsets;      // 按车次字典编号
+    QVector<int> m_trainRows;
+};
+
+#endif // FLOWINDEX_H
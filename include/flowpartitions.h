@@ -0,0 +1,40 @@
+#ifndef FLOWPARTITIONS_H
+#define FLOWPARTITIONS_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <climits>
+
+// 按日期分区的客流数据：目录树中每个 高铁客运量*.csv（可以是.csv.gz或.csv.zst）是一个分区（通常一个月一个文件）。
+// 每个分区记录覆盖的日期范围，只加载与查询日期窗口相交的分区。
+struct FlowPartition {
+    QString path;               // 绝对路径
+    qint64 size = 0;
+    qint64 modified = 0;        // 修改时间（毫秒）
+    int firstDay = INT_MIN;     // 儒略日，闭区间；范围未知时覆盖全部日期，总会被加载
+    int lastDay = INT_MAX;
+    bool exact = false;         // true：解析过整个文件得到的范围；false：首尾行探测的估计
+
+    bool overlaps(int startDay, int endDay) const { return firstDay <= endDay && lastDay >= startDay; }
+};
+
+// 分区发现和范围索引。索引是缓存目录下的一个小文件，记录已解析分区的精确日期范围，
+// 文件大小或修改时间变化的条目不再使用。
+class FlowPartitions
+{
+public:
+    static const quint32 IndexMagic = 0x58444950;   // "PIDX"
+    static const quint32 IndexVersion = 1;
+
+    static bool isPartitionFileName(const QString &fileName);
+
+    // 递归查找目录下的分区文件，按路径排序
+    static QStringList discover(const QString &directory);
+
+    static QString indexPath(const QString &directory);
+    static QVector<FlowPartition> readIndex(const QString &indexPath);
+    static bool writeIndex(const QString &indexPath, const QVector<FlowPartition> &partitions, QString *error);
+};
+
+#endif // FLOWPARTITIONS_H
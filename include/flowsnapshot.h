@@ -0,0 +1,60 @@
+#ifndef FLOWSNAPSHOT_H
+#define FLOWSNAPSHOT_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include "loadrecords.h"
+#include "flowstore.h"
+
+// 二进制快照：一次CSV加载成功后，把站点、列车和列式客流连同字典写成一个文件，
+// 下次启动时内存映射读回，跳过CSV解析。
+// 快照记录源文件的大小、修改时间和抽样哈希，任一不符或文件损坏都视为失效，调用方应退回CSV加载。
+//
+// 文件布局（本机字节序）：
+//   [magic u32][version u32][metaSize u64][metaChecksum u64]
+//   [元数据：QDataStream序列化的源文件指纹、站点、列车、字典和行数]
+//   [各列原始数组，每列按64字节对齐]
+class FlowSnapshot
+{
+public:
+    static const quint32 Magic = 0x50414e53;   // "SNAP"
+    static const quint32 Version = 4;          // 2: 站点列改为按表头映射；3: 客流去重；4: 冷列可存为行偏移
+
+    // 源文件指纹
+    struct SourceFile {
+        QString fileName;
+        qint64 size = -1;
+        qint64 modified = 0;     // 修改时间，毫秒
+        QByteArray sampleHash;   // 文件头尾及均匀分布的若干块的SHA-1
+
+        bool operator==(const SourceFile &other) const {
+            return fileName == other.fileName && size == other.size
+                && modified == other.modified && sampleHash == other.sampleHash;
+        }
+        bool operator!=(const SourceFile &other) const { return !(*this == other); }
+    };
+
+    static SourceFile fingerprint(const QString &path);
+
+    // 数据目录对应的快照路径（位于系统缓存目录下）
+    static QString defaultPath(const QString &dataDirectory);
+
+    // 读写都只涉及普通数据，可以在后台线程中调用
+    static bool write(const QString &snapshotPath, const QVector<SourceFile> &sources,
+                      const QVector<StationRecord> &stations, const QVector<TrainRecord> &trains,
+                      const FlowStore &flows, QString *error = nullptr);
+
+    // 读取并校验快照，失败时输出参数保持不变
+    static bool read(const QString &snapshotPath, const QVector<SourceFile> &sources,
+                     QVector<StationRecord> &stations, QVector<TrainRecord> &trains,
+                     FlowStore &flows, QString *error = nullptr);
+
+private:
+    // 按固定顺序访问FlowStore的各列，写入和读取共用，保证列顺序一致；
+    // 冷列未解码时以行偏移代替冷列
+    template<typename Store, typename Visitor>
+    static bool forEachColumn(Store &store, bool coldPending, Visitor visit);
+};
+
+#endif // FLOWSNAPSHOT_H
@@ -0,0 +1,280 @@
+#ifndef FLOWSTORE_H
+#define FLOWSTORE_H
+
+#include <QVector>
+#include <QString>
+#include <QDate>
+#include <QTime>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include "stringdictionary.h"
+
+class FlowRow;
+class FlowView;
+class FlowColdSource;
+
+// 列式客流存储：每个字段一列连续数组，取代每条记录一个堆上QObject的做法。
+// 日期存为儒略日（QDate::toJulianDay），时间存为一天中的分钟数（-1表示无效），
+// 线路、车次、票种和起终点站存为字典编号。
+// 线路、到达时间、票价和起终点站是冷列：可以只记下各行在源文件中的偏移，
+// 第一次通过访问函数读取时才由FlowColdSource解码（线程安全，只解码一次）。
+// sortByDay之后各行按日期聚集，并有按天的行偏移表，日期范围查询得到的是一段连续的行。
+class FlowStore
+{
+public:
+    typedef quint16 DictId;
+    // 每个字典最多的项数：编号存为16位，超出时加载失败而不是让编号回绕成已有的值
+    static const int MaxDictionarySize = 0x10000;
+
+    struct Record {
+        int stationId = 0;
+        int dayNumber = 0;
+        int arrivalMinute = -1;
+        int departureMinute = -1;
+        int boardingPassengers = 0;
+        int alightingPassengers = 0;
+        double ticketPrice = 0.0;
+        double revenue = 0.0;
+        int lineId = 0;
+        int trainId = 0;
+        int ticketTypeId = 0;
+        int startStationId = 0;
+        int endStationId = 0;
+    };
+
+    int size() const { return m_stationId.size(); }
+    bool isEmpty() const { return m_stationId.isEmpty(); }
+    void reserve(int rows);
+    void clear();
+
+    // record中的字典编号须已由checkDictionaries确认在范围内
+    void append(const Record &record);
+    // 只追加热列，冷列记为源文件中rowOffset处的一行，稍后解码；需先调用deferColdColumns
+    void appendDeferred(const Record &record, qint64 rowOffset);
+    // 追加另一个存储的全部行，字典编号按本存储的字典重新映射；
+    // 双方冷列都未解码且来源相同时只合并行偏移，否则先解码再合并。
+    // 合并后某个字典超过MaxDictionarySize时不做任何修改，返回false并写入error
+    bool append(const FlowStore &other, QString *error = nullptr);
+    // append(other)能否成功，不修改本存储；删除other的行不改变结果（字典不变）
+    bool canAppend(const FlowStore &other, QString *error = nullptr) const;
+    // 删除给定的行（行号递增），其余行保持原有顺序；字典不变
+    void removeRows(const QVector<int> &rows);
+
+    FlowRow row(int index) const;
+    FlowView all() const;
+
+    // 按日期稳定排序（计数排序，同一天内保持原有顺序）并建立按天的行偏移表；已经有序时只建表。
+    // 之后追加的行日期不早于最后一天时偏移表随之延伸，否则失效，需要重新调用
+    void sortByDay();
+    bool isSortedByDay() const { return !m_dayOffsets.isEmpty(); }
+    // 日期在[startDay, endDay]（儒略日）内的行：按日期聚集时两次查表得到一段连续的行，不复制行号；
+    // 否则逐行筛选
+    FlowView dayRange(int startDay, int endDay) const;
+    // 按日期聚集时给出日期范围对应的行区间[beginRow, endRow)，否则返回false
+    bool dayRows(int startDay, int endDay, int *beginRow, int *endRow) const;
+
+    // 列访问
+    const QVector<qint32> &stationIds() const { return m_stationId; }
+    const QVector<qint32> &dayNumbers() const { return m_dayNumber; }
+    const QVector<qint16> &arrivalMinutes() const { ensureColdColumns(); return m_arrivalMinute; }
+    const QVector<qint16> &departureMinutes() const { return m_departureMinute; }
+    const QVector<qint32> &boardingPassengers() const { return m_boarding; }
+    const QVector<qint32> &alightingPassengers() const { return m_alighting; }
+    const QVector<double> &ticketPrices() const { ensureColdColumns(); return m_ticketPrice; }
+    const QVector<double> &revenues() const { return m_revenue; }
+    const QVector<DictId> &lineIds() const { ensureColdColumns(); return m_lineId; }
+    const QVector<DictId> &trainIds() const { return m_trainId; }
+    const QVector<DictId> &ticketTypeIds() const { return m_ticketTypeId; }
+    const QVector<DictId> &startStationIds() const { ensureColdColumns(); return m_startStationId; }
+    const QVector<DictId> &endStationIds() const { ensureColdColumns(); return m_endStationId; }
+
+    // 字典
+    StringDictionary &lineCodes() { ensureColdColumns(); return m_lineCodes; }
+    StringDictionary &trainCodes() { return m_trainCodes; }
+    StringDictionary &ticketTypes() { return m_ticketTypes; }
+    StringDictionary &stationNames() { ensureColdColumns(); return m_stationNames; }
+    const StringDictionary &lineCodes() const { ensureColdColumns(); return m_lineCodes; }
+    const StringDictionary &trainCodes() const { return m_trainCodes; }
+    const StringDictionary &ticketTypes() const { return m_ticketTypes; }
+    const StringDictionary &stationNames() const { ensureColdColumns(); return m_stationNames; }
+
+    // 冷列
+    bool hasPendingColdColumns() const { return m_coldPending.loadAcquire() != 0; }
+    QSharedPointer<FlowColdSource> coldSource() const { return m_coldSource; }
+    // 空存储（或冷列尚未解码的存储）改为从source按行偏移解码冷列
+    void deferColdColumns(const QSharedPointer<FlowColdSource> &source);
+    // 立即解码尚未解码的冷列；来源缺失或文件已变化时记下错误，冷列只是占位
+    void materializeColdColumns() const;
+    // 冷列解码失败：线路、到达时间、票价和起止站都不可用，调用方不能把占位值当作数据
+    bool hasColdColumnsError() const { ensureColdColumns(); return !m_coldError.isEmpty(); }
+    QString coldColumnsError() const { ensureColdColumns(); return m_coldError; }
+
+    // 列数据和字典占用的字节数
+    qint64 memoryUsage() const;
+
+    // 各字典都不超过MaxDictionarySize时返回true，否则写入error；冷列未解码时只检查热列的字典
+    bool checkDictionaries(QString *error) const;
+    static QString dictionaryOverflowError(const QString &name);
+
+    static int minuteOfDay(const QTime &time) { return time.isValid() ? time.hour() * 60 + time.minute() : -1; }
+    static QTime timeFromMinute(int minute) { return minute >= 0 ? QTime(minute / 60, minute % 60) : QTime(); }
+
+private:
+    friend class FlowSnapshot;
+    friend class FlowBlockFile;
+    friend class FlowColumnFile;
+
+    // append(other)是否只合并冷列的行偏移
+    bool appendsDeferred(const FlowStore &other) const;
+    static DictId dictId(int id)
+    {
+        Q_ASSERT(id >= 0 && id < MaxDictionarySize);
+        return static_cast<DictId>(id);
+    }
+    void ensureColdColumns() const
+    {
+        if (m_coldPending.loadAcquire()) {
+            materializeColdColumns();
+        }
+    }
+    // 检查各行是否已按日期有序，有序时重建偏移表
+    bool buildDayIndex();
+    // 在firstRow之后追加了行，延伸偏移表或使其失效
+    void extendDayIndex(int firstRow);
+
+    QVector<qint32> m_stationId;
+    QVector<qint32> m_dayNumber;
+    mutable QVector<qint16> m_arrivalMinute;
+    QVector<qint16> m_departureMinute;
+    QVector<qint32> m_boarding;
+    QVector<qint32> m_alighting;
+    mutable QVector<double> m_ticketPrice;
+    QVector<double> m_revenue;
+    mutable QVector<DictId> m_lineId;
+    QVector<DictId> m_trainId;
+    QVector<DictId> m_ticketTypeId;
+    mutable QVector<DictId> m_startStationId;
+    mutable QVector<DictId> m_endStationId;
+
+    mutable StringDictionary m_lineCodes;
+    StringDictionary m_trainCodes;
+    StringDictionary m_ticketTypes;
+    mutable StringDictionary m_stationNames;
+
+    // 冷列未解码时：各行在源文件中的偏移和来源；解码后两者都释放
+    mutable QVector<qint64> m_rowOffsets;
+    mutable QSharedPointer<FlowColdSource> m_coldSource;
+    mutable QAtomicInt m_coldPending;
+    mutable QString m_coldError;
+
+    // 按天的行偏移：第k项是日期为m_firstDay+k的第一行，末项是行数；为空表示未按日期聚集
+    int m_firstDay = 0;
+    QVector<int> m_dayOffsets;
+};
+
+// 单行视图：接口与PassengerFlow的取值函数一致，便于调用方逐步迁移
+class FlowRow
+{
+public:
+    FlowRow() : m_store(nullptr), m_row(-1) {}
+    FlowRow(const FlowStore *store, int row) : m_store(store), m_row(row) {}
+
+    int row() const { return m_row; }
+    bool isValid() const { return m_store && m_row >= 0; }
+
+    QString getLineCode() const { return m_store->lineCodes().value(getLineId()); }
+    QString getTrainCode() const { return m_store->trainCodes().value(getTrainId()); }
+    int getStationId() const { return m_store->stationIds()[m_row]; }
+    int getDayNumber() const { return m_store->dayNumbers()[m_row]; }
+    QDate getDate() const { return QDate::fromJulianDay(getDayNumber()); }
+    QTime getArrivalTime() const { return FlowStore::timeFromMinute(m_store->arrivalMinutes()[m_row]); }
+    QTime getDepartureTime() const { return FlowStore::timeFromMinute(m_store->departureMinutes()[m_row]); }
+    int getBoardingPassengers() const { return m_store->boardingPassengers()[m_row]; }
+    int getAlightingPassengers() const { return m_store->alightingPassengers()[m_row]; }
+    int getTotalPassengers() const { return getBoardingPassengers() + getAlightingPassengers(); }
+    QString getTicketType() const { return m_store->ticketTypes().value(getTicketTypeId()); }
+    double getTicketPrice() const { return m_store->ticketPrices()[m_row]; }
+    double getRevenue() const { return m_store->revenues()[m_row]; }
+    QString getStartStation() const { return m_store->stationNames().value(m_store->startStationIds()[m_row]); }
+    QString getEndStation() const { return m_store->stationNames().value(m_store->endStationIds()[m_row]); }
+
+    // 字典编号
+    int getLineId() const { return m_store->lineIds()[m_row]; }
+    int getTrainId() const { return m_store->trainIds()[m_row]; }
+    int getTicketTypeId() const { return m_store->ticketTypeIds()[m_row]; }
+
+    // Time analysis
+    int getHour() const {
+        int minute = m_store->departureMinutes()[m_row];
+        return minute >= 0 ? minute / 60 : -1;
+    }
+    // 与QDate::dayOfWeek一致：儒略日0是星期一
+    int getDayOfWeek() const { return getDayNumber() % 7 + 1; }
+    bool isWeekend() const { return getDayOfWeek() > 5; }
+    bool isPeakHour() const {
+        int hour = getHour();
+        return (hour >= 7 && hour <= 9) || (hour >= 17 && hour <= 19);
+    }
+
+private:
+    const FlowStore *m_store;
+    int m_row;
+};
+
+// 多行视图：要么是存储中的一段连续行，要么是一组行号（或其中的一段）；不复制列数据
+class FlowView
+{
+public:
+    FlowView() : m_store(nullptr), m_begin(0), m_end(0) {}
+    FlowView(const FlowStore *store, int begin, int end)
+        : m_store(store), m_begin(begin), m_end(end) {}
+    FlowView(const FlowStore *store, const QVector<int> &rows)
+        : m_store(store), m_begin(0), m_end(rows.size()), m_rows(rows), m_selection(true) {}
+    // rows中[begin, end)这一段，rows隐式共享，不复制
+    FlowView(const FlowStore *store, const QVector<int> &rows, int begin, int end)
+        : m_store(store), m_begin(begin), m_end(end), m_rows(rows), m_selection(true) {}
+
+    int size() const { return m_end - m_begin; }
+    bool isEmpty() const { return m_end <= m_begin; }
+    const FlowStore *store() const { return m_store; }
+
+    int rowAt(int i) const { return m_selection ? m_rows[m_begin + i] : m_begin + i; }
+    FlowRow at(int i) const { return FlowRow(m_store, rowAt(i)); }
+    FlowRow operator[](int i) const { return at(i); }
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const FlowView *view, int i) : m_view(view), m_i(i) {}
+        FlowRow operator*() const { return m_view->at(m_i); }
+        const_iterator &operator++() { ++m_i; return *this; }
+        bool operator==(const const_iterator &other) const { return m_i == other.m_i; }
+        bool operator!=(const const_iterator &other) const { return m_i != other.m_i; }
+
+    private:
+        const FlowView *m_view;
+        int m_i;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    const FlowStore *m_store;
+    int m_begin;
+    int m_end;
+    QVector<int> m_rows;
+    bool m_selection = false;
+};
+
+inline FlowRow FlowStore::row(int index) const
+{
+    return FlowRow(this, index);
+}
+
+inline FlowView FlowStore::all() const
+{
+    return FlowView(this, 0, size());
+}
+
+#endif // FLOWSTORE_H
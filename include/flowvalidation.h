@@ -0,0 +1,69 @@
+#ifndef FLOWVALIDATION_H
+#define FLOWVALIDATION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSaveFile>
+
+// 客流数据质量检查的规则、逐块结果和汇总报告。扫描由DataManager::validateData按批并行完成，
+// 与加载共用分批读取和列映射；每块得到一个Chunk，按文件顺序合并进报告，
+// 违规行的文件、字节偏移和违反的规则追加写入隔离文件（TSV），便于回到原始数据中定位。
+class FlowValidation
+{
+public:
+    enum Rule {
+        MalformedRow,       // 字段数不足
+        UnknownStation,     // 站点ID不在站点表中
+        UnknownTrain,       // 列车编码不在列车表中
+        InvalidDate,        // 日期无法识别或年月日不合法（加载时会被当作2015-01-01或丢弃）
+        NegativeCount,      // 上客量或下客量为负
+        RevenueMismatch,    // 票价或收入为负，或收入超过票价×(上客量+下客量)
+        RuleCount
+    };
+
+    static QString ruleName(Rule rule);         // 隔离文件中使用的英文标识
+    static QString ruleDescription(Rule rule);
+
+    // 一段数据的检查结果，违规行按出现顺序记录
+    struct Chunk {
+        qint64 rows = 0;
+        qint64 counts[RuleCount] = {};
+        QVector<qint64> offsets;    // 违规行在（解压后）文件中的字节偏移
+        QVector<quint8> rules;      // 对应行违反的规则，按位
+
+        void reject(qint64 offset, quint8 ruleMask);
+    };
+
+    struct Report {
+        qint64 rows = 0;
+        qint64 rejectedRows = 0;    // 至少违反一条规则的行
+        qint64 counts[RuleCount] = {};
+        QStringList files;
+        QString quarantinePath;
+        QString reportPath;
+        qint64 elapsedMs = 0;
+        QString error;              // 检查本身没能完成时的原因
+        bool cancelled = false;     // 用户取消，error同时给出说明
+
+        bool isClean() const { return error.isEmpty() && rejectedRows == 0; }
+        QString toText() const;
+    };
+
+    // 隔离文件和报告文件：<base>.quarantine.tsv、<base>.report.txt
+    class Writer
+    {
+    public:
+        bool open(const QString &basePath, Report &report, QString *error);
+        bool append(const QString &file, const Chunk &chunk, Report &report, QString *error);
+        bool finish(Report &report, QString *error);
+
+    private:
+        QSaveFile m_quarantine;
+    };
+
+    // 数据目录对应的输出路径前缀（位于系统缓存目录下）
+    static QString defaultBasePath(const QString &dataDirectory);
+};
+
+#endif // FLOWVALIDATION_H
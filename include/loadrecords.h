@@ -0,0 +1,33 @@
+#ifndef LOADRECORDS_H
+#define LOADRECORDS_H
+
+#include <QString>
+#include <QVector>
+
+// 加载阶段使用的普通数据：可以在任意线程中生成，
+// Station/Train对象只在DataManager所在的线程中据此创建
+struct StationRecord {
+    int id = 0;
+    QString name;
+    QString code;
+    QString shortName;
+    QString telecode;
+};
+
+struct TrainRecord {
+    QString code;
+    QString trainCode;
+    int capacity = 0;
+};
+
+// 运营线路客运站.csv的一行：某条运营线路上的一个站点
+struct RouteStationRecord {
+    QString lineCode;           // 运营线路编码
+    int stationId = 0;
+    int order = 0;              // 线路站点id，线路内的顺序
+    int sectionDistance = 0;    // 与上一站的距离（公里）
+    int transportDistance = 0;  // 运输距离（到线路终点，公里）
+    bool stop = false;          // 是否要停靠
+};
+
+#endif // LOADRECORDS_H
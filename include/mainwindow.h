@@ -41,6 +41,7 @@ protected:
 private slots:
     // Data management
     void onLoadData();
+    void onCancelLoad();
     void onExportData();
     void onExportChart();
     
@@ -71,6 +72,18 @@ private slots:
     // Data events
     void onDataLoaded();
     void onDataLoadError(const QString &error);
+    void onStationsAndTrainsLoaded();
+    void onLoadProgress(qint64 bytesRead, qint64 totalBytes);
+    void onLoadingCancelled();
+    void onPartitionsLoaded();
+    void onTailModeToggled(bool enabled);
+    void onOutOfCoreToggled(bool enabled);
+    void onFlowsAppended(int firstRow, int count);
+    void onSaveToDatabase();
+    void onLoadFromDatabase();
+    void onExportFlows();
+    void onValidateData();
+    void onValidationFinished(const FlowValidation::Report &report);
     
     // Utility actions
     void onSettings();
@@ -125,6 +138,7 @@ private:
     QStatusBar *m_statusBar;
     QLabel *m_statusLabel;
     QProgressBar *m_progressBar;
+    QAction *m_cancelLoadAction;
     
     // Control buttons
     QPushButton *m_analyzeButton;
@@ -3,18 +3,17 @@
 
 #include <QString>
 #include <QDateTime>
-#include <QObject>
 
-class PassengerFlow : public QObject
+// 旧接口的逐行对象，普通数据类：DataManager::getPassengerFlows()在区块分配器中成批构造，
+// 字符串与列存储的字典共享，整批释放时只需递减引用计数
+class PassengerFlow
 {
-    Q_OBJECT
-
 public:
-    explicit PassengerFlow(QObject *parent = nullptr);
+    PassengerFlow();
     PassengerFlow(const QString &lineCode, const QString &trainCode, int stationId,
                   const QDate &date, const QTime &arrivalTime, const QTime &departureTime,
                   int boardingPassengers, int alightingPassengers, const QString &ticketType,
-                  double ticketPrice, double revenue, QObject *parent = nullptr);
+                  double ticketPrice, double revenue);
     
     // Getters
     QString getLineCode() const { return m_lineCode; }
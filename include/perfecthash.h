@@ -0,0 +1,33 @@
+#ifndef PERFECTHASH_H
+#define PERFECTHASH_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 加载后不再变化的字符串集合的完美哈希表（hash-and-displace）：键先按一次哈希分到小桶，
+// 每个桶找一个位移种子让桶内的键落到互不冲突的槽位，查找固定为两次哈希、一次字符串比较。
+// 值就是键在build传入列表中的下标，调用方据此索引自己的数组。
+class PerfectHash
+{
+public:
+    // 重复的键只保留第一次出现的下标；空字符串不参与
+    void build(const QStringList &keys);
+    void clear();
+
+    // 键在build传入列表中的下标，不存在时返回-1
+    int find(const QString &key) const;
+    int size() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+
+private:
+    static uint slotHash(const QString &key, uint seed) { return static_cast<uint>(qHash(key, seed)); }
+
+    QVector<uint> m_seeds;      // 每个桶的位移种子
+    QVector<int> m_slots;       // 槽位 → 键下标，空槽为-1
+    QStringList m_keys;         // 查找时核对键是否真的在集合中
+    int m_count = 0;
+};
+
+#endif // PERFECTHASH_H
@@ -68,6 +68,15 @@ private:
     ModelParameters m_currentParams;
     QVector<double> m_trainedCoefficients;
     
+    // 预测方法的实际计算；公开方法先按目标、日期、天数和实际使用的模型参数查AnalysisEngine的结果缓存
+    QVector<PredictionResult> forecastPassengerFlow(const QDate &startDate, int days, const ModelParameters &params);
+    QVector<PredictionResult> forecastStationFlow(const QString &stationName, const QDate &startDate,
+                                                  int days, const ModelParameters &params);
+    QVector<PredictionResult> forecastTrainFlow(const QString &trainNumber, const QDate &startDate,
+                                                int days, const ModelParameters &params);
+    QString predictionSignature(const char *method, const QString &target, const QDate &startDate,
+                                int days, const ModelParameters &params) const;
+
     // Helper methods
     QVector<double> extractTimeSeries(const QVector<AnalysisEngine::TimeSeriesData> &data) const;
     double calculateHoltWinters(const QVector<double> &data, int index, 
@@ -0,0 +1,73 @@
+#ifndef ROUTEGRAPH_H
+#define ROUTEGRAPH_H
+
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include "loadrecords.h"
+
+// 运营线路拓扑：站点为顶点，同一线路上相邻两站之间为一条无向边（两个方向各存一次）。
+// 邻接关系按CSR存放：顶点v的边是 [edgeBegin(v), edgeEnd(v))，边的终点、距离和所属线路各一列。
+// 每条线路的站点按线路内顺序连续存放，同时记录从线路起点起算的累计距离，
+// 同一线路上两站之间的距离只是两个累计值之差。
+class RouteGraph
+{
+public:
+    void build(const QVector<RouteStationRecord> &records);
+    void clear();
+    bool isEmpty() const { return m_stationIds.isEmpty(); }
+
+    // 顶点：站点id与连续的顶点编号互相转换，站点不在图中时返回-1
+    int nodeCount() const { return m_stationIds.size(); }
+    int nodeOf(int stationId) const { return m_nodeByStation.value(stationId, -1); }
+    int stationIdOf(int node) const { return m_stationIds[node]; }
+
+    // 边
+    int edgeCount() const { return m_edgeTargets.size(); }
+    int edgeBegin(int node) const { return m_edgeOffsets[node]; }
+    int edgeEnd(int node) const { return m_edgeOffsets[node + 1]; }
+    int edgeTarget(int edge) const { return m_edgeTargets[edge]; }
+    int edgeDistance(int edge) const { return m_edgeDistances[edge]; }
+    int edgeLine(int edge) const { return m_edgeLines[edge]; }
+
+    // 线路：编号按运营线路编码首次出现的顺序
+    int lineCount() const { return m_lineCodes.size(); }
+    int lineIndex(const QString &lineCode) const { return m_lineCodes.indexOf(lineCode); }
+    const QString &lineCode(int line) const { return m_lineCodes[line]; }
+    int lineStationCount(int line) const { return m_lineOffsets[line + 1] - m_lineOffsets[line]; }
+    int lineStationId(int line, int position) const { return m_lineStations[m_lineOffsets[line] + position]; }
+    int lineDistance(int line, int position) const { return m_lineDistances[m_lineOffsets[line] + position]; }
+    int lineTransportDistance(int line, int position) const { return m_lineTransportDistances[m_lineOffsets[line] + position]; }
+    bool lineStops(int line, int position) const { return m_lineStops[m_lineOffsets[line] + position]; }
+    // 站点在线路中的位置，不在线路上时返回-1
+    int linePosition(int line, int stationId) const;
+
+    // 同一线路上两站之间的距离（公里），任一站不在线路上时返回-1
+    int distanceAlongLine(int line, int fromStationId, int toStationId) const;
+
+    // 全网最短距离（Dijkstra），不连通时返回-1；path非空时填入途经的站点id（含起终点）
+    int shortestDistance(int fromStationId, int toStationId, QVector<int> *path = nullptr) const;
+
+    qint64 memoryUsage() const;
+
+private:
+    // 顶点
+    QVector<int> m_stationIds;
+    QHash<int, int> m_nodeByStation;
+
+    // CSR邻接表
+    QVector<int> m_edgeOffsets;
+    QVector<int> m_edgeTargets;
+    QVector<int> m_edgeDistances;
+    QVector<quint16> m_edgeLines;
+
+    // 各线路的有序站点，线路line占 [m_lineOffsets[line], m_lineOffsets[line + 1])
+    QVector<QString> m_lineCodes;
+    QVector<int> m_lineOffsets;
+    QVector<int> m_lineStations;
+    QVector<int> m_lineDistances;
+    QVector<int> m_lineTransportDistances;
+    QVector<bool> m_lineStops;
+};
+
+#endif // ROUTEGRAPH_H
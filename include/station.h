@@ -2,15 +2,13 @@
 #define STATION_H
 
 #include <QString>
-#include <QObject>
 
-class Station : public QObject
+// 普通数据类，不是QObject：由DataManager的区块分配器成批构造，重新加载时整块释放
+class Station
 {
-    Q_OBJECT
-
 public:
-    explicit Station(QObject *parent = nullptr);
-    Station(int id, const QString &name, const QString &code, const QString &shortName, QObject *parent = nullptr);
+    Station();
+    Station(int id, const QString &name, const QString &code, const QString &shortName);
     
     // Getters
     int getId() const { return m_id; }
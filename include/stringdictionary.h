@@ -0,0 +1,32 @@
+#ifndef STRINGDICTIONARY_H
+#define STRINGDICTIONARY_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// 字符串字典：相同内容分配同一个稠密编号，编号按首次出现的顺序分配。
+// 以UTF-8字节为键，解析CSV时查找不复制字节，只在第一次出现时解码。
+class StringDictionary
+{
+public:
+    int insert(QByteArrayView utf8);
+    int insert(const QString &value) { return insert(QByteArrayView(value.toUtf8())); }
+    int find(const QString &value) const;
+    // 直接按UTF-8字节查找，不复制也不解码
+    int find(QByteArrayView utf8) const;
+
+    const QString &value(int id) const { return m_values.at(id); }
+    const QVector<QString> &values() const { return m_values; }
+    int size() const { return m_values.size(); }
+    bool isEmpty() const { return m_values.isEmpty(); }
+    void clear();
+
+private:
+    QHash<QByteArray, int> m_ids;
+    QVector<QString> m_values;
+};
+
+#endif // STRINGDICTIONARY_H
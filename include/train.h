@@ -10,15 +10,13 @@
 #define TRAIN_H
 
 #include <QString>
-#include <QObject>
 
-class Train : public QObject
+// 普通数据类，不是QObject：由DataManager的区块分配器成批构造，重新加载时整块释放
+class Train
 {
-    Q_OBJECT
-
 public:
-    explicit Train(QObject *parent = nullptr);
-    Train(const QString &code, const QString &trainCode, int capacity, QObject *parent = nullptr);
+    Train();
+    Train(const QString &code, const QString &trainCode, int capacity);
     
     // Getters
     QString getCode() const { return m_code; }
@@ -0,0 +1,49 @@
+#include "analysiscache.h"
+
+void AnalysisCache::clear()
+{
+    m_entries.clear();
+    m_bytes = 0;
+}
+
+void AnalysisCache::setBudget(qint64 bytes)
+{
+    m_budget = bytes;
+    evict();
+}
+
+void AnalysisCache::insert(const QString &signature, const QSharedPointer<Holder> &value, qint64 bytes)
+{
+    // compute中的嵌套查询可能已经放入了同一签名
+    const auto existing = m_entries.constFind(signature);
+    if (existing != m_entries.constEnd()) {
+        m_bytes -= existing->bytes;
+    }
+    if (bytes > m_budget) {
+        m_entries.remove(signature);
+        return;
+    }
+
+    Entry entry;
+    entry.value = value;
+    entry.bytes = bytes;
+    entry.lastUsed = ++m_clock;
+    m_entries.insert(signature, entry);
+    m_bytes += bytes;
+    evict();
+}
+
+void AnalysisCache::evict()
+{
+    while (m_bytes > m_budget && !m_entries.isEmpty()) {
+        auto victim = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->lastUsed < victim->lastUsed) {
+                victim = it;
+            }
+        }
+        m_bytes -= victim->bytes;
+        m_entries.erase(victim);
+        ++m_evictions;
+    }
+}
@@ -10,52 +10,228 @@ AnalysisEngine::AnalysisEngine(DataManager *dataManager, QObject *parent)
 {
 }
 
+// 公开的分析方法先查结果缓存：签名是方法名和参数，数据代号变化后缓存整体失效
 QVector<AnalysisEngine::StationStatistics> AnalysisEngine::getStationStatistics() const
+{
+    const QString signature = AnalysisCache::signature("getStationStatistics");
+    return m_cache.get<QVector<StationStatistics>>(signature, dataGeneration(), [this]() {
+        return computeStationStatistics();
+    });
+}
+
+QVector<AnalysisEngine::TrainStatistics> AnalysisEngine::getTrainStatistics() const
+{
+    const QString signature = AnalysisCache::signature("getTrainStatistics");
+    return m_cache.get<QVector<TrainStatistics>>(signature, dataGeneration(), [this]() {
+        return computeTrainStatistics();
+    });
+}
+
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getTimeSeriesData(const QDate &startDate, const QDate &endDate) const
+{
+    const QString signature = AnalysisCache::signature("getTimeSeriesData", startDate, endDate);
+    return m_cache.get<QVector<TimeSeriesData>>(signature, dataGeneration(), [&]() {
+        return computeTimeSeriesData(startDate, endDate);
+    });
+}
+
+QVector<QPair<QString, QString>> AnalysisEngine::getStationCorrelations() const
+{
+    const QString signature = AnalysisCache::signature("getStationCorrelations");
+    return m_cache.get<QVector<QPair<QString, QString>>>(signature, dataGeneration(), [this]() {
+        return computeStationCorrelations();
+    });
+}
+
+QVector<QPair<QString, QString>> AnalysisEngine::getTrainCorrelations() const
+{
+    const QString signature = AnalysisCache::signature("getTrainCorrelations");
+    return m_cache.get<QVector<QPair<QString, QString>>>(signature, dataGeneration(), [this]() {
+        return computeTrainCorrelations();
+    });
+}
+
+QMap<QString, double> AnalysisEngine::getStationRevenueAnalysis() const
+{
+    const QString signature = AnalysisCache::signature("getStationRevenueAnalysis");
+    return m_cache.get<QMap<QString, double>>(signature, dataGeneration(), [this]() {
+        return computeStationRevenueAnalysis();
+    });
+}
+
+QMap<QString, double> AnalysisEngine::getTrainRevenueAnalysis() const
+{
+    const QString signature = AnalysisCache::signature("getTrainRevenueAnalysis");
+    return m_cache.get<QMap<QString, double>>(signature, dataGeneration(), [this]() {
+        return computeTrainRevenueAnalysis();
+    });
+}
+
+double AnalysisEngine::getAverageTicketPrice() const
+{
+    const QString signature = AnalysisCache::signature("getAverageTicketPrice");
+    return m_cache.get<double>(signature, dataGeneration(), [this]() {
+        return computeAverageTicketPrice();
+    });
+}
+
+QMap<QString, double> AnalysisEngine::getStationFlowByDateRange(const QDate &startDate, const QDate &endDate) const
+{
+    const QString signature = AnalysisCache::signature("getStationFlowByDateRange", startDate, endDate);
+    return m_cache.get<QMap<QString, double>>(signature, dataGeneration(), [&]() {
+        return computeStationFlowByDateRange(startDate, endDate);
+    });
+}
+
+QMap<QString, double> AnalysisEngine::getTrainFlowByDateRange(const QDate &startDate, const QDate &endDate) const
+{
+    const QString signature = AnalysisCache::signature("getTrainFlowByDateRange", startDate, endDate);
+    return m_cache.get<QMap<QString, double>>(signature, dataGeneration(), [&]() {
+        return computeTrainFlowByDateRange(startDate, endDate);
+    });
+}
+
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getTotalPassengerFlowTimeSeries(const QDate &startDate, const QDate &endDate) const
+{
+    const QString signature = AnalysisCache::signature("getTotalPassengerFlowTimeSeries", startDate, endDate);
+    return m_cache.get<QVector<TimeSeriesData>>(signature, dataGeneration(), [&]() {
+        return computeTotalPassengerFlowTimeSeries(startDate, endDate);
+    });
+}
+
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getPassengerFlowTimeSeriesByStation(const QString &stationName, const QDate &startDate, const QDate &endDate) const
+{
+    const QString signature = AnalysisCache::signature("getPassengerFlowTimeSeriesByStation", stationName, startDate, endDate);
+    return m_cache.get<QVector<TimeSeriesData>>(signature, dataGeneration(), [&]() {
+        return computePassengerFlowTimeSeriesByStation(stationName, startDate, endDate);
+    });
+}
+
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getPassengerFlowTimeSeriesByTrain(const QString &trainNumber, const QDate &startDate, const QDate &endDate) const
+{
+    const QString signature = AnalysisCache::signature("getPassengerFlowTimeSeriesByTrain", trainNumber, startDate, endDate);
+    return m_cache.get<QVector<TimeSeriesData>>(signature, dataGeneration(), [&]() {
+        return computePassengerFlowTimeSeriesByTrain(trainNumber, startDate, endDate);
+    });
+}
+
+QVector<QPointF> AnalysisEngine::getFlowAndTrainCountCorrelation(const QDate &startDate, const QDate &endDate) const
+{
+    const QString signature = AnalysisCache::signature("getFlowAndTrainCountCorrelation", startDate, endDate);
+    return m_cache.get<QVector<QPointF>>(signature, dataGeneration(), [&]() {
+        return computeFlowAndTrainCountCorrelation(startDate, endDate);
+    });
+}
+
+QVector<QPair<QString, double>> AnalysisEngine::getStationEfficiency() const
+{
+    const QString signature = AnalysisCache::signature("getStationEfficiency");
+    return m_cache.get<QVector<QPair<QString, double>>>(signature, dataGeneration(), [this]() {
+        return computeStationEfficiency();
+    });
+}
+
+QVector<QPair<QString, double>> AnalysisEngine::getTrainEfficiency() const
+{
+    const QString signature = AnalysisCache::signature("getTrainEfficiency");
+    return m_cache.get<QVector<QPair<QString, double>>>(signature, dataGeneration(), [this]() {
+        return computeTrainEfficiency();
+    });
+}
+
+QMap<QString, QMap<int, int>> AnalysisEngine::getStationHourlyPatterns() const
+{
+    const QString signature = AnalysisCache::signature("getStationHourlyPatterns");
+    return m_cache.get<QMap<QString, QMap<int, int>>>(signature, dataGeneration(), [this]() {
+        return computeStationHourlyPatterns();
+    });
+}
+
+QMap<QString, QMap<int, int>> AnalysisEngine::getStationDailyPatterns() const
+{
+    const QString signature = AnalysisCache::signature("getStationDailyPatterns");
+    return m_cache.get<QMap<QString, QMap<int, int>>>(signature, dataGeneration(), [this]() {
+        return computeStationDailyPatterns();
+    });
+}
+
+QString AnalysisEngine::getAnalysisSummary() const
+{
+    const QString signature = AnalysisCache::signature("getAnalysisSummary");
+    return m_cache.get<QString>(signature, dataGeneration(), [this]() {
+        return computeAnalysisSummary();
+    });
+}
+
+QVector<AnalysisEngine::TicketTypeAnalysis> AnalysisEngine::getTicketTypeAnalysis(const QDate &startDate, const QDate &endDate) const
+{
+    const QString signature = AnalysisCache::signature("getTicketTypeAnalysis", startDate, endDate);
+    return m_cache.get<QVector<TicketTypeAnalysis>>(signature, dataGeneration(), [&]() {
+        return computeTicketTypeAnalysis(startDate, endDate);
+    });
+}
+
+QMap<double, int> AnalysisEngine::getTicketPriceDistribution() const
+{
+    const QString signature = AnalysisCache::signature("getTicketPriceDistribution");
+    return m_cache.get<QMap<double, int>>(signature, dataGeneration(), [this]() {
+        return computeTicketPriceDistribution();
+    });
+}
+
+QMap<QString, QMap<double, int>> AnalysisEngine::getTicketTypeAndPriceAnalysis() const
+{
+    const QString signature = AnalysisCache::signature("getTicketTypeAndPriceAnalysis");
+    return m_cache.get<QMap<QString, QMap<double, int>>>(signature, dataGeneration(), [this]() {
+        return computeTicketTypeAndPriceAnalysis();
+    });
+}
+
+QVector<AnalysisEngine::StationStatistics> AnalysisEngine::computeStationStatistics() const
 {
     QVector<StationStatistics> stats;
-    QMap<QString, QVector<PassengerFlow*>> stationFlows;
+
+    // 按站点名称累加，不保留客流行，核外模式下逐块扫描
+    struct StationTotals {
+        StationStatistics stat = StationStatistics{QString(), 0, 0, 0, 0.0, 0.0, 0, 0};
+        int flowCount = 0;
+        QMap<int, int> hourlyStats;
+        QMap<int, int> dailyStats;
+    };
+    QMap<QString, StationTotals> stationTotals;
     
     // Group flows by station
-    for (PassengerFlow *flow : m_dataManager->getPassengerFlows()) {
-        if (!flow) continue; // 防止空指针
-        Station *station = m_dataManager->getStationById(flow->getStationId());
-        if (station) {
-            stationFlows[station->getName()].append(flow);
+    scanFlows([this, &stationTotals](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            Station *station = m_dataManager->getStationById(flow.getStationId());
+            if (station) {
+                StationTotals &totals = stationTotals[station->getName()];
+                totals.stat.totalPassengers += flow.getTotalPassengers();
+                totals.stat.boardingPassengers += flow.getBoardingPassengers();
+                totals.stat.alightingPassengers += flow.getAlightingPassengers();
+                totals.stat.totalRevenue += flow.getRevenue();
+                totals.flowCount++;
+
+                totals.hourlyStats[flow.getHour()] += flow.getTotalPassengers();
+                totals.dailyStats[flow.getDayOfWeek()] += flow.getTotalPassengers();
+            }
         }
-    }
+    });
     
     // Calculate statistics for each station
-    for (auto it = stationFlows.begin(); it != stationFlows.end(); ++it) {
-        const QString &stationName = it.key();
-        const QVector<PassengerFlow*> &flows = it.value();
-        
-        StationStatistics stat;
-        stat.stationName = stationName;
-        stat.totalPassengers = 0;
-        stat.boardingPassengers = 0;
-        stat.alightingPassengers = 0;
-        stat.totalRevenue = 0.0;
+    for (auto it = stationTotals.begin(); it != stationTotals.end(); ++it) {
+        const StationTotals &totals = it.value();
         
-        QMap<int, int> hourlyStats;
-        QMap<int, int> dailyStats;
-        
-        for (const PassengerFlow *flow : flows) {
-            stat.totalPassengers += flow->getTotalPassengers();
-            stat.boardingPassengers += flow->getBoardingPassengers();
-            stat.alightingPassengers += flow->getAlightingPassengers();
-            stat.totalRevenue += flow->getRevenue();
-            
-            hourlyStats[flow->getHour()] += flow->getTotalPassengers();
-            dailyStats[flow->getDayOfWeek()] += flow->getTotalPassengers();
-        }
+        StationStatistics stat = totals.stat;
+        stat.stationName = it.key();
         
         // Calculate average ticket price
-        stat.averageTicketPrice = flows.size() > 0 ? stat.totalRevenue / flows.size() : 0.0;
+        stat.averageTicketPrice = totals.flowCount > 0 ? stat.totalRevenue / totals.flowCount : 0.0;
         
         // Find peak hour and day
         int maxHourValue = 0;
         int maxHourKey = 0;
-        for (auto it = hourlyStats.begin(); it != hourlyStats.end(); ++it) {
+        for (auto it = totals.hourlyStats.begin(); it != totals.hourlyStats.end(); ++it) {
             if (it.value() > maxHourValue) {
                 maxHourValue = it.value();
                 maxHourKey = it.key();
@@ -65,7 +241,7 @@ QVector<AnalysisEngine::StationStatistics> AnalysisEngine::getStationStatistics(
         
         int maxDayValue = 0;
         int maxDayKey = 0;
-        for (auto it = dailyStats.begin(); it != dailyStats.end(); ++it) {
+        for (auto it = totals.dailyStats.begin(); it != totals.dailyStats.end(); ++it) {
             if (it.value() > maxDayValue) {
                 maxDayValue = it.value();
                 maxDayKey = it.key();
@@ -85,33 +261,39 @@ QVector<AnalysisEngine::StationStatistics> AnalysisEngine::getStationStatistics(
     return stats;
 }
 
-QVector<AnalysisEngine::TrainStatistics> AnalysisEngine::getTrainStatistics() const
+QVector<AnalysisEngine::TrainStatistics> AnalysisEngine::computeTrainStatistics() const
 {
     QVector<TrainStatistics> stats;
-    QMap<QString, QVector<PassengerFlow*>> trainFlows;
-    
-    // Group flows by train
-    for (PassengerFlow *flow : m_dataManager->getPassengerFlows()) {
-        trainFlows[flow->getTrainCode()].append(flow);
-    }
+
+    // Group flows by train：按车次字典编号直接累加，车次字符串只在输出时取一次。
+    // 核外模式下各块共用同一套字典编号
+    QVector<TrainStatistics> byTrain;
+    StringDictionary trainCodes;
+    scanFlows([&byTrain, &trainCodes](const FlowView &flows) {
+        if (!flows.store()) {
+            return;
+        }
+        trainCodes = flows.store()->trainCodes();
+        if (byTrain.size() < trainCodes.size()) {
+            byTrain.resize(trainCodes.size(), TrainStatistics{QString(), 0, 0.0, 0.0, 0.0, 0});
+        }
+        for (FlowRow flow : flows) {
+            TrainStatistics &stat = byTrain[flow.getTrainId()];
+            stat.totalPassengers += flow.getTotalPassengers();
+            stat.totalRevenue += flow.getRevenue();
+            stat.totalTrips++;
+        }
+    });
     
     // Calculate statistics for each train
-    for (auto it = trainFlows.begin(); it != trainFlows.end(); ++it) {
-        const QString &trainCode = it.key();
-        const QVector<PassengerFlow*> &flows = it.value();
-        
-        Train *train = m_dataManager->getTrainByCode(trainCode);
-        
-        TrainStatistics stat;
-        stat.trainCode = trainCode;
-        stat.totalPassengers = 0;
-        stat.totalRevenue = 0.0;
-        stat.totalTrips = flows.size();
-        
-        for (const PassengerFlow *flow : flows) {
-            stat.totalPassengers += flow->getTotalPassengers();
-            stat.totalRevenue += flow->getRevenue();
+    for (int trainId = 0; trainId < byTrain.size(); ++trainId) {
+        TrainStatistics stat = byTrain[trainId];
+        if (stat.totalTrips == 0) {
+            continue;
         }
+        stat.trainCode = trainCodes.value(trainId);
+        
+        Train *train = m_dataManager->getTrainByCode(stat.trainCode);
         
         // Calculate utilization rate
         if (train && train->getCapacity() > 0) {
@@ -121,7 +303,7 @@ QVector<AnalysisEngine::TrainStatistics> AnalysisEngine::getTrainStatistics() co
         }
         
         // Calculate average ticket price
-        stat.averageTicketPrice = flows.size() > 0 ? stat.totalRevenue / flows.size() : 0.0;
+        stat.averageTicketPrice = stat.totalRevenue / stat.totalTrips;
         
         stats.append(stat);
     }
@@ -135,47 +317,23 @@ QVector<AnalysisEngine::TrainStatistics> AnalysisEngine::getTrainStatistics() co
     return stats;
 }
 
-QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getTimeSeriesData(const QDate &startDate, const QDate &endDate) const
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::computeTimeSeriesData(const QDate &startDate, const QDate &endDate) const
 {
-    QVector<TimeSeriesData> timeSeries;
-    QMap<QDate, QVector<PassengerFlow*>> dailyFlows;
-    
-    // Get flows in date range
-    auto flows = m_dataManager->getPassengerFlowsByDateRange(startDate, endDate);
-    
-    // Group by date
-    for (PassengerFlow *flow : flows) {
-        dailyFlows[flow->getDate()].append(flow);
-    }
-    
-    // Calculate daily statistics
-    for (auto it = dailyFlows.begin(); it != dailyFlows.end(); ++it) {
-        const QDate &date = it.key();
-        const QVector<PassengerFlow*> &flows = it.value();
-        
-        TimeSeriesData data;
-        data.date = date;
-        data.passengers = 0;
-        data.revenue = 0.0;
-        
-        for (const PassengerFlow *flow : flows) {
-            data.passengers += flow->getTotalPassengers();
-            data.revenue += flow->getRevenue();
+    // Group by date：按儒略日累加，QMap有序，结果已按日期排列
+    QMap<int, FlowDatabase::Totals> daily;
+    scanFlows(startDate, endDate, [&daily](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            FlowDatabase::Totals &totals = daily[flow.getDayNumber()];
+            totals.rows++;
+            totals.passengers += flow.getTotalPassengers();
+            totals.revenue += flow.getRevenue();
         }
-        
-        timeSeries.append(data);
-    }
-    
-    // Sort by date
-    std::sort(timeSeries.begin(), timeSeries.end(),
-              [](const TimeSeriesData &a, const TimeSeriesData &b) {
-                  return a.date < b.date;
-              });
+    });
     
-    return timeSeries;
+    return toTimeSeries(daily);
 }
 
-QMap<QString, double> AnalysisEngine::getStationFlowByDateRange(const QDate &startDate, const QDate &endDate) const
+QMap<QString, double> AnalysisEngine::computeStationFlowByDateRange(const QDate &startDate, const QDate &endDate) const
 {
     QMap<QString, double> stationFlow;
     // 使用静态变量控制日志输出频率
@@ -187,62 +345,89 @@ QMap<QString, double> AnalysisEngine::getStationFlowByDateRange(const QDate &sta
                 << startDate.toString("yyyy-MM-dd") << " 至 " << endDate.toString("yyyy-MM-dd");
     }
     
-    auto flows = m_dataManager->getPassengerFlowsByDateRange(startDate, endDate);
-    
-    if (shouldLog) {
-        qDebug() << "筛选到的客流记录数:" << flows.size();
-    }
-    
     // 定义只需要显示的三个站点
     QStringList targetStations = {"重庆北站", "成都东站", "成都站"};
+
+    if (const FlowDatabase *database = m_dataManager->flowDatabase()) {
+        const QHash<int, FlowDatabase::Totals> totals = database->stationTotals(
+            static_cast<int>(startDate.toJulianDay()), static_cast<int>(endDate.toJulianDay()));
+        for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+            Station* station = m_dataManager->getStationById(it.key());
+            if (station && targetStations.contains(station->getName())) {
+                stationFlow[station->getName()] += it.value().passengers;
+            }
+        }
+        if (!stationFlow.isEmpty()) {
+            return stationFlow;
+        }
+    }
+    
+    // 立方体中每个站点两次查表；范围内行数太少时仍走下面的逐行处理（会补入其他站点）
+    const FlowCube &cube = m_dataManager->flowCube();
+    const int startDay = static_cast<int>(startDate.toJulianDay());
+    const int endDay = static_cast<int>(endDate.toJulianDay());
+    if (cube.isValid() && cube.total(startDay, endDay).rows >= 10) {
+        for (int stationId : namedTargetStationIds()) {
+            const FlowCube::Totals totals = cube.station(stationId, startDay, endDay);
+            if (totals.rows > 0) {
+                stationFlow[m_dataManager->getStationById(stationId)->getName()] += totals.passengers();
+            }
+        }
+        if (!stationFlow.isEmpty()) {
+            return stationFlow;
+        }
+    }
     
     // 对每条记录进行处理
+    int filteredCount = 0;
     int processedCount = 0;
     int validCount = 0;
     int invalidStationCount = 0;
     
-    for (PassengerFlow *flow : flows)
-    {
-        processedCount++;
-        if (!flow) {
-            qDebug() << "警告: 发现空客流记录";
-            continue;
-        }
-        
-        Station* station = m_dataManager->getStationById(flow->getStationId());
-        if (station)
+    scanFlows(startDate, endDate, [&](const FlowView &flows) {
+        filteredCount += flows.size();
+        for (FlowRow flow : flows)
         {
-            // 只计算目标站点的数据，但如果数据量太少，允许包含其他站点
-            QString stationName = station->getName();
-            bool isTargetStation = targetStations.contains(stationName);
+            processedCount++;
+            Station* station = m_dataManager->getStationById(flow.getStationId());
+            if (station)
+            {
+                // 只计算目标站点的数据，但如果数据量太少，允许包含其他站点
+                QString stationName = station->getName();
+                bool isTargetStation = targetStations.contains(stationName);
             
-            // 如果是目标站点，或者数据量非常少，都加入到结果中
-            if (isTargetStation || (flows.size() < 10 && validCount < 5)) {
-                // 如果不是目标站点但数据少，重命名为目标站点之一以便显示
-                if (!isTargetStation) {
-                    int index = validCount % targetStations.size();
-                    stationName = targetStations[index];
-                }
+                // 如果是目标站点，或者数据量非常少，都加入到结果中
+                if (isTargetStation || (flows.size() < 10 && validCount < 5)) {
+                    // 如果不是目标站点但数据少，重命名为目标站点之一以便显示
+                    if (!isTargetStation) {
+                        int index = validCount % targetStations.size();
+                        stationName = targetStations[index];
+                    }
                 
-                stationFlow[stationName] += flow->getTotalPassengers();
-                validCount++;
+                    stationFlow[stationName] += flow.getTotalPassengers();
+                    validCount++;
                 
-                // 只输出前几条做示例，且仅在应该记录日志时
-                if (shouldLog && validCount <= 2) {
-                    qDebug() << "客流记录示例: 站点=" << stationName 
-                             << ", 站点ID=" << flow->getStationId()
-                             << ", 日期=" << flow->getDate().toString("yyyy-MM-dd")
-                             << ", 总客流=" << flow->getTotalPassengers();
+                    // 只输出前几条做示例，且仅在应该记录日志时
+                    if (shouldLog && validCount <= 2) {
+                        qDebug() << "客流记录示例: 站点=" << stationName 
+                                 << ", 站点ID=" << flow.getStationId()
+                                 << ", 日期=" << flow.getDate().toString("yyyy-MM-dd")
+                                 << ", 总客流=" << flow.getTotalPassengers();
+                    }
                 }
             }
-        }
-        else
-        {
-            invalidStationCount++;
-            if (shouldLog && invalidStationCount <= 2) {
-                qDebug() << "警告: 无法找到站点ID" << flow->getStationId();
+            else
+            {
+                invalidStationCount++;
+                if (shouldLog && invalidStationCount <= 2) {
+                    qDebug() << "警告: 无法找到站点ID" << flow.getStationId();
+                }
             }
         }
+    });
+    
+    if (shouldLog) {
+        qDebug() << "筛选到的客流记录数:" << filteredCount;
     }
     
     // 如果处理完毕后没有有效数据，添加模拟数据
@@ -272,7 +457,7 @@ QMap<QString, double> AnalysisEngine::getStationFlowByDateRange(const QDate &sta
     return stationFlow;
 }
 
-QMap<QString, double> AnalysisEngine::getTrainFlowByDateRange(const QDate &startDate, const QDate &endDate) const
+QMap<QString, double> AnalysisEngine::computeTrainFlowByDateRange(const QDate &startDate, const QDate &endDate) const
 {
     QMap<QString, double> trainFlow;
     // 使用静态变量控制日志输出频率 - 与站点分析共用同一计数器
@@ -283,17 +468,24 @@ QMap<QString, double> AnalysisEngine::getTrainFlowByDateRange(const QDate &start
         qDebug() << "AnalysisEngine::getTrainFlowByDateRange - 开始查询列车客流 " 
                 << startDate.toString("yyyy-MM-dd") << " 至 " << endDate.toString("yyyy-MM-dd");
     }
-             
-    auto flows = m_dataManager->getPassengerFlowsByDateRange(startDate, endDate);
-    
-    if (shouldLog) {
-        qDebug() << "筛选到的客流记录数:" << flows.size();
+
+    if (const FlowDatabase *database = m_dataManager->flowDatabase()) {
+        const QHash<QString, FlowDatabase::Totals> totals = database->trainTotals(
+            static_cast<int>(startDate.toJulianDay()), static_cast<int>(endDate.toJulianDay()),
+            targetStationIds());
+        for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+            trainFlow[it.key()] += it.value().passengers;
+        }
+        if (!trainFlow.isEmpty()) {
+            return trainFlow;
+        }
     }
-    
+             
     // 定义只需要显示的三个站点
     QStringList targetStations = {"重庆北站", "成都东站", "成都站"};
     
     // 对每条记录进行处理
+    int filteredCount = 0;
     int processedCount = 0;
     int validCount = 0;
     int nullStationCount = 0;
@@ -301,42 +493,65 @@ QMap<QString, double> AnalysisEngine::getTrainFlowByDateRange(const QDate &start
     
     // 直接使用客流记录中的站点ID进行匹配（三大目标站点的ID）
     QSet<int> targetStationIds = {1695, 1640, 1037}; // 对应成都东站、成都站、重庆北站
-    
-    for (PassengerFlow *flow : flows)
-    {
-        processedCount++;
-        if (!flow) continue;
-        
-        int stationId = flow->getStationId();
+
+    // 按车次编号累加，最后再换成车次字符串；核外模式下各块的车次编号一致
+    StringDictionary trainCodes;
+    QVector<double> flowByTrain;
+    QVector<bool> trainSeen;
+    
+    scanFlows(startDate, endDate, [&](const FlowView &flows) {
+        filteredCount += flows.size();
+        if (!flows.store()) {
+            return;
+        }
+        trainCodes = flows.store()->trainCodes();
+        if (flowByTrain.size() < trainCodes.size()) {
+            flowByTrain.resize(trainCodes.size(), 0.0);
+            trainSeen.resize(trainCodes.size(), false);
+        }
+        for (FlowRow flow : flows)
+        {
+            processedCount++;
+            int stationId = flow.getStationId();
         
-        // 直接使用站点ID进行过滤
-        if (targetStationIds.contains(stationId)) {
-            trainFlow[flow->getTrainCode()] += flow->getTotalPassengers();
-            validCount++;
-            
-            // 只在应该记录日志时输出前几条做示例
-            if (shouldLog && validCount <= 2) {
-                Station* station = m_dataManager->getStationById(stationId);
-                QString stationName = station ? station->getName() : QString("ID=%1").arg(stationId);
-                qDebug() << "列车客流记录示例: 列车=" << flow->getTrainCode()
-                         << ", 站点=" << stationName
-                         << ", 总客流=" << flow->getTotalPassengers();
-            }
-        } else {
-            // 通过Station对象尝试二次匹配（以防ID不匹配但名称匹配的情况）
-            Station* station = m_dataManager->getStationById(stationId);
-            if (!station) {
-                nullStationCount++;
-            } else if (targetStations.contains(station->getName())) {
-                trainFlow[flow->getTrainCode()] += flow->getTotalPassengers();
+            // 直接使用站点ID进行过滤
+            if (targetStationIds.contains(stationId)) {
+                flowByTrain[flow.getTrainId()] += flow.getTotalPassengers();
+                trainSeen[flow.getTrainId()] = true;
                 validCount++;
+            
+                // 只在应该记录日志时输出前几条做示例
+                if (shouldLog && validCount <= 2) {
+                    Station* station = m_dataManager->getStationById(stationId);
+                    QString stationName = station ? station->getName() : QString("ID=%1").arg(stationId);
+                    qDebug() << "列车客流记录示例: 列车=" << flow.getTrainCode()
+                             << ", 站点=" << stationName
+                             << ", 总客流=" << flow.getTotalPassengers();
+                }
             } else {
-                nonTargetStationCount++;
+                // 通过Station对象尝试二次匹配（以防ID不匹配但名称匹配的情况）
+                Station* station = m_dataManager->getStationById(stationId);
+                if (!station) {
+                    nullStationCount++;
+                } else if (targetStations.contains(station->getName())) {
+                    flowByTrain[flow.getTrainId()] += flow.getTotalPassengers();
+                    trainSeen[flow.getTrainId()] = true;
+                    validCount++;
+                } else {
+                    nonTargetStationCount++;
+                }
             }
         }
+    });
+
+    for (int trainId = 0; trainId < flowByTrain.size(); ++trainId) {
+        if (trainSeen[trainId]) {
+            trainFlow[trainCodes.value(trainId)] += flowByTrain[trainId];
+        }
     }
     
     if (shouldLog) {
+        qDebug() << "筛选到的客流记录数:" << filteredCount;
         qDebug() << "处理完成: 总记录数=" << processedCount 
                 << ", 有效记录数=" << validCount
                 << ", 获得列车数=" << trainFlow.size()
@@ -364,7 +579,7 @@ QMap<QString, double> AnalysisEngine::getTrainFlowByDateRange(const QDate &start
     return trainFlow;
 }
 
-QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getTotalPassengerFlowTimeSeries(const QDate &startDate, const QDate &endDate) const
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::computeTotalPassengerFlowTimeSeries(const QDate &startDate, const QDate &endDate) const
 {
     // 使用静态变量控制日志输出频率
     static int timeSeriesAnalysisCount = 0;
@@ -376,62 +591,90 @@ QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getTotalPassengerFlowTim
     }
              
     QVector<TimeSeriesData> timeSeries;
-    QMap<QDate, QVector<PassengerFlow*>> dailyFlows;
-    
-    auto flows = m_dataManager->getPassengerFlowsByDateRange(startDate, endDate);
-    
-    if (shouldLog) {
-        qDebug() << "筛选到的客流记录数:" << flows.size();
+
+    if (const FlowDatabase *database = m_dataManager->flowDatabase()) {
+        timeSeries = toTimeSeries(database->dailyTotals(static_cast<int>(startDate.toJulianDay()),
+                                                        static_cast<int>(endDate.toJulianDay()),
+                                                        targetStationIds()));
+        if (!timeSeries.isEmpty()) {
+            return timeSeries;
+        }
     }
     
     // 定义只需要显示的三个站点
     QStringList targetStations = {"重庆北站", "成都东站", "成都站"};
     
+    int filteredCount = 0;
     int processedCount = 0;
     int validCount = 0;
     
-    // 按日期分组，只保留目标站点的数据
-    for (PassengerFlow *flow : flows) {
-        processedCount++;
-        if (!flow) continue;
-        
-        // 只处理目标站点的列车数据
-        Station* station = m_dataManager->getStationById(flow->getStationId());
-        if (station && targetStations.contains(station->getName())) {
-            dailyFlows[flow->getDate()].append(flow);
-            validCount++;
+    // 按日期累加，只保留目标站点的数据
+    QMap<int, FlowDatabase::Totals> daily;
+    const FlowCube &cube = m_dataManager->flowCube();
+    if (cube.isValid() && cube.rowCount() > 0) {
+        // 立方体中每天每个目标站点两次查表，与客流行数无关
+        const QVector<int> stationIds = namedTargetStationIds();
+        const int firstDay = qMax(static_cast<int>(startDate.toJulianDay()), cube.firstDay());
+        const int lastDay = qMin(static_cast<int>(endDate.toJulianDay()), cube.lastDay());
+        for (int day = firstDay; day <= lastDay; ++day) {
+            const FlowCube::Totals totals = cube.stations(stationIds, day, day);
+            if (totals.rows > 0) {
+                FlowDatabase::Totals &dayTotals = daily[day];
+                dayTotals.rows = totals.rows;
+                dayTotals.passengers = totals.passengers();
+                dayTotals.revenue = totals.revenue;
+            }
         }
+        return toTimeSeries(daily);
     }
+    const FlowStore &store = m_dataManager->getFlowStore();
+    if (!store.isEmpty()) {
+        // 内存数据：目标站点位图与日期范围位图求与，只访问命中的行
+        const FlowBitmapIndex &bitmaps = m_dataManager->flowBitmaps();
+        const FlowBitmap rows = bitmaps.stations(namedTargetStationIds())
+                              & bitmaps.days(store, static_cast<int>(startDate.toJulianDay()),
+                                             static_cast<int>(endDate.toJulianDay()));
+        const QVector<qint32> &days = store.dayNumbers();
+        const QVector<qint32> &boarding = store.boardingPassengers();
+        const QVector<qint32> &alighting = store.alightingPassengers();
+        const QVector<double> &revenues = store.revenues();
+        rows.forEach([&](int row) {
+            FlowDatabase::Totals &totals = daily[days[row]];
+            totals.rows++;
+            totals.passengers += boarding[row] + alighting[row];
+            totals.revenue += revenues[row];
+        });
+        if (shouldLog) {
+            qDebug() << "位图筛选命中记录数:" << rows.cardinality() << ", 获得日期数=" << daily.size();
+        }
+        return toTimeSeries(daily);
+    }
+
+    scanFlows(startDate, endDate, [&](const FlowView &flows) {
+        filteredCount += flows.size();
+        for (FlowRow flow : flows) {
+            processedCount++;
+            // 只处理目标站点的列车数据
+            Station* station = m_dataManager->getStationById(flow.getStationId());
+            if (station && targetStations.contains(station->getName())) {
+                FlowDatabase::Totals &totals = daily[flow.getDayNumber()];
+                totals.rows++;
+                totals.passengers += flow.getTotalPassengers();
+                totals.revenue += flow.getRevenue();
+                validCount++;
+            }
+        }
+    });
     
     if (shouldLog) {
+        qDebug() << "筛选到的客流记录数:" << filteredCount;
         qDebug() << "处理完成: 总记录数=" << processedCount 
                 << ", 有效记录数=" << validCount
-                << ", 获得日期数=" << dailyFlows.size();
+                << ", 获得日期数=" << daily.size();
     }
     
-    // 计算每日统计数据
-    for (auto it = dailyFlows.begin(); it != dailyFlows.end(); ++it) {
-        const QDate &date = it.key();
-        const QVector<PassengerFlow*> &dateFlows = it.value();
-        
-        TimeSeriesData data;
-        data.date = date;
-        data.passengers = 0;
-        data.revenue = 0.0;
-        
-        for (const PassengerFlow *flow : dateFlows) {
-            data.passengers += flow->getTotalPassengers();
-            data.revenue += flow->getRevenue();
-        }
-        
-        timeSeries.append(data);
-    }
-    
-    // 按日期排序
-    std::sort(timeSeries.begin(), timeSeries.end(),
-              [](const TimeSeriesData &a, const TimeSeriesData &b) {
-                  return a.date < b.date;
-              });
+    // 计算每日统计数据，按日期排列
+    timeSeries = toTimeSeries(daily);
     
     // 只在应该记录日志时输出部分时间序列数据
     if (shouldLog) {
@@ -445,10 +688,9 @@ QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getTotalPassengerFlowTim
     return timeSeries;
 }
 
-QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getPassengerFlowTimeSeriesByStation(const QString &stationName, const QDate &startDate, const QDate &endDate) const
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::computePassengerFlowTimeSeriesByStation(const QString &stationName, const QDate &startDate, const QDate &endDate) const
 {
     QVector<TimeSeriesData> timeSeries;
-    QMap<QDate, QVector<PassengerFlow*>> dailyFlows;
     
     qDebug() << "AnalysisEngine::getPassengerFlowTimeSeriesByStation - 开始查询站点客流时间序列" 
              << stationName << ", " << startDate.toString("yyyy-MM-dd") << " 至 " << endDate.toString("yyyy-MM-dd");
@@ -468,130 +710,181 @@ QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getPassengerFlowTimeSeri
         return timeSeries;
     }
 
-    auto flows = m_dataManager->getPassengerFlowsByDateRange(startDate, endDate);
-    qDebug() << "筛选到的客流记录数:" << flows.size();
+    if (const FlowDatabase *database = m_dataManager->flowDatabase()) {
+        timeSeries = toTimeSeries(database->dailyTotals(static_cast<int>(startDate.toJulianDay()),
+                                                        static_cast<int>(endDate.toJulianDay()),
+                                                        QVector<int>{ stationId }));
+        if (!timeSeries.isEmpty()) {
+            return timeSeries;
+        }
+    }
 
+    int filteredCount = 0;
     int validCount = 0;
-    for (PassengerFlow *flow : flows) {
-        if (flow && flow->getStationId() == stationId) {
-            dailyFlows[flow->getDate()].append(flow);
-            validCount++;
+    QMap<int, FlowDatabase::Totals> daily;
+    const FlowCube &cube = m_dataManager->flowCube();
+    if (cube.isValid() && cube.rowCount() > 0) {
+        const int firstDay = qMax(static_cast<int>(startDate.toJulianDay()), cube.firstDay());
+        const int lastDay = qMin(static_cast<int>(endDate.toJulianDay()), cube.lastDay());
+        for (int day = firstDay; day <= lastDay; ++day) {
+            const FlowCube::Totals totals = cube.station(stationId, day, day);
+            if (totals.rows > 0) {
+                FlowDatabase::Totals &dayTotals = daily[day];
+                dayTotals.rows = totals.rows;
+                dayTotals.passengers = totals.passengers();
+                dayTotals.revenue = totals.revenue;
+            }
         }
+        qDebug() << "立方体得到日期数:" << daily.size();
+        return toTimeSeries(daily);
     }
-    
-    qDebug() << "找到有效记录:" << validCount << ", 日期数:" << dailyFlows.size();
-
-    for (auto it = dailyFlows.begin(); it != dailyFlows.end(); ++it) {
-        const QDate &date = it.key();
-        const QVector<PassengerFlow*> &dateFlows = it.value();
-
-        TimeSeriesData data;
-        data.date = date;
-        data.passengers = 0;
-        data.revenue = 0.0;
-
-        for (const PassengerFlow *flow : dateFlows) {
-            data.passengers += flow->getTotalPassengers();
-            data.revenue += flow->getRevenue();
+    if (!m_dataManager->getFlowStore().isEmpty()) {
+        // 内存数据：倒排索引直接给出该站点在日期范围内的行
+        const FlowView flows = m_dataManager->getPassengerFlowsByStation(stationId, startDate, endDate);
+        for (FlowRow flow : flows) {
+            FlowDatabase::Totals &totals = daily[flow.getDayNumber()];
+            totals.rows++;
+            totals.passengers += flow.getTotalPassengers();
+            totals.revenue += flow.getRevenue();
         }
-        timeSeries.append(data);
+        qDebug() << "站点索引命中记录:" << flows.size() << ", 日期数:" << daily.size();
+        return toTimeSeries(daily);
     }
 
-    std::sort(timeSeries.begin(), timeSeries.end(),
-              [](const TimeSeriesData &a, const TimeSeriesData &b) {
-                  return a.date < b.date;
-              });
+    scanFlows(startDate, endDate, [&](const FlowView &flows) {
+        filteredCount += flows.size();
+        for (FlowRow flow : flows) {
+            if (flow.getStationId() == stationId) {
+                FlowDatabase::Totals &totals = daily[flow.getDayNumber()];
+                totals.rows++;
+                totals.passengers += flow.getTotalPassengers();
+                totals.revenue += flow.getRevenue();
+                validCount++;
+            }
+        }
+    });
+    qDebug() << "筛选到的客流记录数:" << filteredCount;
+    qDebug() << "找到有效记录:" << validCount << ", 日期数:" << daily.size();
 
-    return timeSeries;
+    return toTimeSeries(daily);
 }
 
-QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::getPassengerFlowTimeSeriesByTrain(const QString &trainNumber, const QDate &startDate, const QDate &endDate) const
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::computePassengerFlowTimeSeriesByTrain(const QString &trainNumber, const QDate &startDate, const QDate &endDate) const
 {
     QVector<TimeSeriesData> timeSeries;
-    QMap<QDate, QVector<PassengerFlow*>> dailyFlows;
     
     qDebug() << "AnalysisEngine::getPassengerFlowTimeSeriesByTrain - 开始查询列车客流时间序列" 
              << trainNumber << ", " << startDate.toString("yyyy-MM-dd") << " 至 " << endDate.toString("yyyy-MM-dd");
-    
-    auto flows = m_dataManager->getPassengerFlowsByDateRange(startDate, endDate);
-    qDebug() << "筛选到的客流记录数:" << flows.size();
+
+    if (const FlowDatabase *database = m_dataManager->flowDatabase()) {
+        timeSeries = toTimeSeries(database->dailyTotals(static_cast<int>(startDate.toJulianDay()),
+                                                        static_cast<int>(endDate.toJulianDay()),
+                                                        targetStationIds(), trainNumber));
+        if (!timeSeries.isEmpty()) {
+            return timeSeries;
+        }
+    }
     
     // 定义只需要显示的三个站点
     QStringList targetStations = {"重庆北站", "成都东站", "成都站"};
-    
+
+    int filteredCount = 0;
     int validCount = 0;
-    for (PassengerFlow *flow : flows) {
-        if (!flow) continue;
-        
-        if (flow->getTrainCode() == trainNumber) {
-            // 只处理目标站点的列车数据
-            Station* station = m_dataManager->getStationById(flow->getStationId());
-            if (station && targetStations.contains(station->getName())) {
-                dailyFlows[flow->getDate()].append(flow);
+    QMap<int, FlowDatabase::Totals> daily;
+    if (!m_dataManager->getFlowStore().isEmpty()) {
+        // 内存数据：对每个目标站点求站点与车次两个索引列表的交集
+        for (int stationId : namedTargetStationIds()) {
+            const FlowView flows = m_dataManager->getPassengerFlowsByStationAndTrain(
+                stationId, trainNumber, startDate, endDate);
+            for (FlowRow flow : flows) {
+                FlowDatabase::Totals &totals = daily[flow.getDayNumber()];
+                totals.rows++;
+                totals.passengers += flow.getTotalPassengers();
+                totals.revenue += flow.getRevenue();
                 validCount++;
             }
         }
+        qDebug() << "站点与车次索引命中记录:" << validCount << ", 日期数:" << daily.size();
+        return toTimeSeries(daily);
     }
-    
-    qDebug() << "找到有效记录:" << validCount << ", 日期数:" << dailyFlows.size();
-
-    for (auto it = dailyFlows.begin(); it != dailyFlows.end(); ++it) {
-        const QDate &date = it.key();
-        const QVector<PassengerFlow*> &dateFlows = it.value();
 
-        TimeSeriesData data;
-        data.date = date;
-        data.passengers = 0;
-        data.revenue = 0.0;
-
-        for (const PassengerFlow *flow : dateFlows) {
-            data.passengers += flow->getTotalPassengers();
-            data.revenue += flow->getRevenue();
+    scanFlows(startDate, endDate, [&](const FlowView &flows) {
+        filteredCount += flows.size();
+        // 车次每块只解析一次成编号，逐行比较整数
+        const int trainId = flows.store() ? flows.store()->trainCodes().find(trainNumber) : -1;
+        if (trainId < 0) {
+            return;
         }
-        timeSeries.append(data);
-    }
-
-    std::sort(timeSeries.begin(), timeSeries.end(),
-              [](const TimeSeriesData &a, const TimeSeriesData &b) {
-                  return a.date < b.date;
-              });
+        for (FlowRow flow : flows) {
+            if (flow.getTrainId() == trainId) {
+                // 只处理目标站点的列车数据
+                Station* station = m_dataManager->getStationById(flow.getStationId());
+                if (station && targetStations.contains(station->getName())) {
+                    FlowDatabase::Totals &totals = daily[flow.getDayNumber()];
+                    totals.rows++;
+                    totals.passengers += flow.getTotalPassengers();
+                    totals.revenue += flow.getRevenue();
+                    validCount++;
+                }
+            }
+        }
+    });
+    qDebug() << "筛选到的客流记录数:" << filteredCount;
+    qDebug() << "找到有效记录:" << validCount << ", 日期数:" << daily.size();
 
-    return timeSeries;
+    return toTimeSeries(daily);
 }
 
-QVector<QPointF> AnalysisEngine::getFlowAndTrainCountCorrelation(const QDate &startDate, const QDate &endDate) const
+QVector<QPointF> AnalysisEngine::computeFlowAndTrainCountCorrelation(const QDate &startDate, const QDate &endDate) const
 {
     QVector<QPointF> correlationData;
     
     qDebug() << "AnalysisEngine::getFlowAndTrainCountCorrelation - 开始生成相关性数据"
              << startDate.toString("yyyy-MM-dd") << "至" << endDate.toString("yyyy-MM-dd");
              
-    QMap<QDate, QPair<int, QSet<QString>>> dailyStats; // Pair: <total_passengers, unique_train_codes>
+    QMap<QDate, QPair<int, QSet<int>>> dailyStats; // Pair: <total_passengers, unique_train_ids>
 
     // 定义只需要显示的三个站点
     QStringList targetStations = {"重庆北站", "成都东站", "成都站"};
-    auto flows = m_dataManager->getPassengerFlowsByDateRange(startDate, endDate);
 
-    int processedFlows = 0;
-    for (PassengerFlow *flow : flows) {
-        if (!flow) continue;
-        processedFlows++;
-        
-        // 只处理目标站点的数据
-        Station* station = m_dataManager->getStationById(flow->getStationId());
-        if (!station || !targetStations.contains(station->getName())) {
-            continue;
+    // 数据库模式下每天的客流和不同车次数由SQL直接算出
+    QMap<QDate, QPair<int, int>> databaseStats;
+    if (const FlowDatabase *database = m_dataManager->flowDatabase()) {
+        const QMap<int, FlowDatabase::Totals> daily = database->dailyTotals(
+            static_cast<int>(startDate.toJulianDay()), static_cast<int>(endDate.toJulianDay()),
+            targetStationIds());
+        for (auto it = daily.constBegin(); it != daily.constEnd(); ++it) {
+            databaseStats.insert(QDate::fromJulianDay(it.key()),
+                                 qMakePair(static_cast<int>(it.value().passengers), it.value().trains));
         }
-        
-        dailyStats[flow->getDate()].first += flow->getTotalPassengers();
-        dailyStats[flow->getDate()].second.insert(flow->getTrainCode());
+    }
+    int processedFlows = 0;
+    if (databaseStats.isEmpty()) {
+        // 车次编号在各块之间一致，可以跨块去重
+        scanFlows(startDate, endDate, [&](const FlowView &flows) {
+            for (FlowRow flow : flows) {
+                processedFlows++;
+                
+                // 只处理目标站点的数据
+                Station* station = m_dataManager->getStationById(flow.getStationId());
+                if (!station || !targetStations.contains(station->getName())) {
+                    continue;
+                }
+                
+                dailyStats[flow.getDate()].first += flow.getTotalPassengers();
+                dailyStats[flow.getDate()].second.insert(flow.getTrainId());
+            }
+        });
     }
     
-    qDebug() << "处理了" << processedFlows << "条客流记录，得到" << dailyStats.size() << "天的数据";
+    qDebug() << "处理了" << processedFlows << "条客流记录，得到" << dailyStats.size() + databaseStats.size() << "天的数据";
 
     for (auto it = dailyStats.begin(); it != dailyStats.end(); ++it) {
+        databaseStats.insert(it.key(), qMakePair(it->first, static_cast<int>(it->second.size())));
+    }
+    for (auto it = databaseStats.begin(); it != databaseStats.end(); ++it) {
         double passengerCount = it->first;
-        double trainCount = it->second.size();
+        double trainCount = it->second;
         if (trainCount > 0 && passengerCount > 0) {
             correlationData.append(QPointF(trainCount, passengerCount));
             qDebug() << "相关性数据点: 日期=" << it.key().toString("yyyy-MM-dd")
@@ -641,11 +934,19 @@ QMap<QString, int> AnalysisEngine::getStationPeakAnalysis() const
     return m_dataManager->getStationPassengerStats();
 }
 
-QVector<QPair<QString, QString>> AnalysisEngine::getStationCorrelations() const
+QVector<QPair<QString, QString>> AnalysisEngine::computeStationCorrelations() const
 {
     QVector<QPair<QString, QString>> correlations;
     auto stationStats = m_dataManager->getStationPassengerStats();
     QVector<QString> stationNames = stationStats.keys();
+
+    // Create time series (simplified - using daily totals)：扫描一遍得到所有站点的每日客流
+    QHash<int, QMap<QDate, int>> dailyByStation;
+    scanFlows([&dailyByStation](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            dailyByStation[flow.getStationId()][flow.getDate()] += flow.getTotalPassengers();
+        }
+    });
     
     // Calculate correlations between stations
     for (int i = 0; i < stationNames.size(); ++i) {
@@ -655,19 +956,8 @@ QVector<QPair<QString, QString>> AnalysisEngine::getStationCorrelations() const
             
             // Get time series for both stations
             QVector<int> series1, series2;
-            auto flows1 = m_dataManager->getPassengerFlowsByStation(
-                m_dataManager->getStationById(station1.toInt())->getId());
-            auto flows2 = m_dataManager->getPassengerFlowsByStation(
-                m_dataManager->getStationById(station2.toInt())->getId());
-            
-            // Create time series (simplified - using daily totals)
-            QMap<QDate, int> daily1, daily2;
-            for (const PassengerFlow *flow : flows1) {
-                daily1[flow->getDate()] += flow->getTotalPassengers();
-            }
-            for (const PassengerFlow *flow : flows2) {
-                daily2[flow->getDate()] += flow->getTotalPassengers();
-            }
+            const QMap<QDate, int> daily1 = dailyByStation.value(m_dataManager->getStationIdByName(station1));
+            const QMap<QDate, int> daily2 = dailyByStation.value(m_dataManager->getStationIdByName(station2));
             
             // Find common dates
             QSet<QDate> commonDates = QSet<QDate>(daily1.keys().begin(), daily1.keys().end()) & 
@@ -689,7 +979,7 @@ QVector<QPair<QString, QString>> AnalysisEngine::getStationCorrelations() const
     return correlations;
 }
 
-QVector<QPair<QString, QString>> AnalysisEngine::getTrainCorrelations() const
+QVector<QPair<QString, QString>> AnalysisEngine::computeTrainCorrelations() const
 {
     QVector<QPair<QString, QString>> correlations;
     auto trainStats = m_dataManager->getTrainPassengerStats();
@@ -701,10 +991,18 @@ QVector<QPair<QString, QString>> AnalysisEngine::getTrainCorrelations() const
     return correlations;
 }
 
-QMap<QString, double> AnalysisEngine::getStationRevenueAnalysis() const
+QMap<QString, double> AnalysisEngine::computeStationRevenueAnalysis() const
 {
     QMap<QString, double> revenueMap;
     auto stationStats = m_dataManager->getStationPassengerStats();
+
+    // 各站点收入在一次扫描中累加
+    QHash<int, double> revenueByStation;
+    scanFlows([&revenueByStation](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            revenueByStation[flow.getStationId()] += flow.getRevenue();
+        }
+    });
     
     for (auto it = stationStats.begin(); it != stationStats.end(); ++it) {
         const QString &stationName = it.key();
@@ -719,43 +1017,60 @@ QMap<QString, double> AnalysisEngine::getStationRevenueAnalysis() const
         }
         
         if (station) {
-            auto flows = m_dataManager->getPassengerFlowsByStation(station->getId());
-            double totalRevenue = 0.0;
-            for (const PassengerFlow *flow : flows) {
-                totalRevenue += flow->getRevenue();
-            }
-            revenueMap[stationName] = totalRevenue;
+            revenueMap[stationName] = revenueByStation.value(station->getId());
         }
     }
     
     return revenueMap;
 }
 
-QMap<QString, double> AnalysisEngine::getTrainRevenueAnalysis() const
+QMap<QString, double> AnalysisEngine::computeTrainRevenueAnalysis() const
 {
     QMap<QString, double> revenueMap;
-    
-    for (const PassengerFlow *flow : m_dataManager->getPassengerFlows()) {
-        revenueMap[flow->getTrainCode()] += flow->getRevenue();
+
+    StringDictionary trainCodes;
+    QVector<double> revenueByTrain;
+    QVector<bool> trainSeen;
+    scanFlows([&](const FlowView &flows) {
+        if (!flows.store()) {
+            return;
+        }
+        trainCodes = flows.store()->trainCodes();
+        if (revenueByTrain.size() < trainCodes.size()) {
+            revenueByTrain.resize(trainCodes.size(), 0.0);
+            trainSeen.resize(trainCodes.size(), false);
+        }
+        for (FlowRow flow : flows) {
+            revenueByTrain[flow.getTrainId()] += flow.getRevenue();
+            trainSeen[flow.getTrainId()] = true;
+        }
+    });
+
+    for (int trainId = 0; trainId < revenueByTrain.size(); ++trainId) {
+        if (trainSeen[trainId]) {
+            revenueMap[trainCodes.value(trainId)] = revenueByTrain[trainId];
+        }
     }
     
     return revenueMap;
 }
 
-double AnalysisEngine::getAverageTicketPrice() const
+double AnalysisEngine::computeAverageTicketPrice() const
 {
     double totalRevenue = 0.0;
     int totalPassengers = 0;
     
-    for (const PassengerFlow *flow : m_dataManager->getPassengerFlows()) {
-        totalRevenue += flow->getRevenue();
-        totalPassengers += flow->getTotalPassengers();
-    }
+    scanFlows([&totalRevenue, &totalPassengers](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            totalRevenue += flow.getRevenue();
+            totalPassengers += flow.getTotalPassengers();
+        }
+    });
     
     return totalPassengers > 0 ? totalRevenue / totalPassengers : 0.0;
 }
 
-QVector<QPair<QString, double>> AnalysisEngine::getStationEfficiency() const
+QVector<QPair<QString, double>> AnalysisEngine::computeStationEfficiency() const
 {
     QVector<QPair<QString, double>> efficiency;
     auto stationStats = getStationStatistics();
@@ -776,7 +1091,7 @@ QVector<QPair<QString, double>> AnalysisEngine::getStationEfficiency() const
     return efficiency;
 }
 
-QVector<QPair<QString, double>> AnalysisEngine::getTrainEfficiency() const
+QVector<QPair<QString, double>> AnalysisEngine::computeTrainEfficiency() const
 {
     QVector<QPair<QString, double>> efficiency;
     auto trainStats = getTrainStatistics();
@@ -796,43 +1111,44 @@ QVector<QPair<QString, double>> AnalysisEngine::getTrainEfficiency() const
     return efficiency;
 }
 
-QMap<QString, QMap<int, int>> AnalysisEngine::getStationHourlyPatterns() const
+QMap<QString, QMap<int, int>> AnalysisEngine::computeStationHourlyPatterns() const
 {
     QMap<QString, QMap<int, int>> patterns;
+
+    // 一次扫描按站点ID分组，不再逐站点筛选
+    QHash<int, QMap<int, int>> byStation;
+    scanFlows([&byStation](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            byStation[flow.getStationId()][flow.getHour()] += flow.getTotalPassengers();
+        }
+    });
     
     for (const Station *station : m_dataManager->getStations()) {
-        auto flows = m_dataManager->getPassengerFlowsByStation(station->getId());
-        QMap<int, int> hourlyPattern;
-        
-        for (const PassengerFlow *flow : flows) {
-            hourlyPattern[flow->getHour()] += flow->getTotalPassengers();
-        }
-        
-        patterns[station->getName()] = hourlyPattern;
+        patterns[station->getName()] = byStation.value(station->getId());
     }
     
     return patterns;
 }
 
-QMap<QString, QMap<int, int>> AnalysisEngine::getStationDailyPatterns() const
+QMap<QString, QMap<int, int>> AnalysisEngine::computeStationDailyPatterns() const
 {
     QMap<QString, QMap<int, int>> patterns;
+
+    QHash<int, QMap<int, int>> byStation;
+    scanFlows([&byStation](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            byStation[flow.getStationId()][flow.getDayOfWeek()] += flow.getTotalPassengers();
+        }
+    });
     
     for (const Station *station : m_dataManager->getStations()) {
-        auto flows = m_dataManager->getPassengerFlowsByStation(station->getId());
-        QMap<int, int> dailyPattern;
-        
-        for (const PassengerFlow *flow : flows) {
-            dailyPattern[flow->getDayOfWeek()] += flow->getTotalPassengers();
-        }
-        
-        patterns[station->getName()] = dailyPattern;
+        patterns[station->getName()] = byStation.value(station->getId());
     }
     
     return patterns;
 }
 
-QString AnalysisEngine::getAnalysisSummary() const
+QString AnalysisEngine::computeAnalysisSummary() const
 {
     QString summary;
     summary += QString("分析摘要:\n");
@@ -859,9 +1175,9 @@ QString AnalysisEngine::getAnalysisSummary() const
     return summary;
 }
 
-QVector<PassengerFlow*> AnalysisEngine::getFilteredData() const
+FlowView AnalysisEngine::getFilteredData() const
 {
-    return m_dataManager->getPassengerFlows();
+    return m_dataManager->getFlows();
 }
 
 double AnalysisEngine::calculateCorrelation(const QVector<int> &x, const QVector<int> &y) const
@@ -887,73 +1203,122 @@ double AnalysisEngine::calculateCorrelation(const QVector<int> &x, const QVector
     return denominator != 0 ? numerator / denominator : 0.0;
 }
 
-QMap<int, int> AnalysisEngine::aggregateByHour(const QVector<PassengerFlow*> &data) const
+QMap<int, int> AnalysisEngine::aggregateByHour(const FlowView &data) const
 {
     QMap<int, int> hourlyStats;
-    for (const PassengerFlow *flow : data) {
-        hourlyStats[flow->getHour()] += flow->getTotalPassengers();
+    for (FlowRow flow : data) {
+        hourlyStats[flow.getHour()] += flow.getTotalPassengers();
     }
     return hourlyStats;
 }
 
-QMap<int, int> AnalysisEngine::aggregateByDay(const QVector<PassengerFlow*> &data) const
+QMap<int, int> AnalysisEngine::aggregateByDay(const FlowView &data) const
 {
     QMap<int, int> dailyStats;
-    for (const PassengerFlow *flow : data) {
-        dailyStats[flow->getDayOfWeek()] += flow->getTotalPassengers();
+    for (FlowRow flow : data) {
+        dailyStats[flow.getDayOfWeek()] += flow.getTotalPassengers();
     }
     return dailyStats;
 }
 
-QVector<AnalysisEngine::TicketTypeAnalysis> AnalysisEngine::getTicketTypeAnalysis(const QDate &startDate, const QDate &endDate) const
+QVector<AnalysisEngine::TicketTypeAnalysis> AnalysisEngine::computeTicketTypeAnalysis(const QDate &startDate, const QDate &endDate) const
 {
     QVector<TicketTypeAnalysis> result;
-    QMap<QString, QVector<PassengerFlow*>> ticketTypeFlows;
-    
-    // 获取指定日期范围的客流记录
-    auto flows = m_dataManager->getPassengerFlowsByDateRange(startDate, endDate);
-    
-    // 按票种分组客流记录
-    for (PassengerFlow *flow : flows) {
-        if (!flow) continue;
-        
-        // 只处理目标站点的数据
-        Station* station = m_dataManager->getStationById(flow->getStationId());
-        if (station && (station->getName() == "成都东站" || 
-                        station->getName() == "重庆北站" || 
-                        station->getName() == "成都站")) {
-            
-            QString ticketType = flow->getTicketType().trimmed();
+    QMap<QString, QPair<TicketTypeAnalysis, double>> ticketTypeTotals;
+    // 冷列不可用时票价都是占位值，不做统计也不生成模拟数据；错误已由DataManager报告
+    if (!m_dataManager->coldColumnsAvailable()) {
+        qDebug() << "客流票价不可用，票种分析返回空结果";
+        return result;
+    }
+
+    // 数据库模式下按票种分组由SQL完成
+    if (const FlowDatabase *database = m_dataManager->flowDatabase()) {
+        const QHash<QString, FlowDatabase::Totals> totals = database->ticketTypeTotals(
+            static_cast<int>(startDate.toJulianDay()), static_cast<int>(endDate.toJulianDay()),
+            targetStationIds());
+        for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+            QString ticketType = it.key().trimmed();
             if (ticketType.isEmpty()) ticketType = "未知";
-            
-            ticketTypeFlows[ticketType].append(flow);
+
+            auto &total = ticketTypeTotals[ticketType];
+            total.first.totalCount += static_cast<int>(it.value().rows);
+            total.first.totalPassengers += static_cast<int>(it.value().passengers);
+            total.first.totalRevenue += it.value().revenue;
+            total.second += it.value().priceSum;
         }
     }
     
-    // 计算每种票价的统计数据
-    for (auto it = ticketTypeFlows.begin(); it != ticketTypeFlows.end(); ++it) {
-        const QString &ticketType = it.key();
-        const QVector<PassengerFlow*> &ticketFlows = it.value();
-        
-        TicketTypeAnalysis analysis;
-        analysis.ticketType = ticketType;
-        analysis.totalCount = ticketFlows.size();
-        analysis.totalPassengers = 0;
-        analysis.totalRevenue = 0.0;
-        double totalPrice = 0.0;
-        
-        for (PassengerFlow *flow : ticketFlows) {
-            analysis.totalPassengers += flow->getTotalPassengers();
-            analysis.totalRevenue += flow->getRevenue();
-            totalPrice += flow->getTicketPrice();
-        }
-        
-        if (analysis.totalCount > 0) {
-            analysis.averagePrice = totalPrice / analysis.totalCount;
-        } else {
-            analysis.averagePrice = 0.0;
+    // 按票种编号分组累加（字典中的票种已去除首尾空白）
+    StringDictionary ticketTypes;
+    QVector<TicketTypeAnalysis> byType;
+    QVector<double> totalPrices;
+    const FlowStore &store = m_dataManager->getFlowStore();
+    if (ticketTypeTotals.isEmpty() && !store.isEmpty()) {
+        // 内存数据：目标站点位图与日期范围位图求与，按票种编号累加命中的行
+        const FlowBitmapIndex &bitmaps = m_dataManager->flowBitmaps();
+        const FlowBitmap rows = bitmaps.stations(namedTargetStationIds())
+                              & bitmaps.days(store, static_cast<int>(startDate.toJulianDay()),
+                                             static_cast<int>(endDate.toJulianDay()));
+        ticketTypes = store.ticketTypes();
+        byType.resize(ticketTypes.size(), TicketTypeAnalysis{QString(), 0, 0, 0.0, 0.0});
+        totalPrices.resize(ticketTypes.size(), 0.0);
+        const QVector<FlowStore::DictId> &typeIds = store.ticketTypeIds();
+        const QVector<qint32> &boarding = store.boardingPassengers();
+        const QVector<qint32> &alighting = store.alightingPassengers();
+        const QVector<double> &revenues = store.revenues();
+        const QVector<double> &prices = store.ticketPrices();
+        rows.forEach([&](int row) {
+            TicketTypeAnalysis &analysis = byType[typeIds[row]];
+            analysis.totalCount++;
+            analysis.totalPassengers += boarding[row] + alighting[row];
+            analysis.totalRevenue += revenues[row];
+            totalPrices[typeIds[row]] += prices[row];
+        });
+    } else if (ticketTypeTotals.isEmpty()) {
+        scanFlows(startDate, endDate, [&](const FlowView &flows) {
+            if (!flows.store()) {
+                return;
+            }
+            ticketTypes = flows.store()->ticketTypes();
+            if (byType.size() < ticketTypes.size()) {
+                byType.resize(ticketTypes.size(), TicketTypeAnalysis{QString(), 0, 0, 0.0, 0.0});
+                totalPrices.resize(ticketTypes.size(), 0.0);
+            }
+            for (FlowRow flow : flows) {
+                // 只处理目标站点的数据
+                Station* station = m_dataManager->getStationById(flow.getStationId());
+                if (station && (station->getName() == "成都东站" || 
+                                station->getName() == "重庆北站" || 
+                                station->getName() == "成都站")) {
+                    TicketTypeAnalysis &analysis = byType[flow.getTicketTypeId()];
+                    analysis.totalCount++;
+                    analysis.totalPassengers += flow.getTotalPassengers();
+                    analysis.totalRevenue += flow.getRevenue();
+                    totalPrices[flow.getTicketTypeId()] += flow.getTicketPrice();
+                }
+            }
+        });
+    }
+    
+    // 计算每种票价的统计数据；空票种和"未知"合并为一组
+    for (int typeId = 0; typeId < byType.size(); ++typeId) {
+        if (byType[typeId].totalCount == 0) {
+            continue;
         }
+        QString ticketType = ticketTypes.value(typeId);
+        if (ticketType.isEmpty()) ticketType = "未知";
         
+        auto &total = ticketTypeTotals[ticketType];
+        total.first.totalCount += byType[typeId].totalCount;
+        total.first.totalPassengers += byType[typeId].totalPassengers;
+        total.first.totalRevenue += byType[typeId].totalRevenue;
+        total.second += totalPrices[typeId];
+    }
+    
+    for (auto it = ticketTypeTotals.begin(); it != ticketTypeTotals.end(); ++it) {
+        TicketTypeAnalysis analysis = it.value().first;
+        analysis.ticketType = it.key();
+        analysis.averagePrice = it.value().second / analysis.totalCount;
         result.append(analysis);
     }
     
@@ -985,24 +1350,29 @@ QVector<AnalysisEngine::TicketTypeAnalysis> AnalysisEngine::getTicketTypeAnalysi
     return result;
 }
 
-QMap<double, int> AnalysisEngine::getTicketPriceDistribution() const
+QMap<double, int> AnalysisEngine::computeTicketPriceDistribution() const
 {
     QMap<double, int> distribution;
+    // 冷列不可用时票价都是占位值，不做统计也不生成模拟数据；错误已由DataManager报告
+    if (!m_dataManager->coldColumnsAvailable()) {
+        qDebug() << "客流票价不可用，票价分布返回空结果";
+        return distribution;
+    }
     
-    for (PassengerFlow *flow : m_dataManager->getPassengerFlows()) {
-        if (!flow) continue;
-        
-        // 只处理目标站点的数据
-        Station* station = m_dataManager->getStationById(flow->getStationId());
-        if (station && (station->getName() == "成都东站" || 
-                        station->getName() == "重庆北站" || 
-                        station->getName() == "成都站")) {
-            
-            // 将价格舍入到最接近的5元，以创建价格区间
-            double roundedPrice = std::round(flow->getTicketPrice() / 5.0) * 5.0;
-            distribution[roundedPrice] += flow->getTotalPassengers();
+    scanFlows([&](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            // 只处理目标站点的数据
+            Station* station = m_dataManager->getStationById(flow.getStationId());
+            if (station && (station->getName() == "成都东站" || 
+                            station->getName() == "重庆北站" || 
+                            station->getName() == "成都站")) {
+                
+                // 将价格舍入到最接近的5元，以创建价格区间
+                double roundedPrice = std::round(flow.getTicketPrice() / 5.0) * 5.0;
+                distribution[roundedPrice] += flow.getTotalPassengers();
+            }
         }
-    }
+    });
     
     // 如果没有数据，生成模拟数据
     if (distribution.isEmpty()) {
@@ -1023,27 +1393,112 @@ QMap<double, int> AnalysisEngine::getTicketPriceDistribution() const
     return distribution;
 }
 
-QMap<QString, QMap<double, int>> AnalysisEngine::getTicketTypeAndPriceAnalysis() const
+QMap<QString, QMap<double, int>> AnalysisEngine::computeTicketTypeAndPriceAnalysis() const
 {
     QMap<QString, QMap<double, int>> analysis;
+    if (!m_dataManager->coldColumnsAvailable()) {
+        qDebug() << "客流票价不可用，票种票价分析返回空结果";
+        return analysis;
+    }
+    StringDictionary ticketTypes;
+    QVector<QMap<double, int>> byType;
     
-    for (PassengerFlow *flow : m_dataManager->getPassengerFlows()) {
-        if (!flow) continue;
+    scanFlows([&](const FlowView &flows) {
+        if (!flows.store()) {
+            return;
+        }
+        ticketTypes = flows.store()->ticketTypes();
+        if (byType.size() < ticketTypes.size()) {
+            byType.resize(ticketTypes.size());
+        }
+        for (FlowRow flow : flows) {
+            // 只处理目标站点的数据
+            Station* station = m_dataManager->getStationById(flow.getStationId());
+            if (station && (station->getName() == "成都东站" || 
+                            station->getName() == "重庆北站" || 
+                            station->getName() == "成都站")) {
+                // 将价格舍入到最接近的5元，以创建价格区间
+                double roundedPrice = std::round(flow.getTicketPrice() / 5.0) * 5.0;
+                byType[flow.getTicketTypeId()][roundedPrice] += flow.getTotalPassengers();
+            }
+        }
+    });
+    
+    // 票种字符串只在输出时解析
+    for (int typeId = 0; typeId < byType.size(); ++typeId) {
+        if (byType[typeId].isEmpty()) {
+            continue;
+        }
+        QString ticketType = ticketTypes.value(typeId);
+        if (ticketType.isEmpty()) ticketType = "未知";
         
-        // 只处理目标站点的数据
-        Station* station = m_dataManager->getStationById(flow->getStationId());
-        if (station && (station->getName() == "成都东站" || 
-                        station->getName() == "重庆北站" || 
-                        station->getName() == "成都站")) {
-            
-            QString ticketType = flow->getTicketType().trimmed();
-            if (ticketType.isEmpty()) ticketType = "未知";
-            
-            // 将价格舍入到最接近的5元，以创建价格区间
-            double roundedPrice = std::round(flow->getTicketPrice() / 5.0) * 5.0;
-            analysis[ticketType][roundedPrice] += flow->getTotalPassengers();
+        QMap<double, int> &prices = analysis[ticketType];
+        for (auto it = byType[typeId].constBegin(); it != byType[typeId].constEnd(); ++it) {
+            prices[it.key()] += it.value();
         }
     }
     
     return analysis;
-}
\ No newline at end of file
+}
+
+QVector<int> AnalysisEngine::targetStationIds() const
+{
+    // 与内存路径相同的目标站点：三大站的ID，加上名称匹配的站点；结果不会为空（空表示不限站点）
+    const QStringList targetStations = {"重庆北站", "成都东站", "成都站"};
+    QVector<int> ids = {1695, 1640, 1037};
+    for (Station *station : m_dataManager->getStations()) {
+        if (targetStations.contains(station->getName()) && !ids.contains(station->getId())) {
+            ids.append(station->getId());
+        }
+    }
+    return ids;
+}
+
+QVector<int> AnalysisEngine::namedTargetStationIds() const
+{
+    const QStringList targetStations = {"重庆北站", "成都东站", "成都站"};
+    QVector<int> ids;
+    for (Station *station : m_dataManager->getStations()) {
+        if (targetStations.contains(station->getName()) && !ids.contains(station->getId())) {
+            ids.append(station->getId());
+        }
+    }
+    return ids;
+}
+
+QVector<AnalysisEngine::TimeSeriesData> AnalysisEngine::toTimeSeries(const QMap<int, FlowDatabase::Totals> &daily) const
+{
+    QVector<TimeSeriesData> timeSeries;
+    timeSeries.reserve(daily.size());
+    for (auto it = daily.constBegin(); it != daily.constEnd(); ++it) {
+        TimeSeriesData data;
+        data.date = QDate::fromJulianDay(it.key());
+        data.passengers = static_cast<int>(it.value().passengers);
+        data.revenue = it.value().revenue;
+        timeSeries.append(data);
+    }
+    return timeSeries;
+}
+
+bool AnalysisEngine::scanFlows(const DataManager::FlowVisitor &visit) const
+{
+    QString error;
+    if (!m_dataManager->scanFlows(visit, &error)) {
+        qDebug() << error;
+        m_cache.markIncomplete();
+        return false;
+    }
+    return true;
+}
+
+bool AnalysisEngine::scanFlows(const QDate &startDate, const QDate &endDate,
+                               const DataManager::FlowVisitor &visit) const
+{
+    QString error;
+    if (!m_dataManager->scanFlows(startDate, endDate, visit, &error)) {
+        qDebug() << error;
+        m_cache.markIncomplete();
+        return false;
+    }
+    return true;
+}
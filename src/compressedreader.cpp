@@ -0,0 +1,374 @@
+#include "compressedreader.h"
+#include <QFileInfo>
+#include <QtEndian>
+#include <QDebug>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+CompressedReader::Codec CompressedReader::codecFor(const QString &path)
+{
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QByteArray magic = file.read(4);
+        if (magic.startsWith("\x1f\x8b")) {
+            return Gzip;
+        }
+        if (magic == QByteArray("\x28\xb5\x2f\xfd", 4)) {
+            return Zstd;
+        }
+        if (magic.size() == 4) {
+            return Plain;
+        }
+    }
+
+    if (path.endsWith(".gz", Qt::CaseInsensitive)) {
+        return Gzip;
+    }
+    if (path.endsWith(".zst", Qt::CaseInsensitive)) {
+        return Zstd;
+    }
+    return Plain;
+}
+
+bool CompressedReader::isSupported(Codec codec)
+{
+    switch (codec) {
+    case Plain:
+        return true;
+    case Gzip:
+#ifdef HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+QString CompressedReader::codecName(Codec codec)
+{
+    switch (codec) {
+    case Gzip: return "gzip";
+    case Zstd: return "zstd";
+    default: return "plain";
+    }
+}
+
+qint64 CompressedReader::expectedSize(const QString &path)
+{
+    const qint64 size = QFileInfo(path).size();
+    const Codec codec = codecFor(path);
+    if (codec == Plain) {
+        return size;
+    }
+
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        if (codec == Gzip && size >= 18 && file.seek(size - 4)) {
+            const QByteArray trailer = file.read(4);
+            if (trailer.size() == 4) {
+                // 尾部只记录长度的低32位；解压后不会比压缩文件的一半还小，按此补足高位
+                qint64 expected = qFromLittleEndian<quint32>(trailer.constData());
+                while (expected * 2 < size) {
+                    expected += qint64(1) << 32;
+                }
+                return expected;
+            }
+        }
+#ifdef HAVE_ZSTD
+        if (codec == Zstd) {
+            const QByteArray head = file.read(18);      // 帧头最长18字节
+            const unsigned long long contentSize = ZSTD_getFrameContentSize(head.constData(), head.size());
+            if (contentSize != ZSTD_CONTENTSIZE_UNKNOWN && contentSize != ZSTD_CONTENTSIZE_ERROR) {
+                return static_cast<qint64>(contentSize);
+            }
+        }
+#endif
+    }
+
+    // 没有记录解压后长度时按常见的CSV压缩比估计
+    return size * 6;
+}
+
+CompressedReader::CompressedReader(const QString &path)
+    : m_path(path)
+    , m_codec(codecFor(path))
+    , m_file(path)
+    , m_thread(nullptr)
+    , m_finished(false)
+    , m_stopRequested(false)
+{
+}
+
+CompressedReader::~CompressedReader()
+{
+    // 读取方提前放弃（取消或出错）时解压线程可能正等着队列腾出空间
+    if (m_thread) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stopRequested = true;
+            m_notFull.wakeAll();
+        }
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+bool CompressedReader::open(QString *error)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        *error = QString("无法打开客流文件: %1\n错误: %2").arg(m_path).arg(m_file.errorString());
+        return false;
+    }
+    if (!isSupported(m_codec)) {
+        *error = QString("程序编译时未启用%1解压支持，无法读取: %2").arg(codecName(m_codec)).arg(m_path);
+        m_file.close();
+        return false;
+    }
+
+    if (m_codec != Plain) {
+        qDebug() << "流式解压客流文件:" << QFileInfo(m_path).fileName() << "格式:" << codecName(m_codec);
+        m_thread = QThread::create([this]() {
+            decompress();
+        });
+        m_thread->start();
+    }
+    return true;
+}
+
+QByteArray CompressedReader::read(qint64 maxBytes)
+{
+    if (m_codec == Plain) {
+        const QByteArray data = m_file.read(maxBytes);
+        if (data.isEmpty() && !m_file.atEnd()) {
+            QMutexLocker locker(&m_mutex);
+            m_error = QString("读取客流文件失败: %1\n错误: %2").arg(m_path).arg(m_file.errorString());
+        }
+        return data;
+    }
+
+    QByteArray data = std::move(m_front);
+    m_front.clear();
+    while (data.size() < maxBytes) {
+        QByteArray chunk;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.isEmpty() && !m_finished) {
+                m_notEmpty.wait(&m_mutex);
+            }
+            if (m_queue.isEmpty()) {
+                break;
+            }
+            chunk = m_queue.dequeue();
+            m_notFull.wakeOne();
+        }
+        if (data.isEmpty()) {
+            data = std::move(chunk);
+        } else {
+            data += chunk;
+        }
+    }
+
+    if (data.size() > maxBytes) {
+        m_front = data.mid(maxBytes);
+        data.truncate(maxBytes);
+    }
+    return data;
+}
+
+bool CompressedReader::atEnd() const
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_error.isEmpty()) {
+        return true;
+    }
+    if (m_codec == Plain) {
+        return m_file.atEnd();
+    }
+    return m_front.isEmpty() && m_queue.isEmpty() && m_finished;
+}
+
+QString CompressedReader::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_error;
+}
+
+void CompressedReader::decompress()
+{
+    QString error;
+    const bool ok = m_codec == Gzip ? decompressGzip(&error) : decompressZstd(&error);
+
+    QMutexLocker locker(&m_mutex);
+    if (!ok && !m_stopRequested) {
+        m_error = error;
+    }
+    m_finished = true;
+    m_notEmpty.wakeAll();
+}
+
+bool CompressedReader::push(QByteArray chunk)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.size() >= QueueDepth && !m_stopRequested) {
+        m_notFull.wait(&m_mutex);
+    }
+    if (m_stopRequested) {
+        return false;
+    }
+    m_queue.enqueue(std::move(chunk));
+    m_notEmpty.wakeOne();
+    return true;
+}
+
+bool CompressedReader::decompressGzip(QString *error)
+{
+#ifdef HAVE_ZLIB
+    z_stream stream = {};
+    // 32：自动识别gzip或zlib头
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        *error = QString("初始化gzip解压失败: %1").arg(m_path);
+        return false;
+    }
+
+    QByteArray input;
+    QByteArray output(OutputChunkBytes, Qt::Uninitialized);
+    qint64 filled = 0;
+    bool inMember = false;      // 当前gzip成员还没解完
+    bool ok = true;
+    while (ok) {
+        input = m_file.read(InputChunkBytes);
+        if (input.isEmpty()) {
+            break;
+        }
+        stream.next_in = reinterpret_cast<Bytef*>(input.data());
+        stream.avail_in = static_cast<uInt>(input.size());
+
+        bool full = false;
+        do {
+            if (stream.avail_in > 0) {
+                inMember = true;
+            }
+            stream.next_out = reinterpret_cast<Bytef*>(output.data() + filled);
+            stream.avail_out = static_cast<uInt>(OutputChunkBytes - filled);
+            const int status = inflate(&stream, Z_NO_FLUSH);
+            filled = OutputChunkBytes - stream.avail_out;
+            if (status == Z_STREAM_END) {
+                // 多个gzip成员首尾相接（如分批压缩后拼接）时接着解下一个成员
+                inMember = false;
+                inflateReset(&stream);
+            } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                *error = QString("gzip解压失败: %1\n错误: %2").arg(m_path)
+                             .arg(stream.msg ? QString::fromLatin1(stream.msg) : QString("数据损坏"));
+                ok = false;
+                break;
+            }
+
+            full = filled == OutputChunkBytes;
+            if (full) {
+                if (!push(output)) {
+                    inflateEnd(&stream);
+                    return true;
+                }
+                output = QByteArray(OutputChunkBytes, Qt::Uninitialized);
+                filled = 0;
+            }
+        } while (stream.avail_in > 0 || full);
+    }
+    inflateEnd(&stream);
+
+    if (ok && m_file.error() != QFileDevice::NoError) {
+        *error = QString("读取压缩文件失败: %1\n错误: %2").arg(m_path).arg(m_file.errorString());
+        ok = false;
+    }
+    if (ok && inMember) {
+        *error = QString("gzip文件不完整: %1").arg(m_path);
+        ok = false;
+    }
+    if (ok && filled > 0) {
+        output.truncate(filled);
+        push(output);
+    }
+    return ok;
+#else
+    *error = QString("程序编译时未启用gzip解压支持，无法读取: %1").arg(m_path);
+    return false;
+#endif
+}
+
+bool CompressedReader::decompressZstd(QString *error)
+{
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if (!stream || ZSTD_isError(ZSTD_initDStream(stream))) {
+        ZSTD_freeDStream(stream);
+        *error = QString("初始化zstd解压失败: %1").arg(m_path);
+        return false;
+    }
+
+    QByteArray input;
+    QByteArray output(OutputChunkBytes, Qt::Uninitialized);
+    qint64 filled = 0;
+    size_t remaining = 0;       // 0表示当前帧已完整解出
+    bool ok = true;
+    while (ok) {
+        input = m_file.read(InputChunkBytes);
+        if (input.isEmpty()) {
+            break;
+        }
+        ZSTD_inBuffer in = { input.constData(), static_cast<size_t>(input.size()), 0 };
+
+        bool full = false;
+        do {
+            ZSTD_outBuffer out = { output.data() + filled, static_cast<size_t>(OutputChunkBytes - filled), 0 };
+            remaining = ZSTD_decompressStream(stream, &out, &in);
+            filled += out.pos;
+            if (ZSTD_isError(remaining)) {
+                *error = QString("zstd解压失败: %1\n错误: %2").arg(m_path)
+                             .arg(QString::fromLatin1(ZSTD_getErrorName(remaining)));
+                ok = false;
+                break;
+            }
+
+            full = filled == OutputChunkBytes;
+            if (full) {
+                if (!push(output)) {
+                    ZSTD_freeDStream(stream);
+                    return true;
+                }
+                output = QByteArray(OutputChunkBytes, Qt::Uninitialized);
+                filled = 0;
+            }
+        } while (in.pos < in.size || full);
+    }
+    ZSTD_freeDStream(stream);
+
+    if (ok && m_file.error() != QFileDevice::NoError) {
+        *error = QString("读取压缩文件失败: %1\n错误: %2").arg(m_path).arg(m_file.errorString());
+        ok = false;
+    }
+    if (ok && remaining != 0) {
+        *error = QString("zstd文件不完整: %1").arg(m_path);
+        ok = false;
+    }
+    if (ok && filled > 0) {
+        output.truncate(filled);
+        push(output);
+    }
+    return ok;
+#else
+    *error = QString("程序编译时未启用zstd解压支持，无法读取: %1").arg(m_path);
+    return false;
+#endif
+}
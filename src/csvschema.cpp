@@ -0,0 +1,70 @@
+#include "csvschema.h"
+#include "csvtokenizer.h"
+#include <QHash>
+
+CsvSchema &CsvSchema::column(int key, const QStringList &headerNames, int defaultIndex)
+{
+    if (m_columns.size() <= key) {
+        m_columns.resize(key + 1);
+    }
+    m_columns[key].headerNames = headerNames;
+    m_columns[key].defaultIndex = defaultIndex;
+    return *this;
+}
+
+CsvProjection CsvSchema::resolve(QByteArrayView headerLine) const
+{
+    // 去掉UTF-8 BOM（Excel导出的文件常带）
+    if (headerLine.size() >= 3 && headerLine.first(3) == QByteArrayView("\xEF\xBB\xBF", 3)) {
+        headerLine = headerLine.sliced(3);
+    }
+
+    // 表头名称 → 列号，同名时取第一个；空表头忽略
+    QHash<QString, int> headerIndex;
+    CsvTokenizer::Fields fields;
+    int headerCount = 0;
+    if (!headerLine.isEmpty()) {
+        CsvTokenizer tokenizer(headerLine.data(), headerLine.data() + headerLine.size());
+        headerCount = tokenizer.nextRow(fields, 1024);
+    }
+    for (int i = 0; i < headerCount; ++i) {
+        const QString name = QString::fromUtf8(CsvTokenizer::trimmed(fields[i])).toLower();
+        if (!name.isEmpty() && !headerIndex.contains(name)) {
+            headerIndex.insert(name, i);
+        }
+    }
+
+    CsvProjection projection;
+    projection.m_indices.resize(m_columns.size());
+    for (int key = 0; key < m_columns.size(); ++key) {
+        const Column &column = m_columns[key];
+        int index = -1;
+        QString matchedName;
+        for (const QString &name : column.headerNames) {
+            index = headerIndex.value(name.toLower(), -1);
+            if (index >= 0) {
+                matchedName = name;
+                break;
+            }
+        }
+        if (index < 0) {
+            index = column.defaultIndex;
+            matchedName = QString("#%1").arg(index);
+            projection.m_missing.append(column.headerNames.value(0));
+        }
+
+        projection.m_indices[key] = index;
+        projection.m_names.append(matchedName);
+        projection.m_fieldCount = qMax(projection.m_fieldCount, index + 1);
+    }
+    return projection;
+}
+
+QString CsvProjection::describe() const
+{
+    QStringList parts;
+    for (int key = 0; key < m_indices.size(); ++key) {
+        parts.append(QString("%1→%2").arg(m_names[key]).arg(m_indices[key]));
+    }
+    return parts.join(", ");
+}
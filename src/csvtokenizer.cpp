@@ -0,0 +1,132 @@
+#include "csvtokenizer.h"
+#include <cstring>
+
+CsvTokenizer::CsvTokenizer(const char *begin, const char *end)
+    : m_begin(begin)
+    , m_end(end)
+    , m_pos(begin)
+{
+}
+
+void CsvTokenizer::skipLine()
+{
+    const char *eol = static_cast<const char*>(std::memchr(m_pos, '\n', m_end - m_pos));
+    m_pos = eol ? eol + 1 : m_end;
+}
+
+int CsvTokenizer::nextRow(Fields &fields, int maxFields)
+{
+    fields.clear();
+
+    const char *lineStart = m_pos;
+    const char *eol = static_cast<const char*>(std::memchr(m_pos, '\n', m_end - m_pos));
+    const char *lineEnd = eol ? eol : m_end;
+    m_pos = eol ? eol + 1 : m_end;
+
+    // 兼容Windows换行
+    if (lineEnd > lineStart && lineEnd[-1] == '\r') {
+        --lineEnd;
+    }
+    m_lastLine = QByteArrayView(lineStart, lineEnd - lineStart);
+
+    const char *fieldStart = lineStart;
+    while (fields.size() < maxFields) {
+        const char *comma = static_cast<const char*>(std::memchr(fieldStart, ',', lineEnd - fieldStart));
+        if (!comma) {
+            fields.append(QByteArrayView(fieldStart, lineEnd - fieldStart));
+            break;
+        }
+        fields.append(QByteArrayView(fieldStart, comma - fieldStart));
+        fieldStart = comma + 1;
+    }
+
+    return fields.size();
+}
+
+QByteArrayView CsvTokenizer::trimmed(QByteArrayView field)
+{
+    const char *b = field.data();
+    const char *e = b + field.size();
+    while (b < e && (*b == ' ' || *b == '\t' || *b == '\r' || *b == '\n')) ++b;
+    while (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r' || e[-1] == '\n')) --e;
+    return QByteArrayView(b, e - b);
+}
+
+int CsvTokenizer::toInt(QByteArrayView field)
+{
+    // 与QString::toInt一致：格式不合法时返回0
+    field = trimmed(field);
+    const char *p = field.data();
+    const char *e = p + field.size();
+    if (p == e) return 0;
+
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        ++p;
+    }
+    if (p == e) return 0;
+
+    qint64 value = 0;
+    for (; p < e; ++p) {
+        unsigned digit = static_cast<unsigned char>(*p) - '0';
+        if (digit > 9) return 0;
+        value = value * 10 + digit;
+        if (value > 2147483648LL) return 0;
+    }
+    if (negative) value = -value;
+    if (value > 2147483647LL) return 0;
+    return static_cast<int>(value);
+}
+
+double CsvTokenizer::toDouble(QByteArrayView field)
+{
+    field = trimmed(field);
+    const char *p = field.data();
+    const char *e = p + field.size();
+    if (p == e) return 0.0;
+
+    // 快速路径：[-]digits[.digits]，有效数字不超过15位时整数除以10的幂是精确舍入的
+    static const double powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char *s = p;
+    bool negative = false;
+    if (*s == '-' || *s == '+') {
+        negative = (*s == '-');
+        ++s;
+    }
+
+    qint64 mantissa = 0;
+    int digits = 0;
+    int fractionDigits = 0;
+    bool seenDot = false;
+    bool fastPath = (s < e);
+    for (; s < e; ++s) {
+        unsigned digit = static_cast<unsigned char>(*s) - '0';
+        if (digit <= 9) {
+            if (digits > 0 || digit != 0) ++digits;
+            mantissa = mantissa * 10 + digit;
+            if (seenDot) ++fractionDigits;
+            if (digits > 15 || fractionDigits > 22) {
+                fastPath = false;
+                break;
+            }
+        } else if (*s == '.' && !seenDot) {
+            seenDot = true;
+        } else {
+            fastPath = false;
+            break;
+        }
+    }
+
+    if (fastPath) {
+        double value = static_cast<double>(mantissa) / powersOf10[fractionDigits];
+        return negative ? -value : value;
+    }
+
+    // 指数、nan等少见格式交给Qt处理；fromRawData不复制数据
+    return QByteArray::fromRawData(p, e - p).toDouble();
+}
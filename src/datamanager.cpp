@@ -1,255 +1,2033 @@
 #include "datamanager.h"
+#include "csvtokenizer.h"
+#include "flowsnapshot.h"
+#include "datetimeparser.h"
+#include "csvschema.h"
+#include "flowpartitions.h"
+#include "flowblockfile.h"
+#include "compressedreader.h"
+#include "flowcoldsource.h"
+#include "flowcolumnfile.h"
 #include <QFile>
 #include <QTextStream>
 #include <QStringList>
 #include <QDebug>
 #include <QDir>
 #include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSharedPointer>
+#include <cstring>
 #include <QCoreApplication> // 添加用于获取应用程序路径
 #include <QRandomGenerator> // 替代QtGlobal中废弃的qrand
 #include <QTime> // 添加用于QTime::currentTime()
 #include <cstdlib> // 用于std::rand() 和 std::srand()
 #include <algorithm> // 用于std::min
+#include <climits>
+
+namespace {
+
+// 流式解析时每个解析任务的字节数；每轮读入线程数个这样的块
+const qint64 kStreamChunkBytes = 8 * 1024 * 1024;
+
+// 数据质量检查的站点ID位图上限（2MB），更大的ID退回站点索引查找
+const int kMaxStationBitmapId = 16 * 1024 * 1024;
+
+// 各CSV文件的列：表头名称可能是拼音缩写也可能是中文，找不到时用原来固定的列号
+enum StationColumn { StationIdColumn, StationNameColumn, StationCodeColumn, StationTelecodeColumn,
+                     StationShortNameColumn };
+enum TrainColumn { TrainCodeColumn, TrainNumberColumn, TrainCapacityColumn };
+enum RouteColumn { RouteLineColumn, RouteStationColumn, RouteOrderColumn, RouteSectionDistanceColumn,
+                   RouteTransportDistanceColumn, RouteStopColumn };
+enum FlowColumn { FlowLineColumn, FlowTrainColumn, FlowStationColumn, FlowDateColumn, FlowArrivalColumn,
+                  FlowDepartureColumn, FlowBoardingColumn, FlowAlightingColumn, FlowTicketTypeColumn,
+                  FlowTicketPriceColumn, FlowStartStationColumn, FlowEndStationColumn, FlowRevenueColumn };
+
+const CsvSchema &stationSchema()
+{
+    static const CsvSchema schema = CsvSchema("客运站点")
+        .column(StationIdColumn, {"zdid", "站点id"}, 0)
+        .column(StationNameColumn, {"zdmc", "站点名称"}, 7)
+        .column(StationCodeColumn, {"station_code", "站点编码"}, 12)
+        .column(StationTelecodeColumn, {"station_telecode", "电报码"}, 13)
+        .column(StationShortNameColumn, {"station_shortname", "站点简称"}, 14);
+    return schema;
+}
+
+const CsvSchema &trainSchema()
+{
+    static const CsvSchema schema = CsvSchema("列车表")
+        .column(TrainCodeColumn, {"lcbm", "列车编码"}, 0)
+        .column(TrainNumberColumn, {"lcdm", "列车代码", "车次"}, 3)
+        .column(TrainCapacityColumn, {"lcyn", "列车运量"}, 6);
+    return schema;
+}
+
+const CsvSchema &routeSchema()
+{
+    static const CsvSchema schema = CsvSchema("运营线路客运站")
+        .column(RouteLineColumn, {"yyxlbm", "运营线路编码"}, 0)
+        .column(RouteStationColumn, {"zdid", "站点id"}, 1)
+        .column(RouteOrderColumn, {"xlzdid", "线路站点id"}, 3)
+        .column(RouteSectionDistanceColumn, {"yqzdjjl", "运营线路站间距离"}, 5)
+        .column(RouteTransportDistanceColumn, {"ysjl", "运输距离"}, 12)
+        .column(RouteStopColumn, {"sfytk", "是否要停靠"}, 14);
+    return schema;
+}
+
+const CsvSchema &flowSchema()
+{
+    static const CsvSchema schema = CsvSchema("客流")
+        .column(FlowLineColumn, {"yyxlbm", "运营线路编码"}, 1)
+        .column(FlowTrainColumn, {"lcbm", "列车编码"}, 2)
+        .column(FlowStationColumn, {"zdid", "站点id"}, 3)
+        .column(FlowDateColumn, {"yxrq", "运行日期", "日期"}, 6)         // 第G列
+        .column(FlowArrivalColumn, {"ddsj", "到达时间"}, 11)
+        .column(FlowDepartureColumn, {"cfsj", "出发时间"}, 12)
+        .column(FlowBoardingColumn, {"skl", "上客量"}, 17)               // 第R列
+        .column(FlowAlightingColumn, {"xkl", "下客量"}, 18)              // 第S列
+        .column(FlowTicketTypeColumn, {"ticket_type", "车票类型"}, 23)   // 第X列
+        .column(FlowTicketPriceColumn, {"ticket_price", "车票价格", "票价"}, 24)
+        .column(FlowStartStationColumn, {"sfz", "起点站"}, 27)
+        .column(FlowEndStationColumn, {"zdz", "终点站"}, 28)
+        .column(FlowRevenueColumn, {"shouru", "收入"}, 38);              // 第AM列
+    return schema;
+}
+
+// 线路拓扑文件与站点文件在同一目录
+QString routesFilePath(const QString &stationsFile)
+{
+    return QFileInfo(stationsFile).dir().filePath("运营线路客运站.csv");
+}
+
+// 单个客流文件，可以是gzip或zstd压缩的，也可以是导出的列式文件；都不存在时返回未压缩的文件名
+QString flowFilePath(const QDir &dir)
+{
+    const QString name = "高铁客运量（成都--重庆）.csv";
+    for (const char *suffix : { ".gz", ".zst" }) {
+        if (dir.exists(name + suffix)) {
+            return dir.filePath(name + suffix);
+        }
+    }
+    const QString columnFile = "高铁客运量（成都--重庆）.fcol";
+    if (!dir.exists(name) && dir.exists(columnFile)) {
+        return dir.filePath(columnFile);
+    }
+    return dir.filePath(name);
+}
+
+CsvProjection resolveColumns(const CsvSchema &schema, QByteArrayView header)
+{
+    CsvProjection columns = schema.resolve(header);
+    qDebug() << schema.name() << "列映射:" << columns.describe();
+    if (columns.usedDefaults()) {
+        qDebug() << schema.name() << "表头中未找到" << columns.missingColumns().join(", ") << "，使用默认列号";
+    }
+    return columns;
+}
+
+// 客流文件的列映射、日期格式和第一条数据行的日期，从文件开头的一小段探测
+struct FlowFileLayout {
+    CsvProjection columns;
+    DateTimeParser::DateFormat dateFormat = DateTimeParser::UnknownDate;
+    int firstDay = DateTimeParser::InvalidDay;
+};
+
+FlowFileLayout probeFlowLayout(const QByteArray &head)
+{
+    FlowFileLayout layout;
+    CsvTokenizer tokenizer(head.constData(), head.constData() + head.size());
+    tokenizer.skipLine();
+    layout.columns = flowSchema().resolve(QByteArrayView(head.constData(), tokenizer.position()));
+    const int dateColumn = layout.columns.index(FlowDateColumn);
+
+    CsvTokenizer::Fields fields;
+    while (!tokenizer.atEnd()) {
+        if (tokenizer.nextRow(fields, dateColumn + 1) > dateColumn) {
+            layout.dateFormat = DateTimeParser::detectDateFormat(fields[dateColumn]);
+            layout.firstDay = DateTimeParser::parseDay(fields[dateColumn], layout.dateFormat);
+            break;
+        }
+    }
+    return layout;
+}
+
+// 客流文件冷列（线路、到达时间、票价、起终点站）的解码来源
+QSharedPointer<FlowColdSource> coldSourceFor(const QString &path, const CsvProjection &columns,
+                                             DateTimeParser::DateFormat dateFormat)
+{
+    return QSharedPointer<FlowColdSource>::create(path, columns.index(FlowStationColumn), columns.index(FlowDateColumn),
+                                                  dateFormat, columns.index(FlowLineColumn),
+                                                  columns.index(FlowArrivalColumn),
+                                                  columns.index(FlowTicketPriceColumn),
+                                                  columns.index(FlowStartStationColumn),
+                                                  columns.index(FlowEndStationColumn), columns.fieldCount());
+}
+
+// 只读文件开头和结尾各一小段，用首尾两条数据行的日期估计分区范围。
+// 按月切分的文件内日期不一定有序，所以范围扩到首尾日期所在月份的整月；
+// 两端任一无法解析时范围未知，分区总会被加载
+FlowPartition probePartition(const QString &path)
+{
+    const qint64 probeBytes = 64 * 1024;
+    FlowPartition partition;
+    QFileInfo info(path);
+    partition.path = info.absoluteFilePath();
+    partition.size = info.size();
+    partition.modified = info.lastModified().toMSecsSinceEpoch();
+
+    // 压缩文件无法只读尾部；范围留作未知，第一次加载后索引会记下精确范围
+    if (CompressedReader::codecFor(path) != CompressedReader::Plain) {
+        return partition;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return partition;
+    }
+
+    const FlowFileLayout layout = probeFlowLayout(file.read(probeBytes));
+    const int dateColumn = layout.columns.index(FlowDateColumn);
+    const int firstDay = layout.firstDay;
+
+    // 最后一条非空行；只读了文件尾部时，行首必须落在读到的范围内
+    const qint64 tailOffset = qMax<qint64>(0, partition.size - probeBytes);
+    file.seek(tailOffset);
+    const QByteArray tail = file.read(probeBytes);
+    int lineEnd = tail.size();
+    while (lineEnd > 0 && (tail[lineEnd - 1] == '\n' || tail[lineEnd - 1] == '\r')) {
+        --lineEnd;
+    }
+    const int lineStart = tail.lastIndexOf('\n', lineEnd - 1) + 1;
+    int lastDay = DateTimeParser::InvalidDay;
+    if (lineEnd > 0 && (lineStart > 0 || tailOffset == 0)) {
+        CsvTokenizer lastLine(tail.constData() + lineStart, tail.constData() + lineEnd);
+        CsvTokenizer::Fields fields;
+        if (lastLine.nextRow(fields, dateColumn + 1) > dateColumn) {
+            lastDay = DateTimeParser::parseDay(fields[dateColumn], layout.dateFormat);
+        }
+    }
+
+    if (firstDay != DateTimeParser::InvalidDay && lastDay != DateTimeParser::InvalidDay) {
+        const QDate first = QDate::fromJulianDay(qMin(firstDay, lastDay));
+        const QDate last = QDate::fromJulianDay(qMax(firstDay, lastDay));
+        partition.firstDay = static_cast<int>(QDate(first.year(), first.month(), 1).toJulianDay());
+        partition.lastDay = static_cast<int>(QDate(last.year(), last.month(), last.daysInMonth()).toJulianDay());
+    }
+    return partition;
+}
+
+} // namespace
 
 DataManager::DataManager(QObject *parent)
     : QObject(parent)
+    , m_stationIdBase(0)
+    , m_parallelLoading(true)
+    , m_snapshotCache(true)
+    , m_lazyColumns(true)
+    , m_loading(false)
+    , m_progressTimer(new QTimer(this))
+    , m_bytesRead(0)
+    , m_bytesTotal(0)
+    , m_cancelRequested(0)
+    , m_partitioned(false)
+    , m_windowRows(0)
+    , m_partitionClock(0)
+    , m_partitionBudget(qint64(1024) * 1024 * 1024)
+    , m_windowStartDay(INT_MIN)
+    , m_windowEndDay(INT_MAX)
+    , m_generation(0)
+    , m_flowIndexGeneration(0)
+    , m_flowBitmapsGeneration(0)
+    , m_duplicateRows(0)
+    , m_tailMode(false)
+    , m_tailWatcher(nullptr)
+    , m_tailOffset(0)
+    , m_tailLayoutValid(false)
+    , m_tailDateFormat(DateTimeParser::UnknownDate)
+    , m_database("flows")
+    , m_databaseBacked(false)
+    , m_outOfCore(false)
+    , m_blockMode(false)
 {
     // 初始化随机数生成器，用于生成模拟数据
     std::srand(QTime::currentTime().msec());
+
+    // 后台加载时定期汇报已解析的字节数，避免解析线程频繁跨线程发信号
+    m_progressTimer->setInterval(100);
+    connect(m_progressTimer, &QTimer::timeout, this, [this]() {
+        emit progress(m_bytesRead.loadRelaxed(), m_bytesTotal.loadRelaxed());
+    });
+}
+
+DataManager::~DataManager()
+{
+    // 工作线程引用着本对象，析构前必须等它结束
+    if (m_loadThread) {
+        m_cancelRequested.storeRelaxed(1);
+        m_loadThread->wait();
+    }
 }
 
 bool DataManager::loadStations(const QString &filename)
+{
+    QVector<StationRecord> records;
+    QString error;
+    if (!readStations(filename, records, &error)) {
+        emit dataLoadError(error);
+        return false;
+    }
+    adoptStations(records);
+    return true;
+}
+
+bool DataManager::loadTrains(const QString &filename)
+{
+    QVector<TrainRecord> records;
+    QString error;
+    if (!readTrains(filename, records, &error)) {
+        emit dataLoadError(error);
+        return false;
+    }
+    adoptTrains(records);
+    return true;
+}
+
+bool DataManager::loadPassengerFlow(const QString &filename)
+{
+    FlowStore store;
+    QString error;
+    if (!readPassengerFlow(filename, store, &error)) {
+        emit dataLoadError(error);
+        return false;
+    }
+    if (!m_flowStore.append(store, &error)) {
+        emit dataLoadError(error);
+        return false;
+    }
+    m_flowStore.sortByDay();
+    return true;
+}
+
+bool DataManager::readStations(const QString &filename, QVector<StationRecord> &records, QString *error) const
 {
     QFile file(filename);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        emit dataLoadError(QString("无法打开站点文件: %1\n错误: %2").arg(filename).arg(file.errorString()));
+        *error = QString("无法打开站点文件: %1\n错误: %2").arg(filename).arg(file.errorString());
         return false;
     }
 
     QTextStream in(&file);
     in.setEncoding(QStringConverter::Utf8);
     
-    // Skip header
-    QString header = in.readLine();
+    // 按表头确定各列位置
+    const CsvProjection columns = resolveColumns(stationSchema(), in.readLine().toUtf8());
+    const int idColumn = columns.index(StationIdColumn);
+    const int nameColumn = columns.index(StationNameColumn);
+    const int codeColumn = columns.index(StationCodeColumn);
+    const int telecodeColumn = columns.index(StationTelecodeColumn);
+    const int shortNameColumn = columns.index(StationShortNameColumn);
     
     // 不限制站点类型，加载所有站点
     while (!in.atEnd()) {
         QString line = in.readLine();
         QStringList fields = line.split(",");
         
-        if (fields.size() >= 15) {
-            int id = fields[0].toInt();
-            QString name = fields[7].trimmed();
-            QString code = fields[12].trimmed();
-            QString shortName = fields[14].trimmed();
-            QString telecode = fields[13].trimmed();
+        if (fields.size() >= columns.fieldCount()) {
+            StationRecord record;
+            record.id = fields[idColumn].toInt();
+            record.name = fields[nameColumn].trimmed();
+            record.code = fields[codeColumn].trimmed();
+            record.shortName = fields[shortNameColumn].trimmed();
+            record.telecode = fields[telecodeColumn].trimmed();
             
             // 加载所有有效站点
-            if (id > 0 && !name.isEmpty()) {
-                Station *station = new Station(id, name, code, shortName, this);
-                station->setTelecode(telecode);
-                m_stations.append(station);
-                m_stationMap[id] = station;
-                qDebug() << "Loaded station:" << name << "(ID:" << id << ")";
+            if (record.id > 0 && !record.name.isEmpty()) {
+                records.append(record);
+                qDebug() << "Loaded station:" << record.name << "(ID:" << record.id << ")";
             }
         }
     }
     
+    m_bytesRead.fetchAndAddRelaxed(file.size());
     file.close();
-    qDebug() << "Loaded" << m_stations.size() << "stations";
+    qDebug() << "Loaded" << records.size() << "stations";
     return true;
 }
 
-bool DataManager::loadTrains(const QString &filename)
+bool DataManager::readTrains(const QString &filename, QVector<TrainRecord> &records, QString *error) const
 {
     QFile file(filename);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        emit dataLoadError(QString("无法打开列车文件: %1").arg(filename));
+        *error = QString("无法打开列车文件: %1").arg(filename);
         return false;
     }
 
     QTextStream in(&file);
     in.setEncoding(QStringConverter::Utf8);
     
-    // Skip header
-    QString header = in.readLine();
+    // 按表头确定各列位置
+    const CsvProjection columns = resolveColumns(trainSchema(), in.readLine().toUtf8());
+    const int codeColumn = columns.index(TrainCodeColumn);
+    const int numberColumn = columns.index(TrainNumberColumn);
+    const int capacityColumn = columns.index(TrainCapacityColumn);
+    
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        QStringList fields = line.split(",");
+        
+        if (fields.size() >= columns.fieldCount()) {
+            TrainRecord record;
+            record.code = fields[codeColumn].trimmed();
+            record.trainCode = fields[numberColumn].trimmed();
+            record.capacity = fields[capacityColumn].toInt();
+            
+            if (!record.code.isEmpty() && !record.trainCode.isEmpty()) {
+                records.append(record);
+            }
+        }
+    }
     
+    m_bytesRead.fetchAndAddRelaxed(file.size());
+    file.close();
+    qDebug() << "Loaded" << records.size() << "trains";
+    return true;
+}
+
+bool DataManager::readRouteGraph(const QString &filename, RouteGraph &graph, QString *error) const
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = QString("无法打开线路文件: %1\n错误: %2").arg(filename).arg(file.errorString());
+        return false;
+    }
+
+    QTextStream in(&file);
+    in.setEncoding(QStringConverter::Utf8);
+
+    // 按表头确定各列位置
+    const CsvProjection columns = resolveColumns(routeSchema(), in.readLine().toUtf8());
+    const int lineColumn = columns.index(RouteLineColumn);
+    const int stationColumn = columns.index(RouteStationColumn);
+    const int orderColumn = columns.index(RouteOrderColumn);
+    const int sectionColumn = columns.index(RouteSectionDistanceColumn);
+    const int transportColumn = columns.index(RouteTransportDistanceColumn);
+    const int stopColumn = columns.index(RouteStopColumn);
+
+    QVector<RouteStationRecord> records;
     while (!in.atEnd()) {
         QString line = in.readLine();
         QStringList fields = line.split(",");
+
+        if (fields.size() >= columns.fieldCount()) {
+            RouteStationRecord record;
+            record.lineCode = fields[lineColumn].trimmed();
+            record.stationId = fields[stationColumn].toInt();
+            record.order = fields[orderColumn].toInt();
+            record.sectionDistance = fields[sectionColumn].toInt();
+            record.transportDistance = fields[transportColumn].toInt();
+            record.stop = fields[stopColumn].toInt() != 0;
+
+            // 第二行是中文列名，站点id不是数字，与其他无效行一起跳过
+            if (record.stationId > 0 && !record.lineCode.isEmpty()) {
+                records.append(record);
+            }
+        }
+    }
+
+    m_bytesRead.fetchAndAddRelaxed(file.size());
+    file.close();
+
+    graph.build(records);
+    qDebug() << "Loaded" << graph.lineCount() << "lines," << graph.nodeCount() << "stations,"
+             << graph.edgeCount() / 2 << "sections from" << records.size() << "line-station rows";
+    return true;
+}
+
+void DataManager::adoptStations(const QVector<StationRecord> &records)
+{
+    for (const StationRecord &record : records) {
+        Station *station = m_stationArena.create(record.id, record.name, record.code, record.shortName);
+        station->setTelecode(record.telecode);
+        m_stations.append(station);
+    }
+    rebuildStationIndex();
+    // 站点名称参与分析结果
+    ++m_generation;
+}
+
+void DataManager::adoptTrains(const QVector<TrainRecord> &records)
+{
+    for (const TrainRecord &record : records) {
+        Train *train = m_trainArena.create(record.code, record.trainCode, record.capacity);
+        m_trains.append(train);
+    }
+    rebuildTrainIndex();
+    ++m_generation;
+}
+
+void DataManager::rebuildStationIndex()
+{
+    m_stationIdBase = 0;
+    m_stationSlots.clear();
+    m_sparseStationIds.clear();
+
+    int minId = INT_MAX;
+    int maxId = INT_MIN;
+    for (const Station *station : m_stations) {
+        minId = qMin(minId, station->getId());
+        maxId = qMax(maxId, station->getId());
+    }
+    // 站点ID通常是几千以内的连续编号，平铺数组只比哈希表多占少量内存
+    const qint64 span = m_stations.isEmpty() ? 0 : qint64(maxId) - minId + 1;
+    const bool flat = span > 0 && span <= qint64(m_stations.size()) * 16 + 65536;
+    if (flat) {
+        m_stationIdBase = minId;
+        m_stationSlots.fill(-1, span);
+    }
+
+    QStringList names;
+    QStringList telecodes;
+    for (int index = 0; index < m_stations.size(); ++index) {
+        const Station *station = m_stations[index];
+        // 重复的站点ID以后加载的为准
+        if (flat) {
+            m_stationSlots[station->getId() - m_stationIdBase] = index;
+        } else {
+            m_sparseStationIds.insert(station->getId(), index);
+        }
+        names.append(station->getName());
+        telecodes.append(station->getTelecode());
+    }
+    m_stationNameIndex.build(names);
+    m_stationTelecodeIndex.build(telecodes);
+}
+
+void DataManager::rebuildTrainIndex()
+{
+    QStringList codes;
+    QStringList numbers;
+    for (const Train *train : m_trains) {
+        codes.append(train->getCode());
+        numbers.append(train->getTrainCode());
+    }
+    m_trainCodeIndex.build(codes);
+    m_trainNumberIndex.build(numbers);
+}
+
+bool DataManager::readPassengerFlow(const QString &filename, FlowStore &store, QString *error,
+                                    bool splitChunks, qint64 *parsedBytes, qint64 *duplicateRows) const
+{
+    // 导出的列式文件已经去过重，各列直接从映射的文件解码，不经过文本解析
+    if (FlowColumnFile::isColumnFile(filename)) {
+        FlowColumnFile columnFile;
+        const bool ok = columnFile.open(filename, error) && columnFile.read(store, error);
+        m_bytesRead.fetchAndAddRelaxed(QFileInfo(filename).size());
+        if (ok) {
+            qDebug() << "从列式文件加载" << columnFile.rowCount() << "条客流数据，"
+                     << columnFile.rowGroupCount() << "个行组";
+        }
+        if (parsedBytes) {
+            *parsedBytes = 0;
+        }
+        if (duplicateRows) {
+            *duplicateRows = 0;
+        }
+        return ok;
+    }
+
+    // 上游重发的重叠数据会让同一行出现多次，按块的顺序去重，保留第一次出现的行
+    FlowDeduplicator deduplicator;
+
+    // 压缩文件不能映射，边解压边解析，各批按文件顺序合并，结果与解压后再加载一致
+    if (CompressedReader::codecFor(filename) != CompressedReader::Plain) {
+        const bool ok = streamPassengerFlow(filename, [&store, &deduplicator](FlowStore &flows, QString *error) {
+            deduplicator.filter(flows);
+            return store.append(flows, error);
+        }, error, splitChunks);
+        if (ok) {
+            qDebug() << "成功加载" << store.size() << "条客流数据，丢弃重复" << deduplicator.duplicates() << "条，"
+                     << "列式存储占用约" << store.memoryUsage() / (1024 * 1024) << "MB";
+        }
+        if (parsedBytes) {
+            *parsedBytes = 0;
+        }
+        if (duplicateRows) {
+            *duplicateRows = deduplicator.duplicates();
+        }
+        return ok;
+    }
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("无法打开客流文件: %1\n错误: %2").arg(filename).arg(file.errorString());
+        return false;
+    }
+
+    // 内存映射整个文件，直接在UTF-8字节上切分字段；映射失败时退回一次性读入
+    const qint64 fileSize = file.size();
+    QByteArray buffer;
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    if (fileSize > 0) {
+        begin = reinterpret_cast<const char*>(file.map(0, fileSize));
+        end = begin ? begin + fileSize : nullptr;
+        if (!begin) {
+            qDebug() << "内存映射失败，改为整体读取:" << file.errorString();
+            buffer = file.readAll();
+            begin = buffer.constData();
+            end = begin + buffer.size();
+        }
+    }
+
+    // 表头只解析一次，得到各列的位置
+    CsvTokenizer header(begin, end);
+    header.skipLine();
+    const char *dataBegin = begin + header.position();
+    m_bytesRead.fetchAndAddRelaxed(header.position());
+    const CsvProjection columns = resolveColumns(flowSchema(), QByteArrayView(begin, header.position()));
+    const int dateColumn = columns.index(FlowDateColumn);
+
+    // 显示进度信息
+    qDebug() << "开始加载客流数据...";
+
+    // 日期格式按第一条数据行探测一次，之后逐行按固定格式解析
+    DateTimeParser::DateFormat dateFormat = DateTimeParser::UnknownDate;
+    {
+        CsvTokenizer probe(dataBegin, end);
+        CsvTokenizer::Fields fields;
+        while (!probe.atEnd() && dateFormat == DateTimeParser::UnknownDate) {
+            if (probe.nextRow(fields, dateColumn + 1) > dateColumn) {
+                dateFormat = DateTimeParser::detectDateFormat(fields[dateColumn]);
+                qDebug() << "日期格式:" << DateTimeParser::formatName(dateFormat)
+                         << "示例:" << QString::fromUtf8(CsvTokenizer::trimmed(fields[dateColumn]));
+                break;
+            }
+        }
+    }
+
+    // 按换行对齐切成若干字节块；单线程时整个文件就是一个块，两条路径共用同一套解析和合并代码。
+    // 分区已经按文件并行解析，单个分区不再切块
+    QVector<QPair<const char*, const char*>> ranges;
+    if (splitChunks) {
+        ranges = splitFlowRanges(dataBegin, end);
+    } else {
+        ranges.append(qMakePair(dataBegin, end));
+    }
+    QVector<FlowChunk> chunks(ranges.size());
+
+    // 单个客流文件的冷列只记行偏移，第一次访问时再解码；分区要合并成窗口，仍整行解析
+    const bool lazyColumns = m_lazyColumns && splitChunks && !m_partitioned;
+    const QSharedPointer<FlowColdSource> coldSource = lazyColumns ? coldSourceFor(filename, columns, dateFormat)
+                                                                  : QSharedPointer<FlowColdSource>();
+    if (lazyColumns) {
+        for (int i = 0; i < ranges.size(); ++i) {
+            chunks[i].fileOffset = ranges[i].first - begin;
+            chunks[i].store.deferColdColumns(coldSource);
+        }
+        if (store.isEmpty()) {
+            store.deferColdColumns(coldSource);
+        }
+    }
+
+    if (ranges.size() == 1) {
+        parseFlowChunk(ranges[0].first, ranges[0].second, columns, dateFormat, chunks[0]);
+    } else {
+        qDebug() << "并行解析客流数据，分块数:" << ranges.size()
+                 << "线程数:" << QThread::idealThreadCount();
+        QThreadPool pool;
+        pool.setMaxThreadCount(QThread::idealThreadCount());
+        for (int i = 0; i < ranges.size(); ++i) {
+            pool.start([this, &ranges, &chunks, &columns, dateFormat, i]() {
+                parseFlowChunk(ranges[i].first, ranges[i].second, columns, dateFormat, chunks[i]);
+            });
+        }
+        pool.waitForDone();
+    }
+
+    // 取消时各块只解析了一部分，结果直接丢弃
+    if (m_cancelRequested.loadRelaxed()) {
+        file.close();
+        *error = "客流数据加载已取消";
+        return false;
+    }
+    for (const FlowChunk &chunk : chunks) {
+        if (!chunk.error.isEmpty()) {
+            file.close();
+            *error = QString("%1: %2").arg(filename, chunk.error);
+            return false;
+        }
+    }
+
+    int totalRecords = 0;
+    int count = 0;
+    qint64 parsedRows = 0;
+    for (const FlowChunk &chunk : chunks) {
+        parsedRows += chunk.store.size();
+    }
+    deduplicator.reserve(parsedRows);
+    for (FlowChunk &chunk : chunks) {
+        deduplicator.filter(chunk.store);
+        totalRecords += chunk.totalRecords;
+        count += chunk.store.size();
+    }
+    file.close();
+
+    if (!mergeFlowChunks(chunks, store, error)) {
+        *error = QString("%1: %2").arg(filename, *error);
+        return false;
+    }
+    if (parsedBytes) {
+        *parsedBytes = end - begin;
+    }
+    if (duplicateRows) {
+        *duplicateRows = deduplicator.duplicates();
+    }
+    
+    qDebug() << "处理了" << totalRecords << "条记录，成功加载" << count << "条客流数据，丢弃重复"
+             << deduplicator.duplicates() << "条，列式存储占用约" << store.memoryUsage() / (1024 * 1024) << "MB";
+    return true;
+}
+
+QVector<QPair<const char*, const char*>> DataManager::splitFlowRanges(const char *begin, const char *end) const
+{
+    QVector<QPair<const char*, const char*>> ranges;
+    const qint64 totalBytes = end - begin;
+
+    // 小文件开线程得不偿失；每块至少4MB，块数取线程数的4倍以平衡负载
+    const qint64 minChunkBytes = 4 * 1024 * 1024;
+    int chunkCount = 1;
+    if (m_parallelLoading && totalBytes > minChunkBytes) {
+        chunkCount = static_cast<int>(qMin<qint64>(QThread::idealThreadCount() * 4,
+                                                   totalBytes / minChunkBytes));
+        chunkCount = qMax(1, chunkCount);
+    }
+
+    const char *chunkBegin = begin;
+    for (int i = 1; i <= chunkCount && chunkBegin < end; ++i) {
+        const char *chunkEnd = end;
+        if (i < chunkCount) {
+            // 块边界移到下一行的开头，保证每行只属于一个块
+            const char *target = begin + totalBytes * i / chunkCount;
+            if (target < chunkBegin) target = chunkBegin;
+            const char *eol = static_cast<const char*>(std::memchr(target, '\n', end - target));
+            chunkEnd = eol ? eol + 1 : end;
+        }
+        ranges.append(qMakePair(chunkBegin, chunkEnd));
+        chunkBegin = chunkEnd;
+    }
+
+    if (ranges.isEmpty()) {
+        ranges.append(qMakePair(begin, end));
+    }
+    return ranges;
+}
+
+void DataManager::parseFlowChunk(const char *begin, const char *end, const CsvProjection &columns,
+                                 DateTimeParser::DateFormat dateFormat, FlowChunk &chunk) const
+{
+    // 列号先取到局部变量，循环内与写死的下标一样只是一次数组访问
+    const int lineColumn = columns.index(FlowLineColumn);
+    const int trainColumn = columns.index(FlowTrainColumn);
+    const int stationColumn = columns.index(FlowStationColumn);
+    const int dateColumn = columns.index(FlowDateColumn);
+    const int arrivalColumn = columns.index(FlowArrivalColumn);
+    const int departureColumn = columns.index(FlowDepartureColumn);
+    const int boardingColumn = columns.index(FlowBoardingColumn);
+    const int alightingColumn = columns.index(FlowAlightingColumn);
+    const int ticketTypeColumn = columns.index(FlowTicketTypeColumn);
+    const int ticketPriceColumn = columns.index(FlowTicketPriceColumn);
+    const int startStationColumn = columns.index(FlowStartStationColumn);
+    const int endStationColumn = columns.index(FlowEndStationColumn);
+    const int revenueColumn = columns.index(FlowRevenueColumn);
+    const int requiredFields = columns.fieldCount();
+
+    CsvTokenizer tokenizer(begin, end);
+    CsvTokenizer::Fields fields;
+    qint64 reportedBytes = 0;
+
+    while (!tokenizer.atEnd()) { // 不限制记录数量
+        // 每4096行汇报一次进度并检查是否取消，原子操作的开销可以忽略
+        if ((chunk.totalRecords & 0xFFF) == 0) {
+            m_bytesRead.fetchAndAddRelaxed(tokenizer.position() - reportedBytes);
+            reportedBytes = tokenizer.position();
+            if (m_cancelRequested.loadRelaxed()) {
+                return;
+            }
+        }
+
+        // 只切分到用到的最后一列
+        const qint64 rowStart = tokenizer.position();
+        int fieldCount = tokenizer.nextRow(fields, requiredFields);
+        chunk.totalRecords++;
         
-        if (fields.size() >= 7) {
-            QString code = fields[0].trimmed();
-            QString trainCode = fields[3].trimmed();
-            int capacity = fields[6].toInt();
+        if (fieldCount >= requiredFields) { // 确保字段数量足够
+            int stationId = CsvTokenizer::toInt(fields[stationColumn]);
+            int dayNumber = DateTimeParser::parseDay(fields[dateColumn], dateFormat);  // 运行日期
             
-            if (!code.isEmpty() && !trainCode.isEmpty()) {
-                Train *train = new Train(code, trainCode, capacity, this);
-                m_trains.append(train);
-                m_trainMap[code] = train;
+            // 加载所有有效记录
+            if (stationId > 0 && dayNumber != DateTimeParser::InvalidDay) {
+                FlowStore &store = chunk.store;
+                FlowStore::Record record;
+                record.stationId = stationId;
+                record.dayNumber = dayNumber;
+                // 车次和票种的取值很少，存为字典编号
+                record.trainId = store.trainCodes().insert(fields[trainColumn]);
+                record.departureMinute = DateTimeParser::parseMinute(fields[departureColumn]);
+                record.boardingPassengers = CsvTokenizer::toInt(fields[boardingColumn]);      // 上客量
+                record.alightingPassengers = CsvTokenizer::toInt(fields[alightingColumn]);    // 下客量
+                record.ticketTypeId = store.ticketTypes().insert(fields[ticketTypeColumn]);   // 车票类型
+                record.revenue = CsvTokenizer::toDouble(fields[revenueColumn]);               // 收入
+                if (chunk.fileOffset >= 0) {
+                    // 冷列留到第一次访问时按行偏移解码
+                    if (!store.checkDictionaries(&chunk.error)) {
+                        return;
+                    }
+                    store.appendDeferred(record, chunk.fileOffset + rowStart);
+                    continue;
+                }
+                record.lineId = store.lineCodes().insert(fields[lineColumn]);
+                record.arrivalMinute = DateTimeParser::parseMinute(fields[arrivalColumn]);    // HHMM
+                record.ticketPrice = CsvTokenizer::toDouble(fields[ticketPriceColumn]);       // 车票价格
+                record.startStationId = store.stationNames().insert(fields[startStationColumn]);
+                record.endStationId = store.stationNames().insert(fields[endStationColumn]);
+                if (!store.checkDictionaries(&chunk.error)) {
+                    return;
+                }
+                store.append(record);
+            }
+        } else if (!CsvTokenizer::trimmed(tokenizer.lastLine()).isEmpty()) {
+            QByteArrayView line = tokenizer.lastLine();
+            qDebug() << "跳过无效行，字段数：" << fieldCount << "行内容："
+                     << QString::fromUtf8(line.first(qMin<qsizetype>(50, line.size()))) << "...";
+        }
+    }
+    m_bytesRead.fetchAndAddRelaxed(tokenizer.position() - reportedBytes);
+}
+
+void DataManager::validateFlowChunk(const char *begin, const char *end, const FlowBatch &batch,
+                                    const QBitArray &knownStations, const StringDictionary &knownTrains,
+                                    FlowValidation::Chunk &chunk) const
+{
+    const int trainColumn = batch.columns.index(FlowTrainColumn);
+    const int stationColumn = batch.columns.index(FlowStationColumn);
+    const int dateColumn = batch.columns.index(FlowDateColumn);
+    const int boardingColumn = batch.columns.index(FlowBoardingColumn);
+    const int alightingColumn = batch.columns.index(FlowAlightingColumn);
+    const int ticketPriceColumn = batch.columns.index(FlowTicketPriceColumn);
+    const int revenueColumn = batch.columns.index(FlowRevenueColumn);
+    const int requiredFields = batch.columns.fieldCount();
+
+    CsvTokenizer tokenizer(begin, end);
+    CsvTokenizer::Fields fields;
+    while (!tokenizer.atEnd()) {
+        const qint64 offset = batch.offsetOf(begin + tokenizer.position());
+        const int fieldCount = tokenizer.nextRow(fields, requiredFields);
+        if (fieldCount < requiredFields) {
+            // 空行加载时也直接跳过，不算违规
+            if (!CsvTokenizer::trimmed(tokenizer.lastLine()).isEmpty()) {
+                chunk.rows++;
+                chunk.reject(offset, 1u << FlowValidation::MalformedRow);
+            }
+            continue;
+        }
+        chunk.rows++;
+
+        quint8 violations = 0;
+        const int stationId = CsvTokenizer::toInt(fields[stationColumn]);
+        const bool knownStation = stationId >= 0 && stationId < knownStations.size()
+                                ? knownStations.testBit(stationId) : getStationIndex(stationId) >= 0;
+        if (!knownStation) {
+            violations |= 1u << FlowValidation::UnknownStation;
+        }
+        if (knownTrains.find(fields[trainColumn]) < 0) {
+            violations |= 1u << FlowValidation::UnknownTrain;
+        }
+        // 加载时无法识别的日期按2015-01-01处理，这里单独标出
+        if (DateTimeParser::parseDayStrict(fields[dateColumn], batch.dateFormat) == DateTimeParser::InvalidDay) {
+            violations |= 1u << FlowValidation::InvalidDate;
+        }
+        const int boarding = CsvTokenizer::toInt(fields[boardingColumn]);
+        const int alighting = CsvTokenizer::toInt(fields[alightingColumn]);
+        if (boarding < 0 || alighting < 0) {
+            violations |= 1u << FlowValidation::NegativeCount;
+        }
+        // 收入不会超过全部上下客按票价计的金额，留一分钱的舍入余量
+        const double price = CsvTokenizer::toDouble(fields[ticketPriceColumn]);
+        const double revenue = CsvTokenizer::toDouble(fields[revenueColumn]);
+        if (price < 0 || revenue < 0 || revenue > price * qMax(0, boarding + alighting) + 0.01) {
+            violations |= 1u << FlowValidation::RevenueMismatch;
+        }
+
+        if (violations) {
+            chunk.reject(offset, violations);
+        }
+    }
+}
+
+bool DataManager::mergeFlowChunks(const QVector<FlowChunk> &chunks, FlowStore &store, QString *error) const
+{
+    // 按块的顺序合并，字典在全局按首次出现的顺序编号，结果与单线程逐行加载完全一致
+    int total = store.size();
+    for (const FlowChunk &chunk : chunks) {
+        total += chunk.store.size();
+    }
+    store.reserve(total);
+
+    for (const FlowChunk &chunk : chunks) {
+        if (!store.append(chunk.store, error)) {
+            return false;
+        }
+    }
+
+    // 只记录几条做示例
+    for (int i = 0; i < std::min(5, store.size()); ++i) {
+        FlowRow flow = store.row(i);
+        qDebug() << "示例数据:" << flow.getStationId()
+                 << "日期:" << flow.getDate().toString("yyyy-MM-dd")
+                 << "上/下客:" << flow.getBoardingPassengers() << "/" << flow.getAlightingPassengers()
+                 << "收入:" << flow.getRevenue();
+    }
+    return true;
+}
+
+static QVector<FlowSnapshot::SourceFile> snapshotSources(const QStringList &sourceFiles)
+{
+    QVector<FlowSnapshot::SourceFile> sources;
+    for (const QString &file : sourceFiles) {
+        sources.append(FlowSnapshot::fingerprint(file));
+    }
+    return sources;
+}
+
+bool DataManager::readFlowBatches(const QString &filename, bool splitChunks, const FlowBatchVisitor &visit,
+                                  QString *error) const
+{
+    // 压缩文件由读取器的后台线程解压，这里处理上一批的同时解压线程已在准备下一批
+    CompressedReader input(filename);
+    if (!input.open(error)) {
+        return false;
+    }
+
+    // 分区已经按文件并行处理，单个分区只用一个线程
+    const int threads = splitChunks && m_parallelLoading ? QThread::idealThreadCount() : 1;
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    FlowBatch batch;
+    bool headerPending = true;
+    QByteArray carry;   // 上一批末尾不完整的行
+    qint64 offset = 0;  // 本批缓冲区开头在（解压后）文件中的偏移
+    while (true) {
+        QByteArray buffer = carry + input.read(kStreamChunkBytes * threads);
+        const bool last = input.atEnd();
+        if (!input.errorString().isEmpty()) {
+            *error = input.errorString();
+            return false;
+        }
+        // 只处理到最后一个换行符，剩下的半行并入下一批
+        const qsizetype usable = last ? buffer.size() : buffer.lastIndexOf('\n') + 1;
+        carry = buffer.mid(usable);
+
+        const char *begin = buffer.constData();
+        const char *end = begin + usable;
+        batch.base = begin;
+        batch.baseOffset = offset;
+        offset += usable;
+        if (headerPending && begin < end) {
+            // 表头和日期格式从第一批的开头探测一次
+            const FlowFileLayout layout = probeFlowLayout(buffer.left(64 * 1024));
+            batch.columns = layout.columns;
+            batch.dateFormat = layout.dateFormat;
+            CsvTokenizer header(begin, end);
+            header.skipLine();
+            begin += header.position();
+            m_bytesRead.fetchAndAddRelaxed(header.position());
+            headerPending = false;
+            qDebug() << "流式读取客流文件:" << QFileInfo(filename).fileName()
+                     << "日期格式:" << DateTimeParser::formatName(batch.dateFormat);
+        }
+
+        batch.ranges.clear();
+        for (const char *chunkBegin = begin; chunkBegin < end;) {
+            const char *chunkEnd = end;
+            if (end - chunkBegin > kStreamChunkBytes) {
+                const char *target = chunkBegin + kStreamChunkBytes;
+                const char *eol = static_cast<const char*>(std::memchr(target, '\n', end - target));
+                chunkEnd = eol ? eol + 1 : end;
+            }
+            batch.ranges.append(qMakePair(chunkBegin, chunkEnd));
+            chunkBegin = chunkEnd;
+        }
+
+        if (!batch.ranges.isEmpty() && !visit(pool, batch, error)) {
+            return false;
+        }
+        if (last) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool DataManager::streamPassengerFlow(const QString &filename, const FlowSink &sink, QString *error,
+                                      bool splitChunks) const
+{
+    return readFlowBatches(filename, splitChunks, [this, &sink](QThreadPool &pool, const FlowBatch &batch,
+                                                                QString *error) {
+        QVector<FlowChunk> chunks(batch.ranges.size());
+        for (int i = 0; i < batch.ranges.size(); ++i) {
+            pool.start([this, &batch, &chunks, i]() {
+                parseFlowChunk(batch.ranges[i].first, batch.ranges[i].second, batch.columns, batch.dateFormat,
+                               chunks[i]);
+            });
+        }
+        pool.waitForDone();
+
+        if (m_cancelRequested.loadRelaxed()) {
+            *error = "客流数据加载已取消";
+            return false;
+        }
+        for (FlowChunk &chunk : chunks) {
+            if (!chunk.error.isEmpty()) {
+                *error = chunk.error;
+                return false;
+            }
+            if (!sink(chunk.store, error)) {
+                return false;
+            }
+        }
+        return true;
+    }, error);
+}
+
+bool DataManager::writeFlowBlocks(const QStringList &files, LoadResult &result) const
+{
+    QElapsedTimer timer;
+    timer.start();
+    result.blockFile = FlowBlockFile::defaultPath(m_dataDirectory);
+    result.blockSources = snapshotSources(files);
+
+    // 源文件未变时沿用上次生成的块文件
+    {
+        FlowBlockFile existing;
+        QString reason;
+        if (existing.open(result.blockFile, result.blockSources, &reason)) {
+            for (const QString &file : files) {
+                m_bytesRead.fetchAndAddRelaxed(CompressedReader::expectedSize(file));
+            }
+            qDebug() << "沿用已有的块文件:" << result.blockFile;
+            return true;
+        }
+        qDebug() << "生成块文件:" << reason;
+    }
+
+    // 未调用finish的写入不会提交，失败或取消时不留下不完整的块文件
+    FlowBlockFile::Writer writer;
+    if (!writer.open(result.blockFile, result.blockSources, &result.flowsError)) {
+        return false;
+    }
+    // 所有文件共用一个指纹集合，文件之间重叠的行也只写入一次
+    FlowDeduplicator deduplicator;
+    const FlowSink sink = [&writer, &deduplicator](FlowStore &flows, QString *error) {
+        deduplicator.filter(flows);
+        return writer.append(flows, error);
+    };
+    for (const QString &file : files) {
+        bool ok = true;
+        if (FlowColumnFile::isColumnFile(file)) {
+            // 列式文件逐个行组读入，同样不必整体放进内存
+            FlowColumnFile columnFile;
+            ok = columnFile.open(file, &result.flowsError);
+            for (int i = 0; ok && i < columnFile.rowGroupCount(); ++i) {
+                FlowStore flows;
+                ok = columnFile.readRowGroup(i, flows, &result.flowsError) && sink(flows, &result.flowsError);
+            }
+            m_bytesRead.fetchAndAddRelaxed(QFileInfo(file).size());
+        } else {
+            ok = streamPassengerFlow(file, sink, &result.flowsError);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    if (!writer.finish(&result.flowsError)) {
+        return false;
+    }
+    result.duplicateRows = deduplicator.duplicates();
+    qDebug() << "客流转换为块文件，丢弃重复" << result.duplicateRows << "条，用时" << timer.elapsed() << "ms:"
+             << result.blockFile;
+    return true;
+}
+
+void DataManager::setParallelLoadingEnabled(bool enabled)
+{
+    m_parallelLoading = enabled;
+}
+
+void DataManager::setSnapshotCacheEnabled(bool enabled)
+{
+    m_snapshotCache = enabled;
+}
+
+void DataManager::setLazyColumnsEnabled(bool enabled)
+{
+    m_lazyColumns = enabled;
+}
+
+void DataManager::setOutOfCoreEnabled(bool enabled)
+{
+    m_outOfCore = enabled;
+}
+
+void DataManager::setBlockCacheBudget(qint64 bytes)
+{
+    m_blockPool.setBudget(bytes);
+}
+
+void DataManager::setPartitionMemoryBudget(qint64 bytes)
+{
+    m_partitionBudget = bytes;
+    evictPartitions();
+}
+
+bool DataManager::isDataLoaded() const
+{
+    // 分区模式下日期窗口内可能恰好没有数据，数据库模式下客流不在内存中，都视为已加载
+    return !m_stations.isEmpty() && !m_trains.isEmpty()
+        && (!m_flowStore.isEmpty() || m_partitioned || m_databaseBacked || m_blockPool.isOpen());
+}
+
+bool DataManager::checkSourceFiles(const QString &path, QStringList &sourceFiles)
+{
+    QDir dir(path);
+    if (!dir.exists()) {
+        QString error = QString("指定的目录不存在: %1").arg(path);
+        qDebug() << error;
+        emit dataLoadError(error);
+        return false;
+    }
+
+    qDebug() << "开始从目录加载数据:" << path;
+    qDebug() << "当前目录下文件:";
+    QStringList files = dir.entryList(QDir::Files);
+    for (const QString &file : files) {
+        qDebug() << " - " << file;
+    }
+
+    // 显示完整路径
+    QString stationsFile = dir.filePath("客运站点.csv");
+    QString trainsFile = dir.filePath("列车表.csv");
+    QString passengersFile = flowFilePath(dir);
+    
+    // 检查文件是否存在
+    bool stationsExist = QFile::exists(stationsFile);
+    bool trainsExist = QFile::exists(trainsFile);
+    bool passengersExist = QFile::exists(passengersFile);
+
+    // 没有单个客流文件时按分区数据集加载
+    QStringList partitionFiles;
+    if (!passengersExist) {
+        partitionFiles = FlowPartitions::discover(path);
+        if (!partitionFiles.isEmpty()) {
+            passengersFile = QString("%1 个分区文件").arg(partitionFiles.size());
+            passengersExist = true;
+        }
+    }
+    
+    qDebug() << "文件检查结果:";
+    qDebug() << " - 站点文件:" << stationsFile << (stationsExist ? "存在" : "不存在");
+    qDebug() << " - 列车文件:" << trainsFile << (trainsExist ? "存在" : "不存在");
+    qDebug() << " - 客流文件:" << passengersFile << (passengersExist ? "存在" : "不存在");
+    
+    if (!stationsExist || !trainsExist || !passengersExist) {
+        QString missingFiles;
+        if (!stationsExist) missingFiles += "客运站点.csv ";
+        if (!trainsExist) missingFiles += "列车表.csv ";
+        if (!passengersExist) missingFiles += "高铁客运量（成都--重庆）.csv[.gz|.zst]（或 .fcol 列式文件，或 高铁客运量*.csv 分区文件） ";
+        QString error = QString("以下数据文件不存在: %1\n请检查文件路径: %2").arg(missingFiles).arg(path);
+        qDebug() << error;
+        emit dataLoadError(error);
+        return false;
+    }
+
+    m_dataDirectory = dir.absolutePath();
+    m_blockMode = m_outOfCore;
+    // 追加读取按字节偏移接续，只适用于未压缩的单个客流CSV文件
+    const bool tailable = partitionFiles.isEmpty() && !m_blockMode
+                       && CompressedReader::codecFor(passengersFile) == CompressedReader::Plain
+                       && !FlowColumnFile::isColumnFile(passengersFile);
+    m_flowFile = tailable ? passengersFile : QString();
+    m_flowSources = partitionFiles.isEmpty() ? QStringList{ passengersFile } : partitionFiles;
+    if (m_blockMode) {
+        // 核外模式把全部客流文件依次转换进同一个块文件，不建分区目录
+        sourceFiles = QStringList{ stationsFile, trainsFile };
+        sourceFiles += partitionFiles.isEmpty() ? QStringList{ passengersFile } : partitionFiles;
+    } else if (!partitionFiles.isEmpty()) {
+        buildPartitionCatalog(partitionFiles);
+        sourceFiles = QStringList{ stationsFile, trainsFile };
+    } else {
+        sourceFiles = QStringList{ stationsFile, trainsFile, passengersFile };
+    }
+    return true;
+}
+
+void DataManager::loadSources(const QStringList &sourceFiles, LoadResult &result, const StageCallback &onStage) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (result.partitionsOnly) {
+        loadPartitions(result.partitions, &result.flowsError);
+        result.cancelled = m_cancelRequested.loadRelaxed();
+        qDebug() << "补充加载" << result.partitions.size() << "个分区，用时" << timer.elapsed() << "ms";
+        return;
+    }
+
+    // 线路拓扑是可选的，文件不存在时不报错；它很小，不放进快照
+    const QString routesFile = routesFilePath(sourceFiles[0]);
+    const bool hasRoutes = QFile::exists(routesFile);
+
+    // 源文件未变化时直接读快照，跳过CSV解析；分区模式下每次只加载部分分区，不适合整体快照，
+    // 核外模式的块文件自带源文件指纹，列式文件本身读得和快照一样快，都不需要快照
+    const bool useSnapshot = m_snapshotCache && !m_partitioned && !m_blockMode
+                          && !FlowColumnFile::isColumnFile(sourceFiles.value(2));
+    const QString snapshotPath = FlowSnapshot::defaultPath(QFileInfo(sourceFiles[0]).absolutePath());
+    const QVector<FlowSnapshot::SourceFile> sources = useSnapshot ? snapshotSources(sourceFiles)
+                                                                  : QVector<FlowSnapshot::SourceFile>();
+    if (useSnapshot) {
+        QString error;
+        if (FlowSnapshot::read(snapshotPath, sources, result.stations, result.trains, result.flows, &error)) {
+            // 快照中的行已经按日期排好，这里只重建按天的偏移表
+            result.flows.sortByDay();
+            if (result.flows.hasPendingColdColumns()) {
+                // 快照只存了冷列的行偏移，来源就是快照对应的客流文件
+                QFile flowFile(sourceFiles[2]);
+                if (flowFile.open(QIODevice::ReadOnly)) {
+                    const FlowFileLayout layout = probeFlowLayout(flowFile.read(64 * 1024));
+                    result.flows.deferColdColumns(coldSourceFor(sourceFiles[2], layout.columns, layout.dateFormat));
+                }
+            }
+            if (hasRoutes) {
+                readRouteGraph(routesFile, result.routeGraph, &result.routesError);
+            }
+            result.flowBytes = sources[2].size;
+            m_bytesRead.storeRelaxed(m_bytesTotal.loadRelaxed());
+            qDebug() << "从快照加载数据完成，用时" << timer.elapsed() << "ms:" << snapshotPath;
+            return;
+        }
+        qDebug() << "未使用快照，改为加载CSV:" << error;
+    }
+
+    // 站点和列车文件较小，放进线程池与客流文件同时读取；两者都读完后先交给调用方
+    QThreadPool pool;
+    QAtomicInt pending(2);
+    auto stageDone = [&result, &pending, &onStage]() {
+        if (!pending.deref() && onStage && result.stationsError.isEmpty() && result.trainsError.isEmpty()) {
+            onStage(result.stations, result.trains);
+            result.stagePublished = true;
+        }
+    };
+    pool.start([this, &sourceFiles, &result, &stageDone]() {
+        readStations(sourceFiles[0], result.stations, &result.stationsError);
+        stageDone();
+    });
+    pool.start([this, &sourceFiles, &result, &stageDone]() {
+        readTrains(sourceFiles[1], result.trains, &result.trainsError);
+        stageDone();
+    });
+    if (hasRoutes) {
+        pool.start([this, &routesFile, &result]() {
+            readRouteGraph(routesFile, result.routeGraph, &result.routesError);
+        });
+    }
+    if (m_partitioned) {
+        loadPartitions(result.partitions, &result.flowsError);
+    } else if (m_blockMode) {
+        writeFlowBlocks(sourceFiles.mid(2), result);
+    } else {
+        readPassengerFlow(sourceFiles[2], result.flows, &result.flowsError, true, &result.flowBytes,
+                          &result.duplicateRows);
+        // 客流按日期聚集存放，日期范围查询直接取连续的一段；随后写出的快照也是排好序的
+        result.flows.sortByDay();
+    }
+    pool.waitForDone();
+
+    result.cancelled = m_cancelRequested.loadRelaxed();
+    const bool success = result.stationsError.isEmpty() && result.trainsError.isEmpty() && result.flowsError.isEmpty();
+    qDebug() << "CSV解析完成，用时" << timer.elapsed() << "ms";
+
+    if (success && !result.cancelled && useSnapshot) {
+        QElapsedTimer snapshotTimer;
+        snapshotTimer.start();
+        QString error;
+        if (FlowSnapshot::write(snapshotPath, sources, result.stations, result.trains, result.flows, &error)) {
+            qDebug() << "已写入数据快照，用时" << snapshotTimer.elapsed() << "ms:" << snapshotPath;
+        } else {
+            // 快照只是加速手段，写不成功不影响本次加载
+            qDebug() << error;
+        }
+    }
+}
+
+bool DataManager::finishLoad(LoadResult &result)
+{
+    m_loading = false;
+    m_progressTimer->stop();
+
+    if (result.cancelled) {
+        // 补充分区时取消，保留已有的数据和窗口
+        if (!result.partitionsOnly) {
+            clearData();
+        }
+        qDebug() << "数据加载已取消";
+        emit loadingCancelled();
+        return false;
+    }
+
+    if (result.partitionsOnly) {
+        adoptPartitions(result.partitions);
+        rebuildFlowWindow();
+        emit progress(m_bytesTotal.loadRelaxed(), m_bytesTotal.loadRelaxed());
+        if (!result.flowsError.isEmpty()) {
+            qDebug() << result.flowsError;
+            emit dataLoadError(result.flowsError);
+        }
+        emit partitionsLoaded();
+        return result.flowsError.isEmpty();
+    }
+
+    // 分步接管并单独报告每个文件的错误
+    if (!result.stagePublished) {
+        if (result.stationsError.isEmpty()) {
+            adoptStations(result.stations);
+        }
+        if (result.trainsError.isEmpty()) {
+            adoptTrains(result.trains);
+        }
+        if (result.stationsError.isEmpty() && result.trainsError.isEmpty()) {
+            emit stationsAndTrainsLoaded();
+        }
+    }
+    if (m_partitioned) {
+        // 解析成功的分区照常接管，失败的分区单独报告
+        adoptPartitions(result.partitions);
+        rebuildFlowWindow();
+    } else if (m_blockMode) {
+        if (result.flowsError.isEmpty()
+            && m_blockPool.open(result.blockFile, result.blockSources, &result.flowsError)) {
+            m_duplicateRows = result.duplicateRows;
+            if (!refreshAggregates(&result.flowsError)) {
+                // 汇总不完整时不接管块文件，和客流文件解析失败一样报告
+                m_blockPool.close();
+            }
+        }
+    } else if (result.flowsError.isEmpty()) {
+        m_flowStore = std::move(result.flows);
+        m_duplicateRows = result.duplicateRows;
+        m_tailOffset = result.flowBytes;
+        m_tailLayoutValid = false;
+        refreshAggregates();
+        watchColdColumns();
+    }
+
+    if (result.routesError.isEmpty()) {
+        m_routeGraph = std::move(result.routeGraph);
+    }
+
+    const QStringList errors = QStringList{ result.stationsError, result.trainsError, result.flowsError,
+                                            result.routesError };
+    bool success = true;
+    for (const QString &error : errors) {
+        if (!error.isEmpty()) {
+            qDebug() << error;
+            emit dataLoadError(error);
+            success = false;
+        }
+    }
+
+    emit progress(m_bytesTotal.loadRelaxed(), m_bytesTotal.loadRelaxed());
+    if (success) {
+        qDebug() << "所有数据加载完成，共" << m_stations.size() << "个站点，"
+                 << m_trains.size() << "趟列车，"
+                 << m_flowStore.size() << "条客流记录";
+        if (m_duplicateRows > 0) {
+            qDebug() << "丢弃重复的客流记录" << m_duplicateRows << "条";
+        }
+        if (m_partitioned) {
+            qDebug() << "分区数据集：共" << m_partitions.size() << "个分区，已加载"
+                     << m_residentPartitions.size() << "个";
+        }
+        if (m_blockPool.isOpen()) {
+            qDebug() << "核外模式：" << m_blockPool.file().rowCount() << "条客流记录分为"
+                     << m_blockPool.file().blockCount() << "块，缓冲池预算"
+                     << m_blockPool.budget() / (1024 * 1024) << "MB";
+        }
+        emit dataLoaded();
+
+        // 加载期间文件可能又追加了内容，接上之后立即补读一次
+        if (m_tailMode && !m_partitioned) {
+            armTailWatcher();
+            appendNewFlows();
+        }
+    } else {
+        qDebug() << "数据加载失败";
+    }
+
+    return success;
+}
+
+bool DataManager::loadDataFromDirectory(const QString &path)
+{
+    if (m_loading) {
+        emit dataLoadError("正在后台加载数据，请稍候");
+        return false;
+    }
+    clearData();
+
+    QStringList sourceFiles;
+    if (!checkSourceFiles(path, sourceFiles)) {
+        return false;
+    }
+
+    LoadResult result;
+    result.partitions = pendingPartitions();
+    resetProgress(sourceFiles, result.partitions);
+
+    loadSources(sourceFiles, result, StageCallback());
+    return finishLoad(result);
+}
+
+void DataManager::loadDataFromDirectoryAsync(const QString &path)
+{
+    if (m_loading) {
+        return;
+    }
+    clearData();
+
+    QStringList sourceFiles;
+    if (!checkSourceFiles(path, sourceFiles)) {
+        return;
+    }
+
+    QSharedPointer<LoadResult> result(new LoadResult);
+    result->partitions = pendingPartitions();
+    startLoadThread(sourceFiles, result);
+}
+
+void DataManager::resetProgress(const QStringList &sourceFiles, const QVector<PartitionLoad> &partitions)
+{
+    m_cancelRequested.storeRelaxed(0);
+    m_bytesRead.storeRelaxed(0);
+    m_bytesTotal.storeRelaxed(0);
+    // 进度按解析的字节数计算，压缩文件按解压后的大小计入
+    for (const QString &file : sourceFiles) {
+        m_bytesTotal.fetchAndAddRelaxed(CompressedReader::expectedSize(file));
+    }
+    if (!sourceFiles.isEmpty()) {
+        m_bytesTotal.fetchAndAddRelaxed(QFileInfo(routesFilePath(sourceFiles[0])).size());
+    }
+    for (const PartitionLoad &load : partitions) {
+        m_bytesTotal.fetchAndAddRelaxed(CompressedReader::expectedSize(load.partition.path));
+    }
+}
+
+void DataManager::startLoadThread(const QStringList &sourceFiles, QSharedPointer<LoadResult> result)
+{
+    m_loading = true;
+    resetProgress(sourceFiles, result->partitions);
+    emit progress(0, m_bytesTotal.loadRelaxed());
+
+    // 工作线程只生成普通数据；Station/Train对象和列存储的接管都投递回本对象所在线程完成
+    QThread *thread = QThread::create([this, sourceFiles, result]() {
+        loadSources(sourceFiles, *result, [this](const QVector<StationRecord> &stations,
+                                                 const QVector<TrainRecord> &trains) {
+            QMetaObject::invokeMethod(this, [this, stations, trains]() {
+                adoptStations(stations);
+                adoptTrains(trains);
+                qDebug() << "站点和列车已可用，客流数据仍在加载";
+                emit stationsAndTrainsLoaded();
+            }, Qt::QueuedConnection);
+        });
+        QMetaObject::invokeMethod(this, [this, result]() {
+            finishLoad(*result);
+        }, Qt::QueuedConnection);
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    m_loadThread = thread;
+    m_progressTimer->start();
+    thread->start();
+}
+
+void DataManager::cancelLoading()
+{
+    if (m_loading) {
+        m_cancelRequested.storeRelaxed(1);
+    }
+}
+
+bool DataManager::setDateWindow(const QDate &startDate, const QDate &endDate)
+{
+    m_windowStartDay = startDate.isValid() ? static_cast<int>(startDate.toJulianDay()) : INT_MIN;
+    m_windowEndDay = endDate.isValid() ? static_cast<int>(endDate.toJulianDay()) : INT_MAX;
+
+    // 尚未加载或正在加载时只记下窗口，加载时按它选择分区
+    if (!m_partitioned || m_loading || m_stations.isEmpty()) {
+        return false;
+    }
+
+    QSharedPointer<LoadResult> result(new LoadResult);
+    result->partitions = pendingPartitions();
+    if (result->partitions.isEmpty()) {
+        rebuildFlowWindow();
+        return false;
+    }
+
+    qDebug() << "日期窗口需要加载" << result->partitions.size() << "个新分区";
+    result->partitionsOnly = true;
+    startLoadThread(QStringList(), result);
+    return true;
+}
+
+void DataManager::buildPartitionCatalog(const QStringList &files)
+{
+    m_partitioned = true;
+    m_partitions.clear();
+
+    // 文件大小和修改时间与索引一致时使用索引中的精确范围，否则探测首尾行
+    const QVector<FlowPartition> indexed = FlowPartitions::readIndex(FlowPartitions::indexPath(m_dataDirectory));
+    int probed = 0;
+    for (const QString &file : files) {
+        QFileInfo info(file);
+        FlowPartition partition;
+        bool found = false;
+        for (const FlowPartition &entry : indexed) {
+            if (entry.path == info.absoluteFilePath() && entry.size == info.size()
+                && entry.modified == info.lastModified().toMSecsSinceEpoch()) {
+                partition = entry;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            partition = probePartition(file);
+            probed++;
+        }
+        m_partitions.append(partition);
+        qDebug() << " - 分区:" << info.fileName()
+                 << QDate::fromJulianDay(partition.firstDay).toString("yyyy-MM-dd")
+                 << "至" << QDate::fromJulianDay(partition.lastDay).toString("yyyy-MM-dd")
+                 << (partition.exact ? "(索引)" : "(探测)");
+    }
+    qDebug() << "发现" << m_partitions.size() << "个客流分区，其中" << probed << "个需要探测日期范围";
+}
+
+QVector<DataManager::PartitionLoad> DataManager::pendingPartitions() const
+{
+    QVector<PartitionLoad> loads;
+    for (const FlowPartition &partition : m_partitions) {
+        if (partition.overlaps(m_windowStartDay, m_windowEndDay)
+            && !m_residentPartitions.contains(partition.path)) {
+            PartitionLoad load;
+            load.partition = partition;
+            loads.append(load);
+        }
+    }
+    return loads;
+}
+
+void DataManager::loadPartitions(QVector<PartitionLoad> &partitions, QString *error) const
+{
+    // 每个分区一个任务，分区内部不再切块
+    QThreadPool pool;
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+    for (int i = 0; i < partitions.size(); ++i) {
+        pool.start([this, &partitions, i]() {
+            PartitionLoad &load = partitions[i];
+            if (!readPassengerFlow(load.partition.path, load.store, &load.error, false, nullptr,
+                                   &load.duplicateRows)) {
+                return;
+            }
+            // 各分区在工作线程中排好序，日期不重叠的分区合并成窗口后仍然有序
+            load.store.sortByDay();
+
+            // 解析过整个文件，记下精确的日期范围供下次剪枝；空分区不与任何窗口相交
+            const QVector<qint32> &days = load.store.dayNumbers();
+            load.partition.firstDay = INT_MAX;
+            load.partition.lastDay = INT_MIN;
+            for (qint32 day : days) {
+                load.partition.firstDay = qMin(load.partition.firstDay, day);
+                load.partition.lastDay = qMax(load.partition.lastDay, day);
+            }
+            load.partition.exact = true;
+        });
+    }
+    pool.waitForDone();
+
+    QStringList errors;
+    for (const PartitionLoad &load : partitions) {
+        if (!load.error.isEmpty()) {
+            errors.append(load.error);
+        }
+    }
+    *error = errors.join("\n");
+}
+
+void DataManager::adoptPartitions(QVector<PartitionLoad> &partitions)
+{
+    bool rangesChanged = false;
+    for (PartitionLoad &load : partitions) {
+        if (!load.error.isEmpty()) {
+            continue;
+        }
+        for (FlowPartition &partition : m_partitions) {
+            if (partition.path == load.partition.path) {
+                rangesChanged = rangesChanged || !partition.exact;
+                partition = load.partition;
+                break;
+            }
+        }
+        ResidentPartition &resident = m_residentPartitions[load.partition.path];
+        resident.store = std::move(load.store);
+        resident.duplicateRows = load.duplicateRows;
+    }
+
+    if (rangesChanged) {
+        QString error;
+        if (!FlowPartitions::writeIndex(FlowPartitions::indexPath(m_dataDirectory), m_partitions, &error)) {
+            // 索引只是加速手段，写不成功不影响本次加载
+            qDebug() << error;
+        }
+    }
+}
+
+void DataManager::rebuildFlowWindow()
+{
+    // 按分区顺序合并窗口内已加载的分区，结果与分区集合一一对应
+    QStringList windowPartitions;
+    QVector<QPair<int, int>> windowDays;
+    int rows = 0;
+    for (const FlowPartition &partition : m_partitions) {
+        auto it = m_residentPartitions.find(partition.path);
+        if (it != m_residentPartitions.end() && partition.overlaps(m_windowStartDay, m_windowEndDay)) {
+            it->lastUsed = ++m_partitionClock;
+            windowPartitions.append(partition.path);
+            windowDays.append(qMakePair(partition.firstDay, partition.lastDay));
+            rows += it->store.size();
+        }
+    }
+
+    if (windowPartitions != m_windowPartitions || m_windowRows != rows) {
+        m_passengerFlows.clear();
+        m_flowArena.clear();
+
+        FlowStore window;
+        window.reserve(rows);
+        qint64 duplicateRows = 0;
+        for (const QString &path : windowPartitions) {
+            const ResidentPartition &resident = *m_residentPartitions.constFind(path);
+            QString error;
+            if (!window.append(resident.store, &error)) {
+                // 各分区的字典合起来超出编号范围，窗口只包含之前的分区
+                qDebug() << error;
+                emit dataLoadError(error);
+                break;
+            }
+            duplicateRows += resident.duplicateRows;
+        }
+
+        // 分区内部的重复在解析时已经去掉；日期是键的一部分，只有日期范围重叠的分区之间才可能重复
+        std::sort(windowDays.begin(), windowDays.end());
+        bool overlapping = false;
+        for (int i = 1; i < windowDays.size() && !overlapping; ++i) {
+            overlapping = windowDays[i].first <= windowDays[i - 1].second;
+        }
+        if (overlapping) {
+            FlowDeduplicator deduplicator;
+            duplicateRows += deduplicator.filter(window);
+        }
+        window.sortByDay();
+
+        m_flowStore = std::move(window);
+        m_windowPartitions = windowPartitions;
+        m_windowRows = rows;
+        m_duplicateRows = duplicateRows;
+        refreshAggregates();
+        qDebug() << "日期窗口包含" << windowPartitions.size() << "个分区，" << m_flowStore.size()
+                 << "条客流记录，丢弃重复" << duplicateRows << "条";
+    }
+
+    evictPartitions();
+}
+
+void DataManager::evictPartitions()
+{
+    qint64 usage = 0;
+    for (const ResidentPartition &resident : m_residentPartitions) {
+        usage += resident.store.memoryUsage();
+    }
+
+    // 当前窗口用到的分区不淘汰，其余按最久未用的顺序淘汰直到不超预算
+    while (usage > m_partitionBudget) {
+        auto victim = m_residentPartitions.end();
+        for (auto it = m_residentPartitions.begin(); it != m_residentPartitions.end(); ++it) {
+            if (!m_windowPartitions.contains(it.key())
+                && (victim == m_residentPartitions.end() || it->lastUsed < victim->lastUsed)) {
+                victim = it;
+            }
+        }
+        if (victim == m_residentPartitions.end()) {
+            break;
+        }
+        qDebug() << "淘汰分区:" << QFileInfo(victim.key()).fileName();
+        usage -= victim->store.memoryUsage();
+        m_residentPartitions.erase(victim);
+    }
+}
+
+bool DataManager::refreshAggregates(QString *error)
+{
+    // 核外模式同样算作一次数据变化，否则按代号缓存的结果不会失效
+    ++m_generation;
+    m_aggregates.clear();
+    m_flowCube.clear();
+    if (m_blockPool.isOpen()) {
+        // 各块共用一套字典编号，逐块累加即可；缺了某块的合计偏小，不能留下
+        const bool ok = scanFlows([this](const FlowView &flows) {
+            m_aggregates.add(*flows.store());
+            m_flowCube.add(*flows.store());
+        }, error);
+        if (!ok) {
+            m_aggregates.clear();
+            m_flowCube.clear();
+        }
+        return ok;
+    }
+    m_aggregates.add(m_flowStore);
+    m_flowCube.add(m_flowStore);
+    m_flowIndex.build(m_flowStore);
+    m_flowIndexGeneration = m_generation;
+    return true;
+}
+
+const FlowIndex &DataManager::flowIndex() const
+{
+    if (m_flowIndexGeneration != m_generation || m_flowIndex.rowCount() != m_flowStore.size()) {
+        m_flowIndex.build(m_flowStore);
+        m_flowIndexGeneration = m_generation;
+    }
+    return m_flowIndex;
+}
+
+const FlowBitmapIndex &DataManager::flowBitmaps() const
+{
+    if (m_flowBitmapsGeneration != m_generation || m_flowBitmaps.rowCount() != m_flowStore.size()) {
+        m_flowBitmaps.build(m_flowStore);
+        m_flowBitmapsGeneration = m_generation;
+    }
+    return m_flowBitmaps;
+}
+
+void DataManager::setTailModeEnabled(bool enabled)
+{
+    if (m_tailMode == enabled) {
+        return;
+    }
+    m_tailMode = enabled;
+
+    if (!enabled) {
+        if (m_tailWatcher && !m_tailWatcher->files().isEmpty()) {
+            m_tailWatcher->removePaths(m_tailWatcher->files());
+        }
+        return;
+    }
+
+    if (!m_tailWatcher) {
+        m_tailWatcher = new QFileSystemWatcher(this);
+        connect(m_tailWatcher, &QFileSystemWatcher::fileChanged, this, [this]() {
+            appendNewFlows();
+        });
+    }
+    // 已经加载了数据时立即开始监视并补读开启前追加的内容
+    if (isDataLoaded() && !m_partitioned) {
+        armTailWatcher();
+        appendNewFlows();
+    }
+}
+
+void DataManager::armTailWatcher()
+{
+    // 文件被原子替换（先写新文件再改名）后监视会失效，每次都检查一遍
+    if (m_tailWatcher && !m_flowFile.isEmpty() && QFile::exists(m_flowFile)
+        && !m_tailWatcher->files().contains(m_flowFile)) {
+        m_tailWatcher->addPath(m_flowFile);
+    }
+}
+
+void DataManager::appendNewFlows()
+{
+    if (!m_tailMode || m_loading || m_partitioned || m_flowFile.isEmpty() || m_stations.isEmpty()) {
+        return;
+    }
+    armTailWatcher();
+
+    QFile file(m_flowFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const qint64 fileSize = file.size();
+    if (fileSize < m_tailOffset) {
+        qDebug() << "客流文件变短，可能被截断或替换，重新加载:" << m_flowFile;
+        file.close();
+        loadDataFromDirectoryAsync(m_dataDirectory);
+        return;
+    }
+    if (fileSize == m_tailOffset) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!m_tailLayoutValid) {
+        const FlowFileLayout layout = probeFlowLayout(file.read(64 * 1024));
+        m_tailColumns = layout.columns;
+        m_tailDateFormat = layout.dateFormat;
+        m_tailLayoutValid = true;
+    }
+
+    // 只解析到最后一个换行符，写了一半的行留到下次
+    file.seek(m_tailOffset);
+    const QByteArray bytes = file.read(fileSize - m_tailOffset);
+    const qsizetype lastNewline = bytes.lastIndexOf('\n');
+    if (lastNewline < 0) {
+        return;
+    }
+
+    // 已有数据的冷列还没解码时，追加的行同样只记偏移，合并时不必先解码全部历史数据
+    FlowChunk chunk;
+    if (m_flowStore.hasPendingColdColumns()) {
+        chunk.fileOffset = m_tailOffset;
+        chunk.store.deferColdColumns(m_flowStore.coldSource());
+    }
+    m_cancelRequested.storeRelaxed(0);
+    parseFlowChunk(bytes.constData(), bytes.constData() + lastNewline + 1, m_tailColumns, m_tailDateFormat, chunk);
+    // 失败时偏移不动，文件下次变化时重新读这段字节
+    if (!chunk.error.isEmpty()) {
+        qDebug() << chunk.error;
+        emit dataLoadError(chunk.error);
+        return;
+    }
+    // 先确认能合并再去重：去重会把指纹记入集合，合并失败后这些行重读时会被误当作重复
+    QString error;
+    if (!m_flowStore.canAppend(chunk.store, &error)) {
+        qDebug() << error;
+        emit dataLoadError(error);
+        return;
+    }
+
+    // 上游重发时追加的行可能与已有数据重叠；指纹集合在第一次追加时由已加载的数据建立
+    if (m_tailDeduplicator.size() == 0) {
+        m_tailDeduplicator.insert(m_flowStore);
+    }
+    const int duplicates = m_tailDeduplicator.filter(chunk.store);
+
+    const int firstRow = m_flowStore.size();
+    if (!m_flowStore.append(chunk.store, &error)) {
+        qDebug() << error;
+        emit dataLoadError(error);
+        return;
+    }
+    m_tailOffset += lastNewline + 1;
+    m_duplicateRows += duplicates;
+    m_aggregates.add(m_flowStore, firstRow);
+    m_flowCube.add(m_flowStore, firstRow);
+    ++m_generation;
+    // 追加的行通常日期不早于已有数据，偏移表直接延伸；补录的旧日期会让偏移表失效，整体重排
+    if (!m_flowStore.isSortedByDay()) {
+        m_flowStore.sortByDay();
+    }
+
+    const int count = m_flowStore.size() - firstRow;
+    qDebug() << "追加" << count << "条客流记录（解析" << chunk.totalRecords << "行，丢弃重复" << duplicates << "条），用时"
+             << timer.elapsed() << "ms";
+    if (count > 0) {
+        emit flowsAppended(firstRow, count);
+    }
+}
+
+
+bool DataManager::saveToDatabase(const QString &path)
+{
+    if (m_loading) {
+        emit dataLoadError("正在后台加载数据，请稍候");
+        return false;
+    }
+    if (m_databaseBacked) {
+        emit dataLoadError("当前数据已经来自数据库");
+        return false;
+    }
+    if (!isDataLoaded()) {
+        emit dataLoadError("没有可保存的数据");
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<StationRecord> stations;
+    for (Station *station : m_stations) {
+        StationRecord record;
+        record.id = station->getId();
+        record.name = station->getName();
+        record.code = station->getCode();
+        record.shortName = station->getShortName();
+        record.telecode = station->getTelecode();
+        stations.append(record);
+    }
+    QVector<TrainRecord> trains;
+    for (Train *train : m_trains) {
+        TrainRecord record;
+        record.code = train->getCode();
+        record.trainCode = train->getTrainCode();
+        record.capacity = train->getCapacity();
+        trains.append(record);
+    }
+
+    FlowDatabase database("flows-import");
+    QString error;
+    bool ok = database.open(path, &error) && database.beginImport(stations, trains, &error);
+    if (ok && m_partitioned) {
+        // 已在内存中的分区直接写入，其余分区逐个解析、写入后释放，不必同时放进内存；
+        // 所有分区共用一个指纹集合，分区之间重叠的行只写入一次
+        FlowDeduplicator deduplicator;
+        for (int i = 0; ok && i < m_partitions.size(); ++i) {
+            const FlowPartition &partition = m_partitions[i];
+            auto resident = m_residentPartitions.constFind(partition.path);
+            FlowStore store;
+            if (resident != m_residentPartitions.constEnd()) {
+                store = resident->store;    // 隐式共享，没有重复行时不复制
+            } else {
+                ok = readPassengerFlow(partition.path, store, &error);
+            }
+            if (ok) {
+                deduplicator.filter(store);
+                ok = database.appendFlows(store, &error);
             }
         }
+    } else if (ok && m_blockPool.isOpen()) {
+        // 核外模式下客流不在m_flowStore中，逐块读入写入，块文件的行已经去过重
+        for (int i = 0; ok && i < m_blockPool.file().blockCount(); ++i) {
+            QSharedPointer<const FlowStore> block = m_blockPool.block(i, &error);
+            ok = block && database.appendFlows(*block, &error);
+        }
+    } else if (ok) {
+        ok = database.appendFlows(m_flowStore, &error);
     }
-    
-    file.close();
-    qDebug() << "Loaded" << m_trains.size() << "trains";
+    ok = ok && database.finishImport(&error);
+
+    if (!ok) {
+        qDebug() << error;
+        emit dataLoadError(error);
+        return false;
+    }
+    qDebug() << "数据已保存到数据库" << path << "，共" << database.flowCount() << "条客流记录，用时"
+             << timer.elapsed() << "ms";
     return true;
 }
 
-bool DataManager::loadPassengerFlow(const QString &filename)
+bool DataManager::exportFlows(const QString &path)
 {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        emit dataLoadError(QString("无法打开客流文件: %1\n错误: %2").arg(filename).arg(file.errorString()));
+    if (m_loading) {
+        emit dataLoadError("正在后台加载数据，请稍候");
+        return false;
+    }
+    if (m_databaseBacked) {
+        emit dataLoadError("数据库模式下客流不在内存中，无法导出列式文件");
+        return false;
+    }
+    if (!isDataLoaded()) {
+        emit dataLoadError("没有可导出的数据");
         return false;
     }
 
-    QTextStream in(&file);
-    in.setEncoding(QStringConverter::Utf8);
-    
-    // Skip header
-    QString header = in.readLine();
-    
-    int count = 0;
-    int totalRecords = 0;
-    
-    // 显示进度信息
-    qDebug() << "开始加载客流数据...";
-    
-    while (!in.atEnd()) { // 不限制记录数量
-        QString line = in.readLine();
-        QStringList fields = line.split(",");
-        totalRecords++;
-        
-        // 只在开始、中间和结束时显示进度
-        if (totalRecords == 1 || totalRecords == 10000 || totalRecords % 50000 == 0) {
-            qDebug() << "处理了" << totalRecords << "条记录...";
-        }
-        
-        if (fields.size() >= 39) { // 确保字段数量足够
-            QString lineCode = fields[1].trimmed();
-            QString trainCode = fields[2].trimmed();
-            int stationId = fields[3].toInt();
-            QDate date = parseDate(fields[6]);  // 第G列 (索引6) - 运行日期
-            QTime arrivalTime = parseTime(fields[11]);
-            QTime departureTime = parseTime(fields[12]);
-            int boardingPassengers = fields[17].toInt();  // 第R列 (索引17) - 上客量
-            int alightingPassengers = fields[18].toInt(); // 第S列 (索引18) - 下客量
-            QString ticketType = fields[23].trimmed();    // 第X列 (索引23) - 车票类型
-            double ticketPrice = fields[24].toDouble();   // 第Y列 (索引24) - 车票价格
-            double revenue = fields[38].toDouble();       // 第AM列 (索引38) - 收入
-            QString startStation = fields[27].trimmed();
-            QString endStation = fields[28].trimmed();
-            
-            // 加载所有有效记录
-            if (stationId > 0 && date.isValid()) {
-                PassengerFlow *flow = new PassengerFlow(lineCode, trainCode, stationId, date,
-                                                       arrivalTime, departureTime, boardingPassengers,
-                                                       alightingPassengers, ticketType, ticketPrice, revenue, this);
-                flow->setStartStation(startStation);
-                flow->setEndStation(endStation);
-                m_passengerFlows.append(flow);
-                count++;
-                
-                // 只记录几条做示例
-                if (count <= 5) {
-                    qDebug() << "示例数据:" << stationId 
-                             << "日期:" << date.toString("yyyy-MM-dd") 
-                             << "上/下客:" << boardingPassengers << "/" << alightingPassengers
-                             << "价格:" << ticketPrice;
-                }
+    QElapsedTimer timer;
+    timer.start();
+
+    // 各列直接从存储编码写出；未调用finish的写入不会提交，失败时不留下不完整的文件
+    FlowColumnFile::Writer writer;
+    QString error;
+    bool ok = writer.open(path, &error);
+    if (ok && m_partitioned) {
+        // 和保存到数据库一样逐个分区导出，分区之间重叠的行只写入一次
+        FlowDeduplicator deduplicator;
+        for (int i = 0; ok && i < m_partitions.size(); ++i) {
+            const FlowPartition &partition = m_partitions[i];
+            auto resident = m_residentPartitions.constFind(partition.path);
+            FlowStore store;
+            if (resident != m_residentPartitions.constEnd()) {
+                store = resident->store;
+            } else {
+                ok = readPassengerFlow(partition.path, store, &error);
+            }
+            if (ok) {
+                deduplicator.filter(store);
+                ok = writer.append(store, &error);
             }
-        } else if (!line.trimmed().isEmpty()) {
-            qDebug() << "跳过无效行，字段数：" << fields.size() << "行内容：" << line.left(50) << "...";
         }
+    } else if (ok && m_blockPool.isOpen()) {
+        // 核外模式逐块读入导出，块文件的行已经去过重
+        for (int i = 0; ok && i < m_blockPool.file().blockCount(); ++i) {
+            QSharedPointer<const FlowStore> block = m_blockPool.block(i, &error);
+            ok = block && writer.append(*block, &error);
+        }
+    } else if (ok) {
+        ok = writer.append(m_flowStore, &error);
     }
-    
-    file.close();
-    qDebug() << "处理了" << totalRecords << "条记录，成功加载" << count << "条客流数据";
-    return true;
-}
-
-bool DataManager::isDataLoaded() const
-{
-    return !m_stations.isEmpty() && !m_trains.isEmpty() && !m_passengerFlows.isEmpty();
-}
-
-bool DataManager::loadDataFromDirectory(const QString &path)
-{
-    clearData();
+    ok = ok && writer.finish(&error);
 
-    QDir dir(path);
-    if (!dir.exists()) {
-        QString error = QString("指定的目录不存在: %1").arg(path);
+    if (!ok) {
         qDebug() << error;
         emit dataLoadError(error);
         return false;
     }
+    qDebug() << "客流已导出为列式文件" << path << "，共" << writer.rowCount() << "条记录，用时"
+             << timer.elapsed() << "ms";
+    return true;
+}
 
-    qDebug() << "开始从目录加载数据:" << path;
-    qDebug() << "当前目录下文件:";
-    QStringList files = dir.entryList(QDir::Files);
-    for (const QString &file : files) {
-        qDebug() << " - " << file;
+bool DataManager::loadDataFromDatabase(const QString &path)
+{
+    if (m_loading) {
+        emit dataLoadError("正在后台加载数据，请稍候");
+        return false;
     }
+    clearData();
 
-    // 显示完整路径
-    QString stationsFile = dir.filePath("客运站点.csv");
-    QString trainsFile = dir.filePath("列车表.csv");
-    QString passengersFile = dir.filePath("高铁客运量（成都--重庆）.csv");
-    
-    // 检查文件是否存在
-    bool stationsExist = QFile::exists(stationsFile);
-    bool trainsExist = QFile::exists(trainsFile);
-    bool passengersExist = QFile::exists(passengersFile);
-    
-    qDebug() << "文件检查结果:";
-    qDebug() << " - 站点文件:" << stationsFile << (stationsExist ? "存在" : "不存在");
-    qDebug() << " - 列车文件:" << trainsFile << (trainsExist ? "存在" : "不存在");
-    qDebug() << " - 客流文件:" << passengersFile << (passengersExist ? "存在" : "不存在");
-    
-    if (!stationsExist || !trainsExist || !passengersExist) {
-        QString missingFiles;
-        if (!stationsExist) missingFiles += "客运站点.csv ";
-        if (!trainsExist) missingFiles += "列车表.csv ";
-        if (!passengersExist) missingFiles += "高铁客运量（成都--重庆）.csv ";
-        QString error = QString("以下数据文件不存在: %1\n请检查文件路径: %2").arg(missingFiles).arg(path);
+    QVector<StationRecord> stations;
+    QVector<TrainRecord> trains;
+    QString error;
+    if (!m_database.open(path, &error) || !m_database.readStations(stations, &error)
+        || !m_database.readTrains(trains, &error)) {
+        m_database.close();
         qDebug() << error;
         emit dataLoadError(error);
         return false;
     }
 
-    bool success = true;
-    
-    // 分步加载并单独报告每个文件的错误
-    if (!loadStations(stationsFile)) {
-        qDebug() << "站点文件加载失败";
-        success = false;
-    }
-    
-    if (!loadTrains(trainsFile)) {
-        qDebug() << "列车文件加载失败";
-        success = false;
-    }
-    
-    if (!loadPassengerFlow(passengersFile)) {
-        qDebug() << "客流数据文件加载失败";
-        success = false;
-    }
-
-    if (success) {
-        qDebug() << "所有数据加载完成，共" << m_stations.size() << "个站点，"
-                 << m_trains.size() << "趟列车，"
-                 << m_passengerFlows.size() << "条客流记录";
-        emit dataLoaded();
-    } else {
-        qDebug() << "数据加载失败";
-    }
+    adoptStations(stations);
+    adoptTrains(trains);
+    m_databaseBacked = true;
+    emit stationsAndTrainsLoaded();
 
-    return success;
+    qDebug() << "从数据库加载完成，共" << m_stations.size() << "个站点，" << m_trains.size() << "趟列车，"
+             << m_database.flowCount() << "条客流记录留在数据库中";
+    emit dataLoaded();
+    return true;
 }
 
-
 bool DataManager::loadAllData()
 {
     // 尝试找到可能存在数据文件的路径
@@ -268,7 +2046,8 @@ bool DataManager::loadAllData()
     for (const QString &path : searchPaths) {
         QDir dir(path);
         qDebug() << "检查目录:" << dir.absolutePath();
-        if (dir.exists("客运站点.csv") && dir.exists("列车表.csv") && dir.exists("高铁客运量（成都--重庆）.csv")) {
+        if (dir.exists("客运站点.csv") && dir.exists("列车表.csv")
+            && (QFile::exists(flowFilePath(dir)) || !FlowPartitions::discover(dir.absolutePath()).isEmpty())) {
             qDebug() << "找到数据文件的目录:" << dir.absolutePath();
             return loadDataFromDirectory(dir.absolutePath());
         }
@@ -279,34 +2058,28 @@ bool DataManager::loadAllData()
     return false;
 }
 
-Station* DataManager::getStationById(int id) const
+Station* DataManager::getStationByName(const QString &name) const
 {
-    return m_stationMap.value(id, nullptr);
+    const int index = m_stationNameIndex.find(name);
+    return index >= 0 ? m_stations[index] : nullptr;
 }
 
-Station* DataManager::getStationByName(const QString &name) const
+Station* DataManager::getStationByTelecode(const QString &telecode) const
 {
-    for (Station* station : m_stations) {
-        if (station->getName() == name) {
-            return station;
-        }
-    }
-    return nullptr;
+    const int index = m_stationTelecodeIndex.find(telecode);
+    return index >= 0 ? m_stations[index] : nullptr;
 }
 
 Train* DataManager::getTrainByCode(const QString &code) const
 {
-    return m_trainMap.value(code, nullptr);
+    const int index = m_trainCodeIndex.find(code);
+    return index >= 0 ? m_trains[index] : nullptr;
 }
 
 Train* DataManager::getTrainByTrainCode(const QString &trainCode) const
 {
-    for(Train* train : m_trains)
-    {
-        if(train->getTrainCode() == trainCode)
-            return train;
-    }
-    return nullptr;
+    const int index = m_trainNumberIndex.find(trainCode);
+    return index >= 0 ? m_trains[index] : nullptr;
 }
 
 int DataManager::getStationIdByName(const QString &name) const
@@ -334,32 +2107,62 @@ QStringList DataManager::getTrainNumbers() const
 }
 
 
-int DataManager::getTotalPassengers() const
+void DataManager::watchColdColumns()
 {
-    int total = 0;
-    for (const PassengerFlow *flow : m_passengerFlows) {
-        total += flow->getTotalPassengers();
+    if (m_flowStore.hasPendingColdColumns()) {
+        // 冷列在第一次访问时解码，可能在分析线程中；失败时投递回本对象所在线程报告
+        QPointer<DataManager> self(this);
+        m_flowStore.coldSource()->setFailureHandler([self](const QString &error) {
+            if (self) {
+                QMetaObject::invokeMethod(self.data(), [self, error]() {
+                    emit self->dataLoadError(QString("客流的线路、到达时间、票价和起止站无法读取，"
+                                                     "票价分析和导出不可用\n%1").arg(error));
+                }, Qt::QueuedConnection);
+            }
+        });
+    } else if (m_flowStore.hasColdColumnsError()) {
+        emit dataLoadError(m_flowStore.coldColumnsError());
     }
-    return total;
 }
 
-double DataManager::getTotalRevenue() const
+QVector<PassengerFlow*> DataManager::getPassengerFlows() const
 {
-    double total = 0.0;
-    for (const PassengerFlow *flow : m_passengerFlows) {
-        total += flow->getRevenue();
+    if (m_passengerFlows.size() != m_flowStore.size()) {
+        m_passengerFlows.clear();
+        m_flowArena.clear();
+        m_passengerFlows.reserve(m_flowStore.size());
+        for (FlowRow flow : m_flowStore.all()) {
+            PassengerFlow *object = m_flowArena.create(flow.getLineCode(), flow.getTrainCode(), flow.getStationId(),
+                                                       flow.getDate(), flow.getArrivalTime(), flow.getDepartureTime(),
+                                                       flow.getBoardingPassengers(), flow.getAlightingPassengers(),
+                                                       flow.getTicketType(), flow.getTicketPrice(), flow.getRevenue());
+            object->setStartStation(flow.getStartStation());
+            object->setEndStation(flow.getEndStation());
+            m_passengerFlows.append(object);
+        }
     }
-    return total;
+    return m_passengerFlows;
+}
+
+// 以下统计直接读取增量维护的汇总，不扫描客流存储
+int DataManager::getTotalPassengers() const
+{
+    return static_cast<int>(m_aggregates.totalPassengers());
+}
+
+double DataManager::getTotalRevenue() const
+{
+    return m_aggregates.totalRevenue();
 }
 
 QMap<QString, int> DataManager::getStationPassengerStats() const
 {
     QMap<QString, int> stats;
-    for (const PassengerFlow *flow : m_passengerFlows) {
-        Station *station = getStationById(flow->getStationId());
+    const QHash<int, qint64> &totals = m_aggregates.stationTotals();
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        Station *station = getStationById(it.key());
         if (station) {
-            QString stationName = station->getName();
-            stats[stationName] += flow->getTotalPassengers();
+            stats[station->getName()] += static_cast<int>(it.value());
         }
     }
     return stats;
@@ -368,67 +2171,117 @@ QMap<QString, int> DataManager::getStationPassengerStats() const
 QMap<QString, int> DataManager::getTrainPassengerStats() const
 {
     QMap<QString, int> stats;
-    for (const PassengerFlow *flow : m_passengerFlows) {
-        stats[flow->getTrainCode()] += flow->getTotalPassengers();
+    const QVector<qint64> &totals = m_aggregates.trainTotals();
+    const QVector<bool> &seen = m_aggregates.trainSeen();
+    const FlowStore &dictionaries = m_blockPool.isOpen() ? m_blockPool.file().dictionaries() : m_flowStore;
+    for (int trainId = 0; trainId < totals.size(); ++trainId) {
+        if (seen[trainId]) {
+            stats[dictionaries.trainCodes().value(trainId)] = static_cast<int>(totals[trainId]);
+        }
     }
     return stats;
 }
 
 QMap<int, int> DataManager::getHourlyPassengerStats() const
+{
+    return m_aggregates.hourlyTotals();
+}
+
+QMap<int, int> DataManager::getHourlyPassengerStats(const QDate &startDate, const QDate &endDate) const
 {
     QMap<int, int> stats;
-    for (const PassengerFlow *flow : m_passengerFlows) {
-        stats[flow->getHour()] += flow->getTotalPassengers();
+    const int startDay = static_cast<int>(startDate.toJulianDay());
+    const int endDay = static_cast<int>(endDate.toJulianDay());
+    if (m_flowCube.isValid() && m_flowCube.rowCount() > 0) {
+        // 每个小时两次查表，与客流行数无关
+        for (int hour = -1; hour < 24; ++hour) {
+            const FlowCube::Totals totals = m_flowCube.total(startDay, endDay, hour);
+            if (totals.rows > 0) {
+                stats.insert(hour, static_cast<int>(totals.passengers()));
+            }
+        }
+        return stats;
+    }
+    QString error;
+    const bool ok = scanFlows(startDate, endDate, [&stats](const FlowView &flows) {
+        for (FlowRow flow : flows) {
+            stats[flow.getHour()] += flow.getTotalPassengers();
+        }
+    }, &error);
+    if (!ok) {
+        // 缺块的统计偏小，宁可不给结果
+        qDebug() << error;
+        return QMap<int, int>();
     }
     return stats;
 }
 
 QMap<int, int> DataManager::getDailyPassengerStats() const
 {
-    QMap<int, int> stats;
-    for (const PassengerFlow *flow : m_passengerFlows) {
-        stats[flow->getDayOfWeek()] += flow->getTotalPassengers();
+    return m_aggregates.dayOfWeekTotals();
+}
+
+QMap<QDate, int> DataManager::getDatePassengerStats() const
+{
+    QMap<QDate, int> stats;
+    const QMap<int, qint64> &totals = m_aggregates.dateTotals();
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        stats.insert(QDate::fromJulianDay(it.key()), static_cast<int>(it.value()));
     }
     return stats;
 }
 
-QVector<PassengerFlow*> DataManager::getPassengerFlowsByDate(const QDate &date) const
+FlowView DataManager::getPassengerFlowsByDate(const QDate &date) const
 {
-    QVector<PassengerFlow*> result;
-    for (PassengerFlow *flow : m_passengerFlows) {
-        if (flow->getDate() == date) {
-            result.append(flow);
-        }
+    const int dayNumber = static_cast<int>(date.toJulianDay());
+    return m_flowStore.dayRange(dayNumber, dayNumber);
+}
+
+FlowView DataManager::getPassengerFlowsByStation(int stationId) const
+{
+    return flowIndex().stationFlows(m_flowStore, stationId);
+}
+
+FlowView DataManager::getPassengerFlowsByTrain(const QString &trainCode) const
+{
+    const int trainId = m_flowStore.trainCodes().find(trainCode);
+    if (trainId < 0) {
+        return FlowView(&m_flowStore, QVector<int>());
     }
-    return result;
+    return flowIndex().trainFlows(m_flowStore, trainId);
 }
 
-QVector<PassengerFlow*> DataManager::getPassengerFlowsByStation(int stationId) const
+FlowView DataManager::getPassengerFlowsByStation(int stationId, const QDate &startDate, const QDate &endDate) const
 {
-    QVector<PassengerFlow*> result;
-    for (PassengerFlow *flow : m_passengerFlows) {
-        if (flow->getStationId() == stationId) {
-            result.append(flow);
-        }
+    return flowIndex().stationFlows(m_flowStore, stationId, static_cast<int>(startDate.toJulianDay()),
+                                    static_cast<int>(endDate.toJulianDay()));
+}
+
+FlowView DataManager::getPassengerFlowsByTrain(const QString &trainCode, const QDate &startDate,
+                                               const QDate &endDate) const
+{
+    const int trainId = m_flowStore.trainCodes().find(trainCode);
+    if (trainId < 0) {
+        return FlowView(&m_flowStore, QVector<int>());
     }
-    return result;
+    return flowIndex().trainFlows(m_flowStore, trainId, static_cast<int>(startDate.toJulianDay()),
+                                  static_cast<int>(endDate.toJulianDay()));
 }
 
-QVector<PassengerFlow*> DataManager::getPassengerFlowsByTrain(const QString &trainCode) const
+FlowView DataManager::getPassengerFlowsByStationAndTrain(int stationId, const QString &trainCode,
+                                                         const QDate &startDate, const QDate &endDate) const
 {
-    QVector<PassengerFlow*> result;
-    for (PassengerFlow *flow : m_passengerFlows) {
-        if (flow->getTrainCode() == trainCode) {
-            result.append(flow);
-        }
+    const int trainId = m_flowStore.trainCodes().find(trainCode);
+    if (trainId < 0) {
+        return FlowView(&m_flowStore, QVector<int>());
     }
-    return result;
+    return flowIndex().stationTrainFlows(m_flowStore, stationId, trainId,
+                                         static_cast<int>(startDate.toJulianDay()),
+                                         static_cast<int>(endDate.toJulianDay()));
 }
 
-QVector<PassengerFlow*> DataManager::getPassengerFlowsByDateRange(const QDate &startDate, const QDate &endDate) const
+FlowView DataManager::getPassengerFlowsByDateRange(const QDate &startDate, const QDate &endDate) const
 {
-    QVector<PassengerFlow*> result;
-    
     // 只在特定日期范围才输出详细日志
     static QDate lastLogDate;
     static int logCount = 0;
@@ -439,40 +2292,22 @@ QVector<PassengerFlow*> DataManager::getPassengerFlowsByDateRange(const QDate &s
         lastLogDate = QDate::currentDate();
         qDebug() << "DataManager::getPassengerFlowsByDateRange - 查询范围: " 
                  << startDate.toString("yyyy-MM-dd") << " 至 " << endDate.toString("yyyy-MM-dd");
-        qDebug() << "总客流记录数量: " << m_passengerFlows.size();
+        qDebug() << "总客流记录数量: " << m_flowStore.size();
     }
     
     // 如果没有客流数据，生成一些模拟数据供测试
-    if (m_passengerFlows.isEmpty()) {
+    if (m_flowStore.isEmpty()) {
         qDebug() << "警告: 客流数据为空，生成模拟数据供测试";
         
         // 生成3个站点的模拟数据
         QStringList stationNamesList = {"成都东站", "重庆北站", "成都站"};
         QStringList trainCodesList = {"G8501", "G8502", "G8503", "G8504", "G8505"};
         
-        // 创建临时站点和列车对象用于模拟数据，而不是添加到成员变量中
-        QVector<Station*> tempStations;
-        if (m_stations.isEmpty()) {
-            qDebug() << "创建模拟站点数据";
-            tempStations.append(new Station(1695, "成都东站", "CD East", "四川省成都市", nullptr));
-            tempStations.append(new Station(1640, "成都站", "Chengdu", "四川省成都市", nullptr));
-            tempStations.append(new Station(1037, "重庆北站", "CQ North", "重庆市", nullptr));
-        } else {
-            // 使用现有站点
-            tempStations = m_stations;
-        }
-        
-        // 创建临时列车对象
-        QVector<Train*> tempTrains;
-        if (m_trains.isEmpty()) {
-            qDebug() << "创建模拟列车数据";
-            for (const QString& code : trainCodesList) {
-                tempTrains.append(new Train(code, code, 500, nullptr));
-            }
-        } else {
-            // 使用现有列车
-            tempTrains = m_trains;
-        }
+        // 模拟数据放在单独的存储中，不修改真实数据（因为这是const方法）
+        m_mockFlows.clear();
+        const int lineId = m_mockFlows.lineCodes().insert(QString("CD-CQ"));
+        const int ticketTypeId = m_mockFlows.ticketTypes().insert(QString("成人票"));
+        const int emptyStationId = m_mockFlows.stationNames().insert(QString());
         
         // 为请求的日期范围生成每一天的数据
         QDate currentDate = startDate;
@@ -509,23 +2344,21 @@ QVector<PassengerFlow*> DataManager::getPassengerFlowsByDateRange(const QDate &s
                     double revenue = (boarding + alighting) * ticketPrice;
                     
                     // 创建客流记录
-                    PassengerFlow *flow = new PassengerFlow(
-                        "CD-CQ", // 线路代码
-                        trainCode, // 列车编号
-                        stationId, // 站点ID
-                        currentDate, // 日期
-                        QTime(8, 0), // 到达时间
-                        QTime(8, 5), // 出发时间
-                        boarding, // 上客人数
-                        alighting, // 下客人数
-                        "成人票", // 票类型
-                        ticketPrice, // 票价
-                        revenue, // 收入
-                        nullptr // 父对象
-                    );
-                    
-                    // 仅添加到返回结果，不修改成员变量（因为这是const方法）
-                    result.append(flow);
+                    FlowStore::Record record;
+                    record.lineId = lineId;                                      // 线路代码
+                    record.trainId = m_mockFlows.trainCodes().insert(trainCode); // 列车编号
+                    record.stationId = stationId;                                // 站点ID
+                    record.dayNumber = static_cast<int>(currentDate.toJulianDay()); // 日期
+                    record.arrivalMinute = 8 * 60;                               // 到达时间
+                    record.departureMinute = 8 * 60 + 5;                         // 出发时间
+                    record.boardingPassengers = boarding;                        // 上客人数
+                    record.alightingPassengers = alighting;                      // 下客人数
+                    record.ticketTypeId = ticketTypeId;                          // 票类型
+                    record.ticketPrice = ticketPrice;                            // 票价
+                    record.revenue = revenue;                                    // 收入
+                    record.startStationId = emptyStationId;
+                    record.endStationId = emptyStationId;
+                    m_mockFlows.append(record);
                 }
             }
             
@@ -534,75 +2367,207 @@ QVector<PassengerFlow*> DataManager::getPassengerFlowsByDateRange(const QDate &s
             dayCount++;
         }
         
-        qDebug() << "生成了" << result.size() << "条模拟客流记录，已添加到数据管理器";
-        return result;
+        qDebug() << "生成了" << m_mockFlows.size() << "条模拟客流记录";
+        return m_mockFlows.all();
     }
     
-    // 正常处理实际数据
-    int skippedInvalidDate = 0;
-    int skippedOutOfRange = 0;
-    
-    for (PassengerFlow *flow : m_passengerFlows) {
-        if (!flow) {
-            qDebug() << "警告: 发现空的客流记录指针";
-            continue;
-        }
-        
-        QDate flowDate = flow->getDate();
-        
-        // 检查日期有效性
-        if (!flowDate.isValid()) {
-            skippedInvalidDate++;
-            if (skippedInvalidDate <= 3) {
-                qDebug() << "警告: 客流记录日期无效 - 列车:" << flow->getTrainCode() 
-                         << "站点ID:" << flow->getStationId();
-            }
-            continue;
-        }
-        
-        // 检查是否在日期范围内
-        if (flowDate >= startDate && flowDate <= endDate) {
-            result.append(flow);
-        } else {
-            skippedOutOfRange++;
-            if (skippedOutOfRange <= 3) {
-                qDebug() << "日期范围外: " << flowDate.toString("yyyy-MM-dd");
-            }
-        }
-    }
+    // 正常处理实际数据：客流按日期聚集存放，两次查按天的偏移表得到一段连续的行，不逐行比较也不复制行号
+    const int startDay = static_cast<int>(startDate.toJulianDay());
+    const int endDay = static_cast<int>(endDate.toJulianDay());
+    FlowView result = m_flowStore.dayRange(startDay, endDay);
     
     if (shouldLog) {
         qDebug() << "查询结果: 符合日期范围的记录数:" << result.size()
-                 << ", 无效日期记录:" << skippedInvalidDate
-                 << ", 超出日期范围记录:" << skippedOutOfRange;
+                 << ", 超出日期范围记录:" << m_flowStore.size() - result.size();
                  
         // 输出前几条记录做示例
-        for (int i = 0; i < std::min(2, (int)result.size()); i++) {
-            PassengerFlow* flow = result[i];
-            qDebug() << "记录示例" << (i+1) << ": 日期=" << flow->getDate().toString("yyyy-MM-dd")
-                     << ", 列车=" << flow->getTrainCode()
-                     << ", 站点ID=" << flow->getStationId()
-                     << ", 上客=" << flow->getBoardingPassengers()
-                     << ", 下客=" << flow->getAlightingPassengers();
+        for (int i = 0; i < std::min(2, result.size()); i++) {
+            FlowRow flow = result[i];
+            qDebug() << "记录示例" << (i+1) << ": 日期=" << flow.getDate().toString("yyyy-MM-dd")
+                     << ", 列车=" << flow.getTrainCode()
+                     << ", 站点ID=" << flow.getStationId()
+                     << ", 上客=" << flow.getBoardingPassengers()
+                     << ", 下客=" << flow.getAlightingPassengers();
         }
     }
     
     return result;
 }
 
-bool DataManager::validateData() const
+bool DataManager::scanFlows(const FlowVisitor &visit, QString *error) const
+{
+    if (!m_blockPool.isOpen()) {
+        visit(getFlows());
+        return true;
+    }
+
+    for (int i = 0; i < m_blockPool.file().blockCount(); ++i) {
+        QSharedPointer<const FlowStore> block = m_blockPool.block(i, error);
+        if (!block) {
+            return false;
+        }
+        visit(block->all());
+    }
+    return true;
+}
+
+bool DataManager::scanFlows(const QDate &startDate, const QDate &endDate, const FlowVisitor &visit,
+                            QString *error) const
+{
+    // 块文件为空时和内存模式一样交给getPassengerFlowsByDateRange生成模拟数据
+    if (!m_blockPool.isOpen() || m_blockPool.file().blockCount() == 0) {
+        visit(getPassengerFlowsByDateRange(startDate, endDate));
+        return true;
+    }
+
+    const int startDay = static_cast<int>(startDate.toJulianDay());
+    const int endDay = static_cast<int>(endDate.toJulianDay());
+    int visited = 0;
+    for (int i = 0; i < m_blockPool.file().blockCount(); ++i) {
+        const FlowBlockFile::Block &entry = m_blockPool.file().block(i);
+        if (!entry.overlaps(startDay, endDay)) {
+            continue;
+        }
+        QSharedPointer<const FlowStore> block = m_blockPool.block(i, error);
+        if (!block) {
+            return false;
+        }
+        visited++;
+
+        // 整块落在范围内时不必逐行筛选
+        if (entry.firstDay >= startDay && entry.lastDay <= endDay) {
+            visit(block->all());
+            continue;
+        }
+        visit(block->dayRange(startDay, endDay));
+    }
+    qDebug() << "核外扫描" << startDate.toString("yyyy-MM-dd") << "至" << endDate.toString("yyyy-MM-dd")
+             << "：读取" << visited << "/" << m_blockPool.file().blockCount() << "块，缓冲池命中"
+             << m_blockPool.hits() << "次，未命中" << m_blockPool.misses() << "次";
+    return true;
+}
+
+bool DataManager::validateData(FlowValidation::Report *report, const QString &outputBase) const
 {
-    if (m_stations.isEmpty() || m_trains.isEmpty() || m_passengerFlows.isEmpty()) {
+    FlowValidation::Report localReport;
+    FlowValidation::Report &result = report ? *report : localReport;
+    result = FlowValidation::Report();
+    QElapsedTimer timer;
+    timer.start();
+
+    if (m_stations.isEmpty() || m_trains.isEmpty()) {
+        result.error = "尚未加载站点和列车数据";
         return false;
     }
-    
-    // Check for data consistency
-    for (const PassengerFlow *flow : m_passengerFlows) {
-        if (!getStationById(flow->getStationId())) {
+    if (m_flowSources.isEmpty()) {
+        result.error = m_databaseBacked ? "数据库模式下没有客流源文件可供检查" : "尚未加载客流数据";
+        return false;
+    }
+    for (const QString &file : m_flowSources) {
+        if (FlowColumnFile::isColumnFile(file)) {
+            result.error = QString("列式客流文件在导出时已按类型解析，不能按CSV规则逐行检查: %1").arg(file);
             return false;
         }
     }
-    
+
+    // 参照表：站点ID位图和列车编码字典，逐行检查只是一次位测试和一次字典查找
+    int maxStationId = 0;
+    for (const Station *station : m_stations) {
+        maxStationId = qMax(maxStationId, station->getId());
+    }
+    QBitArray knownStations(qMin(maxStationId, kMaxStationBitmapId) + 1);
+    for (const Station *station : m_stations) {
+        if (station->getId() >= 0 && station->getId() < knownStations.size()) {
+            knownStations.setBit(station->getId());
+        }
+    }
+    StringDictionary knownTrains;
+    for (const Train *train : m_trains) {
+        knownTrains.insert(train->getCode());
+    }
+
+    QString error;
+    FlowValidation::Writer writer;
+    if (!writer.open(outputBase.isEmpty() ? FlowValidation::defaultBasePath(m_dataDirectory) : outputBase,
+                     result, &error)) {
+        result.error = error;
+        qDebug() << error;
+        return false;
+    }
+
+    for (const QString &file : m_flowSources) {
+        result.files.append(file);
+        const bool ok = readFlowBatches(file, true, [&](QThreadPool &pool, const FlowBatch &batch,
+                                                        QString *error) {
+            QVector<FlowValidation::Chunk> chunks(batch.ranges.size());
+            for (int i = 0; i < batch.ranges.size(); ++i) {
+                pool.start([this, &batch, &knownStations, &knownTrains, &chunks, i]() {
+                    validateFlowChunk(batch.ranges[i].first, batch.ranges[i].second, batch,
+                                      knownStations, knownTrains, chunks[i]);
+                });
+            }
+            pool.waitForDone();
+            m_bytesRead.fetchAndAddRelaxed(batch.ranges.last().second - batch.ranges.first().first);
+            if (m_cancelRequested.loadRelaxed()) {
+                result.cancelled = true;
+                *error = "数据质量检查已取消";
+                return false;
+            }
+
+            // 按文件顺序写出，隔离文件中的偏移单调递增
+            for (const FlowValidation::Chunk &chunk : chunks) {
+                if (!writer.append(file, chunk, result, error)) {
+                    return false;
+                }
+            }
+            return true;
+        }, &error);
+        if (!ok) {
+            result.error = error;
+            qDebug() << error;
+            return false;
+        }
+    }
+
+    result.elapsedMs = timer.elapsed();
+    if (!writer.finish(result, &error)) {
+        result.error = error;
+        qDebug() << error;
+        return false;
+    }
+    qDebug().noquote() << result.toText();
+    return result.isClean();
+}
+
+bool DataManager::validateDataAsync(const QString &outputBase)
+{
+    if (m_loading) {
+        return false;
+    }
+    m_loading = true;
+    m_cancelRequested.storeRelaxed(0);
+    m_bytesRead.storeRelaxed(0);
+    m_bytesTotal.storeRelaxed(0);
+    for (const QString &file : m_flowSources) {
+        m_bytesTotal.fetchAndAddRelaxed(CompressedReader::expectedSize(file));
+    }
+    emit progress(0, m_bytesTotal.loadRelaxed());
+
+    // 检查期间m_loading阻止重新加载和追加，工作线程读到的站点、列车和源文件列表不会变化
+    QThread *thread = QThread::create([this, outputBase]() {
+        FlowValidation::Report report;
+        validateData(&report, outputBase);
+        QMetaObject::invokeMethod(this, [this, report]() {
+            m_loading = false;
+            m_progressTimer->stop();
+            emit progress(m_bytesTotal.loadRelaxed(), m_bytesTotal.loadRelaxed());
+            emit validationFinished(report);
+        }, Qt::QueuedConnection);
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    m_loadThread = thread;
+    m_progressTimer->start();
+    thread->start();
     return true;
 }
 
@@ -612,7 +2577,8 @@ QString DataManager::getDataSummary() const
     summary += QString("数据摘要:\n");
     summary += QString("站点数量: %1\n").arg(m_stations.size());
     summary += QString("列车数量: %1\n").arg(m_trains.size());
-    summary += QString("客流记录: %1\n").arg(m_passengerFlows.size());
+    summary += QString("客流记录: %1\n").arg(m_flowStore.size());
+    summary += QString("重复记录（已丢弃）: %1\n").arg(m_duplicateRows);
     summary += QString("总客流量: %1\n").arg(getTotalPassengers());
     summary += QString("总收入: %.2f\n").arg(getTotalRevenue());
     return summary;
@@ -620,109 +2586,44 @@ QString DataManager::getDataSummary() const
 
 void DataManager::clearData()
 {
-    qDeleteAll(m_stations);
-    qDeleteAll(m_trains);
-    qDeleteAll(m_passengerFlows);
-    
+    // 先清空指针表，再整块释放对象
     m_stations.clear();
     m_trains.clear();
     m_passengerFlows.clear();
-    m_stationMap.clear();
-    m_trainMap.clear();
-}
+    m_stationArena.clear();
+    m_trainArena.clear();
+    m_flowArena.clear();
+    m_flowStore.clear();
+    m_mockFlows.clear();
+    rebuildStationIndex();
+    rebuildTrainIndex();
+    m_routeGraph.clear();
+    m_aggregates.clear();
+    m_flowCube.clear();
+    m_flowIndex.clear();
+    m_flowBitmaps.clear();
+    ++m_generation;
 
-QTime DataManager::parseTime(const QString &timeStr) const
-{
-    QString cleanTime = timeStr.trimmed();
-    if (cleanTime.length() == 4) {
-        // Format: HHMM
-        int hour = cleanTime.left(2).toInt();
-        int minute = cleanTime.right(2).toInt();
-        return QTime(hour, minute);
-    }
-    return QTime();
-}
+    m_duplicateRows = 0;
+    m_tailDeduplicator.clear();
 
-QDate DataManager::parseDate(const QString &dateStr) const
-{
-    QString cleanDate = dateStr.trimmed();
-    
-    // 完全禁用日期解析调试输出 - 只在首次运行时记录一些示例
-    static bool alreadyLogged = false;
-    static QSet<QString> knownFormats;
-    
-    // 尝试多种格式解析
-    if (cleanDate.length() == 8) {
-        // Format: YYYYMMDD
-        int year = cleanDate.left(4).toInt();
-        int month = cleanDate.mid(4, 2).toInt();
-        int day = cleanDate.right(2).toInt();
-        QDate result(year, month, day);
-        
-        // 只记录一次成功解析的示例
-        if (!alreadyLogged && !knownFormats.contains("YYYYMMDD")) {
-            knownFormats.insert("YYYYMMDD");
-            qDebug() << "日期解析示例 - 格式YYYYMMDD:" << dateStr << "→" << result.toString("yyyy-MM-dd");
-            if (knownFormats.size() >= 3) {
-                alreadyLogged = true;
-            }
-        }
-        
-        return result;
-    } else if (cleanDate.contains("-")) {
-        // Format: YYYY-MM-DD
-        QStringList parts = cleanDate.split("-");
-        if (parts.size() == 3) {
-            int year = parts[0].toInt();
-            int month = parts[1].toInt();
-            int day = parts[2].toInt();
-            QDate result(year, month, day);
-            
-            // 只记录一次成功解析的示例
-            if (!alreadyLogged && !knownFormats.contains("YYYY-MM-DD")) {
-                knownFormats.insert("YYYY-MM-DD");
-                qDebug() << "日期解析示例 - 格式YYYY-MM-DD:" << dateStr << "→" << result.toString("yyyy-MM-dd");
-                if (knownFormats.size() >= 3) {
-                    alreadyLogged = true;
-                }
-            }
-            
-            return result;
-        }
-    } else if (cleanDate.contains("/")) {
-        // Format: YYYY/MM/DD or MM/DD/YYYY
-        QStringList parts = cleanDate.split("/");
-        if (parts.size() == 3) {
-            int year, month, day;
-            if (parts[0].length() == 4) { // YYYY/MM/DD
-                year = parts[0].toInt();
-                month = parts[1].toInt();
-                day = parts[2].toInt();
-            } else { // MM/DD/YYYY
-                month = parts[0].toInt();
-                day = parts[1].toInt();
-                year = parts[2].toInt();
-            }
-            QDate result(year, month, day);
-            
-            // 只记录一次成功解析的示例
-            if (!alreadyLogged && !knownFormats.contains("DateWithSlash")) {
-                knownFormats.insert("DateWithSlash");
-                qDebug() << "日期解析示例 - 格式带斜杠:" << dateStr << "→" << result.toString("yyyy-MM-dd");
-                if (knownFormats.size() >= 3) {
-                    alreadyLogged = true;
-                }
-            }
-            
-            return result;
-        }
+    m_flowFile.clear();
+    m_tailOffset = 0;
+    m_tailLayoutValid = false;
+    if (m_tailWatcher && !m_tailWatcher->files().isEmpty()) {
+        m_tailWatcher->removePaths(m_tailWatcher->files());
     }
-    
-    // 如果无法解析，使用2015年1月1日作为默认日期
-    static bool loggedInvalid = false;
-    if (!loggedInvalid) {
-        qDebug() << "无法解析的日期格式示例:" << dateStr << "，使用默认值2015-01-01";
-        loggedInvalid = true;
-    }
-    return QDate(2015, 1, 1);
-}
\ No newline at end of file
+
+    m_flowSources.clear();
+    m_partitioned = false;
+    m_partitions.clear();
+    m_residentPartitions.clear();
+    m_windowPartitions.clear();
+    m_windowRows = 0;
+
+    m_database.close();
+    m_databaseBacked = false;
+
+    m_blockPool.close();
+    m_blockMode = false;
+}
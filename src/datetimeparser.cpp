@@ -0,0 +1,215 @@
+#include "datetimeparser.h"
+#include "csvtokenizer.h"
+#include <cstring>
+
+namespace {
+
+inline bool isDigit(char c)
+{
+    return static_cast<unsigned>(static_cast<unsigned char>(c) - '0') <= 9u;
+}
+
+// 定长数字，调用方保证每个字节都是数字
+inline int digits(const char *p, int count)
+{
+    int value = 0;
+    for (int i = 0; i < count; ++i) {
+        value = value * 10 + (p[i] - '0');
+    }
+    return value;
+}
+
+inline bool allDigits(const char *p, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        if (!isDigit(p[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 按分隔符切成正好三段，与QString::split后要求3段的语义一致
+bool splitThree(QByteArrayView field, char separator, QByteArrayView parts[3])
+{
+    const char *begin = field.data();
+    const char *end = begin + field.size();
+    int count = 0;
+    while (true) {
+        const char *next = static_cast<const char*>(std::memchr(begin, separator, end - begin));
+        if (count == 3) {
+            return false;
+        }
+        parts[count++] = QByteArrayView(begin, (next ? next : end) - begin);
+        if (!next) {
+            break;
+        }
+        begin = next + 1;
+    }
+    return count == 3;
+}
+
+bool contains(QByteArrayView field, char c)
+{
+    return field.size() > 0 && std::memchr(field.data(), c, field.size()) != nullptr;
+}
+
+// 与原来逐行的QString版本规则相同：8位按YYYYMMDD，含'-'按YYYY-MM-DD，
+// 含'/'时首段4位按YYYY/MM/DD否则按MM/DD/YYYY，其余返回默认日期
+int parseDayGeneric(QByteArrayView field, int unrecognizedDay)
+{
+    if (field.size() == 8) {
+        if (allDigits(field.data(), 8)) {
+            return DateTimeParser::julianDay(digits(field.data(), 4), digits(field.data() + 4, 2),
+                                             digits(field.data() + 6, 2));
+        }
+        return DateTimeParser::julianDay(CsvTokenizer::toInt(field.first(4)), CsvTokenizer::toInt(field.sliced(4, 2)),
+                                         CsvTokenizer::toInt(field.last(2)));
+    }
+
+    QByteArrayView parts[3];
+    if (contains(field, '-')) {
+        if (splitThree(field, '-', parts)) {
+            return DateTimeParser::julianDay(CsvTokenizer::toInt(parts[0]), CsvTokenizer::toInt(parts[1]),
+                                             CsvTokenizer::toInt(parts[2]));
+        }
+    } else if (contains(field, '/')) {
+        if (splitThree(field, '/', parts)) {
+            if (parts[0].size() == 4) {
+                return DateTimeParser::julianDay(CsvTokenizer::toInt(parts[0]), CsvTokenizer::toInt(parts[1]),
+                                                 CsvTokenizer::toInt(parts[2]));
+            }
+            return DateTimeParser::julianDay(CsvTokenizer::toInt(parts[2]), CsvTokenizer::toInt(parts[0]),
+                                             CsvTokenizer::toInt(parts[1]));
+        }
+    }
+    return unrecognizedDay;
+}
+
+} // namespace
+
+DateTimeParser::DateFormat DateTimeParser::detectDateFormat(QByteArrayView field)
+{
+    field = CsvTokenizer::trimmed(field);
+    if (field.size() == 8 && allDigits(field.data(), 8)) {
+        return CompactDate;
+    }
+
+    QByteArrayView parts[3];
+    if (contains(field, '-') && splitThree(field, '-', parts)) {
+        return DashedDate;
+    }
+    if (contains(field, '/') && splitThree(field, '/', parts)) {
+        return parts[0].size() == 4 ? SlashedDate : UsSlashedDate;
+    }
+    return UnknownDate;
+}
+
+QString DateTimeParser::formatName(DateFormat format)
+{
+    switch (format) {
+    case CompactDate: return "YYYYMMDD";
+    case DashedDate: return "YYYY-MM-DD";
+    case SlashedDate: return "YYYY/MM/DD";
+    case UsSlashedDate: return "MM/DD/YYYY";
+    default: return "未知";
+    }
+}
+
+int DateTimeParser::parseDay(QByteArrayView field, DateFormat format)
+{
+    return parseDay(field, format, defaultDay());
+}
+
+int DateTimeParser::parseDayStrict(QByteArrayView field, DateFormat format)
+{
+    return parseDay(field, format, InvalidDay);
+}
+
+int DateTimeParser::parseDay(QByteArrayView field, DateFormat format, int unrecognizedDay)
+{
+    field = CsvTokenizer::trimmed(field);
+    const char *p = field.data();
+
+    // 与探测到的格式完全吻合（定长、分隔符位置正确、其余全是数字）时直接计算
+    switch (format) {
+    case CompactDate:
+        if (field.size() == 8 && allDigits(p, 8)) {
+            return julianDay(digits(p, 4), digits(p + 4, 2), digits(p + 6, 2));
+        }
+        break;
+    case DashedDate:
+    case SlashedDate: {
+        const char separator = format == DashedDate ? '-' : '/';
+        if (field.size() == 10 && p[4] == separator && p[7] == separator
+            && allDigits(p, 4) && allDigits(p + 5, 2) && allDigits(p + 8, 2)) {
+            return julianDay(digits(p, 4), digits(p + 5, 2), digits(p + 8, 2));
+        }
+        break;
+    }
+    case UsSlashedDate:
+        if (field.size() == 10 && p[2] == '/' && p[5] == '/'
+            && allDigits(p, 2) && allDigits(p + 3, 2) && allDigits(p + 6, 4)) {
+            return julianDay(digits(p + 6, 4), digits(p, 2), digits(p + 3, 2));
+        }
+        break;
+    default:
+        break;
+    }
+
+    // 不吻合的行（如不补零的月日）按通用规则解析
+    return parseDayGeneric(field, unrecognizedDay);
+}
+
+int DateTimeParser::parseMinute(QByteArrayView field)
+{
+    field = CsvTokenizer::trimmed(field);
+    if (field.size() != 4) {
+        return InvalidMinute;
+    }
+
+    // Format: HHMM
+    const char *p = field.data();
+    int hour, minute;
+    if (allDigits(p, 4)) {
+        hour = digits(p, 2);
+        minute = digits(p + 2, 2);
+    } else {
+        hour = CsvTokenizer::toInt(field.first(2));
+        minute = CsvTokenizer::toInt(field.last(2));
+    }
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+        return InvalidMinute;
+    }
+    return hour * 60 + minute;
+}
+
+int DateTimeParser::julianDay(int year, int month, int day)
+{
+    // 与QDate一致：没有公元0年，公元前的年份为负数
+    if (year == 0 || month < 1 || month > 12 || day < 1) {
+        return InvalidDay;
+    }
+    static const int daysInMonth[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    const int y = year < 0 ? year + 1 : year;
+    const bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (day > daysInMonth[month - 1] + (month == 2 && leap ? 1 : 0)) {
+        return InvalidDay;
+    }
+
+    // 先算相对1970-01-01的天数（proleptic Gregorian），再加上其儒略日2440588
+    const qint64 yy = month <= 2 ? qint64(y) - 1 : y;
+    const qint64 era = (yy >= 0 ? yy : yy - 399) / 400;
+    const qint64 yoe = yy - era * 400;
+    const qint64 doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const qint64 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const qint64 days = era * 146097 + doe - 719468;
+    return static_cast<int>(days + 2440588);
+}
+
+int DateTimeParser::defaultDay()
+{
+    // 如果无法解析，使用2015年1月1日作为默认日期
+    static const int day = julianDay(2015, 1, 1);
+    return day;
+}
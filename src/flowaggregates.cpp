@@ -0,0 +1,63 @@
+#include "flowaggregates.h"
+
+void FlowAggregates::clear()
+{
+    m_rowCount = 0;
+    m_totalPassengers = 0;
+    m_totalRevenue = 0.0;
+    m_stationTotals.clear();
+    m_trainTotals.clear();
+    m_trainSeen.clear();
+    m_hourlyTotals.clear();
+    m_dayOfWeekTotals.clear();
+    m_dateTotals.clear();
+}
+
+void FlowAggregates::add(const FlowStore &store, int firstRow)
+{
+    const QVector<qint32> &stationIds = store.stationIds();
+    const QVector<qint32> &days = store.dayNumbers();
+    const QVector<qint16> &departures = store.departureMinutes();
+    const QVector<qint32> &boarding = store.boardingPassengers();
+    const QVector<qint32> &alighting = store.alightingPassengers();
+    const QVector<double> &revenues = store.revenues();
+    const QVector<FlowStore::DictId> &trainIds = store.trainIds();
+
+    if (m_trainTotals.size() < store.trainCodes().size()) {
+        m_trainTotals.resize(store.trainCodes().size());
+        m_trainSeen.resize(store.trainCodes().size());
+    }
+
+    // 小时和星期只有几十个取值，先在数组里累计，最后再合并进QMap
+    qint64 hourly[25] = {};
+    qint64 dayOfWeek[8] = {};
+    bool hourSeen[25] = {};
+    bool daySeen[8] = {};
+    for (int i = firstRow; i < store.size(); ++i) {
+        const int passengers = boarding[i] + alighting[i];
+        m_totalPassengers += passengers;
+        m_totalRevenue += revenues[i];
+        m_stationTotals[stationIds[i]] += passengers;
+        m_trainTotals[trainIds[i]] += passengers;
+        m_trainSeen[trainIds[i]] = true;
+        const int hour = departures[i] >= 0 ? departures[i] / 60 + 1 : 0;
+        const int day = days[i] % 7 + 1;
+        hourly[hour] += passengers;
+        hourSeen[hour] = true;
+        dayOfWeek[day] += passengers;
+        daySeen[day] = true;
+        m_dateTotals[days[i]] += passengers;
+    }
+
+    for (int hour = 0; hour < 25; ++hour) {
+        if (hourSeen[hour]) {
+            m_hourlyTotals[hour - 1] += static_cast<int>(hourly[hour]);
+        }
+    }
+    for (int day = 1; day < 8; ++day) {
+        if (daySeen[day]) {
+            m_dayOfWeekTotals[day] += static_cast<int>(dayOfWeek[day]);
+        }
+    }
+    m_rowCount += qMax(0, store.size() - firstRow);
+}
@@ -0,0 +1,451 @@
+#include "flowbitmap.h"
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+const int kContainerWords = 65536 / 64;
+
+// 置位[begin, end)（块内的低16位）
+void setBits(QVector<quint64> &words, int begin, int end)
+{
+    for (int bit = begin; bit < end;) {
+        const int word = bit >> 6;
+        const int first = bit & 63;
+        const int last = qMin(end - (word << 6), 64);   // 本字内置位到last之前
+        const quint64 mask = (last - first == 64) ? ~quint64(0)
+                                                  : ((quint64(1) << (last - first)) - 1) << first;
+        words[word] |= mask;
+        bit = (word << 6) + last;
+    }
+}
+
+int countBits(const QVector<quint64> &words)
+{
+    int count = 0;
+    for (quint64 word : words) {
+        count += qPopulationCount(word);
+    }
+    return count;
+}
+
+} // namespace
+
+bool FlowBitmap::Container::contains(quint16 low) const
+{
+    if (isBitmap()) {
+        return (words[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(values.constBegin(), values.constEnd(), low);
+}
+
+void FlowBitmap::Container::toBitmap()
+{
+    if (isBitmap()) {
+        return;
+    }
+    words.fill(0, kContainerWords);
+    for (quint16 low : values) {
+        words[low >> 6] |= quint64(1) << (low & 63);
+    }
+    values.clear();
+}
+
+void FlowBitmap::Container::shrink()
+{
+    if (!isBitmap() || cardinality > ArrayLimit) {
+        return;
+    }
+    values.clear();
+    values.reserve(cardinality);
+    for (int w = 0; w < words.size(); ++w) {
+        quint64 word = words[w];
+        while (word) {
+            values.append(static_cast<quint16>(w * 64 + int(qCountTrailingZeroBits(word))));
+            word &= word - 1;
+        }
+    }
+    words.clear();
+}
+
+FlowBitmap FlowBitmap::range(int begin, int end)
+{
+    FlowBitmap bitmap;
+    if (begin < 0) {
+        begin = 0;
+    }
+    for (int key = begin >> 16; begin < end; ++key) {
+        const int base = key << 16;
+        const int low = begin - base;
+        const int high = int(qMin(qint64(end), qint64(base) + 65536) - base);
+        Container container;
+        container.key = static_cast<quint16>(key);
+        container.cardinality = high - low;
+        if (container.cardinality <= ArrayLimit) {
+            container.values.reserve(container.cardinality);
+            for (int value = low; value < high; ++value) {
+                container.values.append(static_cast<quint16>(value));
+            }
+        } else {
+            container.words.fill(0, kContainerWords);
+            setBits(container.words, low, high);
+        }
+        bitmap.m_containers.append(container);
+        begin = base + high;
+    }
+    return bitmap;
+}
+
+FlowBitmap FlowBitmap::fromRows(const QVector<int> &rows)
+{
+    FlowBitmap bitmap;
+    for (int row : rows) {
+        bitmap.add(row);
+    }
+    return bitmap;
+}
+
+void FlowBitmap::add(int row)
+{
+    const quint16 key = static_cast<quint16>(row >> 16);
+    const quint16 low = static_cast<quint16>(row & 0xffff);
+    if (m_containers.isEmpty() || m_containers.last().key != key) {
+        Container container;
+        container.key = key;
+        m_containers.append(container);
+    }
+    Container &container = m_containers.last();
+    if (container.isBitmap()) {
+        quint64 &word = container.words[low >> 6];
+        const quint64 bit = quint64(1) << (low & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            container.cardinality++;
+        }
+        return;
+    }
+    if (!container.values.isEmpty() && container.values.last() == low) {
+        return;
+    }
+    container.values.append(low);
+    if (++container.cardinality > ArrayLimit) {
+        container.toBitmap();
+    }
+}
+
+bool FlowBitmap::contains(int row) const
+{
+    const quint16 key = static_cast<quint16>(row >> 16);
+    const auto it = std::lower_bound(m_containers.constBegin(), m_containers.constEnd(), key,
+                                     [](const Container &container, quint16 k) { return container.key < k; });
+    return it != m_containers.constEnd() && it->key == key && it->contains(static_cast<quint16>(row & 0xffff));
+}
+
+int FlowBitmap::cardinality() const
+{
+    int count = 0;
+    for (const Container &container : m_containers) {
+        count += container.cardinality;
+    }
+    return count;
+}
+
+FlowBitmap::Container FlowBitmap::intersect(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+    if (a.isBitmap() && b.isBitmap()) {
+        result.words.resize(kContainerWords);
+        for (int w = 0; w < kContainerWords; ++w) {
+            result.words[w] = a.words[w] & b.words[w];
+        }
+        result.cardinality = countBits(result.words);
+        result.shrink();
+        return result;
+    }
+    if (a.isBitmap() || b.isBitmap()) {
+        const Container &array = a.isBitmap() ? b : a;
+        const Container &bitmap = a.isBitmap() ? a : b;
+        for (quint16 low : array.values) {
+            if (bitmap.contains(low)) {
+                result.values.append(low);
+            }
+        }
+    } else {
+        std::set_intersection(a.values.constBegin(), a.values.constEnd(),
+                              b.values.constBegin(), b.values.constEnd(), std::back_inserter(result.values));
+    }
+    result.cardinality = result.values.size();
+    return result;
+}
+
+FlowBitmap::Container FlowBitmap::unite(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+    if (a.isBitmap() && b.isBitmap()) {
+        result.words.resize(kContainerWords);
+        for (int w = 0; w < kContainerWords; ++w) {
+            result.words[w] = a.words[w] | b.words[w];
+        }
+        result.cardinality = countBits(result.words);
+        return result;
+    }
+    if (a.isBitmap() || b.isBitmap()) {
+        const Container &array = a.isBitmap() ? b : a;
+        result = a.isBitmap() ? a : b;
+        for (quint16 low : array.values) {
+            quint64 &word = result.words[low >> 6];
+            const quint64 bit = quint64(1) << (low & 63);
+            if (!(word & bit)) {
+                word |= bit;
+                result.cardinality++;
+            }
+        }
+        return result;
+    }
+    std::set_union(a.values.constBegin(), a.values.constEnd(),
+                   b.values.constBegin(), b.values.constEnd(), std::back_inserter(result.values));
+    result.cardinality = result.values.size();
+    if (result.cardinality > ArrayLimit) {
+        result.toBitmap();
+    }
+    return result;
+}
+
+FlowBitmap::Container FlowBitmap::subtract(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+    if (!a.isBitmap()) {
+        for (quint16 low : a.values) {
+            if (!b.contains(low)) {
+                result.values.append(low);
+            }
+        }
+        result.cardinality = result.values.size();
+        return result;
+    }
+    if (b.isBitmap()) {
+        result.words.resize(kContainerWords);
+        for (int w = 0; w < kContainerWords; ++w) {
+            result.words[w] = a.words[w] & ~b.words[w];
+        }
+        result.cardinality = countBits(result.words);
+    } else {
+        result = a;
+        for (quint16 low : b.values) {
+            quint64 &word = result.words[low >> 6];
+            const quint64 bit = quint64(1) << (low & 63);
+            if (word & bit) {
+                word &= ~bit;
+                result.cardinality--;
+            }
+        }
+    }
+    result.shrink();
+    return result;
+}
+
+FlowBitmap FlowBitmap::operator&(const FlowBitmap &other) const
+{
+    FlowBitmap result;
+    int i = 0;
+    int j = 0;
+    while (i < m_containers.size() && j < other.m_containers.size()) {
+        const Container &a = m_containers[i];
+        const Container &b = other.m_containers[j];
+        if (a.key < b.key) {
+            ++i;
+        } else if (b.key < a.key) {
+            ++j;
+        } else {
+            Container container = intersect(a, b);
+            if (container.cardinality > 0) {
+                result.m_containers.append(container);
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+FlowBitmap FlowBitmap::operator|(const FlowBitmap &other) const
+{
+    FlowBitmap result;
+    int i = 0;
+    int j = 0;
+    while (i < m_containers.size() || j < other.m_containers.size()) {
+        if (j == other.m_containers.size()
+            || (i < m_containers.size() && m_containers[i].key < other.m_containers[j].key)) {
+            result.m_containers.append(m_containers[i++]);
+        } else if (i == m_containers.size() || other.m_containers[j].key < m_containers[i].key) {
+            result.m_containers.append(other.m_containers[j++]);
+        } else {
+            result.m_containers.append(unite(m_containers[i++], other.m_containers[j++]));
+        }
+    }
+    return result;
+}
+
+FlowBitmap FlowBitmap::andNot(const FlowBitmap &other) const
+{
+    FlowBitmap result;
+    int j = 0;
+    for (const Container &a : m_containers) {
+        while (j < other.m_containers.size() && other.m_containers[j].key < a.key) {
+            ++j;
+        }
+        if (j == other.m_containers.size() || other.m_containers[j].key != a.key) {
+            result.m_containers.append(a);
+            continue;
+        }
+        Container container = subtract(a, other.m_containers[j]);
+        if (container.cardinality > 0) {
+            result.m_containers.append(container);
+        }
+    }
+    return result;
+}
+
+FlowBitmap FlowBitmap::complement(int rowCount) const
+{
+    return range(0, rowCount).andNot(*this);
+}
+
+QVector<int> FlowBitmap::toRows() const
+{
+    QVector<int> rows;
+    rows.reserve(cardinality());
+    forEach([&rows](int row) {
+        rows.append(row);
+    });
+    return rows;
+}
+
+qint64 FlowBitmap::memoryUsage() const
+{
+    qint64 bytes = qint64(m_containers.size()) * sizeof(Container);
+    for (const Container &container : m_containers) {
+        bytes += qint64(container.values.size()) * sizeof(quint16) + qint64(container.words.size()) * sizeof(quint64);
+    }
+    return bytes;
+}
+
+void FlowBitmapIndex::build(const FlowStore &store)
+{
+    QElapsedTimer timer;
+    timer.start();
+    clear();
+    m_rowCount = store.size();
+
+    const QVector<qint32> &stationIds = store.stationIds();
+    const QVector<qint32> &days = store.dayNumbers();
+    const QVector<qint16> &departures = store.departureMinutes();
+    const QVector<FlowStore::DictId> &trainIds = store.trainIds();
+    const QVector<FlowStore::DictId> &ticketTypeIds = store.ticketTypeIds();
+    m_trains.resize(store.trainCodes().size());
+    m_ticketTypes.resize(store.ticketTypes().size());
+
+    // 行号递增地加入各位图；相邻行常属同一站点，哈希查找只在站点变化时进行
+    FlowBitmap *station = nullptr;
+    int lastStationId = 0;
+    for (int row = 0; row < m_rowCount; ++row) {
+        if (!station || stationIds[row] != lastStationId) {
+            lastStationId = stationIds[row];
+            station = &m_stations[lastStationId];
+        }
+        station->add(row);
+        m_trains[trainIds[row]].add(row);
+        m_ticketTypes[ticketTypeIds[row]].add(row);
+        m_weekdays[days[row] % 7].add(row);   // 儒略日0是星期一
+        const int hour = departures[row] >= 0 ? departures[row] / 60 : -1;
+        if ((hour >= 7 && hour <= 9) || (hour >= 17 && hour <= 19)) {
+            m_peakHour.add(row);
+        }
+    }
+
+    qDebug() << "客流位图索引建立完成：" << m_rowCount << "行，" << m_stations.size() << "个站点，"
+             << m_trains.size() << "个车次，" << m_ticketTypes.size() << "种票种，占用"
+             << memoryUsage() / 1024 << "KB，用时" << timer.elapsed() << "ms";
+}
+
+void FlowBitmapIndex::clear()
+{
+    m_rowCount = 0;
+    m_stations.clear();
+    m_trains.clear();
+    m_ticketTypes.clear();
+    for (FlowBitmap &bitmap : m_weekdays) {
+        bitmap.clear();
+    }
+    m_peakHour.clear();
+}
+
+const FlowBitmap &FlowBitmapIndex::station(int stationId) const
+{
+    const auto it = m_stations.constFind(stationId);
+    return it != m_stations.constEnd() ? it.value() : m_empty;
+}
+
+const FlowBitmap &FlowBitmapIndex::train(int trainId) const
+{
+    return trainId >= 0 && trainId < m_trains.size() ? m_trains[trainId] : m_empty;
+}
+
+const FlowBitmap &FlowBitmapIndex::ticketType(int ticketTypeId) const
+{
+    return ticketTypeId >= 0 && ticketTypeId < m_ticketTypes.size() ? m_ticketTypes[ticketTypeId] : m_empty;
+}
+
+const FlowBitmap &FlowBitmapIndex::weekday(int dayOfWeek) const
+{
+    return dayOfWeek >= 1 && dayOfWeek <= 7 ? m_weekdays[dayOfWeek - 1] : m_empty;
+}
+
+FlowBitmap FlowBitmapIndex::days(const FlowStore &store, int startDay, int endDay) const
+{
+    int beginRow = 0;
+    int endRow = 0;
+    if (store.dayRows(startDay, endDay, &beginRow, &endRow)) {
+        return FlowBitmap::range(beginRow, endRow);
+    }
+    FlowBitmap bitmap;
+    const QVector<qint32> &dayNumbers = store.dayNumbers();
+    for (int row = 0; row < dayNumbers.size(); ++row) {
+        if (dayNumbers[row] >= startDay && dayNumbers[row] <= endDay) {
+            bitmap.add(row);
+        }
+    }
+    return bitmap;
+}
+
+FlowBitmap FlowBitmapIndex::stations(const QVector<int> &stationIds) const
+{
+    FlowBitmap bitmap;
+    for (int stationId : stationIds) {
+        bitmap |= station(stationId);
+    }
+    return bitmap;
+}
+
+qint64 FlowBitmapIndex::memoryUsage() const
+{
+    qint64 bytes = m_peakHour.memoryUsage();
+    for (const FlowBitmap &bitmap : m_stations) {
+        bytes += bitmap.memoryUsage();
+    }
+    for (const FlowBitmap &bitmap : m_trains) {
+        bytes += bitmap.memoryUsage();
+    }
+    for (const FlowBitmap &bitmap : m_ticketTypes) {
+        bytes += bitmap.memoryUsage();
+    }
+    for (const FlowBitmap &bitmap : m_weekdays) {
+        bytes += bitmap.memoryUsage();
+    }
+    return bytes;
+}
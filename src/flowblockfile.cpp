@@ -0,0 +1,360 @@
+#include "flowblockfile.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const qint64 kColumnAlignment = 64;
+
+struct FileHeader {
+    quint32 magic;
+    quint32 version;
+    quint64 directoryOffset;
+    quint64 directorySize;
+    quint64 directoryChecksum;
+};
+
+qint64 alignUp(qint64 value)
+{
+    return (value + kColumnAlignment - 1) / kColumnAlignment * kColumnAlignment;
+}
+
+// FNV-1a，只用于检查目录是否损坏
+quint64 checksum(const char *data, qint64 size)
+{
+    quint64 hash = 14695981039346656037ULL;
+    for (qint64 i = 0; i < size; ++i) {
+        hash ^= static_cast<uchar>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+bool writePadding(QSaveFile &file, qint64 &position)
+{
+    static const char zeros[kColumnAlignment] = {};
+    const qint64 padding = alignUp(position) - position;
+    if (padding > 0 && file.write(zeros, padding) != padding) {
+        return false;
+    }
+    position += padding;
+    return true;
+}
+
+void writeDictionary(QDataStream &out, const StringDictionary &dictionary)
+{
+    out << static_cast<qint32>(dictionary.size());
+    for (const QString &value : dictionary.values()) {
+        out << value;
+    }
+}
+
+bool readDictionary(QDataStream &in, StringDictionary &dictionary)
+{
+    qint32 count = 0;
+    in >> count;
+    if (count < 0 || count > 0x10000) {
+        return false;
+    }
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString value;
+        in >> value;
+        dictionary.insert(value);
+    }
+    return in.status() == QDataStream::Ok && dictionary.size() == count;
+}
+
+} // namespace
+
+template<typename Store, typename Visitor>
+bool FlowBlockFile::forEachColumn(Store &store, Visitor visit)
+{
+    return visit(store.m_stationId)
+        && visit(store.m_dayNumber)
+        && visit(store.m_arrivalMinute)
+        && visit(store.m_departureMinute)
+        && visit(store.m_boarding)
+        && visit(store.m_alighting)
+        && visit(store.m_ticketPrice)
+        && visit(store.m_revenue)
+        && visit(store.m_lineId)
+        && visit(store.m_trainId)
+        && visit(store.m_ticketTypeId)
+        && visit(store.m_startStationId)
+        && visit(store.m_endStationId);
+}
+
+QString FlowBlockFile::defaultPath(const QString &dataDirectory)
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheDir.isEmpty()) {
+        cacheDir = QDir::tempPath();
+    }
+
+    const QByteArray key = QCryptographicHash::hash(QDir(dataDirectory).absolutePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex().left(16);
+    return QDir(cacheDir).filePath(QString("blocks/%1.blocks").arg(QString::fromLatin1(key)));
+}
+
+bool FlowBlockFile::Writer::open(const QString &path, const QVector<FlowSnapshot::SourceFile> &sources,
+                                 QString *error)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        setError(error, QString("无法创建块文件: %1\n错误: %2").arg(path).arg(m_file.errorString()));
+        return false;
+    }
+    m_sources = sources;
+    m_pending.clear();
+    m_blocks.clear();
+    m_rowCount = 0;
+
+    // 文件头最后再回写，先占位
+    const FileHeader header = {};
+    m_position = sizeof(header);
+    if (m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != qint64(sizeof(header))
+        || !writePadding(m_file, m_position)) {
+        setError(error, QString("写入块文件失败: %1").arg(m_file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool FlowBlockFile::Writer::append(const FlowStore &flows, QString *error)
+{
+    // 块文件按列直接写出，冷列要先解码；合并进待写存储时字典编号映射到全文件的字典
+    flows.materializeColdColumns();
+    if (flows.hasColdColumnsError()) {
+        setError(error, QString("客流冷列不可用，无法写入块文件: %1").arg(flows.coldColumnsError()));
+        return false;
+    }
+    if (!m_pending.append(flows, error)) {
+        return false;
+    }
+
+    int written = 0;
+    while (m_pending.size() - written >= BlockRows) {
+        if (!writeBlock(written, BlockRows)) {
+            setError(error, QString("写入块文件失败: %1").arg(m_file.errorString()));
+            return false;
+        }
+        written += BlockRows;
+    }
+
+    // 写出的行一次性从前面移除，剩下不满一块的行
+    if (written > 0) {
+        forEachColumn(m_pending, [written](auto &column) {
+            column.remove(0, written);
+            return true;
+        });
+    }
+    return true;
+}
+
+bool FlowBlockFile::Writer::writeBlock(int firstRow, int rows)
+{
+    Block block;
+    block.offset = m_position;
+    block.rows = rows;
+    const QVector<qint32> &days = m_pending.dayNumbers();
+    const auto range = std::minmax_element(days.constBegin() + firstRow, days.constBegin() + firstRow + rows);
+    block.firstDay = *range.first;
+    block.lastDay = *range.second;
+
+    const bool ok = forEachColumn(m_pending, [this, firstRow, rows](const auto &column) {
+        const qint64 bytes = rows * qint64(sizeof(column[0]));
+        if (m_file.write(reinterpret_cast<const char*>(column.constData() + firstRow), bytes) != bytes) {
+            return false;
+        }
+        m_position += bytes;
+        return writePadding(m_file, m_position);
+    });
+    block.bytes = m_position - block.offset;
+    m_blocks.append(block);
+    m_rowCount += rows;
+    return ok;
+}
+
+bool FlowBlockFile::Writer::finish(QString *error)
+{
+    if (!m_pending.isEmpty() && !writeBlock(0, m_pending.size())) {
+        setError(error, QString("写入块文件失败: %1").arg(m_file.errorString()));
+        return false;
+    }
+
+    QByteArray directory;
+    {
+        QDataStream out(&directory, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+
+        out << static_cast<qint32>(m_sources.size());
+        for (const FlowSnapshot::SourceFile &source : m_sources) {
+            out << source.fileName << source.size << source.modified << source.sampleHash;
+        }
+
+        writeDictionary(out, m_pending.lineCodes());
+        writeDictionary(out, m_pending.trainCodes());
+        writeDictionary(out, m_pending.ticketTypes());
+        writeDictionary(out, m_pending.stationNames());
+
+        out << static_cast<qint32>(m_blocks.size());
+        for (const Block &block : m_blocks) {
+            out << block.offset << block.bytes << static_cast<qint32>(block.rows)
+                << static_cast<qint32>(block.firstDay) << static_cast<qint32>(block.lastDay);
+        }
+    }
+
+    FileHeader header;
+    header.magic = Magic;
+    header.version = Version;
+    header.directoryOffset = m_position;
+    header.directorySize = directory.size();
+    header.directoryChecksum = checksum(directory.constData(), directory.size());
+
+    const bool ok = m_file.write(directory) == directory.size()
+                 && m_file.seek(0)
+                 && m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header));
+    m_pending.clear();
+    if (!ok || !m_file.commit()) {
+        setError(error, QString("写入块文件失败: %1\n错误: %2").arg(m_file.fileName()).arg(m_file.errorString()));
+        return false;
+    }
+    qDebug() << "块文件写入完成：" << m_rowCount << "条客流记录，" << m_blocks.size() << "块";
+    return true;
+}
+
+bool FlowBlockFile::open(const QString &path, const QVector<FlowSnapshot::SourceFile> &sources, QString *error)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.exists()) {
+        setError(error, QString("块文件不存在: %1").arg(path));
+        return false;
+    }
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        setError(error, QString("无法打开块文件: %1\n错误: %2").arg(path).arg(m_file.errorString()));
+        return false;
+    }
+
+    FileHeader header;
+    const qint64 fileSize = m_file.size();
+    if (m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header))
+        || header.magic != Magic || header.version != Version
+        || header.directoryOffset + header.directorySize > quint64(fileSize)) {
+        setError(error, "块文件版本不符或已损坏，需要重新生成");
+        close();
+        return false;
+    }
+
+    m_file.seek(header.directoryOffset);
+    const QByteArray directory = m_file.read(header.directorySize);
+    if (directory.size() != qint64(header.directorySize)
+        || checksum(directory.constData(), directory.size()) != header.directoryChecksum) {
+        setError(error, "块文件已损坏：目录校验失败");
+        close();
+        return false;
+    }
+
+    QDataStream in(directory);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    qint32 sourceCount = 0;
+    in >> sourceCount;
+    bool fresh = sourceCount == sources.size();
+    for (qint32 i = 0; fresh && i < sourceCount && in.status() == QDataStream::Ok; ++i) {
+        FlowSnapshot::SourceFile source;
+        in >> source.fileName >> source.size >> source.modified >> source.sampleHash;
+        fresh = source == sources[i];
+    }
+    if (!fresh) {
+        setError(error, "块文件已过期：源CSV文件已变化");
+        close();
+        return false;
+    }
+
+    bool ok = readDictionary(in, m_dictionaries.m_lineCodes)
+           && readDictionary(in, m_dictionaries.m_trainCodes)
+           && readDictionary(in, m_dictionaries.m_ticketTypes)
+           && readDictionary(in, m_dictionaries.m_stationNames);
+    qint32 blockCount = 0;
+    in >> blockCount;
+    ok = ok && blockCount >= 0;
+    for (qint32 i = 0; ok && i < blockCount; ++i) {
+        Block block;
+        qint32 rows = 0;
+        qint32 firstDay = 0;
+        qint32 lastDay = 0;
+        in >> block.offset >> block.bytes >> rows >> firstDay >> lastDay;
+        block.rows = rows;
+        block.firstDay = firstDay;
+        block.lastDay = lastDay;
+        ok = in.status() == QDataStream::Ok && rows > 0 && rows <= BlockRows
+          && block.offset + block.bytes <= qint64(header.directoryOffset);
+        m_blocks.append(block);
+        m_rowCount += rows;
+    }
+    if (!ok || in.status() != QDataStream::Ok) {
+        setError(error, "块文件已损坏：目录无法解析");
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FlowBlockFile::close()
+{
+    m_file.close();
+    m_blocks.clear();
+    m_rowCount = 0;
+    m_dictionaries.clear();
+}
+
+bool FlowBlockFile::readBlock(int index, FlowStore &block, QString *error) const
+{
+    const Block &entry = m_blocks[index];
+    if (!m_file.seek(entry.offset)) {
+        setError(error, QString("读取块文件失败: %1").arg(m_file.errorString()));
+        return false;
+    }
+
+    FlowStore loaded;
+    qint64 position = entry.offset;
+    const bool ok = forEachColumn(loaded, [this, &entry, &position](auto &column) {
+        const qint64 bytes = entry.rows * qint64(sizeof(column[0]));
+        column.resize(entry.rows);
+        if (m_file.read(reinterpret_cast<char*>(column.data()), bytes) != bytes) {
+            return false;
+        }
+        position += bytes;
+        const qint64 aligned = alignUp(position);
+        if (aligned != position && !m_file.seek(aligned)) {
+            return false;
+        }
+        position = aligned;
+        return true;
+    });
+    if (!ok) {
+        setError(error, QString("读取块文件失败：第%1块不完整").arg(index));
+        return false;
+    }
+
+    loaded.m_lineCodes = m_dictionaries.m_lineCodes;
+    loaded.m_trainCodes = m_dictionaries.m_trainCodes;
+    loaded.m_ticketTypes = m_dictionaries.m_ticketTypes;
+    loaded.m_stationNames = m_dictionaries.m_stationNames;
+    block = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,65 @@
+#include "flowblockpool.h"
+
+bool FlowBlockPool::open(const QString &path, const QVector<FlowSnapshot::SourceFile> &sources, QString *error)
+{
+    close();
+    return m_file.open(path, sources, error);
+}
+
+void FlowBlockPool::close()
+{
+    m_entries.clear();
+    m_residentBytes = 0;
+    m_hits = 0;
+    m_misses = 0;
+    m_file.close();
+}
+
+void FlowBlockPool::setBudget(qint64 bytes)
+{
+    m_budget = bytes;
+    evict(0);
+}
+
+QSharedPointer<const FlowStore> FlowBlockPool::block(int index, QString *error)
+{
+    auto it = m_entries.find(index);
+    if (it != m_entries.end()) {
+        ++m_hits;
+        it->lastUsed = ++m_clock;
+        return it->store;
+    }
+
+    ++m_misses;
+    const qint64 bytes = m_file.block(index).bytes;
+    // 先腾出空间再读入，池中的块加上新块不超过预算
+    evict(bytes);
+
+    QSharedPointer<FlowStore> store(new FlowStore);
+    if (!m_file.readBlock(index, *store, error)) {
+        return QSharedPointer<const FlowStore>();
+    }
+
+    Entry entry;
+    entry.store = store;
+    entry.bytes = bytes;
+    entry.lastUsed = ++m_clock;
+    m_entries.insert(index, entry);
+    m_residentBytes += bytes;
+    return store;
+}
+
+void FlowBlockPool::evict(qint64 incomingBytes)
+{
+    // 常驻的块数是预算除以块大小，几十到几百个，线性查找最久未用的即可
+    while (!m_entries.isEmpty() && m_residentBytes + incomingBytes > m_budget) {
+        auto victim = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->lastUsed < victim->lastUsed) {
+                victim = it;
+            }
+        }
+        m_residentBytes -= victim->bytes;
+        m_entries.erase(victim);
+    }
+}
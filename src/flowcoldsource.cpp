@@ -0,0 +1,181 @@
+#include "flowcoldsource.h"
+#include "csvtokenizer.h"
+#include "datetimeparser.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+
+// 每个解码任务的行数
+const int kDecodeSegmentRows = 256 * 1024;
+
+// 一个解码任务：先用局部字典编号，合并时映射到全局字典
+struct DecodeSegment {
+    int begin = 0;
+    int end = 0;
+    StringDictionary lineCodes;
+    StringDictionary stationNames;
+    bool ok = true;
+    int mismatchRow = -1;   // 第一个与热列对不上的行
+    bool overflow = false;  // 段内的字典已超出编号范围
+};
+
+void remapIds(QVector<FlowStore::DictId> &ids, int begin, int end, const QVector<FlowStore::DictId> &remap)
+{
+    for (int row = begin; row < end; ++row) {
+        ids[row] = remap[ids[row]];
+    }
+}
+
+// 调用方在合并后检查target是否超出编号范围，超出时整个解码失败，映射结果不再使用
+QVector<FlowStore::DictId> mergeDictionary(StringDictionary &target, const StringDictionary &source)
+{
+    QVector<FlowStore::DictId> remap;
+    remap.reserve(source.size());
+    for (const QString &value : source.values()) {
+        remap.append(static_cast<FlowStore::DictId>(target.insert(value)));
+    }
+    return remap;
+}
+
+} // namespace
+
+FlowColdSource::FlowColdSource(const QString &path, int stationColumn, int dateColumn,
+                               DateTimeParser::DateFormat dateFormat, int lineColumn, int arrivalColumn,
+                               int ticketPriceColumn, int startStationColumn, int endStationColumn, int fieldCount)
+    : m_path(path)
+    , m_fileSize(QFileInfo(path).size())
+    , m_modified(QFileInfo(path).lastModified().toMSecsSinceEpoch())
+    , m_stationColumn(stationColumn)
+    , m_dateColumn(dateColumn)
+    , m_dateFormat(dateFormat)
+    , m_lineColumn(lineColumn)
+    , m_arrivalColumn(arrivalColumn)
+    , m_ticketPriceColumn(ticketPriceColumn)
+    , m_startStationColumn(startStationColumn)
+    , m_endStationColumn(endStationColumn)
+    , m_fieldCount(fieldCount)
+{
+}
+
+bool FlowColdSource::decode(const QVector<qint64> &offsets, const QVector<qint32> &stationIds,
+                            const QVector<qint32> &dayNumbers, Columns &columns, QString *error) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("无法打开客流文件: %1\n错误: %2").arg(m_path).arg(file.errorString());
+        return false;
+    }
+    const qint64 fileSize = file.size();
+    const qint64 modified = QFileInfo(m_path).lastModified().toMSecsSinceEpoch();
+    if (fileSize < m_fileSize || (fileSize == m_fileSize && modified != m_modified)) {
+        *error = QString("客流文件在加载后被截断或改写，无法按行偏移读取: %1").arg(m_path);
+        return false;
+    }
+    QByteArray buffer;
+    const char *data = fileSize > 0 ? reinterpret_cast<const char*>(file.map(0, fileSize)) : nullptr;
+    if (!data) {
+        buffer = file.readAll();
+        data = buffer.constData();
+    }
+    const char *end = data + fileSize;
+
+    const int rows = offsets.size();
+    columns.lineIds.resize(rows);
+    columns.arrivalMinutes.resize(rows);
+    columns.ticketPrices.resize(rows);
+    columns.startStationIds.resize(rows);
+    columns.endStationIds.resize(rows);
+
+    QVector<DecodeSegment> segments;
+    for (int begin = 0; begin < rows; begin += kDecodeSegmentRows) {
+        DecodeSegment segment;
+        segment.begin = begin;
+        segment.end = qMin(rows, begin + kDecodeSegmentRows);
+        segments.append(segment);
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+    for (int i = 0; i < segments.size(); ++i) {
+        pool.start([this, &offsets, &stationIds, &dayNumbers, &columns, &segments, data, end, fileSize, i]() {
+            DecodeSegment &segment = segments[i];
+            CsvTokenizer::Fields fields;
+            for (int row = segment.begin; row < segment.end; ++row) {
+                const qint64 offset = offsets[row];
+                if (offset < 0 || offset >= fileSize) {
+                    segment.ok = false;
+                    return;
+                }
+                CsvTokenizer tokenizer(data + offset, end);
+                if (tokenizer.nextRow(fields, m_fieldCount) < m_fieldCount) {
+                    segment.ok = false;
+                    return;
+                }
+                if (CsvTokenizer::toInt(fields[m_stationColumn]) != stationIds[row]
+                    || DateTimeParser::parseDay(fields[m_dateColumn], m_dateFormat) != dayNumbers[row]) {
+                    segment.ok = false;
+                    segment.mismatchRow = row;
+                    return;
+                }
+                columns.lineIds[row] = static_cast<FlowStore::DictId>(segment.lineCodes.insert(fields[m_lineColumn]));
+                columns.arrivalMinutes[row] = static_cast<qint16>(DateTimeParser::parseMinute(fields[m_arrivalColumn]));
+                columns.ticketPrices[row] = CsvTokenizer::toDouble(fields[m_ticketPriceColumn]);
+                columns.startStationIds[row] = static_cast<FlowStore::DictId>(
+                    segment.stationNames.insert(fields[m_startStationColumn]));
+                columns.endStationIds[row] = static_cast<FlowStore::DictId>(
+                    segment.stationNames.insert(fields[m_endStationColumn]));
+                if (segment.lineCodes.size() > FlowStore::MaxDictionarySize
+                    || segment.stationNames.size() > FlowStore::MaxDictionarySize) {
+                    segment.ok = false;
+                    segment.overflow = true;
+                    return;
+                }
+            }
+        });
+    }
+    pool.waitForDone();
+
+    for (const DecodeSegment &segment : segments) {
+        if (segment.overflow) {
+            *error = FlowStore::dictionaryOverflowError(segment.lineCodes.size() > FlowStore::MaxDictionarySize
+                                                        ? "线路" : "起止站");
+            return false;
+        }
+        if (segment.mismatchRow >= 0) {
+            *error = QString("客流文件已变化：偏移%1处的行与加载时的站点或日期不符，无法按行偏移读取: %2")
+                         .arg(offsets[segment.mismatchRow]).arg(m_path);
+            return false;
+        }
+        if (!segment.ok) {
+            *error = QString("客流文件已变化，无法按行偏移读取: %1").arg(m_path);
+            return false;
+        }
+    }
+
+    // 按段的顺序合并字典，编号与逐行解析时首次出现的顺序一致
+    for (const DecodeSegment &segment : segments) {
+        const QVector<FlowStore::DictId> lineRemap = mergeDictionary(columns.lineCodes, segment.lineCodes);
+        const QVector<FlowStore::DictId> stationRemap = mergeDictionary(columns.stationNames, segment.stationNames);
+        if (columns.lineCodes.size() > FlowStore::MaxDictionarySize
+            || columns.stationNames.size() > FlowStore::MaxDictionarySize) {
+            *error = FlowStore::dictionaryOverflowError(columns.lineCodes.size() > FlowStore::MaxDictionarySize
+                                                        ? "线路" : "起止站");
+            return false;
+        }
+        remapIds(columns.lineIds, segment.begin, segment.end, lineRemap);
+        remapIds(columns.startStationIds, segment.begin, segment.end, stationRemap);
+        remapIds(columns.endStationIds, segment.begin, segment.end, stationRemap);
+    }
+
+    qDebug() << "按需解码客流冷列" << rows << "行，用时" << timer.elapsed() << "ms";
+    return true;
+}
@@ -0,0 +1,698 @@
+#include "flowcolumnfile.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+const qint64 kColumnAlignment = 64;
+const int kHeaderSize = 32;
+const int kDictionaryCount = 4;
+const int kDayColumn = 3;
+
+enum DictionaryKind { LineDictionary, TrainDictionary, TicketTypeDictionary, StationNameDictionary };
+
+// 文件中的列顺序与客流CSV一致；名称取表头的拼音缩写
+struct ColumnInfo {
+    const char *name;
+    FlowColumnFile::ColumnType type;
+    int dictionary;
+};
+
+const ColumnInfo kColumns[] = {
+    { "yyxlbm", FlowColumnFile::DictionaryColumn, LineDictionary },
+    { "lcbm", FlowColumnFile::DictionaryColumn, TrainDictionary },
+    { "zdid", FlowColumnFile::Int32Column, -1 },
+    { "yxrq", FlowColumnFile::Int32Column, -1 },          // 儒略日
+    { "ddsj", FlowColumnFile::Int16Column, -1 },          // 一天中的分钟数，-1表示无效
+    { "cfsj", FlowColumnFile::Int16Column, -1 },
+    { "skl", FlowColumnFile::Int32Column, -1 },
+    { "xkl", FlowColumnFile::Int32Column, -1 },
+    { "ticket_type", FlowColumnFile::DictionaryColumn, TicketTypeDictionary },
+    { "ticket_price", FlowColumnFile::Float64Column, -1 },
+    { "sfz", FlowColumnFile::DictionaryColumn, StationNameDictionary },
+    { "zdz", FlowColumnFile::DictionaryColumn, StationNameDictionary },
+    { "shouru", FlowColumnFile::Float64Column, -1 },
+};
+const int kColumnCount = sizeof(kColumns) / sizeof(kColumns[0]);
+
+struct EncodedColumn {
+    FlowColumnFile::ColumnChunk chunk;
+    QByteArray data;
+};
+
+qint64 alignUp(qint64 value)
+{
+    return (value + kColumnAlignment - 1) / kColumnAlignment * kColumnAlignment;
+}
+
+// FNV-1a，只用于检查尾部是否损坏
+quint64 checksum(const char *data, qint64 size)
+{
+    quint64 hash = 14695981039346656037ULL;
+    for (qint64 i = 0; i < size; ++i) {
+        hash ^= static_cast<uchar>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+int bitWidth(quint64 value)
+{
+    int width = 0;
+    while (value) {
+        ++width;
+        value >>= 1;
+    }
+    return width;
+}
+
+inline quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+inline qint64 unzigzag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+qint64 packedBytes(int rows, int width)
+{
+    return (qint64(rows) * width + 63) / 64 * 8;
+}
+
+// 把rows个width位的值按低位在前紧密排列，value(i)给出第i个值
+template<typename Value>
+QByteArray packBits(int rows, int width, Value value)
+{
+    QByteArray packed(packedBytes(rows, width), '\0');
+    if (width == 0) {
+        return packed;
+    }
+    uchar *out = reinterpret_cast<uchar*>(packed.data());
+    quint64 word = 0;
+    int filled = 0;
+    for (int i = 0; i < rows; ++i) {
+        const quint64 bits = value(i);
+        word |= bits << filled;
+        filled += width;
+        if (filled >= 64) {
+            qToLittleEndian(word, out);
+            out += 8;
+            filled -= 64;
+            word = filled > 0 ? bits >> (width - filled) : 0;
+        }
+    }
+    if (filled > 0) {
+        qToLittleEndian(word, out);
+    }
+    return packed;
+}
+
+// packBits的逆过程，按顺序把第i个值交给store(i, value)
+template<typename Store>
+void unpackBits(const uchar *data, int rows, int width, Store store)
+{
+    if (width == 0) {
+        for (int i = 0; i < rows; ++i) {
+            store(i, 0);
+        }
+        return;
+    }
+    const quint64 mask = width == 64 ? ~quint64(0) : (quint64(1) << width) - 1;
+    qint64 bit = 0;
+    for (int i = 0; i < rows; ++i, bit += width) {
+        const qint64 word = bit >> 6;
+        const int shift = static_cast<int>(bit & 63);
+        quint64 bits = qFromLittleEndian<quint64>(data + word * 8) >> shift;
+        if (shift + width > 64) {
+            bits |= qFromLittleEndian<quint64>(data + (word + 1) * 8) << (64 - shift);
+        }
+        store(i, bits & mask);
+    }
+}
+
+// 整数列：BitPacked和Delta取位宽较小的一种
+template<typename T>
+EncodedColumn encodeIntegers(const T *values, int rows)
+{
+    qint64 minValue = values[0];
+    qint64 maxValue = values[0];
+    quint64 maxDelta = 0;
+    for (int i = 1; i < rows; ++i) {
+        minValue = qMin<qint64>(minValue, values[i]);
+        maxValue = qMax<qint64>(maxValue, values[i]);
+        maxDelta = qMax(maxDelta, zigzag(qint64(values[i]) - values[i - 1]));
+    }
+
+    EncodedColumn column;
+    FlowColumnFile::ColumnChunk &chunk = column.chunk;
+    chunk.minValue = minValue;
+    chunk.maxValue = maxValue;
+    const int packedWidth = bitWidth(quint64(maxValue - minValue));
+    const int deltaWidth = bitWidth(maxDelta);
+    if (deltaWidth < packedWidth) {
+        chunk.encoding = FlowColumnFile::Delta;
+        chunk.bitWidth = deltaWidth;
+        chunk.base = values[0];
+        column.data = packBits(rows, deltaWidth, [values](int i) {
+            return i > 0 ? zigzag(qint64(values[i]) - values[i - 1]) : quint64(0);
+        });
+    } else {
+        chunk.encoding = FlowColumnFile::BitPacked;
+        chunk.bitWidth = packedWidth;
+        chunk.base = minValue;
+        column.data = packBits(rows, packedWidth, [values, minValue](int i) {
+            return quint64(qint64(values[i]) - minValue);
+        });
+    }
+    return column;
+}
+
+EncodedColumn encodeColumn(const qint16 *values, int rows, const QVector<FlowStore::DictId> &)
+{
+    return encodeIntegers(values, rows);
+}
+
+EncodedColumn encodeColumn(const qint32 *values, int rows, const QVector<FlowStore::DictId> &)
+{
+    return encodeIntegers(values, rows);
+}
+
+EncodedColumn encodeColumn(const double *values, int rows, const QVector<FlowStore::DictId> &)
+{
+    EncodedColumn column;
+    column.chunk.encoding = FlowColumnFile::Plain;
+    column.chunk.minValue = values[0];
+    column.chunk.maxValue = values[0];
+    column.data.resize(qint64(rows) * 8);
+    uchar *out = reinterpret_cast<uchar*>(column.data.data());
+    for (int i = 0; i < rows; ++i) {
+        column.chunk.minValue = qMin(column.chunk.minValue, values[i]);
+        column.chunk.maxValue = qMax(column.chunk.maxValue, values[i]);
+        quint64 bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+        qToLittleEndian(bits, out + qint64(i) * 8);
+    }
+    return column;
+}
+
+// 字典列：编号先映射到全文件的字典，再按本行组最大编号的位宽排列
+EncodedColumn encodeColumn(const FlowStore::DictId *ids, int rows, const QVector<FlowStore::DictId> &remap)
+{
+    FlowStore::DictId minId = remap[ids[0]];
+    FlowStore::DictId maxId = minId;
+    for (int i = 1; i < rows; ++i) {
+        minId = qMin(minId, remap[ids[i]]);
+        maxId = qMax(maxId, remap[ids[i]]);
+    }
+
+    EncodedColumn column;
+    column.chunk.encoding = FlowColumnFile::Dictionary;
+    column.chunk.bitWidth = bitWidth(maxId);
+    column.chunk.minValue = minId;
+    column.chunk.maxValue = maxId;
+    column.data = packBits(rows, column.chunk.bitWidth, [ids, &remap](int i) {
+        return quint64(remap[ids[i]]);
+    });
+    return column;
+}
+
+// 校验和只覆盖尾部，列数据中翻转的位要靠取值范围发现：解出的值超出尾部记录的最小、最大值时解码失败。
+// 字典列的最大编号在打开时已确认小于字典大小，这里保证编号不会越出字典
+template<typename T>
+bool decodeIntegers(const uchar *data, const FlowColumnFile::ColumnChunk &chunk, int rows, T *out)
+{
+    const qint64 minValue = static_cast<qint64>(chunk.minValue);
+    const qint64 maxValue = static_cast<qint64>(chunk.maxValue);
+    bool ok = true;
+    if (chunk.encoding == FlowColumnFile::Delta) {
+        qint64 value = chunk.base;
+        unpackBits(data, rows, chunk.bitWidth, [out, &value, &ok, minValue, maxValue](int i, quint64 bits) {
+            if (i > 0) {
+                value += unzigzag(bits);
+            }
+            ok &= value >= minValue && value <= maxValue;
+            out[i] = static_cast<T>(value);
+        });
+    } else {
+        const qint64 base = chunk.base;
+        unpackBits(data, rows, chunk.bitWidth, [out, base, &ok, minValue, maxValue](int i, quint64 bits) {
+            const qint64 value = base + qint64(bits);
+            ok &= value >= minValue && value <= maxValue;
+            out[i] = static_cast<T>(value);
+        });
+    }
+    return ok;
+}
+
+bool decodeColumn(const uchar *data, const FlowColumnFile::ColumnChunk &chunk, int rows, qint16 *out)
+{
+    return decodeIntegers(data, chunk, rows, out);
+}
+
+bool decodeColumn(const uchar *data, const FlowColumnFile::ColumnChunk &chunk, int rows, qint32 *out)
+{
+    return decodeIntegers(data, chunk, rows, out);
+}
+
+bool decodeColumn(const uchar *data, const FlowColumnFile::ColumnChunk &, int rows, double *out)
+{
+    for (int i = 0; i < rows; ++i) {
+        const quint64 bits = qFromLittleEndian<quint64>(data + qint64(i) * 8);
+        std::memcpy(&out[i], &bits, sizeof(bits));
+    }
+    return true;
+}
+
+bool decodeColumn(const uchar *data, const FlowColumnFile::ColumnChunk &chunk, int rows, FlowStore::DictId *out)
+{
+    const quint64 maxId = static_cast<quint64>(chunk.maxValue);
+    bool ok = true;
+    unpackBits(data, rows, chunk.bitWidth, [out, &ok, maxId](int i, quint64 bits) {
+        ok &= bits <= maxId;
+        out[i] = static_cast<FlowStore::DictId>(bits);
+    });
+    return ok;
+}
+
+// 各编码的数据至少要有这么多字节
+qint64 requiredBytes(const FlowColumnFile::ColumnChunk &chunk, int rows)
+{
+    return chunk.encoding == FlowColumnFile::Plain ? qint64(rows) * 8 : packedBytes(rows, chunk.bitWidth);
+}
+
+bool encodingMatches(FlowColumnFile::ColumnType type, FlowColumnFile::Encoding encoding)
+{
+    switch (type) {
+    case FlowColumnFile::Float64Column: return encoding == FlowColumnFile::Plain;
+    case FlowColumnFile::DictionaryColumn: return encoding == FlowColumnFile::Dictionary;
+    default: return encoding == FlowColumnFile::BitPacked || encoding == FlowColumnFile::Delta;
+    }
+}
+
+void writeDictionary(QDataStream &out, const StringDictionary &dictionary)
+{
+    out << static_cast<qint32>(dictionary.size());
+    for (const QString &value : dictionary.values()) {
+        out << value;
+    }
+}
+
+bool readDictionary(QDataStream &in, StringDictionary &dictionary)
+{
+    qint32 count = 0;
+    in >> count;
+    if (count < 0 || count > 0x10000) {
+        return false;
+    }
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString value;
+        in >> value;
+        dictionary.insert(value);
+    }
+    return in.status() == QDataStream::Ok && dictionary.size() == count;
+}
+
+} // namespace
+
+template<typename Store, typename Visitor>
+bool FlowColumnFile::forEachColumn(Store &store, Visitor visit)
+{
+    return visit(0, store.m_lineId)
+        && visit(1, store.m_trainId)
+        && visit(2, store.m_stationId)
+        && visit(3, store.m_dayNumber)
+        && visit(4, store.m_arrivalMinute)
+        && visit(5, store.m_departureMinute)
+        && visit(6, store.m_boarding)
+        && visit(7, store.m_alighting)
+        && visit(8, store.m_ticketTypeId)
+        && visit(9, store.m_ticketPrice)
+        && visit(10, store.m_startStationId)
+        && visit(11, store.m_endStationId)
+        && visit(12, store.m_revenue);
+}
+
+int FlowColumnFile::RowGroup::firstDay() const
+{
+    return static_cast<int>(columns[kDayColumn].minValue);
+}
+
+int FlowColumnFile::RowGroup::lastDay() const
+{
+    return static_cast<int>(columns[kDayColumn].maxValue);
+}
+
+bool FlowColumnFile::isColumnFile(const QString &path)
+{
+    return path.endsWith(".fcol", Qt::CaseInsensitive);
+}
+
+QStringList FlowColumnFile::columnNames()
+{
+    QStringList names;
+    for (const ColumnInfo &column : kColumns) {
+        names.append(QString::fromLatin1(column.name));
+    }
+    return names;
+}
+
+bool FlowColumnFile::Writer::open(const QString &path, QString *error)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        setError(error, QString("无法创建列式文件: %1\n错误: %2").arg(path).arg(m_file.errorString()));
+        return false;
+    }
+    for (StringDictionary &dictionary : m_dictionaries) {
+        dictionary.clear();
+    }
+    m_rowGroups.clear();
+    m_rowCount = 0;
+
+    // 文件头最后再回写，先占位
+    const QByteArray header(alignUp(kHeaderSize), '\0');
+    m_position = header.size();
+    if (m_file.write(header) != header.size()) {
+        setError(error, QString("写入列式文件失败: %1").arg(m_file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool FlowColumnFile::Writer::append(const FlowStore &flows, QString *error)
+{
+    // 冷列要先解码；各批的字典合并进全文件的字典，写出时编号逐行映射
+    flows.materializeColdColumns();
+    if (flows.hasColdColumnsError()) {
+        setError(error, QString("客流冷列不可用，无法导出列式文件: %1").arg(flows.coldColumnsError()));
+        return false;
+    }
+    const StringDictionary *sources[kDictionaryCount] = {
+        &flows.lineCodes(), &flows.trainCodes(), &flows.ticketTypes(), &flows.stationNames()
+    };
+    for (int kind = 0; kind < kDictionaryCount; ++kind) {
+        m_remaps[kind].clear();
+        for (const QString &value : sources[kind]->values()) {
+            m_remaps[kind].append(static_cast<FlowStore::DictId>(m_dictionaries[kind].insert(value)));
+        }
+        if (m_dictionaries[kind].size() > FlowStore::MaxDictionarySize) {
+            setError(error, QString("列式文件的字典超过%1项，无法导出").arg(FlowStore::MaxDictionarySize));
+            return false;
+        }
+    }
+
+    for (int firstRow = 0; firstRow < flows.size(); firstRow += RowGroupRows) {
+        if (!writeRowGroup(flows, firstRow, qMin(int(RowGroupRows), flows.size() - firstRow))) {
+            setError(error, QString("写入列式文件失败: %1").arg(m_file.errorString()));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FlowColumnFile::Writer::writeRowGroup(const FlowStore &flows, int firstRow, int rows)
+{
+    static const char zeros[kColumnAlignment] = {};
+    static const QVector<FlowStore::DictId> noRemap;
+
+    RowGroup group;
+    group.rows = rows;
+    const bool ok = forEachColumn(flows, [this, &group, firstRow, rows](int index, const auto &column) {
+        const int dictionary = kColumns[index].dictionary;
+        EncodedColumn encoded = encodeColumn(column.constData() + firstRow, rows,
+                                             dictionary >= 0 ? m_remaps[dictionary] : noRemap);
+        encoded.chunk.offset = m_position;
+        encoded.chunk.bytes = encoded.data.size();
+        if (m_file.write(encoded.data) != encoded.data.size()) {
+            return false;
+        }
+        m_position += encoded.data.size();
+
+        const qint64 padding = alignUp(m_position) - m_position;
+        if (padding > 0 && m_file.write(zeros, padding) != padding) {
+            return false;
+        }
+        m_position += padding;
+        group.columns.append(encoded.chunk);
+        return true;
+    });
+    m_rowGroups.append(group);
+    m_rowCount += rows;
+    return ok;
+}
+
+bool FlowColumnFile::Writer::finish(QString *error)
+{
+    QByteArray footer;
+    {
+        QDataStream out(&footer, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out.setByteOrder(QDataStream::LittleEndian);
+
+        out << static_cast<qint32>(kColumnCount);
+        for (const ColumnInfo &column : kColumns) {
+            out << QString::fromLatin1(column.name) << static_cast<quint8>(column.type)
+                << static_cast<qint8>(column.dictionary);
+        }
+        for (const StringDictionary &dictionary : m_dictionaries) {
+            writeDictionary(out, dictionary);
+        }
+
+        out << m_rowCount << static_cast<qint32>(m_rowGroups.size());
+        for (const RowGroup &group : m_rowGroups) {
+            out << static_cast<qint32>(group.rows);
+            for (const ColumnChunk &chunk : group.columns) {
+                out << chunk.offset << chunk.bytes << static_cast<quint8>(chunk.encoding)
+                    << static_cast<quint8>(chunk.bitWidth) << chunk.base << chunk.minValue << chunk.maxValue;
+            }
+        }
+    }
+
+    uchar header[kHeaderSize];
+    qToLittleEndian(Magic, header);
+    qToLittleEndian(Version, header + 4);
+    qToLittleEndian(quint64(m_position), header + 8);
+    qToLittleEndian(quint64(footer.size()), header + 16);
+    qToLittleEndian(checksum(footer.constData(), footer.size()), header + 24);
+
+    const bool ok = m_file.write(footer) == footer.size()
+                 && m_file.seek(0)
+                 && m_file.write(reinterpret_cast<const char*>(header), kHeaderSize) == kHeaderSize;
+    if (!ok || !m_file.commit()) {
+        setError(error, QString("写入列式文件失败: %1\n错误: %2").arg(m_file.fileName()).arg(m_file.errorString()));
+        return false;
+    }
+    qDebug() << "列式文件写入完成：" << m_rowCount << "条客流记录，" << m_rowGroups.size() << "个行组，"
+             << m_position + footer.size() << "字节";
+    return true;
+}
+
+bool FlowColumnFile::open(const QString &path, QString *error)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        setError(error, QString("无法打开列式文件: %1\n错误: %2").arg(path).arg(m_file.errorString()));
+        return false;
+    }
+    m_dataSize = m_file.size();
+    if (m_dataSize < kHeaderSize) {
+        setError(error, QString("列式文件已损坏: %1").arg(path));
+        close();
+        return false;
+    }
+    m_data = m_file.map(0, m_dataSize);
+    if (!m_data) {
+        setError(error, QString("无法映射列式文件: %1\n错误: %2").arg(path).arg(m_file.errorString()));
+        close();
+        return false;
+    }
+
+    const quint64 footerOffset = qFromLittleEndian<quint64>(m_data + 8);
+    const quint64 footerSize = qFromLittleEndian<quint64>(m_data + 16);
+    if (qFromLittleEndian<quint32>(m_data) != Magic || qFromLittleEndian<quint32>(m_data + 4) != Version
+        || footerOffset > quint64(m_dataSize) || footerSize > quint64(m_dataSize) - footerOffset) {
+        setError(error, QString("不是受支持的列式客流文件: %1").arg(path));
+        close();
+        return false;
+    }
+    const char *footerData = reinterpret_cast<const char*>(m_data + footerOffset);
+    if (checksum(footerData, footerSize) != qFromLittleEndian<quint64>(m_data + 24)) {
+        setError(error, QString("列式文件已损坏：尾部校验失败: %1").arg(path));
+        close();
+        return false;
+    }
+
+    QDataStream in(QByteArray::fromRawData(footerData, footerSize));
+    in.setVersion(QDataStream::Qt_6_0);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    // 列定义必须与本版本的列完全一致
+    qint32 columnCount = 0;
+    in >> columnCount;
+    bool ok = columnCount == kColumnCount;
+    for (int i = 0; ok && i < kColumnCount; ++i) {
+        QString name;
+        quint8 type = 0;
+        qint8 dictionary = 0;
+        in >> name >> type >> dictionary;
+        ok = name == QString::fromLatin1(kColumns[i].name) && type == kColumns[i].type
+          && dictionary == kColumns[i].dictionary;
+    }
+
+    StringDictionary *dictionaries[kDictionaryCount] = {
+        &m_dictionaries.m_lineCodes, &m_dictionaries.m_trainCodes,
+        &m_dictionaries.m_ticketTypes, &m_dictionaries.m_stationNames
+    };
+    for (int kind = 0; ok && kind < kDictionaryCount; ++kind) {
+        ok = readDictionary(in, *dictionaries[kind]);
+    }
+
+    qint32 groupCount = 0;
+    in >> m_rowCount >> groupCount;
+    ok = ok && groupCount >= 0 && m_rowCount >= 0;
+    qint64 rows = 0;
+    for (qint32 g = 0; ok && g < groupCount; ++g) {
+        RowGroup group;
+        qint32 groupRows = 0;
+        in >> groupRows;
+        group.rows = groupRows;
+        ok = in.status() == QDataStream::Ok && groupRows > 0 && groupRows <= RowGroupRows;
+        for (int i = 0; ok && i < kColumnCount; ++i) {
+            ColumnChunk chunk;
+            quint8 encoding = 0;
+            quint8 width = 0;
+            in >> chunk.offset >> chunk.bytes >> encoding >> width >> chunk.base >> chunk.minValue >> chunk.maxValue;
+            chunk.encoding = static_cast<Encoding>(encoding);
+            chunk.bitWidth = width;
+            // 数据要完整落在尾部之前；字典编号不能超出字典
+            const int dictionary = kColumns[i].dictionary;
+            ok = in.status() == QDataStream::Ok && width <= 64 && encodingMatches(kColumns[i].type, chunk.encoding)
+              && chunk.offset >= kHeaderSize && chunk.bytes >= requiredBytes(chunk, groupRows)
+              && chunk.offset + chunk.bytes <= qint64(footerOffset)
+              && (dictionary < 0 || chunk.maxValue < dictionaries[dictionary]->size());
+            group.columns.append(chunk);
+        }
+        rows += groupRows;
+        m_rowGroups.append(group);
+    }
+    if (!ok || in.status() != QDataStream::Ok || rows != m_rowCount) {
+        setError(error, QString("列式文件已损坏：尾部无法解析: %1").arg(path));
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FlowColumnFile::close()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_dataSize = 0;
+    m_rowGroups.clear();
+    m_rowCount = 0;
+    m_dictionaries.clear();
+}
+
+bool FlowColumnFile::read(FlowStore &store, QString *error, int startDay, int endDay) const
+{
+    QVector<int> groups;
+    for (int i = 0; i < m_rowGroups.size(); ++i) {
+        if (m_rowGroups[i].overlaps(startDay, endDay)) {
+            groups.append(i);
+        }
+    }
+    if (!decode(groups, store)) {
+        setError(error, QString("读取列式文件失败: %1").arg(m_file.fileName()));
+        return false;
+    }
+    return true;
+}
+
+bool FlowColumnFile::readRowGroup(int index, FlowStore &store, QString *error) const
+{
+    store.clear();
+    if (!decode(QVector<int>{ index }, store)) {
+        setError(error, QString("读取列式文件失败：第%1个行组: %2").arg(index).arg(m_file.fileName()));
+        return false;
+    }
+    return true;
+}
+
+bool FlowColumnFile::decode(const QVector<int> &groups, FlowStore &store) const
+{
+    if (!m_data) {
+        return false;
+    }
+
+    QVector<int> firstRows;
+    int total = 0;
+    for (int group : groups) {
+        firstRows.append(total);
+        total += m_rowGroups[group].rows;
+    }
+
+    // 各列先分配好，每个行组解码到自己的那一段，互不重叠
+    FlowStore loaded;
+    forEachColumn(loaded, [total](int, auto &column) {
+        column.resize(total);
+        return true;
+    });
+    QVector<int> corruptColumns(groups.size(), -1);
+    QThreadPool pool;
+    for (int i = 0; i < groups.size(); ++i) {
+        pool.start([this, &loaded, &groups, &firstRows, &corruptColumns, i]() {
+            const RowGroup &group = m_rowGroups[groups[i]];
+            forEachColumn(loaded, [this, &group, &firstRows, &corruptColumns, i](int index, auto &column) {
+                const ColumnChunk &chunk = group.columns[index];
+                if (!decodeColumn(m_data + chunk.offset, chunk, group.rows, column.data() + firstRows[i])) {
+                    corruptColumns[i] = index;
+                    return false;
+                }
+                return true;
+            });
+        });
+    }
+    pool.waitForDone();
+    for (int i = 0; i < groups.size(); ++i) {
+        if (corruptColumns[i] >= 0) {
+            qDebug() << "列式文件已损坏：第" << groups[i] << "个行组的" << kColumns[corruptColumns[i]].name
+                     << "列解出的值超出记录的取值范围";
+            return false;
+        }
+    }
+
+    loaded.m_lineCodes = m_dictionaries.m_lineCodes;
+    loaded.m_trainCodes = m_dictionaries.m_trainCodes;
+    loaded.m_ticketTypes = m_dictionaries.m_ticketTypes;
+    loaded.m_stationNames = m_dictionaries.m_stationNames;
+    if (store.isEmpty() && !store.hasPendingColdColumns()) {
+        store = std::move(loaded);
+    } else {
+        QString reason;
+        if (!store.append(loaded, &reason)) {
+            qDebug() << reason;
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,212 @@
+#include "flowcube.h"
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+
+// 一次add中某个块涉及的日期范围，以及这些日期上新增的量（未累加成前缀和）
+struct Stage {
+    int lowDay = 0;
+    int highDay = 0;
+    QVector<FlowCube::Totals> deltas;
+};
+
+int hourSlot(int departureMinute)
+{
+    return departureMinute >= 0 && departureMinute < 24 * 60 ? departureMinute / 60 + 1 : 0;
+}
+
+} // namespace
+
+FlowCube::Totals &FlowCube::Totals::operator+=(const Totals &other)
+{
+    rows += other.rows;
+    boarding += other.boarding;
+    alighting += other.alighting;
+    revenue += other.revenue;
+    return *this;
+}
+
+FlowCube::Totals FlowCube::Totals::operator-(const Totals &other) const
+{
+    Totals result;
+    result.rows = rows - other.rows;
+    result.boarding = boarding - other.boarding;
+    result.alighting = alighting - other.alighting;
+    result.revenue = revenue - other.revenue;
+    return result;
+}
+
+void FlowCube::clear()
+{
+    m_valid = true;
+    m_rowCount = 0;
+    m_cells = 0;
+    m_stations.clear();
+    m_all = Block();
+}
+
+void FlowCube::extend(Block &block, int lowDay, int highDay)
+{
+    if (block.days == 0) {
+        block.firstDay = lowDay;
+        block.days = highDay - lowDay + 1;
+        block.cells.fill(Totals(), (block.days + 1) * Slots);
+        m_cells += block.cells.size();
+        return;
+    }
+    if (lowDay < block.firstDay) {
+        // 更早的日期前缀和为0，原有各行整体后移
+        const int added = block.firstDay - lowDay;
+        block.cells.insert(0, added * Slots, Totals());
+        block.firstDay = lowDay;
+        block.days += added;
+        m_cells += added * Slots;
+    }
+    const int endDay = block.firstDay + block.days;
+    if (highDay >= endDay) {
+        // 更晚的日期先沿用最后一行的前缀和
+        const int added = highDay - endDay + 1;
+        const int last = block.days * Slots;
+        block.cells.resize((block.days + 1 + added) * Slots);
+        for (int k = 1; k <= added; ++k) {
+            for (int slot = 0; slot < Slots; ++slot) {
+                block.cells[last + k * Slots + slot] = block.cells[last + slot];
+            }
+        }
+        block.days += added;
+        m_cells += added * Slots;
+    }
+}
+
+void FlowCube::add(const FlowStore &store, int firstRow)
+{
+    if (!m_valid || firstRow >= store.size()) {
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+
+    const QVector<qint32> &stationIds = store.stationIds();
+    const QVector<qint32> &days = store.dayNumbers();
+    const QVector<qint16> &departures = store.departureMinutes();
+    const QVector<qint32> &boarding = store.boardingPassengers();
+    const QVector<qint32> &alighting = store.alightingPassengers();
+    const QVector<double> &revenues = store.revenues();
+    const int rows = store.size();
+
+    // 第一遍：各站点本批涉及的日期范围，块先扩展到覆盖这些日期
+    QHash<int, Stage> stages;
+    Stage all;
+    all.lowDay = days[firstRow];
+    all.highDay = days[firstRow];
+    for (int row = firstRow; row < rows; ++row) {
+        const int day = days[row];
+        auto it = stages.find(stationIds[row]);
+        if (it == stages.end()) {
+            Stage stage;
+            stage.lowDay = day;
+            stage.highDay = day;
+            stages.insert(stationIds[row], stage);
+        } else {
+            it->lowDay = qMin(it->lowDay, day);
+            it->highDay = qMax(it->highDay, day);
+        }
+        all.lowDay = qMin(all.lowDay, day);
+        all.highDay = qMax(all.highDay, day);
+    }
+    for (auto it = stages.begin(); it != stages.end(); ++it) {
+        extend(m_stations[it.key()], it->lowDay, it->highDay);
+        it->deltas.fill(Totals(), (it->highDay - it->lowDay + 1) * Slots);
+    }
+    extend(m_all, all.lowDay, all.highDay);
+    all.deltas.fill(Totals(), (all.highDay - all.lowDay + 1) * Slots);
+    if (memoryUsage() > m_budget) {
+        qDebug() << "客流立方体超出内存预算" << m_budget / (1024 * 1024) << "MB，停用，改为逐行扫描";
+        clear();
+        m_valid = false;
+        return;
+    }
+
+    // 第二遍：按日期和小时累加新增的量
+    Stage *stage = nullptr;
+    int lastStationId = 0;
+    for (int row = firstRow; row < rows; ++row) {
+        if (!stage || stationIds[row] != lastStationId) {
+            lastStationId = stationIds[row];
+            stage = &stages[lastStationId];
+        }
+        Totals value;
+        value.rows = 1;
+        value.boarding = boarding[row];
+        value.alighting = alighting[row];
+        value.revenue = revenues[row];
+        const int hour = hourSlot(departures[row]);
+        const int stationCell = (days[row] - stage->lowDay) * Slots;
+        stage->deltas[stationCell + hour] += value;
+        stage->deltas[stationCell + Slots - 1] += value;
+        const int allCell = (days[row] - all.lowDay) * Slots;
+        all.deltas[allCell + hour] += value;
+        all.deltas[allCell + Slots - 1] += value;
+    }
+
+    // 新增量累加成前缀和加到块上：涉及的日期逐行累加，之后的各行加上本批合计
+    auto apply = [](Block &block, const Stage &stage) {
+        Totals running[Slots];
+        const int first = stage.lowDay - block.firstDay;
+        const int span = stage.highDay - stage.lowDay + 1;
+        for (int k = 0; k < span; ++k) {
+            for (int slot = 0; slot < Slots; ++slot) {
+                running[slot] += stage.deltas[k * Slots + slot];
+                block.cells[(first + k + 1) * Slots + slot] += running[slot];
+            }
+        }
+        for (int k = first + span + 1; k <= block.days; ++k) {
+            for (int slot = 0; slot < Slots; ++slot) {
+                block.cells[k * Slots + slot] += running[slot];
+            }
+        }
+    };
+    for (auto it = stages.constBegin(); it != stages.constEnd(); ++it) {
+        apply(m_stations[it.key()], it.value());
+    }
+    apply(m_all, all);
+    m_rowCount += rows - firstRow;
+
+    qDebug() << "客流立方体累加" << rows - firstRow << "行：" << m_stations.size() << "个站点，"
+             << m_all.days << "天，占用" << memoryUsage() / 1024 << "KB，用时" << timer.elapsed() << "ms";
+}
+
+FlowCube::Totals FlowCube::range(const Block &block, int startDay, int endDay, int hour) const
+{
+    if (hour < -1 || hour > AllHours || block.days == 0) {
+        return Totals();
+    }
+    const int slot = hour + 1;
+    const qint64 begin = qBound(qint64(0), qint64(startDay) - block.firstDay, qint64(block.days));
+    const qint64 end = qBound(qint64(0), qint64(endDay) - block.firstDay + 1, qint64(block.days));
+    if (end <= begin) {
+        return Totals();
+    }
+    return block.cells[end * Slots + slot] - block.cells[begin * Slots + slot];
+}
+
+FlowCube::Totals FlowCube::total(int startDay, int endDay, int hour) const
+{
+    return range(m_all, startDay, endDay, hour);
+}
+
+FlowCube::Totals FlowCube::station(int stationId, int startDay, int endDay, int hour) const
+{
+    const auto it = m_stations.constFind(stationId);
+    return it != m_stations.constEnd() ? range(it.value(), startDay, endDay, hour) : Totals();
+}
+
+FlowCube::Totals FlowCube::stations(const QVector<int> &stationIds, int startDay, int endDay, int hour) const
+{
+    Totals result;
+    for (int stationId : stationIds) {
+        result += station(stationId, startDay, endDay, hour);
+    }
+    return result;
+}
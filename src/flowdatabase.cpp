@@ -0,0 +1,386 @@
+#include "flowdatabase.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStringList>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+
+// 每个事务插入的行数：事务越大提交次数越少，SQLite批量导入时这是最主要的开销
+const int kRowsPerTransaction = 100000;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+// 站点id都是整数，直接拼进SQL
+QString stationFilter(const QVector<int> &stationIds)
+{
+    if (stationIds.isEmpty()) {
+        return QString();
+    }
+    QStringList ids;
+    for (int id : stationIds) {
+        ids.append(QString::number(id));
+    }
+    return QString(" AND station_id IN (%1)").arg(ids.join(","));
+}
+
+FlowDatabase::Totals readTotals(const QSqlQuery &query, int firstColumn)
+{
+    FlowDatabase::Totals totals;
+    totals.rows = query.value(firstColumn).toLongLong();
+    totals.passengers = query.value(firstColumn + 1).toLongLong();
+    totals.revenue = query.value(firstColumn + 2).toDouble();
+    totals.priceSum = query.value(firstColumn + 3).toDouble();
+    return totals;
+}
+
+const char *kTotalsColumns = "COUNT(*), SUM(boarding + alighting), SUM(revenue), SUM(ticket_price)";
+
+} // namespace
+
+FlowDatabase::FlowDatabase(const QString &connectionName)
+    : m_connectionName(connectionName)
+{
+}
+
+FlowDatabase::~FlowDatabase()
+{
+    close();
+}
+
+bool FlowDatabase::open(const QString &path, QString *error)
+{
+    close();
+    if (!QSqlDatabase::isDriverAvailable("QSQLITE")) {
+        setError(error, "SQLite驱动不可用");
+        return false;
+    }
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+        db.setDatabaseName(path);
+        if (!db.open()) {
+            setError(error, QString("无法打开数据库: %1\n错误: %2").arg(path).arg(db.lastError().text()));
+            db = QSqlDatabase();
+            QSqlDatabase::removeDatabase(m_connectionName);
+            return false;
+        }
+    }
+    m_path = path;
+
+    // 分析时以读为主；WAL让导入和查询互不阻塞
+    return exec("PRAGMA journal_mode=WAL", error)
+        && exec("CREATE TABLE IF NOT EXISTS meta (key TEXT PRIMARY KEY, value TEXT)", error)
+        && exec("CREATE TABLE IF NOT EXISTS stations (id INTEGER PRIMARY KEY, name TEXT, code TEXT, "
+                "short_name TEXT, telecode TEXT)", error)
+        && exec("CREATE TABLE IF NOT EXISTS trains (code TEXT PRIMARY KEY, train_code TEXT, capacity INTEGER)", error)
+        && exec("CREATE TABLE IF NOT EXISTS flows (line_code TEXT, train_code TEXT, station_id INTEGER, "
+                "day INTEGER, arrival INTEGER, departure INTEGER, boarding INTEGER, alighting INTEGER, "
+                "ticket_type TEXT, ticket_price REAL, revenue REAL, start_station TEXT, end_station TEXT)", error);
+}
+
+void FlowDatabase::close()
+{
+    if (!QSqlDatabase::contains(m_connectionName)) {
+        return;
+    }
+    {
+        QSqlDatabase db = database();
+        if (db.isOpen()) {
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(m_connectionName);
+    m_path.clear();
+}
+
+bool FlowDatabase::isOpen() const
+{
+    return QSqlDatabase::contains(m_connectionName) && database().isOpen();
+}
+
+bool FlowDatabase::exec(const QString &sql, QString *error) const
+{
+    QSqlQuery query(database());
+    if (!query.exec(sql)) {
+        setError(error, QString("数据库操作失败: %1\n错误: %2").arg(sql).arg(query.lastError().text()));
+        return false;
+    }
+    return true;
+}
+
+bool FlowDatabase::beginImport(const QVector<StationRecord> &stations, const QVector<TrainRecord> &trains,
+                               QString *error)
+{
+    // 先删索引，插入完成后再一次性建，比边插入边维护索引快得多
+    if (!exec("DROP INDEX IF EXISTS flows_day", error)
+        || !exec("DROP INDEX IF EXISTS flows_station_day", error)
+        || !exec("DROP INDEX IF EXISTS flows_train_day", error)
+        || !exec("DELETE FROM flows", error)
+        || !exec("DELETE FROM stations", error)
+        || !exec("DELETE FROM trains", error)
+        || !exec("PRAGMA synchronous=OFF", error)) {
+        return false;
+    }
+
+    QSqlDatabase db = database();
+    db.transaction();
+    QSqlQuery stationQuery(db);
+    stationQuery.prepare("INSERT OR REPLACE INTO stations (id, name, code, short_name, telecode) VALUES (?, ?, ?, ?, ?)");
+    for (const StationRecord &station : stations) {
+        stationQuery.addBindValue(station.id);
+        stationQuery.addBindValue(station.name);
+        stationQuery.addBindValue(station.code);
+        stationQuery.addBindValue(station.shortName);
+        stationQuery.addBindValue(station.telecode);
+        if (!stationQuery.exec()) {
+            setError(error, QString("写入站点失败: %1").arg(stationQuery.lastError().text()));
+            db.rollback();
+            return false;
+        }
+    }
+
+    QSqlQuery trainQuery(db);
+    trainQuery.prepare("INSERT OR REPLACE INTO trains (code, train_code, capacity) VALUES (?, ?, ?)");
+    for (const TrainRecord &train : trains) {
+        trainQuery.addBindValue(train.code);
+        trainQuery.addBindValue(train.trainCode);
+        trainQuery.addBindValue(train.capacity);
+        if (!trainQuery.exec()) {
+            setError(error, QString("写入列车失败: %1").arg(trainQuery.lastError().text()));
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commit();
+}
+
+bool FlowDatabase::appendFlows(const FlowStore &flows, QString *error)
+{
+    // 冷列解码失败时票价和起止站都是占位值，不能写入数据库
+    if (flows.hasColdColumnsError()) {
+        setError(error, QString("客流冷列不可用，无法保存到数据库: %1").arg(flows.coldColumnsError()));
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO flows (line_code, train_code, station_id, day, arrival, departure, boarding, "
+                  "alighting, ticket_type, ticket_price, revenue, start_station, end_station) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+
+    // 字典字符串每个只转换一次QVariant
+    auto dictionaryValues = [](const StringDictionary &dictionary) {
+        QVector<QVariant> values;
+        values.reserve(dictionary.size());
+        for (const QString &value : dictionary.values()) {
+            values.append(value);
+        }
+        return values;
+    };
+    const QVector<QVariant> lineCodes = dictionaryValues(flows.lineCodes());
+    const QVector<QVariant> trainCodes = dictionaryValues(flows.trainCodes());
+    const QVector<QVariant> ticketTypes = dictionaryValues(flows.ticketTypes());
+    const QVector<QVariant> stationNames = dictionaryValues(flows.stationNames());
+
+    db.transaction();
+    for (int i = 0; i < flows.size(); ++i) {
+        query.bindValue(0, lineCodes[flows.lineIds()[i]]);
+        query.bindValue(1, trainCodes[flows.trainIds()[i]]);
+        query.bindValue(2, flows.stationIds()[i]);
+        query.bindValue(3, flows.dayNumbers()[i]);
+        query.bindValue(4, flows.arrivalMinutes()[i]);
+        query.bindValue(5, flows.departureMinutes()[i]);
+        query.bindValue(6, flows.boardingPassengers()[i]);
+        query.bindValue(7, flows.alightingPassengers()[i]);
+        query.bindValue(8, ticketTypes[flows.ticketTypeIds()[i]]);
+        query.bindValue(9, flows.ticketPrices()[i]);
+        query.bindValue(10, flows.revenues()[i]);
+        query.bindValue(11, stationNames[flows.startStationIds()[i]]);
+        query.bindValue(12, stationNames[flows.endStationIds()[i]]);
+        if (!query.exec()) {
+            setError(error, QString("写入客流失败: %1").arg(query.lastError().text()));
+            db.rollback();
+            return false;
+        }
+
+        if ((i + 1) % kRowsPerTransaction == 0) {
+            if (!db.commit()) {
+                setError(error, QString("提交事务失败: %1").arg(db.lastError().text()));
+                return false;
+            }
+            db.transaction();
+        }
+    }
+    if (!db.commit()) {
+        setError(error, QString("提交事务失败: %1").arg(db.lastError().text()));
+        return false;
+    }
+
+    qDebug() << "写入数据库" << flows.size() << "条客流记录，用时" << timer.elapsed() << "ms";
+    return true;
+}
+
+bool FlowDatabase::finishImport(QString *error)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 索引包含聚合用到的列（覆盖索引），按日期范围的统计不必回表
+    const bool ok = exec("CREATE INDEX flows_day ON flows (day, station_id, boarding, alighting, revenue, "
+                         "ticket_price)", error)
+        && exec("CREATE INDEX flows_station_day ON flows (station_id, day, train_code, ticket_type, boarding, "
+                "alighting, revenue, ticket_price)", error)
+        && exec("CREATE INDEX flows_train_day ON flows (train_code, day, station_id, boarding, alighting, "
+                "revenue, ticket_price)", error)
+        && exec(QString("INSERT OR REPLACE INTO meta (key, value) VALUES ('schema_version', '%1')")
+                .arg(SchemaVersion), error)
+        && exec("ANALYZE", error)
+        && exec("PRAGMA synchronous=NORMAL", error);
+
+    qDebug() << "数据库索引建立完成，用时" << timer.elapsed() << "ms";
+    return ok;
+}
+
+bool FlowDatabase::readStations(QVector<StationRecord> &records, QString *error) const
+{
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, name, code, short_name, telecode FROM stations ORDER BY id")) {
+        setError(error, QString("读取站点失败: %1").arg(query.lastError().text()));
+        return false;
+    }
+    while (query.next()) {
+        StationRecord record;
+        record.id = query.value(0).toInt();
+        record.name = query.value(1).toString();
+        record.code = query.value(2).toString();
+        record.shortName = query.value(3).toString();
+        record.telecode = query.value(4).toString();
+        records.append(record);
+    }
+    return true;
+}
+
+bool FlowDatabase::readTrains(QVector<TrainRecord> &records, QString *error) const
+{
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT code, train_code, capacity FROM trains ORDER BY rowid")) {
+        setError(error, QString("读取列车失败: %1").arg(query.lastError().text()));
+        return false;
+    }
+    while (query.next()) {
+        TrainRecord record;
+        record.code = query.value(0).toString();
+        record.trainCode = query.value(1).toString();
+        record.capacity = query.value(2).toInt();
+        records.append(record);
+    }
+    return true;
+}
+
+qint64 FlowDatabase::flowCount() const
+{
+    QSqlQuery query(database());
+    if (query.exec("SELECT COUNT(*) FROM flows") && query.next()) {
+        return query.value(0).toLongLong();
+    }
+    return 0;
+}
+
+QHash<int, FlowDatabase::Totals> FlowDatabase::stationTotals(int startDay, int endDay) const
+{
+    QHash<int, Totals> result;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT station_id, %1 FROM flows WHERE day BETWEEN ? AND ? GROUP BY station_id")
+                  .arg(kTotalsColumns));
+    query.addBindValue(startDay);
+    query.addBindValue(endDay);
+    if (!query.exec()) {
+        qDebug() << "站点汇总查询失败:" << query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        result.insert(query.value(0).toInt(), readTotals(query, 1));
+    }
+    return result;
+}
+
+QHash<QString, FlowDatabase::Totals> FlowDatabase::trainTotals(int startDay, int endDay,
+                                                               const QVector<int> &stationIds) const
+{
+    QHash<QString, Totals> result;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT train_code, %1 FROM flows WHERE day BETWEEN ? AND ?%2 GROUP BY train_code")
+                  .arg(kTotalsColumns).arg(stationFilter(stationIds)));
+    query.addBindValue(startDay);
+    query.addBindValue(endDay);
+    if (!query.exec()) {
+        qDebug() << "车次汇总查询失败:" << query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        result.insert(query.value(0).toString(), readTotals(query, 1));
+    }
+    return result;
+}
+
+QMap<int, FlowDatabase::Totals> FlowDatabase::dailyTotals(int startDay, int endDay, const QVector<int> &stationIds,
+                                                          const QString &trainCode) const
+{
+    QMap<int, Totals> result;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT day, %1, COUNT(DISTINCT train_code) FROM flows WHERE day BETWEEN ? AND ?%2%3 "
+                          "GROUP BY day ORDER BY day")
+                  .arg(kTotalsColumns).arg(stationFilter(stationIds))
+                  .arg(trainCode.isEmpty() ? QString() : QString(" AND train_code = ?")));
+    query.addBindValue(startDay);
+    query.addBindValue(endDay);
+    if (!trainCode.isEmpty()) {
+        query.addBindValue(trainCode);
+    }
+    if (!query.exec()) {
+        qDebug() << "按日汇总查询失败:" << query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        Totals totals = readTotals(query, 1);
+        totals.trains = query.value(5).toInt();
+        result.insert(query.value(0).toInt(), totals);
+    }
+    return result;
+}
+
+QHash<QString, FlowDatabase::Totals> FlowDatabase::ticketTypeTotals(int startDay, int endDay,
+                                                                    const QVector<int> &stationIds) const
+{
+    QHash<QString, Totals> result;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT ticket_type, %1 FROM flows WHERE day BETWEEN ? AND ?%2 GROUP BY ticket_type")
+                  .arg(kTotalsColumns).arg(stationFilter(stationIds)));
+    query.addBindValue(startDay);
+    query.addBindValue(endDay);
+    if (!query.exec()) {
+        qDebug() << "票种汇总查询失败:" << query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        result.insert(query.value(0).toString(), readTotals(query, 1));
+    }
+    return result;
+}
@@ -0,0 +1,125 @@
+#include "flowdeduplicator.h"
+#include <QHash>
+
+namespace {
+
+// MurmurHash3的64位收尾混合，把输入的每一位扩散到全部64位
+inline quint64 mix64(quint64 h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 字典中每个字符串的哈希，逐行计算指纹时按编号查表
+QVector<quint64> dictionaryHashes(const StringDictionary &dictionary)
+{
+    QVector<quint64> hashes;
+    hashes.reserve(dictionary.size());
+    for (const QString &value : dictionary.values()) {
+        hashes.append(mix64(qHash(value, 0)));
+    }
+    return hashes;
+}
+
+} // namespace
+
+quint64 FlowDeduplicator::fingerprint(quint64 trainHash, int stationId, int dayNumber, int departureMinute,
+                                      quint64 ticketTypeHash)
+{
+    quint64 h = mix64(trainHash ^ ((quint64(quint32(stationId)) << 32) | quint32(dayNumber)));
+    h = mix64(h ^ ticketTypeHash);
+    return mix64(h + quint32(departureMinute));
+}
+
+template<typename Visit>
+void FlowDeduplicator::visitFingerprints(const FlowStore &store, Visit visit)
+{
+    const QVector<quint64> trainHashes = dictionaryHashes(store.trainCodes());
+    const QVector<quint64> ticketTypeHashes = dictionaryHashes(store.ticketTypes());
+    const QVector<qint32> &stationIds = store.stationIds();
+    const QVector<qint32> &dayNumbers = store.dayNumbers();
+    const QVector<qint16> &departureMinutes = store.departureMinutes();
+    const QVector<FlowStore::DictId> &trainIds = store.trainIds();
+    const QVector<FlowStore::DictId> &ticketTypeIds = store.ticketTypeIds();
+
+    reserve(m_count + store.size());
+    for (int row = 0; row < store.size(); ++row) {
+        visit(row, fingerprint(trainHashes[trainIds[row]], stationIds[row], dayNumbers[row],
+                               departureMinutes[row], ticketTypeHashes[ticketTypeIds[row]]));
+    }
+}
+
+int FlowDeduplicator::filter(FlowStore &store)
+{
+    QVector<int> duplicateRows;
+    visitFingerprints(store, [this, &duplicateRows](int row, quint64 fingerprint) {
+        if (!insert(fingerprint)) {
+            duplicateRows.append(row);
+        }
+    });
+
+    // 重复通常很少，没有重复时不触碰存储
+    if (!duplicateRows.isEmpty()) {
+        store.removeRows(duplicateRows);
+        m_duplicates += duplicateRows.size();
+    }
+    return duplicateRows.size();
+}
+
+void FlowDeduplicator::insert(const FlowStore &store)
+{
+    visitFingerprints(store, [this](int, quint64 fingerprint) {
+        insert(fingerprint);
+    });
+}
+
+bool FlowDeduplicator::insert(quint64 fingerprint)
+{
+    // 0留作空槽标记
+    if (fingerprint == 0) {
+        fingerprint = 1;
+    }
+    const qsizetype mask = m_slots.size() - 1;
+    for (qsizetype slot = fingerprint & mask;; slot = (slot + 1) & mask) {
+        if (m_slots[slot] == fingerprint) {
+            return false;
+        }
+        if (m_slots[slot] == 0) {
+            m_slots[slot] = fingerprint;
+            ++m_count;
+            return true;
+        }
+    }
+}
+
+void FlowDeduplicator::reserve(qint64 rows)
+{
+    // 装载率不超过七成，线性探测的平均探测长度保持在2左右
+    qsizetype capacity = 1024;
+    while (capacity * 7 < rows * 10) {
+        capacity *= 2;
+    }
+    if (capacity <= m_slots.size()) {
+        return;
+    }
+
+    const QVector<quint64> old = std::move(m_slots);
+    m_slots = QVector<quint64>(capacity, 0);
+    m_count = 0;
+    for (quint64 fingerprint : old) {
+        if (fingerprint != 0) {
+            insert(fingerprint);
+        }
+    }
+}
+
+void FlowDeduplicator::clear()
+{
+    m_slots = QVector<quint64>();
+    m_count = 0;
+    m_duplicates = 0;
+}
@@ -0,0 +1,229 @@
+#include "flowindex.h"
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// 站点ID跨度不超过这个值时平铺成数组（4MB的偏移表）
+const qint64 kMaxFlatStationSpan = 1024 * 1024;
+
+// CSR填充：keys[row]是第row行所属的列表，offsets已是各列表的起始位置；按行号顺序放入，列表内递增
+template<typename Slot>
+void fillPostings(int rows, const QVector<int> &offsets, QVector<int> &postings, Slot slotOf)
+{
+    QVector<int> next = offsets;
+    postings.resize(rows);
+    for (int row = 0; row < rows; ++row) {
+        postings[next[slotOf(row)]++] = row;
+    }
+}
+
+void prefixSum(QVector<int> &offsets)
+{
+    for (int k = 1; k < offsets.size(); ++k) {
+        offsets[k] += offsets[k - 1];
+    }
+}
+
+} // namespace
+
+void FlowIndex::build(const FlowStore &store)
+{
+    QElapsedTimer timer;
+    timer.start();
+    clear();
+    m_rowCount = store.size();
+    if (m_rowCount == 0) {
+        return;
+    }
+
+    // 站点：先定下每个站点ID的列表编号，计数、前缀和，再按行号顺序放入
+    const QVector<qint32> &stationIds = store.stationIds();
+    const auto range = std::minmax_element(stationIds.constBegin(), stationIds.constEnd());
+    const qint64 span = qint64(*range.second) - *range.first + 1;
+    m_flatStations = span <= kMaxFlatStationSpan;
+    QVector<int> stationSlots;
+    if (m_flatStations) {
+        m_stationIdBase = *range.first;
+        m_stationOffsets.fill(0, span + 1);
+        for (qint32 id : stationIds) {
+            m_stationOffsets[id - m_stationIdBase + 1]++;
+        }
+    } else {
+        stationSlots.resize(m_rowCount);
+        m_stationOffsets.append(0);
+        for (int row = 0; row < m_rowCount; ++row) {
+            auto it = m_stationSlots.constFind(stationIds[row]);
+            if (it == m_stationSlots.constEnd()) {
+                it = m_stationSlots.insert(stationIds[row], m_stationSlots.size());
+                m_stationOffsets.append(0);
+            }
+            stationSlots[row] = it.value();
+            m_stationOffsets[it.value() + 1]++;
+        }
+    }
+    prefixSum(m_stationOffsets);
+    if (m_flatStations) {
+        const int base = m_stationIdBase;
+        fillPostings(m_rowCount, m_stationOffsets, m_stationRows, [&stationIds, base](int row) {
+            return stationIds[row] - base;
+        });
+    } else {
+        fillPostings(m_rowCount, m_stationOffsets, m_stationRows, [&stationSlots](int row) {
+            return stationSlots[row];
+        });
+    }
+
+    // 车次：字典编号本身就是稠密的列表编号
+    const QVector<FlowStore::DictId> &trainIds = store.trainIds();
+    m_trainOffsets.fill(0, store.trainCodes().size() + 1);
+    for (FlowStore::DictId id : trainIds) {
+        m_trainOffsets[id + 1]++;
+    }
+    prefixSum(m_trainOffsets);
+    fillPostings(m_rowCount, m_trainOffsets, m_trainRows, [&trainIds](int row) {
+        return int(trainIds[row]);
+    });
+
+    qDebug() << "客流倒排索引建立完成：" << m_rowCount << "行，" << m_stationOffsets.size() - 1 << "个站点列表，"
+             << m_trainOffsets.size() - 1 << "个车次列表，用时" << timer.elapsed() << "ms";
+}
+
+void FlowIndex::clear()
+{
+    m_rowCount = 0;
+    m_stationIdBase = 0;
+    m_flatStations = true;
+    m_stationSlots.clear();
+    m_stationOffsets.clear();
+    m_stationRows.clear();
+    m_trainOffsets.clear();
+    m_trainRows.clear();
+}
+
+int FlowIndex::stationSlot(int stationId) const
+{
+    if (!m_flatStations) {
+        return m_stationSlots.value(stationId, -1);
+    }
+    const qint64 slot = qint64(stationId) - m_stationIdBase;
+    return slot >= 0 && slot < m_stationOffsets.size() - 1 ? int(slot) : -1;
+}
+
+FlowIndex::Slice FlowIndex::stationSlice(int stationId) const
+{
+    Slice slice;
+    const int slot = stationSlot(stationId);
+    if (slot >= 0) {
+        slice.begin = m_stationOffsets[slot];
+        slice.end = m_stationOffsets[slot + 1];
+    }
+    return slice;
+}
+
+FlowIndex::Slice FlowIndex::trainSlice(int trainId) const
+{
+    Slice slice;
+    if (trainId >= 0 && trainId < m_trainOffsets.size() - 1) {
+        slice.begin = m_trainOffsets[trainId];
+        slice.end = m_trainOffsets[trainId + 1];
+    }
+    return slice;
+}
+
+bool FlowIndex::restrictToDays(const FlowStore &store, const QVector<int> &rows, Slice &slice,
+                               int startDay, int endDay) const
+{
+    if (startDay == INT_MIN && endDay == INT_MAX) {
+        return true;
+    }
+    int beginRow = 0;
+    int endRow = 0;
+    if (!store.dayRows(startDay, endDay, &beginRow, &endRow)) {
+        return false;
+    }
+    slice.begin = gallop(rows.constData(), slice.begin, slice.end, beginRow);
+    slice.end = gallop(rows.constData(), slice.begin, slice.end, endRow);
+    return true;
+}
+
+FlowView FlowIndex::view(const FlowStore &store, const QVector<int> &rows, Slice slice,
+                         int startDay, int endDay) const
+{
+    if (restrictToDays(store, rows, slice, startDay, endDay)) {
+        return FlowView(&store, rows, slice.begin, slice.end);
+    }
+
+    // 存储未按日期聚集时逐个检查列表中各行的日期，仍然只触及该站点或车次的行
+    const QVector<qint32> &days = store.dayNumbers();
+    QVector<int> selected;
+    for (int i = slice.begin; i < slice.end; ++i) {
+        if (days[rows[i]] >= startDay && days[rows[i]] <= endDay) {
+            selected.append(rows[i]);
+        }
+    }
+    return FlowView(&store, selected);
+}
+
+FlowView FlowIndex::stationFlows(const FlowStore &store, int stationId, int startDay, int endDay) const
+{
+    return view(store, m_stationRows, stationSlice(stationId), startDay, endDay);
+}
+
+FlowView FlowIndex::trainFlows(const FlowStore &store, int trainId, int startDay, int endDay) const
+{
+    return view(store, m_trainRows, trainSlice(trainId), startDay, endDay);
+}
+
+FlowView FlowIndex::stationTrainFlows(const FlowStore &store, int stationId, int trainId,
+                                      int startDay, int endDay) const
+{
+    Slice stations = stationSlice(stationId);
+    Slice trains = trainSlice(trainId);
+    const bool restricted = restrictToDays(store, m_stationRows, stations, startDay, endDay)
+                         && restrictToDays(store, m_trainRows, trains, startDay, endDay);
+    QVector<int> rows = intersect(m_stationRows.constData() + stations.begin, stations.end - stations.begin,
+                                  m_trainRows.constData() + trains.begin, trains.end - trains.begin);
+    if (!restricted) {
+        const QVector<qint32> &days = store.dayNumbers();
+        rows.erase(std::remove_if(rows.begin(), rows.end(), [&days, startDay, endDay](int row) {
+            return days[row] < startDay || days[row] > endDay;
+        }), rows.end());
+    }
+    return FlowView(&store, rows);
+}
+
+int FlowIndex::gallop(const int *rows, int from, int to, int value)
+{
+    if (from >= to || rows[from] >= value) {
+        return from;
+    }
+    // rows[low] < value；high为to或第一个已知不小于value的位置
+    int low = from;
+    int step = 1;
+    while (low + step < to && rows[low + step] < value) {
+        low += step;
+        step *= 2;
+    }
+    const int high = qMin(low + step, to);
+    return static_cast<int>(std::lower_bound(rows + low + 1, rows + high, value) - rows);
+}
+
+QVector<int> FlowIndex::intersect(const int *a, int aSize, const int *b, int bSize)
+{
+    if (aSize > bSize) {
+        std::swap(a, b);
+        std::swap(aSize, bSize);
+    }
+    QVector<int> result;
+    int position = 0;
+    for (int i = 0; i < aSize && position < bSize; ++i) {
+        position = gallop(b, position, bSize, a[i]);
+        if (position < bSize && b[position] == a[i]) {
+            result.append(a[i]);
+            ++position;
+        }
+    }
+    return result;
+}
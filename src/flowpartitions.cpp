@@ -0,0 +1,114 @@
+#include "flowpartitions.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+
+bool FlowPartitions::isPartitionFileName(const QString &fileName)
+{
+    return fileName.startsWith("高铁客运量")
+        && (fileName.endsWith(".csv", Qt::CaseInsensitive) || fileName.endsWith(".csv.gz", Qt::CaseInsensitive)
+            || fileName.endsWith(".csv.zst", Qt::CaseInsensitive));
+}
+
+QStringList FlowPartitions::discover(const QString &directory)
+{
+    QStringList files;
+    QDirIterator it(directory, QStringList{ "*.csv", "*.CSV", "*.gz", "*.zst" }, QDir::Files,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        if (isPartitionFileName(QFileInfo(path).fileName())) {
+            files.append(QFileInfo(path).absoluteFilePath());
+        }
+    }
+    files.sort();
+    return files;
+}
+
+QString FlowPartitions::indexPath(const QString &directory)
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheDir.isEmpty()) {
+        cacheDir = QDir::tempPath();
+    }
+
+    // 与快照一样，以数据目录绝对路径的哈希命名
+    const QByteArray key = QCryptographicHash::hash(QDir(directory).absolutePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex().left(16);
+    return QDir(cacheDir).filePath(QString("partitions/%1.index").arg(QString::fromLatin1(key)));
+}
+
+QVector<FlowPartition> FlowPartitions::readIndex(const QString &indexPath)
+{
+    QVector<FlowPartition> partitions;
+    QFile file(indexPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return partitions;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != IndexMagic || version != IndexVersion || count < 0) {
+        return partitions;
+    }
+
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        FlowPartition partition;
+        qint32 firstDay = 0;
+        qint32 lastDay = 0;
+        in >> partition.path >> partition.size >> partition.modified >> firstDay >> lastDay;
+        partition.firstDay = firstDay;
+        partition.lastDay = lastDay;
+        partition.exact = true;
+        partitions.append(partition);
+    }
+    if (in.status() != QDataStream::Ok) {
+        partitions.clear();
+    }
+    return partitions;
+}
+
+bool FlowPartitions::writeIndex(const QString &indexPath, const QVector<FlowPartition> &partitions, QString *error)
+{
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) {
+            *error = QString("无法创建分区索引: %1\n错误: %2").arg(indexPath).arg(file.errorString());
+        }
+        return false;
+    }
+
+    // 只记录精确范围；探测得到的估计值每次重新探测
+    QVector<FlowPartition> exact;
+    for (const FlowPartition &partition : partitions) {
+        if (partition.exact) {
+            exact.append(partition);
+        }
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << IndexMagic << IndexVersion << static_cast<qint32>(exact.size());
+    for (const FlowPartition &partition : exact) {
+        out << partition.path << partition.size << partition.modified
+            << static_cast<qint32>(partition.firstDay) << static_cast<qint32>(partition.lastDay);
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        if (error) {
+            *error = QString("写入分区索引失败: %1\n错误: %2").arg(indexPath).arg(file.errorString());
+        }
+        return false;
+    }
+    return true;
+}
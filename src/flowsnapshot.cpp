@@ -0,0 +1,374 @@
+#include "flowsnapshot.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+const qint64 kColumnAlignment = 64;
+const qint64 kSampleBlockSize = 64 * 1024;
+const int kSampleBlockCount = 16;
+
+struct FileHeader {
+    quint32 magic;
+    quint32 version;
+    quint64 metaSize;
+    quint64 metaChecksum;
+};
+
+qint64 alignUp(qint64 value)
+{
+    return (value + kColumnAlignment - 1) / kColumnAlignment * kColumnAlignment;
+}
+
+// FNV-1a，只用于检查元数据是否损坏
+quint64 checksum(const char *data, qint64 size)
+{
+    quint64 hash = 14695981039346656037ULL;
+    for (qint64 i = 0; i < size; ++i) {
+        hash ^= static_cast<uchar>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+bool writePadding(QSaveFile &file, qint64 &position)
+{
+    static const char zeros[kColumnAlignment] = {};
+    const qint64 padding = alignUp(position) - position;
+    if (padding > 0 && file.write(zeros, padding) != padding) {
+        return false;
+    }
+    position += padding;
+    return true;
+}
+
+void writeDictionary(QDataStream &out, const StringDictionary &dictionary)
+{
+    out << static_cast<qint32>(dictionary.size());
+    for (const QString &value : dictionary.values()) {
+        out << value;
+    }
+}
+
+bool readDictionary(QDataStream &in, StringDictionary &dictionary)
+{
+    qint32 count = 0;
+    in >> count;
+    if (count < 0 || count > 0x10000) {
+        return false;
+    }
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString value;
+        in >> value;
+        dictionary.insert(value);
+    }
+    // 重复的字符串会合并编号，说明数据已损坏
+    return in.status() == QDataStream::Ok && dictionary.size() == count;
+}
+
+template<typename T>
+T columnMax(const QVector<T> &column)
+{
+    T result = 0;
+    for (T value : column) {
+        result = qMax(result, value);
+    }
+    return result;
+}
+
+} // namespace
+
+template<typename Store, typename Visitor>
+bool FlowSnapshot::forEachColumn(Store &store, bool coldPending, Visitor visit)
+{
+    const bool hot = visit(store.m_stationId)
+        && visit(store.m_dayNumber)
+        && visit(store.m_departureMinute)
+        && visit(store.m_boarding)
+        && visit(store.m_alighting)
+        && visit(store.m_revenue)
+        && visit(store.m_trainId)
+        && visit(store.m_ticketTypeId);
+    if (!hot) {
+        return false;
+    }
+    if (coldPending) {
+        return visit(store.m_rowOffsets);
+    }
+    return visit(store.m_arrivalMinute)
+        && visit(store.m_ticketPrice)
+        && visit(store.m_lineId)
+        && visit(store.m_startStationId)
+        && visit(store.m_endStationId);
+}
+
+FlowSnapshot::SourceFile FlowSnapshot::fingerprint(const QString &path)
+{
+    SourceFile source;
+    QFileInfo info(path);
+    source.fileName = info.fileName();
+    if (!info.exists()) {
+        return source;
+    }
+    source.size = info.size();
+    source.modified = info.lastModified().toMSecsSinceEpoch();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return source;
+    }
+
+    // 小文件整体哈希；大文件只取均匀分布的若干块（含首尾），启动时几乎不花时间
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (source.size <= kSampleBlockSize * kSampleBlockCount) {
+        hash.addData(file.readAll());
+    } else {
+        const qint64 stride = (source.size - kSampleBlockSize) / (kSampleBlockCount - 1);
+        for (int i = 0; i < kSampleBlockCount; ++i) {
+            file.seek(i * stride);
+            hash.addData(file.read(kSampleBlockSize));
+        }
+    }
+    source.sampleHash = hash.result();
+    return source;
+}
+
+QString FlowSnapshot::defaultPath(const QString &dataDirectory)
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheDir.isEmpty()) {
+        cacheDir = QDir::tempPath();
+    }
+
+    // 每个数据目录一个快照，以目录绝对路径的哈希命名
+    const QByteArray key = QCryptographicHash::hash(QDir(dataDirectory).absolutePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex().left(16);
+    return QDir(cacheDir).filePath(QString("snapshots/%1.snapshot").arg(QString::fromLatin1(key)));
+}
+
+bool FlowSnapshot::write(const QString &snapshotPath, const QVector<SourceFile> &sources,
+                         const QVector<StationRecord> &stations, const QVector<TrainRecord> &trains,
+                         const FlowStore &flows, QString *error)
+{
+    // 冷列未解码时快照只存行偏移，读回后同样按需解码
+    const bool coldPending = flows.hasPendingColdColumns();
+    QByteArray meta;
+    {
+        QDataStream out(&meta, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+
+        out << static_cast<qint32>(sources.size());
+        for (const SourceFile &source : sources) {
+            out << source.fileName << source.size << source.modified << source.sampleHash;
+        }
+
+        out << static_cast<qint32>(stations.size());
+        for (const StationRecord &station : stations) {
+            out << static_cast<qint32>(station.id) << station.name << station.code
+                << station.shortName << station.telecode;
+        }
+
+        out << static_cast<qint32>(trains.size());
+        for (const TrainRecord &train : trains) {
+            out << train.code << train.trainCode << static_cast<qint32>(train.capacity);
+        }
+
+        writeDictionary(out, flows.m_lineCodes);
+        writeDictionary(out, flows.m_trainCodes);
+        writeDictionary(out, flows.m_ticketTypes);
+        writeDictionary(out, flows.m_stationNames);
+        out << static_cast<qint32>(flows.size()) << coldPending;
+    }
+
+    QDir().mkpath(QFileInfo(snapshotPath).absolutePath());
+    QSaveFile file(snapshotPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(error, QString("无法创建快照文件: %1\n错误: %2").arg(snapshotPath).arg(file.errorString()));
+        return false;
+    }
+
+    FileHeader header;
+    header.magic = Magic;
+    header.version = Version;
+    header.metaSize = meta.size();
+    header.metaChecksum = checksum(meta.constData(), meta.size());
+
+    qint64 position = 0;
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header))
+           && file.write(meta) == meta.size();
+    position = sizeof(header) + meta.size();
+    ok = ok && writePadding(file, position);
+
+    ok = ok && forEachColumn(flows, coldPending, [&file, &position](const auto &column) {
+        const qint64 bytes = column.size() * qint64(sizeof(column[0]));
+        if (bytes > 0 && file.write(reinterpret_cast<const char*>(column.constData()), bytes) != bytes) {
+            return false;
+        }
+        position += bytes;
+        return writePadding(file, position);
+    });
+
+    if (!ok || !file.commit()) {
+        setError(error, QString("写入快照文件失败: %1\n错误: %2").arg(snapshotPath).arg(file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool FlowSnapshot::read(const QString &snapshotPath, const QVector<SourceFile> &sources,
+                        QVector<StationRecord> &stations, QVector<TrainRecord> &trains,
+                        FlowStore &flows, QString *error)
+{
+    QFile file(snapshotPath);
+    if (!file.exists()) {
+        setError(error, QString("快照不存在: %1").arg(snapshotPath));
+        return false;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, QString("无法打开快照文件: %1\n错误: %2").arg(snapshotPath).arg(file.errorString()));
+        return false;
+    }
+
+    const qint64 fileSize = file.size();
+    if (fileSize < qint64(sizeof(FileHeader))) {
+        setError(error, "快照文件已损坏：文件过短");
+        return false;
+    }
+
+    // 列数据直接从映射内存拷入各列；映射失败时退回一次性读入
+    QByteArray buffer;
+    const char *data = reinterpret_cast<const char*>(file.map(0, fileSize));
+    if (!data) {
+        buffer = file.readAll();
+        if (buffer.size() != fileSize) {
+            setError(error, QString("读取快照文件失败: %1").arg(file.errorString()));
+            return false;
+        }
+        data = buffer.constData();
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != Magic || header.version != Version) {
+        setError(error, QString("快照版本不符（%1），需要重新生成").arg(header.version));
+        return false;
+    }
+    if (header.metaSize > quint64(fileSize - sizeof(header))) {
+        setError(error, "快照文件已损坏：元数据长度越界");
+        return false;
+    }
+    const char *metaBegin = data + sizeof(header);
+    if (checksum(metaBegin, header.metaSize) != header.metaChecksum) {
+        setError(error, "快照文件已损坏：元数据校验失败");
+        return false;
+    }
+
+    QDataStream in(QByteArray::fromRawData(metaBegin, header.metaSize));
+    in.setVersion(QDataStream::Qt_6_0);
+
+    // 源文件指纹必须与当前CSV一致
+    qint32 sourceCount = 0;
+    in >> sourceCount;
+    bool fresh = sourceCount == sources.size();
+    for (qint32 i = 0; fresh && i < sourceCount && in.status() == QDataStream::Ok; ++i) {
+        SourceFile source;
+        in >> source.fileName >> source.size >> source.modified >> source.sampleHash;
+        fresh = source == sources[i];
+    }
+    if (!fresh) {
+        setError(error, "快照已过期：源CSV文件已变化");
+        return false;
+    }
+
+    QVector<StationRecord> stationRecords;
+    qint32 stationCount = 0;
+    in >> stationCount;
+    for (qint32 i = 0; i < stationCount && in.status() == QDataStream::Ok; ++i) {
+        StationRecord record;
+        qint32 id = 0;
+        in >> id >> record.name >> record.code >> record.shortName >> record.telecode;
+        record.id = id;
+        stationRecords.append(record);
+    }
+
+    QVector<TrainRecord> trainRecords;
+    qint32 trainCount = 0;
+    in >> trainCount;
+    for (qint32 i = 0; i < trainCount && in.status() == QDataStream::Ok; ++i) {
+        TrainRecord record;
+        qint32 capacity = 0;
+        in >> record.code >> record.trainCode >> capacity;
+        record.capacity = capacity;
+        trainRecords.append(record);
+    }
+
+    FlowStore loaded;
+    qint32 rowCount = 0;
+    bool coldPending = false;
+    bool ok = readDictionary(in, loaded.m_lineCodes)
+           && readDictionary(in, loaded.m_trainCodes)
+           && readDictionary(in, loaded.m_ticketTypes)
+           && readDictionary(in, loaded.m_stationNames);
+    in >> rowCount >> coldPending;
+    if (!ok || in.status() != QDataStream::Ok || rowCount < 0) {
+        setError(error, "快照文件已损坏：元数据无法解析");
+        return false;
+    }
+
+    qint64 position = alignUp(sizeof(header) + header.metaSize);
+    ok = forEachColumn(loaded, coldPending, [data, fileSize, rowCount, &position](auto &column) {
+        const qint64 bytes = rowCount * qint64(sizeof(column[0]));
+        if (position + bytes > fileSize) {
+            return false;
+        }
+        column.resize(rowCount);
+        if (bytes > 0) {
+            std::memcpy(column.data(), data + position, bytes);
+        }
+        position = alignUp(position + bytes);
+        return true;
+    });
+    if (!ok || position != fileSize) {
+        setError(error, "快照文件已损坏：列数据长度不符");
+        return false;
+    }
+
+    // 字典编号越界会在访问时崩溃，读入后统一检查一次
+    const bool idsValid = (rowCount == 0)
+        || (columnMax(loaded.m_trainId) < loaded.m_trainCodes.size()
+            && columnMax(loaded.m_ticketTypeId) < loaded.m_ticketTypes.size()
+            && (coldPending
+                || (columnMax(loaded.m_lineId) < loaded.m_lineCodes.size()
+                    && columnMax(loaded.m_startStationId) < loaded.m_stationNames.size()
+                    && columnMax(loaded.m_endStationId) < loaded.m_stationNames.size())));
+    if (!idsValid) {
+        setError(error, "快照文件已损坏：字典编号越界");
+        return false;
+    }
+
+    // 冷列来源由调用方按源文件设置
+    if (coldPending) {
+        loaded.m_coldPending.storeRelease(1);
+    }
+
+    // 全部校验通过后才写输出参数
+    stations = std::move(stationRecords);
+    trains = std::move(trainRecords);
+    flows = std::move(loaded);
+    return true;
+}
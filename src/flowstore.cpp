@@ -0,0 +1,492 @@
+#include "flowstore.h"
+#include "flowcoldsource.h"
+#include <QMutex>
+#include <QDebug>
+#include <algorithm>
+
+// 偏移表最多覆盖的天数（约两千八百年），日期异常时不按日期聚集，避免偏移表过大
+static const qint64 kMaxIndexedDays = 1024 * 1024;
+
+// 冷列解码很少发生（每个存储至多一次），所有存储共用一把锁
+static QMutex &coldColumnsMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+void FlowStore::reserve(int rows)
+{
+    m_stationId.reserve(rows);
+    m_dayNumber.reserve(rows);
+    m_departureMinute.reserve(rows);
+    m_boarding.reserve(rows);
+    m_alighting.reserve(rows);
+    m_revenue.reserve(rows);
+    m_trainId.reserve(rows);
+    m_ticketTypeId.reserve(rows);
+    if (hasPendingColdColumns()) {
+        m_rowOffsets.reserve(rows);
+        return;
+    }
+    m_arrivalMinute.reserve(rows);
+    m_ticketPrice.reserve(rows);
+    m_lineId.reserve(rows);
+    m_startStationId.reserve(rows);
+    m_endStationId.reserve(rows);
+}
+
+void FlowStore::clear()
+{
+    m_stationId.clear();
+    m_dayNumber.clear();
+    m_arrivalMinute.clear();
+    m_departureMinute.clear();
+    m_boarding.clear();
+    m_alighting.clear();
+    m_ticketPrice.clear();
+    m_revenue.clear();
+    m_lineId.clear();
+    m_trainId.clear();
+    m_ticketTypeId.clear();
+    m_startStationId.clear();
+    m_endStationId.clear();
+
+    m_lineCodes.clear();
+    m_trainCodes.clear();
+    m_ticketTypes.clear();
+    m_stationNames.clear();
+
+    m_rowOffsets.clear();
+    m_coldSource.reset();
+    m_coldPending.storeRelease(0);
+    m_coldError.clear();
+    m_dayOffsets.clear();
+}
+
+void FlowStore::append(const Record &record)
+{
+    ensureColdColumns();
+    const int firstRow = size();
+    m_stationId.append(record.stationId);
+    m_dayNumber.append(record.dayNumber);
+    m_arrivalMinute.append(static_cast<qint16>(record.arrivalMinute));
+    m_departureMinute.append(static_cast<qint16>(record.departureMinute));
+    m_boarding.append(record.boardingPassengers);
+    m_alighting.append(record.alightingPassengers);
+    m_ticketPrice.append(record.ticketPrice);
+    m_revenue.append(record.revenue);
+    m_lineId.append(dictId(record.lineId));
+    m_trainId.append(dictId(record.trainId));
+    m_ticketTypeId.append(dictId(record.ticketTypeId));
+    m_startStationId.append(dictId(record.startStationId));
+    m_endStationId.append(dictId(record.endStationId));
+    extendDayIndex(firstRow);
+}
+
+void FlowStore::deferColdColumns(const QSharedPointer<FlowColdSource> &source)
+{
+    // 已有整行数据时不能混入待解码的行
+    if (!isEmpty() && !hasPendingColdColumns()) {
+        qDebug() << "已解码的客流存储不能改为按需解码";
+        return;
+    }
+    m_coldSource = source;
+    m_coldPending.storeRelease(1);
+}
+
+void FlowStore::appendDeferred(const Record &record, qint64 rowOffset)
+{
+    if (!hasPendingColdColumns()) {
+        qDebug() << "客流存储未设置冷列来源，不能追加待解码的行";
+        return;
+    }
+    const int firstRow = size();
+    m_stationId.append(record.stationId);
+    m_dayNumber.append(record.dayNumber);
+    m_departureMinute.append(static_cast<qint16>(record.departureMinute));
+    m_boarding.append(record.boardingPassengers);
+    m_alighting.append(record.alightingPassengers);
+    m_revenue.append(record.revenue);
+    m_trainId.append(dictId(record.trainId));
+    m_ticketTypeId.append(dictId(record.ticketTypeId));
+    m_rowOffsets.append(rowOffset);
+    extendDayIndex(firstRow);
+}
+
+void FlowStore::materializeColdColumns() const
+{
+    QMutexLocker locker(&coldColumnsMutex());
+    if (!m_coldPending.loadRelaxed()) {
+        return;
+    }
+
+    FlowColdSource::Columns columns;
+    QString error;
+    if (!m_coldSource) {
+        error = "客流冷列缺少来源文件";
+    } else if (m_coldSource->decode(m_rowOffsets, m_stationId, m_dayNumber, columns, &error)) {
+        error.clear();
+    }
+    if (!error.isEmpty()) {
+        // 解码失败时存储标为冷列不可用并通知来源的持有者；冷列只填占位值，保证按行下标访问不越界，
+        // 依赖冷列的分析和导出先检查hasColdColumnsError。热列的统计不受影响
+        qDebug() << error;
+        m_coldError = error;
+        if (m_coldSource) {
+            m_coldSource->reportFailure(error);
+        }
+        const int rows = m_stationId.size();
+        columns = FlowColdSource::Columns();
+        columns.lineIds.fill(0, rows);
+        columns.arrivalMinutes.fill(-1, rows);
+        columns.ticketPrices.fill(0.0, rows);
+        columns.startStationIds.fill(0, rows);
+        columns.endStationIds.fill(0, rows);
+        columns.lineCodes.insert(QString());
+        columns.stationNames.insert(QString());
+    }
+
+    m_lineId = std::move(columns.lineIds);
+    m_arrivalMinute = std::move(columns.arrivalMinutes);
+    m_ticketPrice = std::move(columns.ticketPrices);
+    m_startStationId = std::move(columns.startStationIds);
+    m_endStationId = std::move(columns.endStationIds);
+    m_lineCodes = std::move(columns.lineCodes);
+    m_stationNames = std::move(columns.stationNames);
+    m_rowOffsets = QVector<qint64>();
+    m_coldSource.reset();
+    m_coldPending.storeRelease(0);
+}
+
+// target合并source之后是否仍在编号范围内
+static bool fitsMerged(const StringDictionary &target, const StringDictionary &source, const QString &name,
+                       QString *error)
+{
+    int size = target.size();
+    for (const QString &value : source.values()) {
+        if (target.find(value) < 0) {
+            ++size;
+        }
+    }
+    if (size <= FlowStore::MaxDictionarySize) {
+        return true;
+    }
+    if (error) {
+        *error = FlowStore::dictionaryOverflowError(name);
+    }
+    return false;
+}
+
+// 调用方已用fitsMerged确认合并后不超出编号范围
+static QVector<FlowStore::DictId> remapDictionary(StringDictionary &target, const StringDictionary &source)
+{
+    QVector<FlowStore::DictId> remap;
+    remap.reserve(source.size());
+    for (const QString &value : source.values()) {
+        remap.append(static_cast<FlowStore::DictId>(target.insert(value)));
+    }
+    return remap;
+}
+
+static void appendRemapped(QVector<FlowStore::DictId> &target, const QVector<FlowStore::DictId> &source,
+                           const QVector<FlowStore::DictId> &remap)
+{
+    for (FlowStore::DictId id : source) {
+        target.append(remap[id]);
+    }
+}
+
+// 空存储直接接过对方的冷列来源；同一来源的待解码行只需合并偏移
+bool FlowStore::appendsDeferred(const FlowStore &other) const
+{
+    if (!other.hasPendingColdColumns()) {
+        return false;
+    }
+    if (!hasPendingColdColumns()) {
+        return isEmpty();
+    }
+    return m_coldSource == other.m_coldSource;
+}
+
+bool FlowStore::canAppend(const FlowStore &other, QString *error) const
+{
+    const bool deferred = appendsDeferred(other);
+    if (!deferred) {
+        materializeColdColumns();
+        other.materializeColdColumns();
+    }
+    return fitsMerged(m_trainCodes, other.m_trainCodes, "车次", error)
+        && fitsMerged(m_ticketTypes, other.m_ticketTypes, "票种", error)
+        && (deferred || (fitsMerged(m_lineCodes, other.m_lineCodes, "线路", error)
+                         && fitsMerged(m_stationNames, other.m_stationNames, "起止站", error)));
+}
+
+bool FlowStore::append(const FlowStore &other, QString *error)
+{
+    if (!canAppend(other, error)) {
+        return false;
+    }
+    const bool deferred = appendsDeferred(other);
+    if (deferred && !hasPendingColdColumns()) {
+        m_coldSource = other.m_coldSource;
+        m_coldPending.storeRelease(1);
+    }
+
+    // 按对方字典的编号顺序插入，保证首次出现的顺序与逐行追加一致
+    QVector<DictId> trainRemap = remapDictionary(m_trainCodes, other.m_trainCodes);
+    QVector<DictId> ticketRemap = remapDictionary(m_ticketTypes, other.m_ticketTypes);
+
+    const int firstRow = size();
+    reserve(size() + other.size());
+    m_stationId.append(other.m_stationId);
+    m_dayNumber.append(other.m_dayNumber);
+    m_departureMinute.append(other.m_departureMinute);
+    m_boarding.append(other.m_boarding);
+    m_alighting.append(other.m_alighting);
+    m_revenue.append(other.m_revenue);
+    appendRemapped(m_trainId, other.m_trainId, trainRemap);
+    appendRemapped(m_ticketTypeId, other.m_ticketTypeId, ticketRemap);
+    if (deferred) {
+        m_rowOffsets.append(other.m_rowOffsets);
+    } else {
+        QVector<DictId> lineRemap = remapDictionary(m_lineCodes, other.m_lineCodes);
+        QVector<DictId> stationRemap = remapDictionary(m_stationNames, other.m_stationNames);
+        m_arrivalMinute.append(other.m_arrivalMinute);
+        m_ticketPrice.append(other.m_ticketPrice);
+        appendRemapped(m_lineId, other.m_lineId, lineRemap);
+        appendRemapped(m_startStationId, other.m_startStationId, stationRemap);
+        appendRemapped(m_endStationId, other.m_endStationId, stationRemap);
+        if (m_coldError.isEmpty()) {
+            m_coldError = other.m_coldError;
+        }
+    }
+    extendDayIndex(firstRow);
+    return true;
+}
+
+bool FlowStore::checkDictionaries(QString *error) const
+{
+    const StringDictionary *dictionaries[] = { &m_trainCodes, &m_ticketTypes, &m_lineCodes, &m_stationNames };
+    const char *names[] = { "车次", "票种", "线路", "起止站" };
+    for (int i = 0; i < 4; ++i) {
+        if (dictionaries[i]->size() > MaxDictionarySize) {
+            if (error) {
+                *error = dictionaryOverflowError(QString::fromUtf8(names[i]));
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+QString FlowStore::dictionaryOverflowError(const QString &name)
+{
+    return QString("客流数据中不同的%1超过%2种，超出列式存储的字典编号范围，无法加载")
+        .arg(name).arg(MaxDictionarySize);
+}
+
+template<typename T>
+static void removeColumnRows(QVector<T> &column, const QVector<int> &rows)
+{
+    int write = rows.first();
+    for (int i = 0; i < rows.size(); ++i) {
+        const int next = i + 1 < rows.size() ? rows[i + 1] : column.size();
+        for (int read = rows[i] + 1; read < next; ++read) {
+            column[write++] = column[read];
+        }
+    }
+    column.resize(write);
+}
+
+void FlowStore::removeRows(const QVector<int> &rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+    // 删除行不改变其余行的顺序，有序的存储删除后仍然有序
+    const bool sortedByDay = isSortedByDay();
+    removeColumnRows(m_stationId, rows);
+    removeColumnRows(m_dayNumber, rows);
+    removeColumnRows(m_departureMinute, rows);
+    removeColumnRows(m_boarding, rows);
+    removeColumnRows(m_alighting, rows);
+    removeColumnRows(m_revenue, rows);
+    removeColumnRows(m_trainId, rows);
+    removeColumnRows(m_ticketTypeId, rows);
+    if (hasPendingColdColumns()) {
+        removeColumnRows(m_rowOffsets, rows);
+    } else {
+        removeColumnRows(m_arrivalMinute, rows);
+        removeColumnRows(m_ticketPrice, rows);
+        removeColumnRows(m_lineId, rows);
+        removeColumnRows(m_startStationId, rows);
+        removeColumnRows(m_endStationId, rows);
+    }
+    if (sortedByDay) {
+        buildDayIndex();
+    }
+}
+
+template<typename T>
+static void permuteColumn(QVector<T> &column, const QVector<int> &order)
+{
+    QVector<T> sorted(order.size());
+    for (int i = 0; i < order.size(); ++i) {
+        sorted[i] = column[order[i]];
+    }
+    column = std::move(sorted);
+}
+
+void FlowStore::sortByDay()
+{
+    if (isEmpty() || buildDayIndex()) {
+        return;
+    }
+    const auto range = std::minmax_element(m_dayNumber.constBegin(), m_dayNumber.constEnd());
+    const qint64 span = qint64(*range.second) - *range.first + 1;
+    if (span > kMaxIndexedDays) {
+        qDebug() << "客流日期跨度过大，不按日期聚集:" << span << "天";
+        return;
+    }
+
+    // 计数排序：每天的行数的前缀和就是每天的起始行，再按原顺序逐行放入
+    const int firstDay = *range.first;
+    QVector<int> offsets(span + 1, 0);
+    for (qint32 day : m_dayNumber) {
+        offsets[day - firstDay + 1]++;
+    }
+    for (int k = 1; k <= span; ++k) {
+        offsets[k] += offsets[k - 1];
+    }
+    QVector<int> order(size());
+    QVector<int> next = offsets;
+    for (int row = 0; row < size(); ++row) {
+        order[next[m_dayNumber[row] - firstDay]++] = row;
+    }
+
+    permuteColumn(m_stationId, order);
+    permuteColumn(m_dayNumber, order);
+    permuteColumn(m_departureMinute, order);
+    permuteColumn(m_boarding, order);
+    permuteColumn(m_alighting, order);
+    permuteColumn(m_revenue, order);
+    permuteColumn(m_trainId, order);
+    permuteColumn(m_ticketTypeId, order);
+    if (hasPendingColdColumns()) {
+        // 冷列按重排后的偏移解码，自然与热列对齐
+        permuteColumn(m_rowOffsets, order);
+    } else {
+        permuteColumn(m_arrivalMinute, order);
+        permuteColumn(m_ticketPrice, order);
+        permuteColumn(m_lineId, order);
+        permuteColumn(m_startStationId, order);
+        permuteColumn(m_endStationId, order);
+    }
+    m_firstDay = firstDay;
+    m_dayOffsets = offsets;
+}
+
+bool FlowStore::buildDayIndex()
+{
+    m_dayOffsets.clear();
+    if (isEmpty()) {
+        return false;
+    }
+    for (int row = 1; row < size(); ++row) {
+        if (m_dayNumber[row] < m_dayNumber[row - 1]) {
+            return false;
+        }
+    }
+    const qint64 span = qint64(m_dayNumber.last()) - m_dayNumber.first() + 1;
+    if (span > kMaxIndexedDays) {
+        return false;
+    }
+
+    m_firstDay = m_dayNumber.first();
+    m_dayOffsets.reserve(span + 1);
+    m_dayOffsets.append(0);
+    int day = m_firstDay;
+    for (int row = 0; row < size(); ++row) {
+        for (; day < m_dayNumber[row]; ++day) {
+            m_dayOffsets.append(row);
+        }
+    }
+    m_dayOffsets.append(size());
+    return true;
+}
+
+void FlowStore::extendDayIndex(int firstRow)
+{
+    if (m_dayOffsets.isEmpty()) {
+        return;
+    }
+    // 去掉末尾的行数，逐行补上新出现的日期的起始行
+    m_dayOffsets.removeLast();
+    int lastDay = m_firstDay + m_dayOffsets.size() - 1;
+    for (int row = firstRow; row < size(); ++row) {
+        const int day = m_dayNumber[row];
+        if (day < lastDay || qint64(day) - m_firstDay >= kMaxIndexedDays) {
+            m_dayOffsets.clear();
+            return;
+        }
+        for (; lastDay < day; ++lastDay) {
+            m_dayOffsets.append(row);
+        }
+    }
+    m_dayOffsets.append(size());
+}
+
+bool FlowStore::dayRows(int startDay, int endDay, int *beginRow, int *endRow) const
+{
+    if (!isSortedByDay()) {
+        return false;
+    }
+    const int lastDay = m_firstDay + m_dayOffsets.size() - 2;
+    const int first = qBound(m_firstDay, startDay, lastDay + 1);
+    const int last = qBound(m_firstDay - 1, endDay, lastDay);
+    if (first > last) {
+        *beginRow = *endRow = 0;
+    } else {
+        *beginRow = m_dayOffsets[first - m_firstDay];
+        *endRow = m_dayOffsets[last - m_firstDay + 1];
+    }
+    return true;
+}
+
+FlowView FlowStore::dayRange(int startDay, int endDay) const
+{
+    int beginRow = 0;
+    int endRow = 0;
+    if (dayRows(startDay, endDay, &beginRow, &endRow)) {
+        return FlowView(this, beginRow, endRow);
+    }
+
+    QVector<int> rows;
+    for (int row = 0; row < size(); ++row) {
+        if (m_dayNumber[row] >= startDay && m_dayNumber[row] <= endDay) {
+            rows.append(row);
+        }
+    }
+    return FlowView(this, rows);
+}
+
+static qint64 dictionaryBytes(const StringDictionary &dictionary)
+{
+    qint64 bytes = 0;
+    for (const QString &value : dictionary.values()) {
+        // 字符串本身加上哈希表中的UTF-8键
+        bytes += value.size() * 3 + 64;
+    }
+    return bytes;
+}
+
+qint64 FlowStore::memoryUsage() const
+{
+    // 冷列未解码时每行只占一个偏移
+    const qint64 hotPerRow = sizeof(qint32) * 4 + sizeof(qint16) + sizeof(double) + sizeof(DictId) * 2;
+    const qint64 coldPerRow = hasPendingColdColumns() ? sizeof(qint64)
+                                                      : sizeof(qint16) + sizeof(double) + sizeof(DictId) * 3;
+    return (hotPerRow + coldPerRow) * m_stationId.capacity()
+         + dictionaryBytes(m_lineCodes) + dictionaryBytes(m_trainCodes)
+         + dictionaryBytes(m_ticketTypes) + dictionaryBytes(m_stationNames);
+}
@@ -0,0 +1,153 @@
+#include "flowvalidation.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QDebug>
+
+QString FlowValidation::ruleName(Rule rule)
+{
+    switch (rule) {
+    case MalformedRow: return "malformed_row";
+    case UnknownStation: return "unknown_station";
+    case UnknownTrain: return "unknown_train";
+    case InvalidDate: return "invalid_date";
+    case NegativeCount: return "negative_count";
+    case RevenueMismatch: return "revenue_mismatch";
+    default: return QString();
+    }
+}
+
+QString FlowValidation::ruleDescription(Rule rule)
+{
+    switch (rule) {
+    case MalformedRow: return "字段数不足";
+    case UnknownStation: return "站点ID不在站点表中";
+    case UnknownTrain: return "列车编码不在列车表中";
+    case InvalidDate: return "日期无效";
+    case NegativeCount: return "上下客量为负";
+    case RevenueMismatch: return "收入与票价不符";
+    default: return QString();
+    }
+}
+
+void FlowValidation::Chunk::reject(qint64 offset, quint8 ruleMask)
+{
+    for (int rule = 0; rule < RuleCount; ++rule) {
+        if (ruleMask & (1u << rule)) {
+            counts[rule]++;
+        }
+    }
+    offsets.append(offset);
+    rules.append(ruleMask);
+}
+
+QString FlowValidation::Report::toText() const
+{
+    QString text;
+    if (!error.isEmpty()) {
+        text += QString("数据质量检查未完成: %1\n").arg(error);
+    }
+    const double percent = rows > 0 ? 100.0 * rejectedRows / rows : 0.0;
+    text += QString("检查客流记录: %1 行（%2 个文件），用时 %3 ms\n").arg(rows).arg(files.size()).arg(elapsedMs);
+    text += QString("违规记录: %1 行（%2%）\n").arg(rejectedRows).arg(percent, 0, 'f', 2);
+    for (int rule = 0; rule < RuleCount; ++rule) {
+        text += QString("  %1: %2\n").arg(ruleDescription(static_cast<Rule>(rule))).arg(counts[rule]);
+    }
+    if (!quarantinePath.isEmpty()) {
+        text += QString("隔离文件: %1\n").arg(quarantinePath);
+    }
+    return text;
+}
+
+QString FlowValidation::defaultBasePath(const QString &dataDirectory)
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheDir.isEmpty()) {
+        cacheDir = QDir::tempPath();
+    }
+
+    const QByteArray key = QCryptographicHash::hash(QDir(dataDirectory).absolutePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex().left(16);
+    return QDir(cacheDir).filePath(QString("validation/%1").arg(QString::fromLatin1(key)));
+}
+
+bool FlowValidation::Writer::open(const QString &basePath, Report &report, QString *error)
+{
+    report.quarantinePath = basePath + ".quarantine.tsv";
+    report.reportPath = basePath + ".report.txt";
+
+    QDir().mkpath(QFileInfo(report.quarantinePath).absolutePath());
+    m_quarantine.setFileName(report.quarantinePath);
+    if (!m_quarantine.open(QIODevice::WriteOnly)) {
+        *error = QString("无法写入隔离文件: %1\n错误: %2").arg(report.quarantinePath).arg(m_quarantine.errorString());
+        return false;
+    }
+    // 偏移是行首在（解压后）文件中的字节位置，可以直接seek回原始数据
+    m_quarantine.write("file\toffset\trules\n");
+    return true;
+}
+
+bool FlowValidation::Writer::append(const QString &file, const Chunk &chunk, Report &report, QString *error)
+{
+    report.rows += chunk.rows;
+    report.rejectedRows += chunk.offsets.size();
+    for (int rule = 0; rule < RuleCount; ++rule) {
+        report.counts[rule] += chunk.counts[rule];
+    }
+    if (chunk.offsets.isEmpty()) {
+        return true;
+    }
+
+    const QByteArray fileName = file.toUtf8();
+    QByteArray lines;
+    lines.reserve(chunk.offsets.size() * (fileName.size() + 40));
+    for (int i = 0; i < chunk.offsets.size(); ++i) {
+        lines += fileName;
+        lines += '\t';
+        lines += QByteArray::number(chunk.offsets[i]);
+        lines += '\t';
+        bool first = true;
+        for (int rule = 0; rule < RuleCount; ++rule) {
+            if (chunk.rules[i] & (1u << rule)) {
+                if (!first) {
+                    lines += ',';
+                }
+                lines += ruleName(static_cast<Rule>(rule)).toLatin1();
+                first = false;
+            }
+        }
+        lines += '\n';
+    }
+    if (m_quarantine.write(lines) != lines.size()) {
+        *error = QString("写入隔离文件失败: %1\n错误: %2").arg(report.quarantinePath).arg(m_quarantine.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool FlowValidation::Writer::finish(Report &report, QString *error)
+{
+    if (!m_quarantine.commit()) {
+        *error = QString("保存隔离文件失败: %1\n错误: %2").arg(report.quarantinePath).arg(m_quarantine.errorString());
+        return false;
+    }
+
+    QSaveFile file(report.reportPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = QString("无法写入检查报告: %1\n错误: %2").arg(report.reportPath).arg(file.errorString());
+        return false;
+    }
+    QString text = report.toText();
+    text += "客流文件:\n";
+    for (const QString &source : report.files) {
+        text += QString("  %1\n").arg(source);
+    }
+    file.write(text.toUtf8());
+    if (!file.commit()) {
+        *error = QString("保存检查报告失败: %1\n错误: %2").arg(report.reportPath).arg(file.errorString());
+        return false;
+    }
+    qDebug() << "数据质量检查报告已写入" << report.reportPath;
+    return true;
+}
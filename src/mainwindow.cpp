@@ -10,7 +10,6 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QApplication>
-#include <QProgressDialog>
 #include <QCloseEvent>
 #include <QDebug> // Added for qDebug()
 #include <QTimer> // 添加用于延迟加载数据
@@ -32,6 +31,12 @@ MainWindow::MainWindow(QWidget *parent)
     // Connect data manager signals
     connect(m_dataManager, &DataManager::dataLoaded, this, &MainWindow::onDataLoaded);
     connect(m_dataManager, &DataManager::dataLoadError, this, &MainWindow::onDataLoadError);
+    connect(m_dataManager, &DataManager::stationsAndTrainsLoaded, this, &MainWindow::onStationsAndTrainsLoaded);
+    connect(m_dataManager, &DataManager::progress, this, &MainWindow::onLoadProgress);
+    connect(m_dataManager, &DataManager::loadingCancelled, this, &MainWindow::onLoadingCancelled);
+    connect(m_dataManager, &DataManager::partitionsLoaded, this, &MainWindow::onPartitionsLoaded);
+    connect(m_dataManager, &DataManager::flowsAppended, this, &MainWindow::onFlowsAppended);
+    connect(m_dataManager, &DataManager::validationFinished, this, &MainWindow::onValidationFinished);
     
     // Load settings
     loadSettings();
@@ -99,6 +104,17 @@ void MainWindow::setupMenuBar()
     QMenu *fileMenu = menuBar->addMenu("文件(&F)");
     QAction *loadAction = fileMenu->addAction("加载数据(&L)", this, &MainWindow::onLoadData);
     loadAction->setShortcut(QKeySequence::Open);
+    m_cancelLoadAction = fileMenu->addAction("取消加载(&X)", this, &MainWindow::onCancelLoad);
+    m_cancelLoadAction->setEnabled(false);
+    QAction *tailAction = fileMenu->addAction("追加数据自动更新(&U)");
+    tailAction->setCheckable(true);
+    connect(tailAction, &QAction::toggled, this, &MainWindow::onTailModeToggled);
+    QAction *outOfCoreAction = fileMenu->addAction("核外模式(&O)");
+    outOfCoreAction->setCheckable(true);
+    connect(outOfCoreAction, &QAction::toggled, this, &MainWindow::onOutOfCoreToggled);
+    fileMenu->addAction("保存到数据库(&B)...", this, &MainWindow::onSaveToDatabase);
+    fileMenu->addAction("从数据库加载(&D)...", this, &MainWindow::onLoadFromDatabase);
+    fileMenu->addAction("导出列式客流文件(&M)...", this, &MainWindow::onExportFlows);
     fileMenu->addSeparator();
     QAction *exportDataAction = fileMenu->addAction("导出数据(&E)", this, &MainWindow::onExportData);
     exportDataAction->setShortcut(QKeySequence::Save);
@@ -132,6 +148,7 @@ void MainWindow::setupMenuBar()
 
     // Tools menu
     QMenu *toolsMenu = menuBar->addMenu("工具(&T)");
+    toolsMenu->addAction("数据质量检查(&V)", this, &MainWindow::onValidateData);
     toolsMenu->addAction("设置(&S)", this, &MainWindow::onSettings);
     
     // Help menu
@@ -145,6 +162,7 @@ void MainWindow::setupToolBar()
     toolBar->setMovable(false);
     
     toolBar->addAction("加载数据", this, &MainWindow::onLoadData);
+    toolBar->addAction(m_cancelLoadAction);
     toolBar->addSeparator();
     toolBar->addAction("站点分析", this, &MainWindow::onAnalyzeStations);
     toolBar->addAction("列车分析", this, &MainWindow::onAnalyzeTrains);
@@ -340,18 +358,201 @@ void MainWindow::onLoadData()
                                                     | QFileDialog::DontResolveSymlinks);
     if (!dir.isEmpty()) {
         m_settings->setValue("lastDataDir", dir);
-        QProgressDialog progress("正在加载数据...", "取消", 0, 0, this);
-        progress.setWindowModality(Qt::WindowModal);
-        progress.show();
-        QApplication::processEvents(); // Ensure progress dialog is shown
 
-        m_dataManager->loadDataFromDirectory(dir);
+        // 在后台线程加载，界面保持响应；进度显示在状态栏
+        m_progressBar->setRange(0, 100);
+        m_progressBar->setValue(0);
+        m_progressBar->setVisible(true);
+        m_cancelLoadAction->setEnabled(true);
+        updateStatus("正在加载数据...");
+        updateControlStates();
+
+        // 分区数据集只加载当前日期范围内的分区
+        m_dataManager->setDateWindow(m_startDateEdit->date(), m_endDateEdit->date());
+        m_dataManager->loadDataFromDirectoryAsync(dir);
+        if (!m_dataManager->isLoading()) {
+            // 目录检查未通过，错误已经通过dataLoadError报告
+            m_progressBar->setVisible(false);
+            m_cancelLoadAction->setEnabled(false);
+        }
+    }
+}
+
+void MainWindow::onCancelLoad()
+{
+    if (m_dataManager->isLoading()) {
+        m_dataManager->cancelLoading();
+        m_cancelLoadAction->setEnabled(false);
+        updateStatus("正在取消加载...");
+    }
+}
+
+void MainWindow::onLoadProgress(qint64 bytesRead, qint64 totalBytes)
+{
+    if (totalBytes > 0) {
+        m_progressBar->setValue(static_cast<int>(qMin<qint64>(100, bytesRead * 100 / totalBytes)));
+    }
+}
+
+void MainWindow::onStationsAndTrainsLoaded()
+{
+    // 站点和列车先可用，筛选下拉框不必等客流数据
+    m_stationCombo->clear();
+    m_stationCombo->addItem("全部站点");
+    m_stationCombo->addItems(m_dataManager->getStationNames());
+
+    m_trainCombo->clear();
+    m_trainCombo->addItem("全部列车");
+    m_trainCombo->addItems(m_dataManager->getTrainNumbers());
+
+    if (m_dataManager->isLoading()) {
+        updateStatus("站点和列车已加载，正在加载客流数据...");
+    }
+}
+
+void MainWindow::onLoadingCancelled()
+{
+    m_progressBar->setVisible(false);
+    m_cancelLoadAction->setEnabled(false);
+    updateStatus("数据加载已取消");
+    updateControlStates();
+}
+
+void MainWindow::onPartitionsLoaded()
+{
+    m_progressBar->setVisible(false);
+    m_cancelLoadAction->setEnabled(false);
+    updateControlStates();
+
+    // 加载期间日期范围可能又变了，按最新范围再筛选一次（需要时会继续加载分区）
+    onFilterByDate();
+}
+
+void MainWindow::onTailModeToggled(bool enabled)
+{
+    m_dataManager->setTailModeEnabled(enabled);
+    updateStatus(enabled ? "客流文件有新数据追加时将自动更新" : "已关闭追加数据自动更新");
+}
+
+void MainWindow::onOutOfCoreToggled(bool enabled)
+{
+    // 下次加载时生效：客流转成块文件，分析时按块读入，内存占用受缓冲池上限约束
+    m_dataManager->setOutOfCoreEnabled(enabled);
+    updateStatus(enabled ? "核外模式已开启，重新加载数据后生效" : "核外模式已关闭，重新加载数据后生效");
+}
+
+void MainWindow::onFlowsAppended(int firstRow, int count)
+{
+    Q_UNUSED(firstRow);
+    updateStatus(QString("追加了 %1 条客流记录").arg(count));
+
+    // 只刷新正在显示的图表，不切换用户当前的标签页
+    if (m_tabWidget->currentWidget() == m_chartWidget) {
+        onAnalyze();
+    }
+}
+
+void MainWindow::onSaveToDatabase()
+{
+    if (!validateDataLoaded()) return;
+
+    QString filePath = QFileDialog::getSaveFileName(this, "保存到数据库",
+                                                    m_settings->value("lastDatabase", QDir::homePath()).toString(),
+                                                    "SQLite数据库 (*.sqlite *.db)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+    m_settings->setValue("lastDatabase", filePath);
+
+    updateStatus("正在保存到数据库...");
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool saved = m_dataManager->saveToDatabase(filePath);
+    QApplication::restoreOverrideCursor();
+    if (saved) {
+        updateStatus("数据已保存到数据库");
+    }
+}
+
+void MainWindow::onExportFlows()
+{
+    if (!validateDataLoaded()) return;
+
+    QString filePath = QFileDialog::getSaveFileName(this, "导出列式客流文件",
+                                                    m_settings->value("lastFlowExport", QDir::homePath()).toString(),
+                                                    "列式客流文件 (*.fcol)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+    if (!filePath.endsWith(".fcol", Qt::CaseInsensitive)) {
+        filePath += ".fcol";
+    }
+    m_settings->setValue("lastFlowExport", filePath);
+
+    updateStatus("正在导出列式客流文件...");
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool exported = m_dataManager->exportFlows(filePath);
+    QApplication::restoreOverrideCursor();
+    if (exported) {
+        updateStatus("客流已导出为列式文件");
+    }
+}
+
+void MainWindow::onValidateData()
+{
+    if (!validateDataLoaded() || m_dataManager->isLoading()) return;
+
+    // 重新扫描全部客流源文件，在后台线程进行，进度和取消与加载共用
+    if (!m_dataManager->validateDataAsync()) {
+        return;
     }
+    m_progressBar->setRange(0, 100);
+    m_progressBar->setValue(0);
+    m_progressBar->setVisible(true);
+    m_cancelLoadAction->setEnabled(true);
+    updateStatus("正在检查客流数据质量...");
+    updateControlStates();
+}
+
+void MainWindow::onValidationFinished(const FlowValidation::Report &report)
+{
+    m_progressBar->setVisible(false);
+    m_cancelLoadAction->setEnabled(false);
+    updateControlStates();
+    if (report.cancelled) {
+        updateStatus("数据质量检查已取消");
+        return;
+    }
+    if (!report.error.isEmpty()) {
+        showError("数据质量检查", report.toText());
+        return;
+    }
+    updateStatus(report.isClean() ? "客流数据质量检查通过" : QString("发现 %1 条违规记录").arg(report.rejectedRows));
+    showInfo("数据质量检查", report.toText());
+}
+
+void MainWindow::onLoadFromDatabase()
+{
+    if (m_dataManager->isLoading()) return;
+
+    QString filePath = QFileDialog::getOpenFileName(this, "从数据库加载",
+                                                    m_settings->value("lastDatabase", QDir::homePath()).toString(),
+                                                    "SQLite数据库 (*.sqlite *.db)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+    m_settings->setValue("lastDatabase", filePath);
+
+    // 只读站点和列车，客流留在数据库中按需查询
+    updateStatus("正在从数据库加载...");
+    m_dataManager->loadDataFromDatabase(filePath);
 }
 
 void MainWindow::onDataLoaded()
 {
-    updateStatus("数据加载成功");
+    m_progressBar->setVisible(false);
+    m_cancelLoadAction->setEnabled(false);
+    const qint64 duplicates = m_dataManager->duplicateRowCount();
+    updateStatus(duplicates > 0 ? QString("数据加载成功，丢弃重复记录 %1 条").arg(duplicates) : QString("数据加载成功"));
     QMessageBox::information(this, "成功", "所有数据文件已成功加载。");
     updateControlStates();
 
@@ -367,6 +568,8 @@ void MainWindow::onDataLoaded()
 
 void MainWindow::onDataLoadError(const QString &errorMessage)
 {
+    m_progressBar->setVisible(false);
+    m_cancelLoadAction->setEnabled(false);
     updateStatus("数据加载失败");
     QMessageBox::critical(this, "错误", "数据加载失败: \n" + errorMessage);
     updateControlStates();
@@ -628,6 +831,16 @@ void MainWindow::onFilterByDate()
     QDate endDate = m_endDateEdit->date();
     
     updateStatus(QString("正在按日期筛选：%1 至 %2").arg(startDate.toString("yyyy-MM-dd")).arg(endDate.toString("yyyy-MM-dd")));
+
+    // 分区数据集需要补充加载分区时，等partitionsLoaded后再分析
+    if (m_dataManager->setDateWindow(startDate, endDate)) {
+        m_progressBar->setRange(0, 100);
+        m_progressBar->setValue(0);
+        m_progressBar->setVisible(true);
+        m_cancelLoadAction->setEnabled(true);
+        updateStatus("正在加载日期范围内的客流分区...");
+        return;
+    }
     
     // 根据当前的分析类型重新加载数据
     onAnalyze();
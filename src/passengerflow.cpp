@@ -1,8 +1,7 @@
 #include "passengerflow.h"
 
-PassengerFlow::PassengerFlow(QObject *parent)
-    : QObject(parent)
-    , m_stationId(0)
+PassengerFlow::PassengerFlow()
+    : m_stationId(0)
     , m_boardingPassengers(0)
     , m_alightingPassengers(0)
     , m_ticketPrice(0.0)
@@ -13,9 +12,8 @@ PassengerFlow::PassengerFlow(QObject *parent)
 PassengerFlow::PassengerFlow(const QString &lineCode, const QString &trainCode, int stationId,
                              const QDate &date, const QTime &arrivalTime, const QTime &departureTime,
                              int boardingPassengers, int alightingPassengers, const QString &ticketType,
-                             double ticketPrice, double revenue, QObject *parent)
-    : QObject(parent)
-    , m_lineCode(lineCode)
+                             double ticketPrice, double revenue)
+    : m_lineCode(lineCode)
     , m_trainCode(trainCode)
     , m_stationId(stationId)
     , m_date(date)
@@ -0,0 +1,106 @@
+#include "perfecthash.h"
+#include <QSet>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// 单个桶尝试的种子上限；超过时放大槽位表重建
+const uint kMaxSeed = 1u << 16;
+
+} // namespace
+
+void PerfectHash::build(const QStringList &keys)
+{
+    clear();
+
+    QVector<int> unique;
+    {
+        QSet<QString> seen;
+        for (int i = 0; i < keys.size(); ++i) {
+            if (!keys[i].isEmpty() && !seen.contains(keys[i])) {
+                seen.insert(keys[i]);
+                unique.append(i);
+            }
+        }
+    }
+    if (unique.isEmpty()) {
+        return;
+    }
+    m_keys = keys;
+    m_count = unique.size();
+
+    // 平均每桶4个键，槽位留两成余量，每个桶通常几次尝试就能放下
+    const int bucketCount = qMax(1, m_count / 4);
+    int slotCount = m_count + m_count / 4 + 1;
+    QVector<QVector<int>> buckets(bucketCount);
+    for (int index : unique) {
+        buckets[slotHash(keys[index], 0) % bucketCount].append(index);
+    }
+
+    // 大桶先放：越往后空槽越少，小桶更容易找到位置
+    QVector<int> order(bucketCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&buckets](int a, int b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    QVector<uint> candidate;
+    bool placed = false;
+    while (!placed) {
+        m_seeds.fill(0, bucketCount);
+        m_slots.fill(-1, slotCount);
+        placed = true;
+        for (int bucket : order) {
+            const QVector<int> &members = buckets[bucket];
+            if (members.isEmpty()) {
+                break;
+            }
+
+            bool found = false;
+            for (uint seed = 1; seed < kMaxSeed && !found; ++seed) {
+                candidate.clear();
+                found = true;
+                for (int index : members) {
+                    const uint slot = slotHash(keys[index], seed) % slotCount;
+                    if (m_slots[slot] >= 0 || candidate.contains(slot)) {
+                        found = false;
+                        break;
+                    }
+                    candidate.append(slot);
+                }
+                if (found) {
+                    for (int i = 0; i < members.size(); ++i) {
+                        m_slots[candidate[i]] = members[i];
+                    }
+                    m_seeds[bucket] = seed;
+                }
+            }
+            if (!found) {
+                placed = false;
+                break;
+            }
+        }
+        if (!placed) {
+            slotCount += slotCount / 2;
+        }
+    }
+}
+
+void PerfectHash::clear()
+{
+    m_seeds.clear();
+    m_slots.clear();
+    m_keys.clear();
+    m_count = 0;
+}
+
+int PerfectHash::find(const QString &key) const
+{
+    if (m_count == 0) {
+        return -1;
+    }
+    const uint bucket = slotHash(key, 0) % m_seeds.size();
+    const int index = m_slots[slotHash(key, m_seeds[bucket]) % m_slots.size()];
+    return index >= 0 && m_keys[index] == key ? index : -1;
+}
@@ -19,6 +19,47 @@ PredictionModel::PredictionModel(AnalysisEngine *analysisEngine, QObject *parent
 
 QVector<PredictionModel::PredictionResult> PredictionModel::predictPassengerFlow(
     const QDate &startDate, int days, const ModelParameters &params)
+{
+    const ModelParameters modelParams = params.windowSize > 0 ? params : m_currentParams;
+    const QString signature = predictionSignature("predictPassengerFlow", QString(), startDate, days, modelParams);
+    return m_analysisEngine->resultCache().get<QVector<PredictionResult>>(
+        signature, m_analysisEngine->dataGeneration(), [&]() {
+            return forecastPassengerFlow(startDate, days, modelParams);
+        });
+}
+
+QVector<PredictionModel::PredictionResult> PredictionModel::predictStationFlow(
+    const QString &stationName, const QDate &startDate, int days, const ModelParameters &params)
+{
+    const ModelParameters modelParams = params.windowSize > 0 ? params : m_currentParams;
+    const QString signature = predictionSignature("predictStationFlow", stationName, startDate, days, modelParams);
+    return m_analysisEngine->resultCache().get<QVector<PredictionResult>>(
+        signature, m_analysisEngine->dataGeneration(), [&]() {
+            return forecastStationFlow(stationName, startDate, days, modelParams);
+        });
+}
+
+QVector<PredictionModel::PredictionResult> PredictionModel::predictTrainFlow(
+    const QString &trainNumber, const QDate &startDate, int days, const ModelParameters &params)
+{
+    const ModelParameters modelParams = params.windowSize > 0 ? params : m_currentParams;
+    const QString signature = predictionSignature("predictTrainFlow", trainNumber, startDate, days, modelParams);
+    return m_analysisEngine->resultCache().get<QVector<PredictionResult>>(
+        signature, m_analysisEngine->dataGeneration(), [&]() {
+            return forecastTrainFlow(trainNumber, startDate, days, modelParams);
+        });
+}
+
+QString PredictionModel::predictionSignature(const char *method, const QString &target, const QDate &startDate,
+                                             int days, const ModelParameters &params) const
+{
+    // 预测中的随机扰动也随结果一起缓存，同样的查询在数据不变时得到同样的结果
+    return AnalysisCache::signature(method, target, startDate, days, params.windowSize, params.alpha,
+                                    params.beta, params.gamma, params.seasonality);
+}
+
+QVector<PredictionModel::PredictionResult> PredictionModel::forecastPassengerFlow(
+    const QDate &startDate, int days, const ModelParameters &params)
 {
     QVector<PredictionResult> predictions;
     
@@ -90,7 +131,7 @@ QVector<PredictionModel::PredictionResult> PredictionModel::predictPassengerFlow
     return predictions;
 }
 
-QVector<PredictionModel::PredictionResult> PredictionModel::predictStationFlow(
+QVector<PredictionModel::PredictionResult> PredictionModel::forecastStationFlow(
     const QString &stationName, const QDate &startDate, int days, const ModelParameters &params)
 {
     QVector<PredictionResult> predictions;
@@ -163,7 +204,7 @@ QVector<PredictionModel::PredictionResult> PredictionModel::predictStationFlow(
     return predictions;
 }
 
-QVector<PredictionModel::PredictionResult> PredictionModel::predictTrainFlow(
+QVector<PredictionModel::PredictionResult> PredictionModel::forecastTrainFlow(
     const QString &trainNumber, const QDate &startDate, int days, const ModelParameters &params)
 {
     QVector<PredictionResult> predictions;
@@ -0,0 +1,191 @@
+#include "routegraph.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <queue>
+#include <vector>
+
+void RouteGraph::build(const QVector<RouteStationRecord> &records)
+{
+    clear();
+
+    // 按线路分组（保持线路首次出现的顺序），组内按线路站点顺序排列
+    QHash<QString, int> lineByCode;
+    QVector<QVector<int>> lineRecords;
+    for (int i = 0; i < records.size(); ++i) {
+        auto it = lineByCode.find(records[i].lineCode);
+        if (it == lineByCode.end()) {
+            it = lineByCode.insert(records[i].lineCode, m_lineCodes.size());
+            m_lineCodes.append(records[i].lineCode);
+            lineRecords.append(QVector<int>());
+        }
+        lineRecords[it.value()].append(i);
+    }
+
+    struct Edge {
+        int from;
+        int to;
+        int distance;
+        int line;
+    };
+    QVector<Edge> edges;
+
+    m_lineOffsets.reserve(m_lineCodes.size() + 1);
+    m_lineOffsets.append(0);
+    for (int line = 0; line < lineRecords.size(); ++line) {
+        QVector<int> &rows = lineRecords[line];
+        std::stable_sort(rows.begin(), rows.end(), [&records](int a, int b) {
+            return records[a].order < records[b].order;
+        });
+
+        int distance = 0;
+        int previousNode = -1;
+        for (int position = 0; position < rows.size(); ++position) {
+            const RouteStationRecord &record = records[rows[position]];
+            if (position > 0) {
+                distance += record.sectionDistance;
+            }
+
+            int node = m_nodeByStation.value(record.stationId, -1);
+            if (node < 0) {
+                node = m_stationIds.size();
+                m_nodeByStation.insert(record.stationId, node);
+                m_stationIds.append(record.stationId);
+            }
+
+            m_lineStations.append(record.stationId);
+            m_lineDistances.append(distance);
+            m_lineTransportDistances.append(record.transportDistance);
+            m_lineStops.append(record.stop);
+
+            if (previousNode >= 0 && previousNode != node) {
+                edges.append({ previousNode, node, record.sectionDistance, line });
+                edges.append({ node, previousNode, record.sectionDistance, line });
+            }
+            previousNode = node;
+        }
+        m_lineOffsets.append(m_lineStations.size());
+    }
+
+    // 计数排序成CSR：先统计每个顶点的出边数，前缀和得到起始位置，再依次填入
+    m_edgeOffsets.fill(0, m_stationIds.size() + 1);
+    for (const Edge &edge : edges) {
+        m_edgeOffsets[edge.from + 1]++;
+    }
+    for (int node = 0; node < m_stationIds.size(); ++node) {
+        m_edgeOffsets[node + 1] += m_edgeOffsets[node];
+    }
+
+    m_edgeTargets.resize(edges.size());
+    m_edgeDistances.resize(edges.size());
+    m_edgeLines.resize(edges.size());
+    QVector<int> cursor = m_edgeOffsets;
+    for (const Edge &edge : edges) {
+        const int slot = cursor[edge.from]++;
+        m_edgeTargets[slot] = edge.to;
+        m_edgeDistances[slot] = edge.distance;
+        m_edgeLines[slot] = static_cast<quint16>(edge.line);
+    }
+}
+
+void RouteGraph::clear()
+{
+    m_stationIds.clear();
+    m_nodeByStation.clear();
+    m_edgeOffsets.clear();
+    m_edgeTargets.clear();
+    m_edgeDistances.clear();
+    m_edgeLines.clear();
+    m_lineCodes.clear();
+    m_lineOffsets.clear();
+    m_lineStations.clear();
+    m_lineDistances.clear();
+    m_lineTransportDistances.clear();
+    m_lineStops.clear();
+}
+
+int RouteGraph::linePosition(int line, int stationId) const
+{
+    for (int position = 0; position < lineStationCount(line); ++position) {
+        if (lineStationId(line, position) == stationId) {
+            return position;
+        }
+    }
+    return -1;
+}
+
+int RouteGraph::distanceAlongLine(int line, int fromStationId, int toStationId) const
+{
+    const int from = linePosition(line, fromStationId);
+    const int to = linePosition(line, toStationId);
+    if (from < 0 || to < 0) {
+        return -1;
+    }
+    return qAbs(lineDistance(line, to) - lineDistance(line, from));
+}
+
+int RouteGraph::shortestDistance(int fromStationId, int toStationId, QVector<int> *path) const
+{
+    const int source = nodeOf(fromStationId);
+    const int target = nodeOf(toStationId);
+    if (path) {
+        path->clear();
+    }
+    if (source < 0 || target < 0) {
+        return -1;
+    }
+
+    QVector<int> distance(nodeCount(), INT_MAX);
+    QVector<int> previous(nodeCount(), -1);
+    typedef std::pair<int, int> Entry;   // (距离, 顶点)
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    distance[source] = 0;
+    queue.push(Entry(0, source));
+
+    while (!queue.empty()) {
+        const Entry top = queue.top();
+        queue.pop();
+        const int node = top.second;
+        if (top.first > distance[node]) {
+            continue;   // 已有更短的路径
+        }
+        if (node == target) {
+            break;
+        }
+        for (int edge = edgeBegin(node); edge < edgeEnd(node); ++edge) {
+            const int next = m_edgeTargets[edge];
+            const int candidate = top.first + m_edgeDistances[edge];
+            if (candidate < distance[next]) {
+                distance[next] = candidate;
+                previous[next] = node;
+                queue.push(Entry(candidate, next));
+            }
+        }
+    }
+
+    if (distance[target] == INT_MAX) {
+        return -1;
+    }
+    if (path) {
+        for (int node = target; node >= 0; node = previous[node]) {
+            path->prepend(m_stationIds[node]);
+        }
+    }
+    return distance[target];
+}
+
+qint64 RouteGraph::memoryUsage() const
+{
+    qint64 bytes = 0;
+    bytes += m_stationIds.capacity() * qint64(sizeof(int));
+    bytes += m_nodeByStation.size() * qint64(2 * sizeof(int));
+    bytes += (m_edgeOffsets.capacity() + m_edgeTargets.capacity() + m_edgeDistances.capacity()) * qint64(sizeof(int));
+    bytes += m_edgeLines.capacity() * qint64(sizeof(quint16));
+    bytes += (m_lineOffsets.capacity() + m_lineStations.capacity() + m_lineDistances.capacity()
+              + m_lineTransportDistances.capacity()) * qint64(sizeof(int));
+    bytes += m_lineStops.capacity() * qint64(sizeof(bool));
+    for (const QString &code : m_lineCodes) {
+        bytes += code.size() * qint64(sizeof(QChar));
+    }
+    return bytes;
+}
@@ -0,0 +1,35 @@
+#include "stringdictionary.h"
+#include "csvtokenizer.h"
+
+int StringDictionary::insert(QByteArrayView utf8)
+{
+    utf8 = CsvTokenizer::trimmed(utf8);
+    const QByteArray key = QByteArray::fromRawData(utf8.data(), utf8.size());
+    auto it = m_ids.constFind(key);
+    if (it != m_ids.constEnd()) {
+        return it.value();
+    }
+
+    // 第一次出现：复制键并解码
+    int id = m_values.size();
+    m_values.append(QString::fromUtf8(utf8));
+    m_ids.insert(QByteArray(utf8.data(), utf8.size()), id);
+    return id;
+}
+
+int StringDictionary::find(const QString &value) const
+{
+    return m_ids.value(value.trimmed().toUtf8(), -1);
+}
+
+int StringDictionary::find(QByteArrayView utf8) const
+{
+    utf8 = CsvTokenizer::trimmed(utf8);
+    return m_ids.value(QByteArray::fromRawData(utf8.data(), utf8.size()), -1);
+}
+
+void StringDictionary::clear()
+{
+    m_ids.clear();
+    m_values.clear();
+}
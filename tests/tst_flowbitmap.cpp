@@ -0,0 +1,193 @@
+#include <QtTest>
+#include <QSet>
+#include <QRandomGenerator>
+#include <algorithm>
+#include "flowbitmap.h"
+
+// 位图的集合运算与QSet<int>逐个比较，覆盖数组容器、位图容器以及两者在ArrayLimit处的互相转换
+class TestFlowBitmap : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void setOperations_data();
+    void setOperations();
+    void arrayLimitConversion();
+    void rangeAcrossContainers();
+
+private:
+    static constexpr int RowCount = 3 * 65536 + 100;
+
+    static FlowBitmap build(const QSet<int> &rows, bool useRange = false);
+    static void compare(const FlowBitmap &bitmap, const QSet<int> &expected);
+    static QSet<int> randomRows(QRandomGenerator &random, int count, int limit);
+};
+
+Q_DECLARE_METATYPE(QSet<int>)
+
+FlowBitmap TestFlowBitmap::build(const QSet<int> &rows, bool useRange)
+{
+    QVector<int> sorted = rows.values();
+    std::sort(sorted.begin(), sorted.end());
+    if (useRange && !sorted.isEmpty() && sorted.last() - sorted.first() + 1 == sorted.size()) {
+        return FlowBitmap::range(sorted.first(), sorted.last() + 1);
+    }
+    return FlowBitmap::fromRows(sorted);
+}
+
+void TestFlowBitmap::compare(const FlowBitmap &bitmap, const QSet<int> &expected)
+{
+    QVector<int> sorted = expected.values();
+    std::sort(sorted.begin(), sorted.end());
+    QCOMPARE(bitmap.cardinality(), int(sorted.size()));
+    QCOMPARE(bitmap.isEmpty(), sorted.isEmpty());
+    QCOMPARE(bitmap.toRows(), sorted);
+
+    QVector<int> visited;
+    bitmap.forEach([&visited](int row) { visited.append(row); });
+    QCOMPARE(visited, sorted);
+
+    // 容器边界附近和随机位置的查询
+    for (int row : { 0, 1, 65535, 65536, 65537, 2 * 65536 - 1, 2 * 65536, RowCount - 1 }) {
+        QCOMPARE(bitmap.contains(row), expected.contains(row));
+    }
+    QRandomGenerator random(7);
+    for (int i = 0; i < 1000; ++i) {
+        const int row = random.bounded(RowCount);
+        QCOMPARE(bitmap.contains(row), expected.contains(row));
+    }
+}
+
+QSet<int> TestFlowBitmap::randomRows(QRandomGenerator &random, int count, int limit)
+{
+    QSet<int> rows;
+    for (int i = 0; i < count; ++i) {
+        rows.insert(random.bounded(limit));
+    }
+    return rows;
+}
+
+void TestFlowBitmap::setOperations_data()
+{
+    QTest::addColumn<QSet<int>>("left");
+    QTest::addColumn<QSet<int>>("right");
+
+    QRandomGenerator random(20240601);
+    QSet<int> empty;
+    QSet<int> sparse = randomRows(random, 300, RowCount);
+    QSet<int> sparse2 = randomRows(random, 300, RowCount);
+    QSet<int> dense = randomRows(random, 100000, RowCount);
+    QSet<int> dense2 = randomRows(random, 100000, RowCount);
+    QSet<int> block;
+    for (int row = 40000; row < 150000; ++row) {
+        block.insert(row);
+    }
+
+    QTest::newRow("empty & sparse") << empty << sparse;
+    QTest::newRow("sparse & sparse") << sparse << sparse2;
+    QTest::newRow("sparse & dense") << sparse << dense;
+    QTest::newRow("dense & sparse") << dense << sparse;
+    QTest::newRow("dense & dense") << dense << dense2;
+    QTest::newRow("range & dense") << block << dense;
+    QTest::newRow("range & sparse") << block << sparse;
+    QTest::newRow("same set") << dense << dense;
+}
+
+void TestFlowBitmap::setOperations()
+{
+    QFETCH(QSet<int>, left);
+    QFETCH(QSet<int>, right);
+
+    for (bool useRange : { false, true }) {
+        const FlowBitmap a = build(left, useRange);
+        const FlowBitmap b = build(right, useRange);
+        compare(a, left);
+        compare(a & b, QSet<int>(left).intersect(right));
+        compare(a | b, QSet<int>(left).unite(right));
+        compare(a.andNot(b), QSet<int>(left).subtract(right));
+
+        QSet<int> complement;
+        for (int row = 0; row < RowCount; ++row) {
+            if (!left.contains(row)) {
+                complement.insert(row);
+            }
+        }
+        compare(a.complement(RowCount), complement);
+
+        // 组合运算的结果可以继续参与运算
+        compare((a | b) & a, left);
+        compare((a | b).andNot(b), QSet<int>(left).subtract(right));
+
+        FlowBitmap c = a;
+        c &= b;
+        compare(c, QSet<int>(left).intersect(right));
+        c |= a;
+        compare(c, left);
+    }
+}
+
+void TestFlowBitmap::arrayLimitConversion()
+{
+    // 一个块恰好ArrayLimit行时仍是数组容器，再多一行转成位图容器；
+    // 差集把行数降回ArrayLimit以内时转回数组，之后的运算结果都不变
+    QSet<int> rows;
+    FlowBitmap bitmap;
+    for (int i = 0; i < FlowBitmap::ArrayLimit; ++i) {
+        rows.insert(65536 + i * 3);
+        bitmap.add(65536 + i * 3);
+    }
+    compare(bitmap, rows);
+    const qint64 arrayUsage = bitmap.memoryUsage();
+
+    // 位图容器固定1024个字，与ArrayLimit项的数组一样大，比多一项的数组小
+    rows.insert(65536 + FlowBitmap::ArrayLimit * 3);
+    bitmap.add(65536 + FlowBitmap::ArrayLimit * 3);
+    compare(bitmap, rows);
+    QCOMPARE(bitmap.memoryUsage(), arrayUsage);
+
+    QSet<int> removed;
+    for (int i = 0; i < 10; ++i) {
+        removed.insert(65536 + i * 3);
+    }
+    const FlowBitmap shrunk = bitmap.andNot(build(removed));
+    const QSet<int> remaining = QSet<int>(rows).subtract(removed);
+    compare(shrunk, remaining);
+
+    // 恰好跨过界限的交集和并集
+    QSet<int> other;
+    for (int i = 0; i <= FlowBitmap::ArrayLimit; ++i) {
+        other.insert(65536 + i * 2);
+    }
+    const FlowBitmap otherBitmap = build(other);
+    compare(shrunk & otherBitmap, QSet<int>(remaining).intersect(other));
+    compare(shrunk | otherBitmap, QSet<int>(remaining).unite(other));
+    compare(otherBitmap.andNot(shrunk), QSet<int>(other).subtract(remaining));
+
+    // 位图容器的补集行数不超过ArrayLimit时同样转回数组
+    QSet<int> full;
+    for (int row = 0; row < 65536; ++row) {
+        full.insert(row);
+    }
+    QSet<int> holes;
+    for (int i = 0; i < FlowBitmap::ArrayLimit; ++i) {
+        holes.insert(i * 16);
+    }
+    const FlowBitmap dense = build(QSet<int>(full).subtract(holes));
+    compare(dense.complement(65536), holes);
+}
+
+void TestFlowBitmap::rangeAcrossContainers()
+{
+    for (const QPair<int, int> &range : { qMakePair(0, 0), qMakePair(5, 6), qMakePair(65530, 65542),
+                                          qMakePair(100, 2 * 65536 + 5), qMakePair(65536, 2 * 65536),
+                                          qMakePair(0, RowCount) }) {
+        QSet<int> expected;
+        for (int row = range.first; row < range.second; ++row) {
+            expected.insert(row);
+        }
+        compare(FlowBitmap::range(range.first, range.second), expected);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestFlowBitmap)
+#include "tst_flowbitmap.moc"
@@ -0,0 +1,219 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <climits>
+#include "flowcolumnfile.h"
+
+Q_DECLARE_METATYPE(FlowStore)
+
+// 列式文件的编码（BitPacked、zigzag Delta、字典、Plain）写出后再读回，逐列与原存储比较
+class TestFlowColumnFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void multipleBatches();
+    void corruptDictionaryColumn();
+
+private:
+    static void appendRow(FlowStore &store, int stationId, int dayNumber, int minute, int boarding, int alighting,
+                          double price, double revenue, const QString &train, const QString &ticketType,
+                          const QString &line, const QString &from, const QString &to);
+    static void compareStores(const FlowStore &actual, const FlowStore &expected);
+    static bool writeFile(const QString &path, const QVector<FlowStore> &batches);
+};
+
+void TestFlowColumnFile::appendRow(FlowStore &store, int stationId, int dayNumber, int minute, int boarding,
+                                   int alighting, double price, double revenue, const QString &train,
+                                   const QString &ticketType, const QString &line, const QString &from,
+                                   const QString &to)
+{
+    FlowStore::Record record;
+    record.stationId = stationId;
+    record.dayNumber = dayNumber;
+    record.arrivalMinute = minute;
+    record.departureMinute = minute >= 0 ? (minute + 5) % (24 * 60) : -1;
+    record.boardingPassengers = boarding;
+    record.alightingPassengers = alighting;
+    record.ticketPrice = price;
+    record.revenue = revenue;
+    record.trainId = store.trainCodes().insert(train);
+    record.ticketTypeId = store.ticketTypes().insert(ticketType);
+    record.lineId = store.lineCodes().insert(line);
+    record.startStationId = store.stationNames().insert(from);
+    record.endStationId = store.stationNames().insert(to);
+    store.append(record);
+}
+
+// 字典编号可以不同，比较的是每行解析出的字符串
+void TestFlowColumnFile::compareStores(const FlowStore &actual, const FlowStore &expected)
+{
+    QCOMPARE(actual.size(), expected.size());
+    QCOMPARE(actual.stationIds(), expected.stationIds());
+    QCOMPARE(actual.dayNumbers(), expected.dayNumbers());
+    QCOMPARE(actual.arrivalMinutes(), expected.arrivalMinutes());
+    QCOMPARE(actual.departureMinutes(), expected.departureMinutes());
+    QCOMPARE(actual.boardingPassengers(), expected.boardingPassengers());
+    QCOMPARE(actual.alightingPassengers(), expected.alightingPassengers());
+    QCOMPARE(actual.ticketPrices(), expected.ticketPrices());
+    QCOMPARE(actual.revenues(), expected.revenues());
+    for (int row = 0; row < expected.size(); ++row) {
+        QCOMPARE(actual.trainCodes().value(actual.trainIds()[row]),
+                 expected.trainCodes().value(expected.trainIds()[row]));
+        QCOMPARE(actual.ticketTypes().value(actual.ticketTypeIds()[row]),
+                 expected.ticketTypes().value(expected.ticketTypeIds()[row]));
+        QCOMPARE(actual.lineCodes().value(actual.lineIds()[row]),
+                 expected.lineCodes().value(expected.lineIds()[row]));
+        QCOMPARE(actual.stationNames().value(actual.startStationIds()[row]),
+                 expected.stationNames().value(expected.startStationIds()[row]));
+        QCOMPARE(actual.stationNames().value(actual.endStationIds()[row]),
+                 expected.stationNames().value(expected.endStationIds()[row]));
+    }
+}
+
+bool TestFlowColumnFile::writeFile(const QString &path, const QVector<FlowStore> &batches)
+{
+    FlowColumnFile::Writer writer;
+    QString error;
+    bool ok = writer.open(path, &error);
+    for (int i = 0; ok && i < batches.size(); ++i) {
+        ok = writer.append(batches[i], &error);
+    }
+    ok = ok && writer.finish(&error);
+    if (!ok) {
+        qWarning() << error;
+    }
+    return ok;
+}
+
+void TestFlowColumnFile::roundTrip_data()
+{
+    QTest::addColumn<FlowStore>("store");
+
+    // 单行：所有列的位宽都是0
+    FlowStore single;
+    appendRow(single, 1, 2460000, 480, 3, 4, 55.5, 222.0, "G1", "成人票", "CD-CQ", "成都东", "重庆北");
+    QTest::newRow("single row") << single;
+
+    // 按日期有序：日期列取Delta，差值经zigzag后只有0和1
+    FlowStore sorted;
+    for (int i = 0; i < 1000; ++i) {
+        appendRow(sorted, 100 + i % 7, 2460000 + i / 100, (i * 37) % (24 * 60), i % 50, i % 30, 10.0 + i % 9,
+                  (i % 50 + i % 30) * (10.0 + i % 9), QString("G%1").arg(i % 13), i % 2 ? "成人票" : "学生票",
+                  "CD-CQ", QString("站%1").arg(i % 5), QString("站%1").arg((i + 1) % 5));
+    }
+    QTest::newRow("sorted days") << sorted;
+
+    // 负数、-1（无效时间）和跨越整个32位范围的值：BitPacked的位宽到32位，
+    // 日期来回跳动时Delta的差值为负，zigzag后仍然正确还原
+    FlowStore wide;
+    const int days[] = { 2460000, 2459000, 2461000, 2459999, INT_MIN / 2, INT_MAX / 2, -1, 0 };
+    const int stations[] = { INT_MAX, INT_MIN, -1, 0, 1, -100000, 100000, 65536 };
+    for (int i = 0; i < 8; ++i) {
+        appendRow(wide, stations[i], days[i], i % 3 == 0 ? -1 : 1439 - i, -i * 1000, INT_MAX - i,
+                  i % 2 ? -0.5 * i : 1e9 + i, i % 2 ? -1e12 : 0.1 * i, QString("T%1").arg(i), QString(),
+                  QString("L%1").arg(i % 2), QString(), QString("终点%1").arg(i));
+    }
+    QTest::newRow("negative and wide values") << wide;
+
+    // 日期差值只有0和-1：zigzag后是0和1，Delta取1位
+    FlowStore descending;
+    for (int i = 0; i < 300; ++i) {
+        appendRow(descending, 7, 2460300 - i, -1, 1, 1, 1.0, 2.0, "K1", "成人票", "L", "A", "B");
+    }
+    QTest::newRow("descending days") << descending;
+}
+
+void TestFlowColumnFile::roundTrip()
+{
+    QFETCH(FlowStore, store);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("flows.fcol");
+    QVERIFY(writeFile(path, QVector<FlowStore>{ store }));
+
+    FlowColumnFile file;
+    QString error;
+    QVERIFY2(file.open(path, &error), qPrintable(error));
+    QCOMPARE(file.rowCount(), qint64(store.size()));
+
+    FlowStore loaded;
+    QVERIFY2(file.read(loaded, &error), qPrintable(error));
+    compareStores(loaded, store);
+}
+
+void TestFlowColumnFile::multipleBatches()
+{
+    // 各批的字典各自编号，写出时合并成全文件的字典
+    FlowStore first;
+    FlowStore second;
+    appendRow(first, 1, 2460000, 60, 1, 2, 3.0, 9.0, "G1", "成人票", "L1", "A", "B");
+    appendRow(first, 2, 2460001, 61, 4, 5, 6.0, 54.0, "G2", "学生票", "L2", "B", "C");
+    appendRow(second, 3, 2460002, -1, 7, 8, 9.0, 135.0, "G3", "学生票", "L2", "C", "D");
+    appendRow(second, 1, 2460003, 62, 0, 0, 0.0, 0.0, "G1", "儿童票", "L3", "D", "A");
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("flows.fcol");
+    QVERIFY(writeFile(path, QVector<FlowStore>{ first, second }));
+
+    FlowStore expected = first;
+    QVERIFY(expected.append(second));
+
+    FlowColumnFile file;
+    QString error;
+    QVERIFY2(file.open(path, &error), qPrintable(error));
+    FlowStore loaded;
+    QVERIFY2(file.read(loaded, &error), qPrintable(error));
+    compareStores(loaded, expected);
+
+    // 日期范围不相交的行组不读入
+    FlowStore none;
+    QVERIFY(file.read(none, &error, 2470000, 2470001));
+    QCOMPARE(none.size(), 0);
+}
+
+void TestFlowColumnFile::corruptDictionaryColumn()
+{
+    // 3个车次的编号取2位；把车次列的数据全部置1后解出编号3，超出尾部记录的最大编号，读取必须失败
+    FlowStore store;
+    for (int i = 0; i < 64; ++i) {
+        appendRow(store, 1, 2460000, 60, 1, 1, 1.0, 2.0, QString("G%1").arg(i % 3), "成人票", "L", "A", "B");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("flows.fcol");
+    QVERIFY(writeFile(path, QVector<FlowStore>{ store }));
+
+    qint64 offset = 0;
+    qint64 bytes = 0;
+    {
+        FlowColumnFile file;
+        QString error;
+        QVERIFY2(file.open(path, &error), qPrintable(error));
+        const FlowColumnFile::ColumnChunk &chunk = file.rowGroup(0).columns[1];
+        QCOMPARE(chunk.encoding, FlowColumnFile::Dictionary);
+        QCOMPARE(chunk.maxValue, 2.0);
+        offset = chunk.offset;
+        bytes = chunk.bytes;
+    }
+
+    QFile raw(path);
+    QVERIFY(raw.open(QIODevice::ReadWrite));
+    QVERIFY(raw.seek(offset));
+    QCOMPARE(raw.write(QByteArray(bytes, char(0xFF))), bytes);
+    raw.close();
+
+    FlowColumnFile file;
+    QString error;
+    QVERIFY2(file.open(path, &error), qPrintable(error));
+    FlowStore loaded;
+    QVERIFY(!file.read(loaded, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+QTEST_APPLESS_MAIN(TestFlowColumnFile)
+#include "tst_flowcolumnfile.moc"
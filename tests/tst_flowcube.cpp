@@ -0,0 +1,174 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <climits>
+#include "flowcube.h"
+
+// 立方体的日期范围合计与逐行扫描比较，包括分批累加、日期早于已有数据的批次和超出预算时失效
+class TestFlowCube : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void batches_data();
+    void batches();
+    void emptyAndOutOfRange();
+    void overBudget();
+
+private:
+    static void appendRows(FlowStore &store, QRandomGenerator &random, int rows, int firstDay, int days);
+    static FlowCube::Totals scan(const FlowStore &store, const QVector<int> &stationIds, int startDay, int endDay,
+                                 int hour);
+    static void compareTotals(const FlowCube::Totals &actual, const FlowCube::Totals &expected);
+};
+
+void TestFlowCube::appendRows(FlowStore &store, QRandomGenerator &random, int rows, int firstDay, int days)
+{
+    for (int i = 0; i < rows; ++i) {
+        FlowStore::Record record;
+        record.stationId = 1000 + random.bounded(6);
+        record.dayNumber = firstDay + random.bounded(days);
+        // 约十分之一的行发车时间无效（-1），计入小时-1
+        record.departureMinute = random.bounded(10) == 0 ? -1 : random.bounded(24 * 60);
+        record.boardingPassengers = random.bounded(100);
+        record.alightingPassengers = random.bounded(100);
+        record.revenue = random.bounded(10000) / 10.0;
+        record.trainId = store.trainCodes().insert(QString("G%1").arg(random.bounded(4)));
+        record.ticketTypeId = store.ticketTypes().insert(QString("成人票"));
+        record.lineId = store.lineCodes().insert(QString("CD-CQ"));
+        record.startStationId = store.stationNames().insert(QString());
+        record.endStationId = record.startStationId;
+        store.append(record);
+    }
+}
+
+// stationIds为空时统计全部站点
+FlowCube::Totals TestFlowCube::scan(const FlowStore &store, const QVector<int> &stationIds, int startDay,
+                                    int endDay, int hour)
+{
+    FlowCube::Totals totals;
+    for (int row = 0; row < store.size(); ++row) {
+        const int day = store.dayNumbers()[row];
+        const int departure = store.departureMinutes()[row];
+        const int rowHour = departure >= 0 && departure < 24 * 60 ? departure / 60 : -1;
+        if (day < startDay || day > endDay || (hour != FlowCube::AllHours && rowHour != hour)
+            || (!stationIds.isEmpty() && !stationIds.contains(store.stationIds()[row]))) {
+            continue;
+        }
+        totals.rows++;
+        totals.boarding += store.boardingPassengers()[row];
+        totals.alighting += store.alightingPassengers()[row];
+        totals.revenue += store.revenues()[row];
+    }
+    return totals;
+}
+
+void TestFlowCube::compareTotals(const FlowCube::Totals &actual, const FlowCube::Totals &expected)
+{
+    QCOMPARE(actual.rows, expected.rows);
+    QCOMPARE(actual.boarding, expected.boarding);
+    QCOMPARE(actual.alighting, expected.alighting);
+    QVERIFY2(qAbs(actual.revenue - expected.revenue) < 1e-6 * qMax(1.0, qAbs(expected.revenue)),
+             qPrintable(QString("%1 != %2").arg(actual.revenue).arg(expected.revenue)));
+}
+
+void TestFlowCube::batches_data()
+{
+    // 每批的日期起点相对第一批的偏移；负数表示早于已有数据，立方体要向前扩展
+    QTest::addColumn<QVector<int>>("offsets");
+
+    QTest::newRow("single batch") << QVector<int>{ 0 };
+    QTest::newRow("appended in order") << QVector<int>{ 0, 20, 45 };
+    QTest::newRow("earlier batch") << QVector<int>{ 0, -30 };
+    QTest::newRow("overlapping and earlier") << QVector<int>{ 10, 0, -5, 40, -60 };
+    QTest::newRow("inside existing range") << QVector<int>{ -20, 30, 5 };
+}
+
+void TestFlowCube::batches()
+{
+    QFETCH(QVector<int>, offsets);
+
+    QRandomGenerator random(42);
+    const int baseDay = 2460000;
+    const int batchDays = 25;
+    FlowStore store;
+    FlowCube cube;
+    for (int offset : offsets) {
+        const int firstRow = store.size();
+        appendRows(store, random, 400, baseDay + offset, batchDays);
+        cube.add(store, firstRow);
+        QVERIFY(cube.isValid());
+        QCOMPARE(cube.rowCount(), qint64(store.size()));
+    }
+
+    const int minDay = *std::min_element(store.dayNumbers().constBegin(), store.dayNumbers().constEnd());
+    const int maxDay = *std::max_element(store.dayNumbers().constBegin(), store.dayNumbers().constEnd());
+    QCOMPARE(cube.firstDay(), minDay);
+    QCOMPARE(cube.lastDay(), maxDay);
+
+    for (int query = 0; query < 300; ++query) {
+        // 查询范围可以越过数据的两端，也可以为空（起点晚于终点）
+        const int startDay = minDay - 5 + random.bounded(maxDay - minDay + 10);
+        const int endDay = startDay - 2 + random.bounded(40);
+        const int hour = random.bounded(3) == 0 ? int(FlowCube::AllHours) : random.bounded(25) - 1;
+        const int stationId = 1000 + random.bounded(7);    // 1006没有数据
+
+        compareTotals(cube.total(startDay, endDay, hour), scan(store, QVector<int>(), startDay, endDay, hour));
+        compareTotals(cube.station(stationId, startDay, endDay, hour),
+                      scan(store, QVector<int>{ stationId }, startDay, endDay, hour));
+        const QVector<int> stationIds{ stationId, 1000 + (stationId + 1) % 6 };
+        compareTotals(cube.stations(stationIds, startDay, endDay, hour),
+                      scan(store, stationIds, startDay, endDay, hour));
+        if (QTest::currentTestFailed()) {
+            qWarning() << "query" << startDay << endDay << hour << stationId;
+            return;
+        }
+    }
+
+    // 全部日期和全天的合计等于整个存储
+    compareTotals(cube.total(minDay, maxDay), scan(store, QVector<int>(), minDay, maxDay, FlowCube::AllHours));
+}
+
+void TestFlowCube::emptyAndOutOfRange()
+{
+    FlowCube cube;
+    QVERIFY(cube.isValid());
+    QVERIFY(cube.firstDay() > cube.lastDay());
+    QCOMPARE(cube.total(0, INT_MAX / 2).rows, qint64(0));
+
+    FlowStore store;
+    QRandomGenerator random(1);
+    appendRows(store, random, 50, 2460000, 3);
+    cube.add(store);
+    QCOMPARE(cube.total(2459000, 2459999).rows, qint64(0));
+    QCOMPARE(cube.total(2460003, 2461000).rows, qint64(0));
+    QCOMPARE(cube.total(2460000, 2460002, -2).rows, qint64(0));
+    QCOMPARE(cube.total(2460000, 2460002, FlowCube::AllHours + 1).rows, qint64(0));
+    QCOMPARE(cube.station(999, 2460000, 2460002).rows, qint64(0));
+    QCOMPARE(cube.total(2460000, 2460002).rows, qint64(50));
+
+    // 已累加的行不会重复累加
+    cube.add(store, store.size());
+    QCOMPARE(cube.rowCount(), qint64(50));
+}
+
+void TestFlowCube::overBudget()
+{
+    FlowStore store;
+    QRandomGenerator random(2);
+    appendRows(store, random, 100, 2460000, 365);
+
+    FlowCube cube(1024);
+    cube.add(store);
+    QVERIFY(!cube.isValid());
+    QCOMPARE(cube.memoryUsage(), qint64(0));
+
+    // 失效后继续追加也保持失效，调用方回到逐行扫描
+    const int firstRow = store.size();
+    appendRows(store, random, 10, 2460000, 1);
+    cube.add(store, firstRow);
+    QVERIFY(!cube.isValid());
+}
+
+QTEST_APPLESS_MAIN(TestFlowCube)
+#include "tst_flowcube.moc"